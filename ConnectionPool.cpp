@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <ConnectionPool.hpp>
+
+#include <poll.h>
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+PooledSocket::PooledSocket(std::string aOrigin, size_t aCacheSize,
+                           const char* aAddress, const char* aPort, unsigned long aUsecTimeout,
+                           const SocketOptions& aOptions)
+: PooledSocket(std::unique_ptr<char[]>(new char[aCacheSize]), aCacheSize, std::move(aOrigin),
+               aAddress, aPort, aUsecTimeout, aOptions)
+{
+}
+
+PooledSocket::PooledSocket(std::unique_ptr<char[]>&& aCache, size_t aCacheSize, std::string&& aOrigin,
+                           const char* aAddress, const char* aPort, unsigned long aUsecTimeout,
+                           const SocketOptions& aOptions)
+: PlainSocket(aCache.get(), aCacheSize, aAddress, aPort, aUsecTimeout, BLOCKING, aOptions),
+  m_Cache(std::move(aCache)), m_Origin(std::move(aOrigin))
+{
+}
+
+ConnectionPool::ConnectionPool(unsigned long aUsecIdleTimeout, size_t aMaxIdlePerOrigin,
+                               size_t aCacheSize, unsigned long aUsecTimeout, const SocketOptions& aOptions)
+: m_IdleTimeout(std::chrono::microseconds(aUsecIdleTimeout)), m_MaxIdlePerOrigin(aMaxIdlePerOrigin),
+  m_CacheSize(aCacheSize), m_UsecTimeout(aUsecTimeout), m_Options(aOptions)
+{
+}
+
+bool ConnectionPool::isUsable(const PooledSocket& aSocket, Clock::time_point aNow) const
+{
+    if (aNow - aSocket.m_IdleSince >= m_IdleTimeout)
+        return false;
+    // An idle connection must have nothing to read: it's either closed by the peer or
+    // has unexpected data.
+    struct pollfd sPoll{aSocket.fd(), POLLIN | POLLRDHUP, 0};
+    return poll(&sPoll, 1, 0) == 0;
+}
+
+ConnectionPool::Connection ConnectionPool::checkOut(const char* aHost, const char* aPort)
+{
+    std::string sOrigin = std::string(aHost) + ':' + aPort;
+    while (true)
+    {
+        Connection sConnection;
+        {
+            std::lock_guard<std::mutex> sLock(m_Mutex);
+            auto sItr = m_Idle.find(sOrigin);
+            if (sItr == m_Idle.end() || sItr->second.empty())
+                break;
+            sConnection = std::move(sItr->second.back());
+            sItr->second.pop_back();
+            --m_NumIdle;
+        }
+        // Not usable one is closed out of the lock.
+        if (isUsable(*sConnection, Clock::now()))
+        {
+            ++m_Reuses;
+            return sConnection;
+        }
+    }
+    Connection sConnection(new PooledSocket(sOrigin, m_CacheSize, aHost, aPort, m_UsecTimeout, m_Options));
+    ++m_Connects;
+    return sConnection;
+}
+
+void ConnectionPool::checkIn(Connection&& aConnection, bool aKeepAlive)
+{
+    Connection sConnection = std::move(aConnection);
+    // Unread data means that the response was not read to the end.
+    if (sConnection == nullptr || !aKeepAlive || !sConnection->cachedData().first.empty())
+        return;
+    sConnection->m_IdleSince = Clock::now();
+    Connection sEvicted;
+    std::lock_guard<std::mutex> sLock(m_Mutex);
+    std::vector<Connection>& sIdle = m_Idle[sConnection->origin()];
+    if (sIdle.size() >= m_MaxIdlePerOrigin)
+    {
+        if (sIdle.empty())
+            return;
+        sEvicted = std::move(sIdle.front());
+        sIdle.erase(sIdle.begin());
+        --m_NumIdle;
+    }
+    sIdle.push_back(std::move(sConnection));
+    ++m_NumIdle;
+}
+
+size_t ConnectionPool::purge()
+{
+    std::vector<Connection> sEvicted;
+    Clock::time_point sNow = Clock::now();
+    std::lock_guard<std::mutex> sLock(m_Mutex);
+    for (auto sItr = m_Idle.begin(); sItr != m_Idle.end(); )
+    {
+        std::vector<Connection>& sIdle = sItr->second;
+        auto sEnd = std::stable_partition(sIdle.begin(), sIdle.end(),
+                                          [&](const Connection& c) { return isUsable(*c, sNow); });
+        std::move(sEnd, sIdle.end(), std::back_inserter(sEvicted));
+        sIdle.erase(sEnd, sIdle.end());
+        if (sIdle.empty())
+            sItr = m_Idle.erase(sItr);
+        else
+            ++sItr;
+    }
+    m_NumIdle -= sEvicted.size();
+    return sEvicted.size();
+}
+
+void ConnectionPool::clear()
+{
+    std::unordered_map<std::string, std::vector<Connection>> sIdle;
+    std::lock_guard<std::mutex> sLock(m_Mutex);
+    sIdle.swap(m_Idle);
+    m_NumIdle = 0;
+}
+
+size_t ConnectionPool::idle() const
+{
+    std::lock_guard<std::mutex> sLock(m_Mutex);
+    return m_NumIdle;
+}
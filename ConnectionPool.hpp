@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <PlainSocket.hpp>
+
+// Blocking PlainSocket that owns its cache, for ConnectionPool.
+class PooledSocket : public PlainSocket
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Throws NetException, see PlainSocket.
+    PooledSocket(std::string aOrigin, size_t aCacheSize,
+                 const char* aAddress, const char* aPort, unsigned long aUsecTimeout,
+                 const SocketOptions& aOptions = SocketOptions());
+
+    // Key of the pool, "host:port".
+    const std::string& origin() const { return m_Origin; }
+
+    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
+//private:
+
+    PooledSocket(std::unique_ptr<char[]>&& aCache, size_t aCacheSize, std::string&& aOrigin,
+                 const char* aAddress, const char* aPort, unsigned long aUsecTimeout,
+                 const SocketOptions& aOptions);
+
+    std::unique_ptr<char[]> m_Cache;
+    std::string m_Origin;
+    // When it was checked in.
+    Clock::time_point m_IdleSince;
+};
+
+// Pool of idle keep-alive connections per origin (host and port).
+// A connection is checked out for a request, a new one is connected if there's no idle
+// one. After the response is fully read the connection is checked in, and it is kept
+// only if the response allows reuse (see keepAliveFromCache) and nothing is left in
+// the cache. Idle connections are evicted after the idle timeout, when the peer has
+// closed them (that is checked without waiting on check out) or when there are too
+// many of them for an origin (the oldest one goes).
+// Thread safe.
+// Usage:
+//  ConnectionPool sPool;
+//  ConnectionPool::Connection c = sPool.checkOut("example.com", "80");
+//  c->sendOrDie("GET / HTTP/1.1\r\nHost: example.com\r\n\r\n");
+//  KeepAliveHttpResponseParser p;
+//  ... feedFromCache(p, *c, s) ...
+//  bool sKeepAlive = keepAliveFromCache(p, *c, KeepAliveHttpResponseParser::CONNECTION);
+//  ... read the body ...
+//  sPool.checkIn(std::move(c), sKeepAlive);
+class ConnectionPool
+{
+public:
+    using Connection = std::unique_ptr<PooledSocket>;
+
+    static constexpr unsigned long DEFAULT_IDLE_TIMEOUT = 30000000;
+    static constexpr size_t DEFAULT_MAX_IDLE_PER_ORIGIN = 8;
+    static constexpr size_t DEFAULT_CACHE_SIZE = 16 * 1024;
+
+    // aUsecIdleTimeout - how long an idle connection is kept (microseconds);
+    // aCacheSize - size of the cache of each connection;
+    // aUsecTimeout - send/recv and connect timeout of new connections, see SocketBase;
+    // aOptions - TCP tuning of new connections.
+    explicit ConnectionPool(unsigned long aUsecIdleTimeout = DEFAULT_IDLE_TIMEOUT,
+                            size_t aMaxIdlePerOrigin = DEFAULT_MAX_IDLE_PER_ORIGIN,
+                            size_t aCacheSize = DEFAULT_CACHE_SIZE,
+                            unsigned long aUsecTimeout = 0,
+                            const SocketOptions& aOptions = SocketOptions());
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Take an idle connection to the origin or connect a new one. Throws NetException.
+    Connection checkOut(const char* aHost, const char* aPort);
+    // Return the connection after the response is read; it's closed unless aKeepAlive.
+    void checkIn(Connection&& aConnection, bool aKeepAlive);
+
+    // Close idle connections that are expired or closed by peers, return their number.
+    size_t purge();
+    void clear();
+
+    // Number of idle connections.
+    size_t idle() const;
+    // Number of new connections and of check outs of idle ones.
+    size_t connects() const { return m_Connects; }
+    size_t reuses() const { return m_Reuses; }
+
+    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
+//private:
+
+    using Clock = PooledSocket::Clock;
+
+    // Whether an idle connection can be used: it's not expired, the peer has not
+    // closed it and has sent nothing.
+    bool isUsable(const PooledSocket& aSocket, Clock::time_point aNow) const;
+
+    const Clock::duration m_IdleTimeout;
+    const size_t m_MaxIdlePerOrigin;
+    const size_t m_CacheSize;
+    const unsigned long m_UsecTimeout;
+    const SocketOptions m_Options;
+
+    mutable std::mutex m_Mutex;
+    // Idle connections of each origin, the most recently used is the last.
+    std::unordered_map<std::string, std::vector<Connection>> m_Idle;
+    size_t m_NumIdle = 0;
+    std::atomic<size_t> m_Connects{0};
+    std::atomic<size_t> m_Reuses{0};
+};
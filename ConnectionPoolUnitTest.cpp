@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <ConnectionPool.hpp>
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <HttpResponseParser.hpp>
+#include <HttpResponseReader.hpp>
+#include <NetException.hpp>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+std::atomic<size_t> g_Accepted{0};
+
+// Serve requests of a connection: the path selects the response, see below.
+void serve(int s)
+{
+    std::string sRequest;
+    char sBuf[1024];
+    while (true)
+    {
+        size_t sEnd = sRequest.find("\r\n\r\n");
+        if (sEnd == std::string::npos)
+        {
+            ssize_t r = recv(s, sBuf, sizeof(sBuf), 0);
+            if (r <= 0)
+                break;
+            sRequest.append(sBuf, r);
+            continue;
+        }
+        std::string sPath = sRequest.substr(4, sRequest.find(' ', 4) - 4);
+        sRequest.erase(0, sEnd + 4);
+
+        std::string sResponse;
+        if (sPath == "/keep" || sPath == "/bye")
+            sResponse = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nHELLO";
+        else if (sPath == "/close")
+            sResponse = "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 5\r\n\r\nHELLO";
+        else if (sPath == "/old")
+            sResponse = "HTTP/1.0 200 OK\r\nContent-Length: 5\r\n\r\nHELLO";
+        else if (sPath == "/old-keep")
+            sResponse = "HTTP/1.0 200 OK\r\nConnection: Keep-Alive\r\nContent-Length: 5\r\n\r\nHELLO";
+        else
+            sResponse = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+        check(send(s, sResponse.data(), sResponse.size(), MSG_NOSIGNAL) == ssize_t(sResponse.size()), "send");
+        // Keep-alive is allowed, but the server closes the connection soon.
+        if (sPath == "/close" || sPath == "/bye")
+            break;
+    }
+    close(s);
+}
+
+void server(int aListen)
+{
+    while (true)
+    {
+        int s = accept(aListen, nullptr, nullptr);
+        if (s < 0)
+            break;
+        ++g_Accepted;
+        std::thread(serve, s).detach();
+    }
+}
+
+// Make a request with a connection of the pool, return whether the connection was new.
+bool fetch(ConnectionPool& aPool, const char* aPort, const char* aPath, size_t aExtraBytes = 0)
+{
+    size_t sConnects = aPool.connects();
+    ConnectionPool::Connection c = aPool.checkOut("127.0.0.1", aPort);
+    c->sendOrDie("GET ", std::string_view(aPath), " HTTP/1.1\r\nHost: localhost\r\n\r\n");
+
+    KeepAliveHttpResponseParser p;
+    HttpResponseParser::status_t res = 0;
+    size_t sHeaderSize = feedFromCache(p, *c, res);
+    while (res == 0)
+    {
+        bool sShutDown = true;
+        c->recvSome(1, sShutDown);
+        sHeaderSize = feedFromCache(p, *c, res);
+    }
+    check(res == HttpResponseParser::SUCCESS, "Not success");
+    bool sKeepAlive = keepAliveFromCache(p, *c, KeepAliveHttpResponseParser::CONNECTION);
+    c->dropCache(sHeaderSize);
+    std::string sBody(p.contentLength() - aExtraBytes, '\0');
+    c->recvOrDie(sBody);
+    // Leave the rest of the body in the cache.
+    while (c->cachedData().first.size() < aExtraBytes)
+    {
+        bool sShutDown = true;
+        c->recvSome(1, sShutDown);
+    }
+    aPool.checkIn(std::move(c), sKeepAlive);
+    return aPool.connects() != sConnects;
+}
+
+void test_reuse(const char* aPort)
+{
+    ConnectionPool sPool;
+    size_t sAccepted = g_Accepted;
+    check(fetch(sPool, aPort, "/keep"), "Not a new connection");
+    for (size_t i = 0; i < 5; i++)
+        check(!fetch(sPool, aPort, "/keep"), "Not reused");
+    check(sPool.connects() == 1 && sPool.reuses() == 5 && sPool.idle() == 1, "Wrong stats");
+
+    // Connection: close.
+    check(!fetch(sPool, aPort, "/close"), "Not reused");
+    check(sPool.idle() == 0, "Closed connection is kept");
+    check(fetch(sPool, aPort, "/keep"), "Not a new connection");
+
+    // HTTP/1.0 is persistent only with Connection: keep-alive.
+    check(!fetch(sPool, aPort, "/old"), "Not reused");
+    check(fetch(sPool, aPort, "/old-keep"), "Not a new connection");
+    check(!fetch(sPool, aPort, "/keep"), "Not reused");
+
+    // The response is not read to the end.
+    check(!fetch(sPool, aPort, "/keep", 2), "Not reused");
+    check(sPool.idle() == 0, "Unread connection is kept");
+    check(fetch(sPool, aPort, "/keep"), "Not a new connection");
+
+    // Closed by the server while idle.
+    check(!fetch(sPool, aPort, "/bye"), "Not reused");
+    check(sPool.idle() == 1, "Keep-alive connection is not kept");
+    usleep(50000);
+    check(fetch(sPool, aPort, "/keep"), "Not a new connection");
+    check(sPool.idle() == 1, "Wrong stats");
+
+    check(sPool.connects() == 5, "Wrong number of connects");
+    check(g_Accepted - sAccepted == sPool.connects(), "Wrong number of accepted connections");
+}
+
+void test_idle(const char* aPort)
+{
+    ConnectionPool sPool(100000, 2);
+    fetch(sPool, aPort, "/keep");
+    usleep(150000);
+    check(fetch(sPool, aPort, "/keep"), "Expired connection is used");
+
+    // Too many idle connections.
+    std::vector<ConnectionPool::Connection> sConnections;
+    for (size_t i = 0; i < 3; i++)
+        sConnections.push_back(sPool.checkOut("127.0.0.1", aPort));
+    check(sPool.idle() == 0 && sPool.connects() == 4, "Wrong stats");
+    for (auto& c : sConnections)
+        sPool.checkIn(std::move(c), true);
+    check(sPool.idle() == 2, "Too many idle connections");
+
+    // Purge of expired and closed connections.
+    check(sPool.purge() == 0, "Purged alive connections");
+    check(!fetch(sPool, aPort, "/bye"), "Not reused");
+    usleep(50000);
+    check(sPool.purge() == 1 && sPool.idle() == 1, "Closed connection is not purged");
+    usleep(150000);
+    check(sPool.purge() == 1 && sPool.idle() == 0, "Expired connection is not purged");
+}
+
+void test_move(const char* aPort)
+{
+    char sCache[64];
+    std::vector<PlainSocket> sSockets;
+    sSockets.emplace_back(sCache, "127.0.0.1", aPort);
+    int sFd = sSockets.front().fd();
+    sSockets.reserve(100);
+    check(sSockets.front().fd() == sFd, "Wrong moved socket");
+    sSockets.front().sendOrDie("GET /keep HTTP/1.1\r\n\r\n");
+    char sResponse[43];
+    sSockets.front().recvOrDie(sResponse);
+    check(std::string_view(sResponse, sizeof(sResponse)).substr(38) == "HELLO", "Wrong response");
+}
+
+int main()
+{
+    try
+    {
+        int sListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        check(sListen >= 0, "socket");
+        struct sockaddr_in sAddr{};
+        sAddr.sin_family = AF_INET;
+        sAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t sAddrLen = sizeof(sAddr);
+        check(bind(sListen, (sockaddr*)&sAddr, sizeof(sAddr)) == 0, "bind");
+        check(listen(sListen, 16) == 0, "listen");
+        check(getsockname(sListen, (sockaddr*)&sAddr, &sAddrLen) == 0, "getsockname");
+        std::string sPort = std::to_string(ntohs(sAddr.sin_port));
+
+        std::thread srv(server, sListen);
+        test_reuse(sPort.c_str());
+        test_idle(sPort.c_str());
+        test_move(sPort.c_str());
+        shutdown(sListen, SHUT_RDWR);
+        srv.join();
+        close(sListen);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const NetException& e)
+    {
+        std::cerr << e.what() << ": " << e.how() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Well done!" << std::endl;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <DynamicHttpResponseParser.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+#include <HttpResponseStateMachine.hpp>
+
+namespace
+{
+    using Conditions = HttpResponseParserBase::Conditions;
+    using CompactTransition = HttpResponseParserBase::CompactTransition;
+
+    void checkName(std::string_view aName)
+    {
+        if (aName.empty())
+            throw std::invalid_argument("empty header name");
+        for (unsigned char c : aName)
+            if (c <= ' ' || c >= 127 || c == ':')
+                throw std::invalid_argument("invalid character in header name");
+    }
+
+    // The same name twice would make the first fragment unreachable.
+    void checkUnique(const std::string_view* aNames, size_t aCount)
+    {
+        for (size_t i = 0; i < aCount; i++)
+            for (size_t j = 0; j < i; j++)
+                if (details::equalHeaderNames(aNames[i], aNames[j]))
+                    throw std::invalid_argument("duplicate header name");
+    }
+} // namespace {
+
+DynamicHttpResponseParser::Machine::Machine(const std::string_view* aNames, size_t aCount)
+{
+    std::for_each(aNames, aNames + aCount, checkName);
+    checkUnique(aNames, aCount);
+    m_HeaderNames.assign(aNames, aNames + aCount);
+    m_ContentLengthFragment = SPECIAL_MAX + details::findContentLength(aNames, aCount);
+
+    // Full state machine, that is used only during construction of the compact one.
+    details::RuntimeStateMachine sWide;
+    sWide.m_Conditions.resize(details::maxNumConditions(aNames, aCount));
+    sWide.m_NumConditions = details::buildStateMachine(sWide, aNames, aCount);
+    m_NumConditions = sWide.m_NumConditions;
+
+    uint8_t sClasses[Conditions::NUM_TRANSITIONS];
+    unsigned char sClassBytes[Conditions::NUM_TRANSITIONS];
+    m_NumClasses = details::buildByteClasses(sWide, sClasses, sClassBytes);
+
+    if (numTags() > UINT8_MAX || m_NumConditions * m_NumClasses > UINT16_MAX)
+        throw std::invalid_argument("too many headers");
+
+    // Class map first, it's size is a multiple of transition alignment.
+    static_assert(sizeof(sClasses) % alignof(CompactTransition) == 0, "Wrong alignment");
+    size_t sNumTransitions = m_NumConditions * m_NumClasses;
+    m_Memory.reset(new char[sizeof(sClasses) + sNumTransitions * sizeof(CompactTransition)]);
+    uint8_t* sMapMemory = reinterpret_cast<uint8_t*>(m_Memory.get());
+    CompactTransition* sTransitions = reinterpret_cast<CompactTransition*>(m_Memory.get() + sizeof(sClasses));
+    std::copy(sClasses, sClasses + sizeof(sClasses), sMapMemory);
+    std::uninitialized_default_construct_n(sTransitions, sNumTransitions);
+    details::buildCompactTransitions(sWide, sClassBytes, m_NumClasses, sTransitions);
+
+    m_Classes = sMapMemory;
+    m_Transitions = sTransitions;
+}
+
+DynamicHttpResponseParser::Machine::Machine(const std::vector<std::string_view>& aNames)
+: Machine(aNames.data(), aNames.size())
+{
+}
+
+HttpResponseParserBase::fragment_t DynamicHttpResponseParser::Machine::header(std::string_view aName) const
+{
+    auto sItr = std::find(m_HeaderNames.begin(), m_HeaderNames.end(), aName);
+    return SPECIAL_MAX + (sItr - m_HeaderNames.begin());
+}
+
+size_t DynamicHttpResponseParser::Machine::footprint() const
+{
+    return Conditions::NUM_TRANSITIONS + m_NumConditions * m_NumClasses * sizeof(CompactTransition);
+}
+
+std::string DynamicHttpResponseParser::Machine::profileReport(size_t aTop) const
+{
+    std::vector<std::string_view> sNames(m_HeaderNames.begin(), m_HeaderNames.end());
+    return HttpResponseParserProfile::report(this, sNames.data(), sNames.size(), aTop);
+}
+
+DynamicHttpResponseParser::DynamicHttpResponseParser(const Machine& aMachine)
+: m_Machine(aMachine), m_SavedTagOffsets(new size_t[aMachine.numTags()]())
+{
+}
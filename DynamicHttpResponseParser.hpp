@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <HttpResponseParserBase.hpp>
+
+// The same parser as BasicHttpResponseParser, but the set of headers to store
+// is given in runtime (for instance, is read from a configuration file).
+// The state machine is built once (see DynamicHttpResponseParser::Machine) and then
+// can be shared by any number of parsers; parsing is done by exactly the same code
+// as in BasicHttpResponseParser, so the speed is the same.
+
+class DynamicHttpResponseParser : public HttpResponseParserBase
+{
+public:
+    // Compact state machine built in runtime for the given header names
+    // (case insensitive, visible characters only).
+    // The byte class map and the transition table are stored in one allocation.
+    class Machine
+    {
+    public:
+        // Throws std::invalid_argument if a name is invalid or repeated, or the set is too large.
+        Machine(const std::string_view* aNames, size_t aCount);
+        explicit Machine(const std::vector<std::string_view>& aNames);
+
+        Machine(const Machine&) = delete;
+        Machine& operator=(const Machine&) = delete;
+
+        // Number of stored headers.
+        size_t numHeaders() const { return m_HeaderNames.size(); }
+        // Header-value fragments follow special fragments in the order of given names.
+        fragment_t headerMax() const { return SPECIAL_MAX + m_HeaderNames.size(); }
+        // Get fragment ID of a header by its name (headerMax() if there's no such header).
+        fragment_t header(std::string_view aName) const;
+        // Total number of tags.
+        size_t numTags() const { return headerMax() * 2 + 1; }
+        // Fragment of Content-Length header, headerMax() if it's not stored.
+        fragment_t contentLengthFragment() const { return m_ContentLengthFragment; }
+
+        state_t numConditions() const { return m_NumConditions; }
+        size_t numClasses() const { return m_NumClasses; }
+        // Size of the memory that is used during parsing.
+        size_t footprint() const;
+        // Report of the profile, see GenericHttpResponseParser::profileReport.
+        std::string profileReport(size_t aTop = 20) const;
+
+        const uint8_t* classes() const { return m_Classes; }
+        const CompactTransition* transitions() const { return m_Transitions; }
+        const CompactTransition& get(state_t s, unsigned char c) const { return m_Transitions[s + m_Classes[c]]; }
+
+    private:
+        std::vector<std::string> m_HeaderNames;
+        fragment_t m_ContentLengthFragment;
+        state_t m_NumConditions;
+        size_t m_NumClasses;
+        std::unique_ptr<char[]> m_Memory;
+        const uint8_t* m_Classes;
+        const CompactTransition* m_Transitions;
+    };
+
+    // The machine must outlive the parser.
+    explicit DynamicHttpResponseParser(const Machine& aMachine);
+
+    // See BasicHttpResponseParser for description of the methods below.
+    inline status_t feed(char c);
+    inline size_t feed(const char* aBegin, const char* aEnd, status_t& aStatus);
+    inline size_t feed(std::string_view aData, status_t& aStatus);
+    inline size_t feed(const char* aBegin, const char* aEnd, status_t& aStatus, Limits& aLimits);
+    inline size_t feed(std::string_view aData, status_t& aStatus, Limits& aLimits);
+    inline size_t count() const;
+    inline void reset();
+    inline void restart(size_t aSkip = 0);
+    inline bool isFragmentFound(fragment_t aFragment) const;
+    inline std::pair<size_t, size_t> getFragment(fragment_t aFragment) const;
+    inline std::string_view getFragmentStr(std::string_view sInput, fragment_t aFragment) const;
+    inline std::pair<std::string_view, std::string_view>
+    getFragmentStr(std::string_view aFirst, std::string_view aSecond, fragment_t aFragment) const;
+    inline uint64_t statusCode() const;
+    inline uint64_t contentLength() const;
+
+    const Machine& machine() const { return m_Machine; }
+
+private:
+    const Machine& m_Machine;
+
+    // Variables of parsing state.
+    // State in compact state machine (offset of its row).
+    state_t m_CurrentState = 0;
+    // Number of characters that was consumed.
+    size_t m_CurrentPos = 0;
+    // Saved tag positions, m_Machine.numTags() of them.
+    std::unique_ptr<size_t[]> m_SavedTagOffsets;
+    // Calculated numbers.
+    Numbers m_Numbers;
+};
+
+//////////////////////////////////// IMPLEMENTATION ////////////////////////////////////
+HttpResponseParserBase::status_t DynamicHttpResponseParser::feed(char c)
+{
+    return feedImpl(m_Machine, m_CurrentState, m_CurrentPos, m_SavedTagOffsets, m_Numbers, c);
+}
+
+size_t DynamicHttpResponseParser::feed(const char* aBegin, const char* aEnd, status_t& aStatus)
+{
+    return feedImpl(m_Machine, m_CurrentState, m_CurrentPos, m_SavedTagOffsets, m_Numbers,
+                    aBegin, aEnd, aStatus);
+}
+
+size_t DynamicHttpResponseParser::feed(std::string_view aData, status_t& aStatus)
+{
+    return feed(aData.data(), aData.data() + aData.size(), aStatus);
+}
+
+size_t DynamicHttpResponseParser::feed(const char* aBegin, const char* aEnd, status_t& aStatus, Limits& aLimits)
+{
+    return limitedFeedImpl(m_Machine, m_CurrentState, m_CurrentPos, m_SavedTagOffsets, m_Numbers, aLimits,
+                           aBegin, aEnd, aStatus);
+}
+
+size_t DynamicHttpResponseParser::feed(std::string_view aData, status_t& aStatus, Limits& aLimits)
+{
+    return feed(aData.data(), aData.data() + aData.size(), aStatus, aLimits);
+}
+
+size_t DynamicHttpResponseParser::count() const
+{
+    return m_CurrentPos;
+}
+
+void DynamicHttpResponseParser::reset()
+{
+    m_CurrentState = 0;
+    m_CurrentPos = 0;
+    std::fill(m_SavedTagOffsets.get(), m_SavedTagOffsets.get() + m_Machine.numTags(), 0);
+    m_Numbers.reset();
+}
+
+void DynamicHttpResponseParser::restart(size_t aSkip)
+{
+    restartImpl(m_CurrentState, m_CurrentPos, m_SavedTagOffsets, m_Numbers, aSkip);
+}
+
+bool DynamicHttpResponseParser::isFragmentFound(fragment_t aFragment) const
+{
+    // See BasicHttpResponseParser::isFragmentFound.
+    return m_SavedTagOffsets[tagEnd(aFragment)] > m_SavedTagOffsets[tagBegin(MAJOR_VERSION)];
+}
+
+std::pair<size_t, size_t> DynamicHttpResponseParser::getFragment(fragment_t aFragment) const
+{
+    if (!isFragmentFound(aFragment))
+        return {0, 0};
+    size_t b =  m_SavedTagOffsets[tagBegin(aFragment)];
+    size_t e = m_SavedTagOffsets[tagEnd(aFragment)];
+    return {b, e};
+}
+
+std::string_view DynamicHttpResponseParser::getFragmentStr(std::string_view sInput, fragment_t aFragment) const
+{
+    auto [b, e] = getFragment(aFragment);
+    return sInput.substr(b, e - b);
+}
+
+std::pair<std::string_view, std::string_view>
+DynamicHttpResponseParser::getFragmentStr(std::string_view aFirst, std::string_view aSecond, fragment_t aFragment) const
+{
+    auto [b, e] = getFragment(aFragment);
+    return splitFragmentImpl(aFirst, aSecond, b, e);
+}
+
+uint64_t DynamicHttpResponseParser::statusCode() const
+{
+    return m_Numbers.m_Values[STATUS_CODE_NUMBER];
+}
+
+uint64_t DynamicHttpResponseParser::contentLength() const
+{
+    if (m_Machine.contentLengthFragment() == m_Machine.headerMax())
+        return INVALID_NUMBER;
+    return m_Numbers.m_Values[CONTENT_LENGTH_NUMBER];
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <DynamicHttpResponseParser.hpp>
+
+#include <assert.h>
+
+#include <iostream>
+#include <stdexcept>
+
+#include <HttpResponseParser.hpp>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+void test_same_table()
+{
+    using Static = HttpResponseParser;
+    DynamicHttpResponseParser::Machine m(std::vector<std::string_view>(Static::HeaderNames.begin(), Static::HeaderNames.end()));
+
+    check(m.numHeaders() == Static::NUM_HEADERS, "Wrong number of headers");
+    check(m.headerMax() == Static::HEADER_MAX, "Wrong number of fragments");
+    check(m.numTags() == Static::NUM_TAGS, "Wrong number of tags");
+    check(m.numConditions() == Static::NUM_CONDITIONS, "Wrong number of states");
+    check(m.numClasses() == Static::NUM_CLASSES, "Wrong number of classes");
+    check(m.footprint() == Static::TheCompactStateMachine.footprint(), "Wrong footprint");
+    check(m.header(HttpHeaderName::LOCATION) == Static::LOCATION, "Wrong header ID");
+    check(m.header("Unknown") == m.headerMax(), "Unknown header was found");
+
+    const auto& sTable = Static::TheCompactStateMachine;
+    check(std::equal(sTable.m_Classes.begin(), sTable.m_Classes.end(), m.classes()), "Different classes");
+    check(std::equal(sTable.m_Transitions.begin(), sTable.m_Transitions.end(), m.transitions(),
+                     [](const auto& a, const auto& b)
+                     {
+                         return a.m_State == b.m_State && a.m_Tag == b.m_Tag && a.m_Status == b.m_Status &&
+                                a.m_Number == b.m_Number;
+                     }),
+          "Different transitions");
+}
+
+void test_parse(const DynamicHttpResponseParser::Machine& m, std::string_view resp,
+                HttpResponseParserBase::status_t expected,
+                HttpResponseParserBase::fragment_t fragment, std::string_view value)
+{
+    DynamicHttpResponseParser p(m);
+    HttpResponseParserBase::status_t res = 0;
+    size_t sFed = p.feed(resp, res);
+    check(res == expected, "Wrong result");
+    if (res != HttpResponseParserBase::SUCCESS)
+        return;
+    check(sFed == resp.size(), "Not all data was fed");
+    check(p.isFragmentFound(fragment) == !value.empty(), "Wrong found state");
+    check(p.getFragmentStr(resp, fragment) == value, "Wrong value");
+
+    p.reset();
+    res = 0;
+    for (char c : resp)
+        if ((res = p.feed(c)) != 0)
+            break;
+    check(res == HttpResponseParserBase::SUCCESS, "Not success after reset");
+    check(p.count() == resp.size(), "Not all data was fed after reset");
+    check(p.getFragmentStr(resp, fragment) == value, "Wrong value after reset");
+}
+
+void test_configured()
+{
+    std::vector<std::string> sConfig = {"ETag", "X-Request-Id", "Connection", "X-Request"};
+    std::vector<std::string_view> sNames(sConfig.begin(), sConfig.end());
+    DynamicHttpResponseParser::Machine m(sNames);
+    sConfig.clear();
+
+    std::string_view resp = "HTTP/1.1 200 OK\r\nx-request-id: 42\r\nX-Request: 7\r\nETAG:\"x\"\r\n\r\n";
+    test_parse(m, resp, HttpResponseParserBase::SUCCESS, m.header("X-Request-Id"), "42");
+    test_parse(m, resp, HttpResponseParserBase::SUCCESS, m.header("X-Request"), "7");
+    test_parse(m, resp, HttpResponseParserBase::SUCCESS, m.header("ETag"), "\"x\"");
+    test_parse(m, resp, HttpResponseParserBase::SUCCESS, m.header("Connection"), "");
+    test_parse(m, resp, HttpResponseParserBase::SUCCESS, HttpResponseParserBase::STATUS_CODE, "200");
+    test_parse(m, "HTTP/1.1 2000 OK\r\n\r\n", HttpResponseParserBase::ERROR_WRONG_LENGTH_OF_STATUS_CODE, 0, "");
+    test_parse(m, "HTTP/1.a 200 OK\r\n\r\n", HttpResponseParserBase::ERROR_NOT_A_DIGIT_MINOR_VERSION, 0, "");
+
+    DynamicHttpResponseParser::Machine c({"ETag", "content-LENGTH"});
+    check(c.contentLengthFragment() == c.header("content-LENGTH"), "Wrong Content-Length fragment");
+    DynamicHttpResponseParser pc(c);
+    HttpResponseParserBase::status_t res = 0;
+    pc.feed("HTTP/1.1 206 Partial\r\nContent-Length: 31337\r\n\r\n", res);
+    check(res == HttpResponseParserBase::SUCCESS, "Not success");
+    check(pc.statusCode() == 206, "Wrong status code");
+    check(pc.contentLength() == 31337, "Wrong content length");
+    DynamicHttpResponseParser pm(m);
+    pm.feed(resp, res);
+    check(pm.contentLength() == HttpResponseParserBase::INVALID_NUMBER, "Content-Length is not stored");
+
+    DynamicHttpResponseParser::Machine e(nullptr, 0);
+    check(e.header("ETag") == HttpResponseParserBase::SPECIAL_MAX, "Unknown header was found");
+    test_parse(e, resp, HttpResponseParserBase::SUCCESS, HttpResponseParserBase::REASON_PHRASE, "OK");
+}
+
+void test_invalid()
+{
+    auto sThrows = [](std::vector<std::string_view> aNames)
+    {
+        try
+        {
+            DynamicHttpResponseParser::Machine m(aNames);
+        }
+        catch (const std::invalid_argument&)
+        {
+            return true;
+        }
+        return false;
+    };
+
+    check(sThrows({"ETag", ""}), "Empty name was accepted");
+    check(sThrows({"E Tag"}), "Space was accepted");
+    check(sThrows({"ETag:"}), "Colon was accepted");
+    check(sThrows({"ETag\377"}), "Invisible character was accepted");
+    check(sThrows({"ETag", "Server", "etag"}), "Duplicate name was accepted");
+    check(!sThrows({"ETag", "ETags"}), "Prefix was rejected as a duplicate");
+    std::vector<std::string> sMany;
+    for (size_t i = 0; i < 200; i++)
+        sMany.push_back("X" + std::to_string(i));
+    check(sThrows(std::vector<std::string_view>(sMany.begin(), sMany.end())), "Too many headers were accepted");
+}
+
+void test_limits()
+{
+    DynamicHttpResponseParser::Machine m(std::vector<std::string_view>{"Server"});
+    const std::string_view resp = "HTTP/1.1 200 OK\r\nServer: x\r\nDate: today\r\n\r\n";
+    for (size_t sMaxHeaders : {1, 2})
+    {
+        DynamicHttpResponseParser p(m);
+        DynamicHttpResponseParser::Limits sLimits(0, 0, sMaxHeaders);
+        DynamicHttpResponseParser::status_t res = 0;
+        size_t sEaten = p.feed(resp, res, sLimits);
+        if (sMaxHeaders == 1)
+            check(res == HttpResponseParserBase::ERROR_TOO_MANY_HEADERS && sEaten == 30, "Limit was not applied");
+        else
+            check(res == HttpResponseParserBase::SUCCESS && sEaten == resp.size(), "Wrong limit was applied");
+    }
+}
+
+void test_restart()
+{
+    // Position is not limited, the same as for HttpResponseParser: a stream of pipelined
+    // responses may go over 4GB.
+    DynamicHttpResponseParser::Machine m(std::vector<std::string_view>{"Server"});
+    const std::string_view resp = "HTTP/1.1 200 OK\r\nServer: x\r\n\r\n";
+    const size_t sSkip = size_t(UINT32_MAX) + 1;
+    DynamicHttpResponseParser p(m);
+    DynamicHttpResponseParser::status_t res = 0;
+    p.restart(sSkip);
+    check(p.feed(resp, res) == resp.size() && res == HttpResponseParserBase::SUCCESS, "Not success after restart");
+    check(p.count() == sSkip + resp.size(), "Wrong count after restart");
+    check(p.getFragment(m.header("Server")).first == sSkip + 25, "Wrong fragment after restart");
+}
+
+int main()
+{
+    try
+    {
+        test_same_table();
+        test_configured();
+        test_invalid();
+        test_limits();
+        test_restart();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Well done!" << std::endl;
+}
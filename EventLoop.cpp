@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <EventLoop.hpp>
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <NetException.hpp>
+
+EventLoop::EventLoop(size_t aMaxEvents)
+: m_Fd(epoll_create1(EPOLL_CLOEXEC)), m_Events(aMaxEvents)
+{
+    if (m_Fd < 0)
+        throw NetException("epoll_create1 failed", errno);
+}
+
+EventLoop::~EventLoop() noexcept
+{
+    close(m_Fd);
+}
+
+uint32_t EventLoop::toEpoll(uint32_t aEvents)
+{
+    return ((aEvents & READ) ? uint32_t(EPOLLIN | EPOLLRDHUP) : 0) | ((aEvents & WRITE) ? uint32_t(EPOLLOUT) : 0);
+}
+
+uint32_t EventLoop::fromEpoll(uint32_t aEvents)
+{
+    // Hang up of the peer's side is reported as readability: there's EOF to read.
+    return ((aEvents & (EPOLLIN | EPOLLRDHUP)) ? uint32_t(READ) : 0) |
+           ((aEvents & EPOLLOUT) ? uint32_t(WRITE) : 0) |
+           ((aEvents & (EPOLLERR | EPOLLHUP)) ? uint32_t(CLOSED) : 0);
+}
+
+void EventLoop::addImpl(int aFd, uint32_t aEvents, callback_t aCallback, void* aHandler)
+{
+    epoll_event sEvent{};
+    sEvent.events = toEpoll(aEvents);
+    sEvent.data.fd = aFd;
+    if (0 != epoll_ctl(m_Fd, EPOLL_CTL_ADD, aFd, &sEvent))
+        throw NetException("epoll_ctl failed", errno);
+    if (size_t(aFd) >= m_Registrations.size())
+        m_Registrations.resize(aFd + 1);
+    m_Registrations[aFd] = Registration{aCallback, aHandler};
+    ++m_Size;
+}
+
+void EventLoop::modify(int aFd, uint32_t aEvents)
+{
+    epoll_event sEvent{};
+    sEvent.events = toEpoll(aEvents);
+    sEvent.data.fd = aFd;
+    if (0 != epoll_ctl(m_Fd, EPOLL_CTL_MOD, aFd, &sEvent))
+        throw NetException("epoll_ctl failed", errno);
+}
+
+void EventLoop::remove(int aFd)
+{
+    if (size_t(aFd) >= m_Registrations.size() || m_Registrations[aFd].m_Callback == nullptr)
+        return;
+    epoll_ctl(m_Fd, EPOLL_CTL_DEL, aFd, nullptr);
+    m_Registrations[aFd] = Registration{};
+    --m_Size;
+}
+
+size_t EventLoop::runOnce(int aMsecTimeout)
+{
+    int sCount;
+    do
+    {
+        sCount = epoll_wait(m_Fd, m_Events.data(), m_Events.size(), aMsecTimeout);
+    } while (sCount < 0 && errno == EINTR);
+    if (sCount < 0)
+        throw NetException("epoll_wait failed", errno);
+
+    size_t sHandled = 0;
+    for (int i = 0; i < sCount; i++)
+    {
+        int sFd = m_Events[i].data.fd;
+        // The handler could be removed by a previous one in this round.
+        Registration sReg = m_Registrations[sFd];
+        if (sReg.m_Callback == nullptr)
+            continue;
+        sReg.m_Callback(sReg.m_Handler, fromEpoll(m_Events[i].events));
+        ++sHandled;
+    }
+    return sHandled;
+}
+
+void EventLoop::run()
+{
+    m_Stopped = false;
+    while (m_Size != 0 && !m_Stopped)
+        runOnce();
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <sys/epoll.h>
+
+#include <cstdint>
+#include <vector>
+
+// Reactor that drives many non-blocking sockets (see SocketBase::NON_BLOCKING) from
+// one thread with epoll. A handler is registered for a file descriptor with a set of
+// interesting events and is called with the events that have happened.
+// Events are level-triggered: an event is reported again until it is handled (data
+// is read etc), so a handler may do one step per call.
+// A handler may add, modify and remove any registrations, including its own. It must
+// tolerate spurious events, that are possible if a descriptor is closed and reused
+// by another one in the same round of dispatching.
+// Usage:
+//  struct Download { void onEvent(uint32_t aEvents); PlainSocket m_Socket; ... };
+//  EventLoop sLoop;
+//  sLoop.add(sDownload.m_Socket.fd(), EventLoop::WRITE, sDownload); // Wait for connect.
+//  sLoop.run(); // Until all handlers remove themselves.
+
+class EventLoop
+{
+public:
+    enum event_t : uint32_t
+    {
+        READ = 1,
+        WRITE = 2,
+        // Error or hang up, it is reported even if not requested.
+        CLOSED = 4,
+    };
+
+    // Throws NetException.
+    // aMaxEvents is the number of events that are fetched from the kernel at once.
+    explicit EventLoop(size_t aMaxEvents = 256);
+    ~EventLoop() noexcept;
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // Register a handler of events aEvents (event_t mask) of the descriptor, it is called
+    // as aHandler.onEvent(uint32_t aEvents). The handler must outlive the registration.
+    // Throws NetException.
+    template <class HANDLER>
+    void add(int aFd, uint32_t aEvents, HANDLER& aHandler);
+    // Change the set of interesting events. Throws NetException.
+    void modify(int aFd, uint32_t aEvents);
+    // Unregister the descriptor, must be done before it is closed.
+    void remove(int aFd);
+    // Number of registered descriptors.
+    size_t size() const { return m_Size; }
+
+    // Wait for events (at most aMsecTimeout milliseconds, -1 means forever) and call
+    // their handlers. Return the number of handled events. Throws NetException.
+    size_t runOnce(int aMsecTimeout = -1);
+    // Call runOnce until there are no registered descriptors or stop is called.
+    void run();
+    // Make run return after the current round, to be called by a handler.
+    void stop() { m_Stopped = true; }
+
+
+    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
+//private:
+
+    using callback_t = void (*)(void* aHandler, uint32_t aEvents);
+    struct Registration
+    {
+        callback_t m_Callback = nullptr;
+        void* m_Handler = nullptr;
+    };
+
+    void addImpl(int aFd, uint32_t aEvents, callback_t aCallback, void* aHandler);
+    // Convert event_t mask to epoll events and back.
+    static uint32_t toEpoll(uint32_t aEvents);
+    static uint32_t fromEpoll(uint32_t aEvents);
+
+    int m_Fd;
+    size_t m_Size = 0;
+    bool m_Stopped = false;
+    // Registrations by descriptors, that are small numbers.
+    std::vector<Registration> m_Registrations;
+    std::vector<epoll_event> m_Events;
+};
+
+//////////////////////////////////// IMPLEMENTATION ////////////////////////////////////
+template <class HANDLER>
+void EventLoop::add(int aFd, uint32_t aEvents, HANDLER& aHandler)
+{
+    callback_t sCallback = [](void* aPtr, uint32_t aHappened) { static_cast<HANDLER*>(aPtr)->onEvent(aHappened); };
+    addImpl(aFd, aEvents, sCallback, &aHandler);
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <EventLoop.hpp>
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <NetException.hpp>
+#include <PlainSocket.hpp>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+// Echo server and clients are driven by the same loop in one thread.
+constexpr size_t NUM_CLIENTS = 500;
+// Size of data that a client sends in the bulk test, much more than socket buffers.
+constexpr size_t BULK_SIZE = 16 * 1024 * 1024;
+
+// Server side of a connection: echoes lines, in bulk mode answers "OK\n" after BULK_SIZE bytes.
+struct Connection
+{
+    Connection(EventLoop& aLoop, int aFd) : m_Loop(aLoop), m_Fd(aFd)
+    {
+        m_Loop.add(m_Fd, EventLoop::READ, *this);
+    }
+    ~Connection()
+    {
+        close(m_Fd);
+    }
+
+    void onEvent(uint32_t)
+    {
+        char sBuf[4096];
+        ssize_t r = recv(m_Fd, sBuf, sizeof(sBuf), 0);
+        if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (r <= 0)
+        {
+            m_Loop.remove(m_Fd);
+            m_Closed = true;
+            return;
+        }
+        m_Received += r;
+        if (sBuf[0] == 'B')
+            m_Bulk = true;
+        // Small answers always fit in the socket buffer.
+        if (!m_Bulk)
+            check(send(m_Fd, sBuf, r, MSG_NOSIGNAL) == r, "send");
+        else if (m_Received == BULK_SIZE)
+            check(send(m_Fd, "OK\n", 3, MSG_NOSIGNAL) == 3, "send");
+    }
+
+    EventLoop& m_Loop;
+    int m_Fd;
+    size_t m_Received = 0;
+    bool m_Bulk = false;
+    bool m_Closed = false;
+};
+
+struct Listener
+{
+    void onEvent(uint32_t)
+    {
+        int s = accept4(m_Fd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (s < 0)
+            return;
+        m_Connections.emplace_back(new Connection(m_Loop, s));
+    }
+
+    EventLoop& m_Loop;
+    int m_Fd;
+    std::vector<std::unique_ptr<Connection>> m_Connections;
+};
+
+// Client: connects, sends its request, waits for the echo (or "OK\n") and closes.
+struct Client
+{
+    Client(EventLoop& aLoop, const char* aPort, std::string aRequest, std::string aAnswer)
+    : m_Loop(aLoop), m_Socket(m_Cache, "127.0.0.1", aPort, 0, PlainSocket::NON_BLOCKING),
+      m_Request(std::move(aRequest)), m_Answer(std::move(aAnswer)), m_OVec(m_Request)
+    {
+        m_Loop.add(m_Socket.fd(), EventLoop::WRITE, *this);
+    }
+
+    void onEvent(uint32_t aEvents)
+    {
+        if (!m_Connected)
+        {
+            check(m_Socket.connectError() == 0, "connect failed");
+            m_Connected = true;
+        }
+        if (aEvents & EventLoop::WRITE)
+        {
+            OVec* sRest = &m_OVec;
+            size_t sCount = m_Count;
+            m_Socket.trySend(sRest, sCount);
+            m_Count = sCount;
+            if (m_Count == 0)
+                m_Loop.modify(m_Socket.fd(), EventLoop::READ);
+            else
+                m_WouldBlock = true;
+            return;
+        }
+        bool sShutDown = false;
+        bool sWouldBlock = false;
+        m_Socket.tryRecvSome(sShutDown, sWouldBlock);
+        check(!sShutDown, "Unexpected shutdown");
+        auto [sFirst, sSecond] = m_Socket.cachedData();
+        check(sSecond.empty(), "Unexpected wrap of cache");
+        if (sFirst.size() < m_Answer.size())
+            return;
+        check(sFirst == m_Answer, "Wrong answer");
+        m_Loop.remove(m_Socket.fd());
+        m_Done = true;
+    }
+
+    EventLoop& m_Loop;
+    char m_Cache[64];
+    PlainSocket m_Socket;
+    std::string m_Request;
+    std::string m_Answer;
+    OVec m_OVec;
+    size_t m_Count = 1;
+    bool m_Connected = false;
+    bool m_WouldBlock = false;
+    bool m_Done = false;
+};
+
+int main()
+{
+    try
+    {
+        int sListen = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP);
+        check(sListen >= 0, "socket");
+        struct sockaddr_in sAddr{};
+        sAddr.sin_family = AF_INET;
+        sAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t sAddrLen = sizeof(sAddr);
+        check(bind(sListen, (sockaddr*)&sAddr, sizeof(sAddr)) == 0, "bind");
+        check(listen(sListen, SOMAXCONN) == 0, "listen");
+        check(getsockname(sListen, (sockaddr*)&sAddr, &sAddrLen) == 0, "getsockname");
+        std::string sPort = std::to_string(ntohs(sAddr.sin_port));
+
+        EventLoop sLoop;
+        Listener sListener{sLoop, sListen, {}};
+        sLoop.add(sListen, EventLoop::READ, sListener);
+
+        std::vector<std::unique_ptr<Client>> sClients;
+        for (size_t i = 0; i < NUM_CLIENTS; i++)
+        {
+            std::string sLine = "client " + std::to_string(i) + "\n";
+            sClients.emplace_back(new Client(sLoop, sPort.c_str(), sLine, sLine));
+        }
+        std::string sBulk(BULK_SIZE, 'B');
+        sClients.emplace_back(new Client(sLoop, sPort.c_str(), sBulk, "OK\n"));
+
+        // The listener is never removed, so run until all the clients are done.
+        auto sAllDone = [&]()
+        {
+            return std::all_of(sClients.begin(), sClients.end(), [](const auto& c) { return c->m_Done; });
+        };
+        while (!sAllDone())
+            check(sLoop.runOnce(10000) != 0, "Timeout");
+        check(sClients.back()->m_WouldBlock, "Bulk data was sent without a wait");
+
+        // Closed clients are seen by the server.
+        sClients.clear();
+        auto sAllClosed = [&]()
+        {
+            return std::all_of(sListener.m_Connections.begin(), sListener.m_Connections.end(),
+                               [](const auto& c) { return c->m_Closed; });
+        };
+        while (!sAllClosed())
+            check(sLoop.runOnce(10000) != 0, "Timeout");
+        check(sListener.m_Connections.size() == NUM_CLIENTS + 1, "Wrong number of connections");
+        check(sLoop.size() == 1, "Wrong number of registrations");
+        sLoop.remove(sListen);
+        sLoop.run();
+        close(sListen);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const NetException& e)
+    {
+        std::cerr << e.what() << ": " << e.how() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Well done!" << std::endl;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <GeneratedAllHeadersParser.hpp>
+#include <GeneratedHttpResponseParser.hpp>
+
+#include <assert.h>
+#include <climits>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <HttpResponseParser.hpp>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+using AllHeadersParser = BasicHttpResponseParser<HttpHeaderName::CONTENT_TYPE, HttpHeaderName::CONTENT_LENGTH,
+                                                 HttpHeaderName::CONTENT_RANGE, HttpHeaderName::TRANSFER_ENCODING,
+                                                 HttpHeaderName::LOCATION, HttpHeaderName::CONNECTION,
+                                                 HttpHeaderName::ETAG, HttpHeaderName::LAST_MODIFIED>;
+
+static_assert(GeneratedHttpResponseParser::LOCATION == HttpResponseParser::header(HttpHeaderName::LOCATION),
+              "Wrong header ID");
+static_assert(GeneratedAllHeadersParser::LAST_MODIFIED == AllHeadersParser::header(HttpHeaderName::LAST_MODIFIED),
+              "Wrong header ID");
+
+// Generated code must give exactly the same as the state machine, for any split of the input.
+template <class GENERATED, class PARSER>
+void test_same(std::string_view aInput)
+{
+    for (size_t sChunk = 1; sChunk <= aInput.size(); sChunk++)
+    {
+        PARSER table;
+        GENERATED p;
+        typename PARSER::status_t res = 0;
+        typename PARSER::status_t table_res = 0;
+        size_t sEaten = 0;
+        size_t sTableEaten = 0;
+        while (res == 0 && sEaten < aInput.size())
+        {
+            std::string_view sPiece = aInput.substr(sEaten, sChunk);
+            sEaten += p.feed(sPiece, res);
+            sTableEaten += table.feed(sPiece, table_res);
+            check(res == table_res, "Generated: wrong status");
+            check(sEaten == sTableEaten && p.count() == table.count(), "Generated: wrong count");
+        }
+        for (typename PARSER::fragment_t f = 0; f < PARSER::HEADER_MAX; f++)
+            check(p.getFragment(f) == table.getFragment(f), "Generated: wrong fragment");
+        check(p.statusCode() == table.statusCode(), "Generated: wrong status code");
+        check(p.contentLength() == table.contentLength(), "Generated: wrong content length");
+    }
+}
+
+template <class GENERATED, class PARSER>
+void test_same_limited(std::string_view aInput)
+{
+    typename PARSER::Limits sTableLimits(0, 20, 3);
+    typename PARSER::Limits sLimits = sTableLimits;
+    PARSER table;
+    GENERATED p;
+    typename PARSER::status_t res = 0;
+    typename PARSER::status_t table_res = 0;
+    check(p.feed(aInput, res, sLimits) == table.feed(aInput, table_res, sTableLimits), "Limited: wrong count");
+    check(res == table_res, "Limited: wrong status");
+}
+
+void test_generated()
+{
+    std::string sLong(100, 'z');
+    const std::string sResponses[] = {
+        "HTTP/1.1 200 OK\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nLocation: here\r\nContent-Length: 12\r\n\r\nBODY",
+        "HTTP/1.0 404 Not Found\r\nContent-Length:  0012 \r\nContent-Length: 1x\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nContent-Length: 123456789012345678901234567890\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nlocation: a\r\nLOCATION: b\r\nLoCaTiOn:c\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nLocation : a\r\nLocatio: b\r\nLocationn: c\r\nLocatiom: d\r\n\r\n",
+        "HTTP/1.1 200 OK\r\n: a\r\n:\r\nLoc\ration: b\r\nLocation\r\n: c\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nContent-Type: x\r\nContent-Length: 5\r\nContent-Range: y\r\nContent: z\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nX: 1\r\nETag: \"abc\"\r\nEtag2: x\r\nETa@: y\r\nETa`: z\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nConnection: close\r\nConnection:keep-alive\r\nLast-Modified: today\r\n\r\n",
+        "HTTP/1.1 200 OK\r\n" + sLong + ": " + sLong + "\r\nLocation" + sLong + ": x\r\n" + sLong + "\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nSet-Cookie: " + sLong + "\r\nLocation: " + sLong + "\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nLocation\n: a\r\nLocation\t: b\r\n\nLocation: c\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nLocation: a\r\n folded \r\n\tvalue\r\n\r\n",
+        "HTTP/1.1 200 OK\r\n\rLocation: a\r\n\r\n",
+        "HTTP/12.34 567 OK\r\n\r\n",
+        "HTTP/1.1 2000 OK\r\n\r\n",
+        "HTTP/1.1 20 OK\r\n\r\n",
+        "HTTP/a.1 200 OK\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nContent-Length: 1\r\n\r",
+    };
+    for (const std::string& sResp : sResponses)
+    {
+        test_same<GeneratedHttpResponseParser, HttpResponseParser>(sResp);
+        test_same<GeneratedAllHeadersParser, AllHeadersParser>(sResp);
+        test_same_limited<GeneratedHttpResponseParser, HttpResponseParser>(sResp);
+    }
+
+    // Any byte in any position, including the status line prefix.
+    std::string sResp = "HTTP/1.1 304 OK\r\nContent-Length: 10\r\nETag: x\r\n\r\n";
+    for (size_t i = 0; i < sResp.size(); i++)
+    {
+        for (size_t c = 0; c <= UCHAR_MAX; c++)
+        {
+            std::string sMutated = sResp;
+            sMutated[i] = char(c);
+            test_same<GeneratedHttpResponseParser, HttpResponseParser>(sMutated.substr(0, 20));
+            test_same<GeneratedAllHeadersParser, AllHeadersParser>(sMutated);
+        }
+    }
+}
+
+int main()
+{
+    try
+    {
+        test_generated();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Well done!" << std::endl;
+    return EXIT_SUCCESS;
+}
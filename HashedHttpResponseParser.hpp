@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include <HttpResponseParser.hpp>
+
+// The same parser as BasicHttpResponseParser, but with another engine of header name
+// recognition. The state machine matches names byte by byte through a trie; this parser
+// instead finds the end of the name (':') by vectorized search, looks the name up in a
+// perfect hash table that is generated in compile time for HEADER_NAMES, checks it by one
+// case insensitive comparison and jumps right to the state of reading the value.
+// Everything else (status line, values, line ends) is done by the same state machine,
+// and the results are exactly the same as with BasicHttpResponseParser.
+// The lookup is done only when the whole name is in the given range; a name that is split
+// between feeds is walked by the state machine as usual.
+// Only bulk feed uses the lookup; feed by characters and feedMany are inherited.
+// The header index is not supported: the lookup jumps over the names it would record.
+
+namespace details {
+
+// Read up to 8 bytes as a little endian number, missing bytes are zeros.
+// Compilers merge that into one load when aSize is 8.
+constexpr uint64_t loadNameWord(const char* aData, size_t aSize)
+{
+    uint64_t sRes = 0;
+    for (size_t i = 0; i < aSize; i++)
+        sRes |= uint64_t(uint8_t(aData[i])) << (8 * i);
+    return sRes;
+}
+
+// Case insensitive (for letters) key of a header name: first and last 8 bytes and the size.
+// Other bytes are not taken into account, names that differ only there can't be hashed.
+constexpr uint64_t nameKey(const char* aName, size_t aSize)
+{
+    constexpr uint64_t LOWER = 0x2020202020202020ull;
+    uint64_t sFirst = aSize < 8 ? loadNameWord(aName, aSize) : loadNameWord(aName, 8);
+    uint64_t sLast = aSize < 8 ? sFirst : loadNameWord(aName + aSize - 8, 8);
+    sFirst |= LOWER;
+    sLast |= LOWER;
+    return sFirst ^ ((sLast << 29) | (sLast >> 35)) ^ (aSize * 0x9E3779B97F4A7C15ull);
+}
+
+// Perfect hash of a set of names: slot = (key * m_Seed) >> m_Shift.
+struct NamePerfectHash
+{
+    uint64_t m_Seed = 0;
+    unsigned m_Shift = 0;
+    bool m_Found = false;
+
+    constexpr size_t slot(uint64_t aKey) const { return (aKey * m_Seed) >> m_Shift; }
+};
+
+// Find a perfect hash for aNames with no more than 1 << aBits slots.
+constexpr NamePerfectHash findNamePerfectHash(const std::string_view* aNames, size_t aCount, unsigned aBits)
+{
+    constexpr size_t MAX_TRIES = 4096;
+    constexpr size_t MAX_SLOTS = 1 << 10;
+    NamePerfectHash sRes;
+    sRes.m_Shift = 64 - aBits;
+    uint64_t sSeed = 0x9E3779B97F4A7C15ull;
+    for (size_t sTry = 0; sTry < MAX_TRIES; sTry++)
+    {
+        sSeed = sSeed * 6364136223846793005ull + 1442695040888963407ull;
+        sRes.m_Seed = sSeed | 1;
+        std::array<bool, MAX_SLOTS> sUsed = {};
+        bool sCollision = false;
+        for (size_t i = 0; i < aCount && !sCollision; i++)
+        {
+            size_t sSlot = sRes.slot(nameKey(aNames[i].data(), aNames[i].size()));
+            sCollision = sUsed[sSlot];
+            sUsed[sSlot] = true;
+        }
+        if (!sCollision)
+        {
+            sRes.m_Found = true;
+            return sRes;
+        }
+    }
+    return sRes;
+}
+
+// Number of bits of perfect hash: twice as many slots as names at least.
+constexpr unsigned namePerfectHashBits(size_t aCount)
+{
+    unsigned sRes = 1;
+    while ((size_t(1) << sRes) < aCount * 2)
+        sRes++;
+    return sRes;
+}
+
+// Run the compact state machine from aState by aInput.
+template <class MACHINE>
+constexpr state_t walkCompactStateMachine(const MACHINE& aMachine, state_t aState, std::string_view aInput)
+{
+    for (char c : aInput)
+        aState = aMachine.get(aState, c).m_State;
+    return aState;
+}
+
+constexpr size_t maxNameSize(const std::string_view* aNames, size_t aCount)
+{
+    size_t sRes = 0;
+    for (size_t i = 0; i < aCount; i++)
+        sRes = aNames[i].size() > sRes ? aNames[i].size() : sRes;
+    return sRes;
+}
+
+// Header name that is stored in a slot of the hash table.
+template <size_t MAX_NAME_SIZE>
+struct HashedNameSlot
+{
+    // Size of the name, zero if the slot is free.
+    size_t m_Size = 0;
+    // Lower case name.
+    std::array<char, MAX_NAME_SIZE> m_Lower = {};
+    // The state of reading the value of the header.
+    state_t m_ValueState = 0;
+};
+
+// Fill the hash table. aLineStart is the state at the beginning of a header line.
+template <size_t NUM_SLOTS, size_t MAX_NAME_SIZE, class MACHINE>
+constexpr std::array<HashedNameSlot<MAX_NAME_SIZE>, NUM_SLOTS>
+buildHashedNameSlots(const MACHINE& aMachine, const std::string_view* aNames, size_t aCount,
+                     NamePerfectHash aHash, state_t aLineStart)
+{
+    std::array<HashedNameSlot<MAX_NAME_SIZE>, NUM_SLOTS> sRes = {};
+    for (size_t i = 0; i < aCount; i++)
+    {
+        std::string_view sName = aNames[i];
+        HashedNameSlot<MAX_NAME_SIZE>& sSlot = sRes[aHash.slot(nameKey(sName.data(), sName.size()))];
+        sSlot.m_Size = sName.size();
+        for (size_t j = 0; j < sName.size(); j++)
+            sSlot.m_Lower[j] = simple_tolower(sName[j]);
+        sSlot.m_ValueState = walkCompactStateMachine(aMachine, walkCompactStateMachine(aMachine, aLineStart, sName), ":");
+    }
+    return sRes;
+}
+
+} // namespace details {
+
+template <const std::string_view& ...HEADER_NAMES>
+class BasicHashedHttpResponseParser : public BasicHttpResponseParser<HEADER_NAMES...>
+{
+    using Base = BasicHttpResponseParser<HEADER_NAMES...>;
+public:
+    using status_t = typename Base::status_t;
+    using state_t = typename Base::state_t;
+    using Limits = typename Base::Limits;
+
+    // Feed the parser a range of characters, see BasicHttpResponseParser::feed.
+    using Base::feed;
+    inline size_t feed(const char* aBegin, const char* aEnd, status_t& aStatus);
+    inline size_t feed(std::string_view aData, status_t& aStatus);
+    inline size_t feed(const char* aBegin, const char* aEnd, status_t& aStatus, Limits& aLimits);
+    inline size_t feed(std::string_view aData, status_t& aStatus, Limits& aLimits);
+    // The index is recorded by the state machine only, use BasicHttpResponseParser.
+    size_t feed(const char* aBegin, const char* aEnd, status_t& aStatus, HttpHeaderIndex& aIndex) = delete;
+    size_t feed(std::string_view aData, status_t& aStatus, HttpHeaderIndex& aIndex) = delete;
+
+    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
+//private:
+
+    static constexpr size_t NUM_HEADERS = Base::NUM_HEADERS;
+    static constexpr const auto& Machine = Base::TheCompactStateMachine;
+
+    // The state at the beginning of a header line.
+    static constexpr state_t LINE_START = Base::LINE_START_CONDITION * Machine.numClasses();
+    // The state of a line that is not stored (there's no header name with \x01).
+    static constexpr state_t SKIP_LINE = details::walkCompactStateMachine(Machine, LINE_START, "\x01");
+    // Names longer than that can't match.
+    static constexpr size_t MAX_NAME_SIZE = details::maxNameSize(Base::HeaderNames.data(), NUM_HEADERS);
+
+    static constexpr unsigned HASH_BITS = details::namePerfectHashBits(NUM_HEADERS);
+    static constexpr size_t NUM_SLOTS = size_t(1) << HASH_BITS;
+    static constexpr details::NamePerfectHash Hash =
+        details::findNamePerfectHash(Base::HeaderNames.data(), NUM_HEADERS, HASH_BITS);
+    static_assert(Hash.m_Found, "Header names are too similar for the perfect hash");
+
+    using Slot = details::HashedNameSlot<MAX_NAME_SIZE>;
+    static constexpr std::array<Slot, NUM_SLOTS> Slots =
+        details::buildHashedNameSlots<NUM_SLOTS, MAX_NAME_SIZE>(Machine, Base::HeaderNames.data(), NUM_HEADERS,
+                                                                Hash, LINE_START);
+
+    static_assert(LINE_START != SKIP_LINE && SKIP_LINE != 0, "Unexpected state machine");
+
+    // Find the first ':' or '\r' in [aBegin, aEnd), return aEnd if not found.
+    static const char* findNameEnd(const char* aBegin, const char* aEnd);
+    // Look up the name [aBegin, aEnd) that is followed by ':'.
+    // Return the state of reading its value, or SKIP_LINE if it's not stored.
+    static state_t lookup(const char* aBegin, const char* aEnd);
+    // Bulk feed, with the checks of aLimits if LIMITED.
+    template <bool LIMITED>
+    inline size_t hashedFeedImpl(const char* aBegin, const char* aEnd, status_t& aStatus, Limits* aLimits);
+};
+
+// The default set of headers with the hashed engine.
+using HashedHttpResponseParser = BasicHashedHttpResponseParser<HttpHeaderName::CONTENT_TYPE,
+                                                               HttpHeaderName::CONTENT_LENGTH,
+                                                               HttpHeaderName::TRANSFER_ENCODING,
+                                                               HttpHeaderName::LOCATION>;
+
+//////////////////////////////////// IMPLEMENTATION ////////////////////////////////////
+template <const std::string_view& ...HEADER_NAMES>
+const char* BasicHashedHttpResponseParser<HEADER_NAMES...>::findNameEnd(const char* aBegin, const char* aEnd)
+{
+    const char* sPos = aBegin;
+#if defined(__SSE2__)
+    const __m128i sColon = _mm_set1_epi8(':');
+    const __m128i sCR = _mm_set1_epi8('\r');
+    for (; aEnd - sPos >= 16; sPos += 16)
+    {
+        __m128i sData = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPos));
+        __m128i sFound = _mm_or_si128(_mm_cmpeq_epi8(sData, sColon), _mm_cmpeq_epi8(sData, sCR));
+        uint32_t sMask = _mm_movemask_epi8(sFound);
+        if (0 != sMask)
+            return sPos + __builtin_ctz(sMask);
+    }
+#endif
+    while (sPos != aEnd && *sPos != ':' && *sPos != '\r')
+        ++sPos;
+    return sPos;
+}
+
+template <const std::string_view& ...HEADER_NAMES>
+typename BasicHashedHttpResponseParser<HEADER_NAMES...>::state_t
+BasicHashedHttpResponseParser<HEADER_NAMES...>::lookup(const char* aBegin, const char* aEnd)
+{
+    size_t sSize = aEnd - aBegin;
+    if (sSize > MAX_NAME_SIZE)
+        return SKIP_LINE;
+    const Slot& sSlot = Slots[Hash.slot(details::nameKey(aBegin, sSize))];
+    if (sSlot.m_Size != sSize)
+        return SKIP_LINE;
+    for (size_t i = 0; i < sSize; i++)
+        if (details::simple_tolower(aBegin[i]) != sSlot.m_Lower[i])
+            return SKIP_LINE;
+    return sSlot.m_ValueState;
+}
+
+template <const std::string_view& ...HEADER_NAMES>
+template <bool LIMITED>
+size_t BasicHashedHttpResponseParser<HEADER_NAMES...>::hashedFeedImpl(const char* aBegin, const char* aEnd,
+                                                                      status_t& aStatus, Limits* aLimits)
+{
+    using PB = HttpResponseParserBase;
+    // With limits nothing goes further than the current line may, see Base::limitedFeedImpl.
+    status_t sEndError = 0;
+    status_t sLineError = 0;
+    if constexpr (LIMITED)
+        aEnd = aLimits->headerStop(this->m_CurrentState, this->m_CurrentPos, aBegin, aEnd, sEndError);
+
+    const char* sPos = aBegin;
+    const char* sStop = aEnd;
+    if constexpr (LIMITED)
+        sStop = aLimits->lineStop(this->m_CurrentPos, sPos, aEnd, sLineError);
+    if (PB::statusLineImpl(Machine, this->m_CurrentState, this->m_CurrentPos, this->m_Numbers.accumulator(),
+                           this->m_SavedTagOffsets, this->m_Numbers, sPos, sStop))
+        sPos += PB::STATUS_LINE_PREFIX_SIZE;
+
+    state_t sState = this->m_CurrentState;
+    size_t sCount = this->m_CurrentPos;
+    uint64_t sAccumulator = this->m_Numbers.accumulator();
+    status_t sStatus = 0;
+
+    while (sPos != sStop)
+    {
+        if (sState == LINE_START)
+        {
+            // Jump over the name and ':' if the whole name is here. In the state machine
+            // name bytes save no tags and numbers, so only the accumulator must be reset.
+            // Names longer than MAX_NAME_SIZE can't match, no need to look further.
+            const char* sWindowEnd = size_t(sStop - sPos) > MAX_NAME_SIZE ? sPos + MAX_NAME_SIZE + 1 : sStop;
+            const char* sNameEnd = findNameEnd(sPos, sWindowEnd);
+            const char* sNext = sPos;
+            if (sNameEnd == sPos)
+            {
+                // Empty name, let the state machine handle it.
+            }
+            else if (sNameEnd == sWindowEnd)
+            {
+                // Too long name, or no end of it in the range yet.
+                if (size_t(sWindowEnd - sPos) > MAX_NAME_SIZE)
+                {
+                    sState = SKIP_LINE;
+                    sNext = sWindowEnd;
+                }
+            }
+            else if (*sNameEnd == ':')
+            {
+                sState = lookup(sPos, sNameEnd);
+                sNext = sNameEnd + (sState != SKIP_LINE);
+            }
+            else
+            {
+                // A line without ':'.
+                sState = SKIP_LINE;
+                sNext = sNameEnd;
+            }
+            if (sNext != sPos)
+            {
+                PB::profileSkip(Machine, LINE_START, sNext - sPos);
+                sCount += sNext - sPos;
+                sPos = sNext;
+                sAccumulator = 0;
+                if (sState == SKIP_LINE)
+                {
+                    const char* sSkipStop = PB::skipImpl(PB::SKIP_TO_CR, sPos, sStop);
+                    PB::profileSkip(Machine, SKIP_LINE, sSkipStop - sPos);
+                    sCount += sSkipStop - sPos;
+                    sPos = sSkipStop;
+                }
+                continue;
+            }
+        }
+
+        const typename PB::CompactTransition& t = Machine.get(sState, *sPos);
+        PB::profileHit(Machine, t);
+        sState = t.m_State;
+        this->m_SavedTagOffsets[t.m_Tag] = sCount++;
+        PB::numberImpl(sAccumulator, this->m_Numbers, t.m_Number, *sPos++);
+        if (0 != t.m_Status)
+        {
+            sStatus = t.m_Status;
+            break;
+        }
+        if constexpr (LIMITED)
+        {
+            if (sState == LINE_START)
+            {
+                aLimits->nextLine(sCount);
+                sStop = aLimits->lineStop(sCount, sPos, aEnd, sLineError);
+                continue;
+            }
+        }
+        if (PB::SKIP_NONE != t.m_Skip)
+        {
+            const char* sSkipStop = PB::skipImpl(t.m_Skip, sPos, sStop);
+            PB::profileSkip(Machine, sState, sSkipStop - sPos);
+            sAccumulator = sSkipStop == sPos ? sAccumulator : 0;
+            sCount += sSkipStop - sPos;
+            sPos = sSkipStop;
+        }
+    }
+
+    if (0 == sStatus)
+        sStatus = sPos != aEnd ? sLineError : sEndError;
+    this->m_CurrentState = sState;
+    this->m_CurrentPos = sCount;
+    this->m_Numbers.accumulator() = sAccumulator;
+    aStatus = sStatus;
+    return sPos - aBegin;
+}
+
+template <const std::string_view& ...HEADER_NAMES>
+size_t BasicHashedHttpResponseParser<HEADER_NAMES...>::feed(const char* aBegin, const char* aEnd, status_t& aStatus)
+{
+    return hashedFeedImpl<false>(aBegin, aEnd, aStatus, nullptr);
+}
+
+template <const std::string_view& ...HEADER_NAMES>
+size_t BasicHashedHttpResponseParser<HEADER_NAMES...>::feed(std::string_view aData, status_t& aStatus)
+{
+    return feed(aData.data(), aData.data() + aData.size(), aStatus);
+}
+
+template <const std::string_view& ...HEADER_NAMES>
+size_t BasicHashedHttpResponseParser<HEADER_NAMES...>::feed(const char* aBegin, const char* aEnd, status_t& aStatus,
+                                                            Limits& aLimits)
+{
+    return hashedFeedImpl<true>(aBegin, aEnd, aStatus, &aLimits);
+}
+
+template <const std::string_view& ...HEADER_NAMES>
+size_t BasicHashedHttpResponseParser<HEADER_NAMES...>::feed(std::string_view aData, status_t& aStatus,
+                                                            Limits& aLimits)
+{
+    return feed(aData.data(), aData.data() + aData.size(), aStatus, aLimits);
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <HttpChunkedDecoder.hpp>
+
+#include <algorithm>
+
+namespace
+{
+    using Transition = HttpChunkedDecoder::Transition;
+    using StateMachine = HttpChunkedDecoder::StateMachine;
+    using state_t = HttpChunkedDecoder::state_t;
+    using tag_t = HttpChunkedDecoder::tag_t;
+    using status_t = HttpChunkedDecoder::status_t;
+
+    constexpr std::string_view m_StatusErrors[] = {
+        "",
+        "Success",
+        "Not a hex digit in chunk size",
+        "Too big chunk size",
+        "Wrong character in chunk size line",
+        "No CRLF after chunk data"
+    };
+
+    static_assert(sizeof(m_StatusErrors) / sizeof(m_StatusErrors[0]) == HttpChunkedDecoder::STATUS_END, "smth went wrong!");
+
+    constexpr Transition final(status_t aStatus)
+    {
+        return Transition{HttpChunkedDecoder::SIZE_FIRST, HttpChunkedDecoder::DUMMY_TAG, uint8_t(aStatus), 0};
+    }
+
+    constexpr Transition normal(state_t aNextState, tag_t aTag = HttpChunkedDecoder::DUMMY_TAG)
+    {
+        return Transition{aNextState, aTag, 0, 0};
+    }
+
+    constexpr Transition digit(state_t aNextState)
+    {
+        return Transition{aNextState, HttpChunkedDecoder::DUMMY_TAG, 0, 1};
+    }
+
+    constexpr StateMachine buildStateMachine()
+    {
+        StateMachine sRes;
+
+        for (size_t i = 0; i < 256; i++)
+        {
+            unsigned char c = i;
+            if (c >= '0' && c <= '9')
+                sRes.m_HexValues[c] = c - '0';
+            else if (c >= 'a' && c <= 'f')
+                sRes.m_HexValues[c] = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                sRes.m_HexValues[c] = c - 'A' + 10;
+            sRes.m_Classes[c] = HttpChunkedDecoder::CLASS_OTHER;
+        }
+        for (size_t i = 0; i < 256; i++)
+            if (sRes.m_HexValues[i] != 0 || i == '0')
+                sRes.m_Classes[i] = HttpChunkedDecoder::CLASS_HEX_DIGIT;
+        sRes.m_Classes[' '] = HttpChunkedDecoder::CLASS_SPACE;
+        sRes.m_Classes['\t'] = HttpChunkedDecoder::CLASS_SPACE;
+        sRes.m_Classes[';'] = HttpChunkedDecoder::CLASS_SEMICOLON;
+        sRes.m_Classes['\r'] = HttpChunkedDecoder::CLASS_CR;
+        sRes.m_Classes['\n'] = HttpChunkedDecoder::CLASS_LF;
+
+        auto sSet = [&sRes](state_t aState, Transition aOther, Transition aDigit, Transition aSpace,
+                            Transition aSemicolon, Transition aCR, Transition aLF)
+        {
+            sRes.m_Transitions[aState][HttpChunkedDecoder::CLASS_OTHER] = aOther;
+            sRes.m_Transitions[aState][HttpChunkedDecoder::CLASS_HEX_DIGIT] = aDigit;
+            sRes.m_Transitions[aState][HttpChunkedDecoder::CLASS_SPACE] = aSpace;
+            sRes.m_Transitions[aState][HttpChunkedDecoder::CLASS_SEMICOLON] = aSemicolon;
+            sRes.m_Transitions[aState][HttpChunkedDecoder::CLASS_CR] = aCR;
+            sRes.m_Transitions[aState][HttpChunkedDecoder::CLASS_LF] = aLF;
+        };
+
+        // Chunk size line: chunk-size [ BWS chunk-ext ] CRLF.
+        // Bare LF is accepted instead of CRLF, as in HttpResponseParser.
+        Transition sNotDigit = final(HttpChunkedDecoder::ERROR_NOT_A_HEX_DIGIT_CHUNK_SIZE);
+        Transition sWrongLine = final(HttpChunkedDecoder::ERROR_WRONG_CHUNK_SIZE_LINE);
+        // First, required digit.
+        sSet(HttpChunkedDecoder::SIZE_FIRST, sNotDigit, digit(HttpChunkedDecoder::SIZE), sNotDigit,
+             sNotDigit, sNotDigit, sNotDigit);
+        // More digits.
+        sSet(HttpChunkedDecoder::SIZE, sWrongLine, digit(HttpChunkedDecoder::SIZE),
+             normal(HttpChunkedDecoder::SIZE_WS), normal(HttpChunkedDecoder::EXTENSION),
+             normal(HttpChunkedDecoder::SIZE_LF), normal(HttpChunkedDecoder::DATA));
+        // Whitespaces after size.
+        sSet(HttpChunkedDecoder::SIZE_WS, sWrongLine, sWrongLine,
+             normal(HttpChunkedDecoder::SIZE_WS), normal(HttpChunkedDecoder::EXTENSION),
+             normal(HttpChunkedDecoder::SIZE_LF), normal(HttpChunkedDecoder::DATA));
+        // Extensions are ignored.
+        Transition sExt = normal(HttpChunkedDecoder::EXTENSION);
+        sSet(HttpChunkedDecoder::EXTENSION, sExt, sExt, sExt, sExt,
+             normal(HttpChunkedDecoder::SIZE_LF), normal(HttpChunkedDecoder::DATA));
+        // Previous char is '\r'.
+        sSet(HttpChunkedDecoder::SIZE_LF, sWrongLine, sWrongLine, sWrongLine, sWrongLine,
+             sWrongLine, normal(HttpChunkedDecoder::DATA));
+
+        // CRLF after chunk data.
+        Transition sNoCRLF = final(HttpChunkedDecoder::ERROR_NO_CRLF_AFTER_CHUNK);
+        sSet(HttpChunkedDecoder::DATA_CR, sNoCRLF, sNoCRLF, sNoCRLF, sNoCRLF,
+             normal(HttpChunkedDecoder::DATA_LF), normal(HttpChunkedDecoder::SIZE_FIRST));
+        sSet(HttpChunkedDecoder::DATA_LF, sNoCRLF, sNoCRLF, sNoCRLF, sNoCRLF,
+             sNoCRLF, normal(HttpChunkedDecoder::SIZE_FIRST));
+
+        // Trailer section: any lines until an empty line.
+        // Like header lines in HttpResponseParser, single '\r' does not finish a line.
+        Transition sSuccess = final(HttpChunkedDecoder::SUCCESS);
+        Transition sFirst = normal(HttpChunkedDecoder::TRAILER_LINE, HttpChunkedDecoder::TRAILER_BEGIN);
+        sSet(HttpChunkedDecoder::TRAILER_FIRST, sFirst, sFirst, sFirst, sFirst,
+             normal(HttpChunkedDecoder::FINAL_LF), sSuccess);
+        Transition sLine = normal(HttpChunkedDecoder::TRAILER_LINE);
+        sSet(HttpChunkedDecoder::TRAILER_LINE_START, sLine, sLine, sLine, sLine,
+             normal(HttpChunkedDecoder::FINAL_LF, HttpChunkedDecoder::TRAILER_END),
+             final(HttpChunkedDecoder::SUCCESS));
+        sRes.m_Transitions[HttpChunkedDecoder::TRAILER_LINE_START][HttpChunkedDecoder::CLASS_LF].m_Tag = HttpChunkedDecoder::TRAILER_END;
+        sSet(HttpChunkedDecoder::TRAILER_LINE, sLine, sLine, sLine, sLine,
+             normal(HttpChunkedDecoder::TRAILER_LF), normal(HttpChunkedDecoder::TRAILER_LINE_START));
+        sSet(HttpChunkedDecoder::TRAILER_LF, sLine, sLine, sLine, sLine,
+             normal(HttpChunkedDecoder::TRAILER_LF), normal(HttpChunkedDecoder::TRAILER_LINE_START));
+        sSet(HttpChunkedDecoder::FINAL_LF, sLine, sLine, sLine, sLine,
+             normal(HttpChunkedDecoder::TRAILER_LF), sSuccess);
+
+        return sRes;
+    }
+
+    constexpr StateMachine theStateMachine = buildStateMachine();
+
+    // Number of bits of chunk size that are guaranteed to be free before adding the next digit.
+    constexpr unsigned SIZE_DIGIT_BITS = 4;
+    constexpr uint64_t MAX_CHUNK_SIZE_BEFORE_DIGIT = UINT64_MAX >> SIZE_DIGIT_BITS;
+} // namespace {
+
+const StateMachine& HttpChunkedDecoder::TheStateMachine = theStateMachine;
+
+const std::string_view HttpChunkedDecoder::getErrorStr(status_t s) { return m_StatusErrors[s]; }
+
+size_t HttpChunkedDecoder::decode(const char* aBegin, const char* aEnd, std::string_view& aData, status_t& aStatus)
+{
+    const char* sPos = aBegin;
+    aData = std::string_view();
+    aStatus = 0;
+
+    while (sPos != aEnd)
+    {
+        if (m_CurrentState == DATA)
+        {
+            size_t sSize = std::min(uint64_t(aEnd - sPos), m_ChunkSize);
+            aData = std::string_view(sPos, sSize);
+            sPos += sSize;
+            m_CurrentPos += sSize;
+            m_ChunkSize -= sSize;
+            if (0 == m_ChunkSize)
+                m_CurrentState = DATA_CR;
+            break;
+        }
+
+        unsigned char c = *sPos++;
+        const Transition& t = TheStateMachine.m_Transitions[m_CurrentState][TheStateMachine.m_Classes[c]];
+        if (t.m_Digit && m_ChunkSize > MAX_CHUNK_SIZE_BEFORE_DIGIT)
+        {
+            m_CurrentPos++;
+            aStatus = ERROR_TOO_BIG_CHUNK_SIZE;
+            break;
+        }
+        // Branchless: for non-digits the chunk size is left as is.
+        uint64_t sDigitMask = -uint64_t(t.m_Digit);
+        m_ChunkSize = (((m_ChunkSize << SIZE_DIGIT_BITS) | TheStateMachine.m_HexValues[c]) & sDigitMask) |
+                      (m_ChunkSize & ~sDigitMask);
+        m_CurrentState = t.m_State;
+        m_SavedTagOffsets[t.m_Tag] = m_CurrentPos++;
+        aStatus = t.m_Status;
+        if (0 != aStatus)
+            break;
+
+        if (m_CurrentState == DATA && 0 == m_ChunkSize)
+            m_CurrentState = TRAILER_FIRST;
+    }
+    return sPos - aBegin;
+}
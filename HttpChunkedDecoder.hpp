@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+// RFC7230 decoder of body with chunked transfer coding.
+// Works on a stream of input bytes that come in pieces of any size, has
+// no allocations and no copying: decoded data is given out as spans that point
+// into the input. Chunk size lines, extensions, CRLFs after data and the trailer
+// section are parsed by a small state machine with branchless state transitions,
+// just like in HttpResponseParser.
+// The trailer section (if present) is stored as a pair of offsets in the input stream,
+// in the same way as fragments in HttpResponseParser.
+
+class HttpChunkedDecoder
+{
+public:
+    // Type of result of decoding.
+    using status_t = uint16_t;
+    enum status_value_t
+    {
+        IN_PROGRESS = 0,
+        SUCCESS,
+        ERROR_NOT_A_HEX_DIGIT_CHUNK_SIZE,
+        ERROR_TOO_BIG_CHUNK_SIZE,
+        ERROR_WRONG_CHUNK_SIZE_LINE,
+        ERROR_NO_CRLF_AFTER_CHUNK,
+        STATUS_END,
+    };
+
+    // Decode next piece of the input.
+    // Eats framing (chunk size lines, CRLF after data, trailer section) and at most
+    // one span of chunk data, which is returned in aData and points into the input.
+    // aStatus is set to SUCCESS after the end of the trailer section, to appropriate
+    // error if the input is invalid and to zero otherwise. Only in the last case
+    // further decoding is allowed.
+    // Return number of eaten characters. It can be less than the size of input only if
+    // aData is not empty (call again with the rest) or aStatus is not zero (the rest
+    // of input does not belong to the body).
+    size_t decode(const char* aBegin, const char* aEnd, std::string_view& aData, status_t& aStatus);
+    inline size_t decode(std::string_view aInput, std::string_view& aData, status_t& aStatus);
+
+    // Return number of eaten characters.
+    inline size_t count() const;
+
+    // Reset decoding state to the initial.
+    inline void reset();
+
+    // Get a description of error status. Actually it's a null-terminating string.
+    static const std::string_view getErrorStr(status_t s);
+
+    // Check that nonempty trailer section was found in the input stream.
+    inline bool isTrailerFound() const;
+    // Get begin and end offsets of the trailer section (without the last empty line).
+    inline std::pair<size_t, size_t> getTrailer() const;
+    // Wrapper that extracts trailer section from whole stream (empty if not found).
+    inline std::string_view getTrailerStr(std::string_view sInput) const;
+
+
+    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
+//private:
+
+    // Type of ID of a decoding state.
+    using state_t = uint8_t;
+    // Type of a tag ID - offset that must be saved.
+    using tag_t = uint8_t;
+    enum tag_value_t
+    {
+        DUMMY_TAG = 0,
+        TRAILER_BEGIN,
+        TRAILER_END,
+        NUM_TAGS
+    };
+
+    // Transition from one state to another.
+    struct Transition
+    {
+        // This transition leads to that state.
+        state_t m_State = 0;
+        // In that tag the current position must be saved.
+        tag_t m_Tag = DUMMY_TAG;
+        // Status after this transition, see HttpResponseParser::Transition.
+        uint8_t m_Status = 0;
+        // Nonzero if the byte is a hex digit of chunk size.
+        uint8_t m_Digit = 0;
+    };
+
+    // Input bytes are split into classes with the same transitions.
+    enum class_t
+    {
+        CLASS_OTHER = 0,
+        CLASS_HEX_DIGIT,
+        CLASS_SPACE,
+        CLASS_SEMICOLON,
+        CLASS_CR,
+        CLASS_LF,
+        NUM_CLASSES
+    };
+
+    // States of the state machine.
+    enum state_value_t
+    {
+        // Reading chunk data, it's handled out of the state machine.
+        DATA = 0,
+        SIZE_FIRST,
+        SIZE,
+        SIZE_WS,
+        EXTENSION,
+        SIZE_LF,
+        DATA_CR,
+        DATA_LF,
+        TRAILER_FIRST,
+        TRAILER_LINE_START,
+        TRAILER_LINE,
+        TRAILER_LF,
+        FINAL_LF,
+        NUM_STATES
+    };
+
+    struct StateMachine
+    {
+        // Class of each input byte.
+        std::array<uint8_t, 256> m_Classes = {};
+        // Value of each hex digit.
+        std::array<uint8_t, 256> m_HexValues = {};
+        // Transitions of each state by each class.
+        std::array<std::array<Transition, NUM_CLASSES>, NUM_STATES> m_Transitions = {};
+    };
+
+private:
+    // The instance of the state machine, see HttpResponseParser for explanation.
+    static const StateMachine& TheStateMachine;
+
+    // Variables of decoding state.
+    // State in state machine.
+    state_t m_CurrentState = SIZE_FIRST;
+    // Number of characters that was consumed.
+    uint64_t m_CurrentPos = 0;
+    // Size of current chunk while reading chunk size; the rest of chunk while reading data.
+    uint64_t m_ChunkSize = 0;
+    // Saved tag positions.
+    std::array<uint64_t, NUM_TAGS> m_SavedTagOffsets = {};
+};
+
+//////////////////////////////////// IMPLEMENTATION ////////////////////////////////////
+size_t HttpChunkedDecoder::decode(std::string_view aInput, std::string_view& aData, status_t& aStatus)
+{
+    return decode(aInput.data(), aInput.data() + aInput.size(), aData, aStatus);
+}
+
+size_t HttpChunkedDecoder::count() const
+{
+    return m_CurrentPos;
+}
+
+void HttpChunkedDecoder::reset()
+{
+    m_CurrentState = SIZE_FIRST;
+    m_CurrentPos = 0;
+    m_ChunkSize = 0;
+    m_SavedTagOffsets.fill(0);
+}
+
+bool HttpChunkedDecoder::isTrailerFound() const
+{
+    // The trailer can't start at zero offset.
+    return m_SavedTagOffsets[TRAILER_BEGIN] != 0;
+}
+
+std::pair<size_t, size_t> HttpChunkedDecoder::getTrailer() const
+{
+    if (!isTrailerFound())
+        return {0, 0};
+    return {m_SavedTagOffsets[TRAILER_BEGIN], m_SavedTagOffsets[TRAILER_END]};
+}
+
+std::string_view HttpChunkedDecoder::getTrailerStr(std::string_view sInput) const
+{
+    auto [b, e] = getTrailer();
+    return sInput.substr(b, e - b);
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <HttpChunkedDecoder.hpp>
+
+#include <assert.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+void check_err(HttpChunkedDecoder::status_t status, std::string_view str)
+{
+    check(HttpChunkedDecoder::getErrorStr(status) == str, "unexpected error message");
+}
+
+// Decode the input given by pieces of aPieceSize bytes.
+// Return decoded data, status and number of eaten bytes.
+struct Result
+{
+    std::string m_Data;
+    HttpChunkedDecoder::status_t m_Status = 0;
+    size_t m_Eaten = 0;
+};
+
+Result decode(HttpChunkedDecoder& d, std::string_view aInput, size_t aPieceSize)
+{
+    Result sRes;
+    d.reset();
+    while (sRes.m_Eaten < aInput.size() && 0 == sRes.m_Status)
+    {
+        std::string_view sPiece = aInput.substr(sRes.m_Eaten, aPieceSize);
+        while (!sPiece.empty() && 0 == sRes.m_Status)
+        {
+            std::string_view sData;
+            size_t sEaten = d.decode(sPiece, sData, sRes.m_Status);
+            check(sEaten <= sPiece.size(), "Eaten more than given");
+            check(sData.empty() || (sData.data() >= sPiece.data() && sData.data() + sData.size() <= sPiece.data() + sEaten),
+                  "Data is not in the input");
+            check(sEaten == sPiece.size() || !sData.empty() || sRes.m_Status != 0, "Stopped without a reason");
+            sRes.m_Data += sData;
+            sRes.m_Eaten += sEaten;
+            sPiece.remove_prefix(sEaten);
+        }
+    }
+    check(d.count() == sRes.m_Eaten, "Wrong count");
+    return sRes;
+}
+
+void test_pass(std::string_view body, std::string_view data, std::string_view trailer)
+{
+    // Something after the body must not be eaten.
+    std::string sInput = std::string(body) + "HTTP/1.1 200 OK\r\n";
+    HttpChunkedDecoder d;
+    for (size_t sPieceSize = 1; sPieceSize <= sInput.size(); sPieceSize++)
+    {
+        Result sRes = decode(d, sInput, sPieceSize);
+        check(sRes.m_Status == HttpChunkedDecoder::SUCCESS, "Not success");
+        check(sRes.m_Eaten == body.size(), "Wrong number of eaten bytes");
+        check(sRes.m_Data == data, "Wrong data");
+        check(d.isTrailerFound() == !trailer.empty(), "Wrong trailer presence");
+        check(d.getTrailerStr(sInput) == trailer, "Wrong trailer");
+    }
+}
+
+void test_fail(std::string_view body, HttpChunkedDecoder::status_t expected)
+{
+    HttpChunkedDecoder d;
+    for (size_t sPieceSize = 1; sPieceSize <= body.size(); sPieceSize++)
+    {
+        Result sRes = decode(d, body, sPieceSize);
+        check(sRes.m_Status == expected, "Wrong result");
+    }
+}
+
+void test_massive()
+{
+    const size_t COUNT = 1024;
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        std::string sBody;
+        std::string sData;
+        size_t sNumChunks = rand() % 8;
+        for (size_t j = 0; j < sNumChunks; j++)
+        {
+            size_t sSize = 1 + rand() % 300;
+            std::string sChunk(sSize, 'a' + rand() % 26);
+            char sSizeLine[32];
+            snprintf(sSizeLine, sizeof(sSizeLine), (rand() & 1) ? "%zx" : "%zX", sSize);
+            sBody += sSizeLine;
+            if (rand() & 1)
+                sBody += " ; name=value";
+            sBody += "\r\n" + sChunk + "\r\n";
+            sData += sChunk;
+        }
+        sBody += "0\r\n\r\n";
+
+        HttpChunkedDecoder d;
+        Result sRes = decode(d, sBody, 1 + rand() % 64);
+        check(sRes.m_Status == HttpChunkedDecoder::SUCCESS, "Not success");
+        check(sRes.m_Eaten == sBody.size(), "Wrong number of eaten bytes");
+        check(sRes.m_Data == sData, "Wrong data");
+    }
+}
+
+int main()
+{
+    try
+    {
+        check_err(HttpChunkedDecoder::SUCCESS, "Success");
+        check_err(HttpChunkedDecoder::ERROR_NOT_A_HEX_DIGIT_CHUNK_SIZE, "Not a hex digit in chunk size");
+        check_err(HttpChunkedDecoder::ERROR_TOO_BIG_CHUNK_SIZE, "Too big chunk size");
+        check_err(HttpChunkedDecoder::ERROR_WRONG_CHUNK_SIZE_LINE, "Wrong character in chunk size line");
+        check_err(HttpChunkedDecoder::ERROR_NO_CRLF_AFTER_CHUNK, "No CRLF after chunk data");
+
+        test_pass("0\r\n\r\n", "", "");
+        test_pass("000\n\n", "", "");
+        test_pass("5\r\nhello\r\n0\r\n\r\n", "hello", "");
+        test_pass("5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n", "hello world", "");
+        test_pass("a\r\n0123456789\r\nA\r\n0123456789\r\n0\r\n\r\n", "01234567890123456789", "");
+        test_pass("0000c\r\nhello\r\nworld\r\n0\r\n\r\n", "hello\r\nworld", "");
+        test_pass("5;ext\r\nhello\r\n6 ; a=b;c=\"d\"\r\n world\r\n0 \t;last\r\n\r\n", "hello world", "");
+        test_pass("5\nhello\n0\n\n", "hello", "");
+        test_pass("5\r\nhello\r\n0\r\nExpires: never\r\n\r\n", "hello", "Expires: never\r\n");
+        test_pass("5\r\nhello\r\n0\r\nA: b\r\nC: d\re\r\n\r\n", "hello", "A: b\r\nC: d\re\r\n");
+        test_pass("1\r\n\377\r\n0\r\nA: b\n\n", "\377", "A: b\n");
+
+        test_fail("\r\n", HttpChunkedDecoder::ERROR_NOT_A_HEX_DIGIT_CHUNK_SIZE);
+        test_fail("g\r\n", HttpChunkedDecoder::ERROR_NOT_A_HEX_DIGIT_CHUNK_SIZE);
+        test_fail(" 5\r\nhello\r\n0\r\n\r\n", HttpChunkedDecoder::ERROR_NOT_A_HEX_DIGIT_CHUNK_SIZE);
+        test_fail("-5\r\nhello\r\n0\r\n\r\n", HttpChunkedDecoder::ERROR_NOT_A_HEX_DIGIT_CHUNK_SIZE);
+        test_fail("5\r\nhello\r\n\r\n", HttpChunkedDecoder::ERROR_NOT_A_HEX_DIGIT_CHUNK_SIZE);
+        test_fail("5x\r\nhello\r\n0\r\n\r\n", HttpChunkedDecoder::ERROR_WRONG_CHUNK_SIZE_LINE);
+        test_fail("5 5\r\nhello\r\n0\r\n\r\n", HttpChunkedDecoder::ERROR_WRONG_CHUNK_SIZE_LINE);
+        test_fail("5\rhello\r\n0\r\n\r\n", HttpChunkedDecoder::ERROR_WRONG_CHUNK_SIZE_LINE);
+        test_fail("5\r\nhello!\r\n0\r\n\r\n", HttpChunkedDecoder::ERROR_NO_CRLF_AFTER_CHUNK);
+        test_fail("5\r\nhello\r!\r\n0\r\n\r\n", HttpChunkedDecoder::ERROR_NO_CRLF_AFTER_CHUNK);
+        test_fail("ffffffffffffffff\r\n", HttpChunkedDecoder::IN_PROGRESS);
+        test_fail("10000000000000000\r\n", HttpChunkedDecoder::ERROR_TOO_BIG_CHUNK_SIZE);
+
+        test_massive();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Well done!" << std::endl;
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <HttpContentDecoder.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include <zlib.h>
+
+namespace
+{
+    using status_t = HttpContentDecoder::status_t;
+
+    constexpr std::string_view m_StatusErrors[] = {
+        "",
+        "Success",
+        "Unknown content coding",
+        "Corrupted compressed data",
+        "Out of memory"
+    };
+
+    static_assert(sizeof(m_StatusErrors) / sizeof(m_StatusErrors[0]) == HttpContentDecoder::STATUS_END, "smth went wrong!");
+
+    // Window bits for inflateInit2: gzip only, zlib wrapper, raw deflate.
+    constexpr int GZIP_WINDOW_BITS = MAX_WBITS + 16;
+    constexpr int ZLIB_WINDOW_BITS = MAX_WBITS;
+    constexpr int RAW_WINDOW_BITS = -MAX_WBITS;
+
+    bool equalNoCase(std::string_view a, std::string_view b)
+    {
+        return a.size() == b.size() &&
+               std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return (x | 0x20) == (y | 0x20); });
+    }
+
+    std::string_view trim(std::string_view aStr)
+    {
+        while (!aStr.empty() && (aStr.front() == ' ' || aStr.front() == '\t'))
+            aStr.remove_prefix(1);
+        while (!aStr.empty() && (aStr.back() == ' ' || aStr.back() == '\t'))
+            aStr.remove_suffix(1);
+        return aStr;
+    }
+
+    // RFC1950: compression method 8 and the header is a multiple of 31.
+    bool isZlibHeader(unsigned char aCMF, unsigned char aFLG)
+    {
+        return (aCMF & 0x0f) == Z_DEFLATED && (aCMF * 256u + aFLG) % 31 == 0;
+    }
+} // namespace {
+
+const std::string_view HttpContentDecoder::getErrorStr(status_t s) { return m_StatusErrors[s]; }
+
+HttpContentDecoder::coding_t HttpContentDecoder::coding(std::string_view aContentEncoding)
+{
+    coding_t sRes = IDENTITY;
+    while (!aContentEncoding.empty())
+    {
+        size_t sComma = std::min(aContentEncoding.find(','), aContentEncoding.size());
+        std::string_view sName = trim(aContentEncoding.substr(0, sComma));
+        aContentEncoding.remove_prefix(std::min(sComma + 1, aContentEncoding.size()));
+        if (sName.empty() || equalNoCase(sName, "identity"))
+            continue;
+        // Several codings are applied one after another, that is not supported.
+        if (sRes != IDENTITY)
+            return UNKNOWN;
+        if (equalNoCase(sName, "gzip") || equalNoCase(sName, "x-gzip"))
+            sRes = GZIP;
+        else if (equalNoCase(sName, "deflate"))
+            sRes = DEFLATE;
+        else
+            return UNKNOWN;
+    }
+    return sRes;
+}
+
+HttpContentDecoder::coding_t HttpContentDecoder::coding(std::pair<std::string_view, std::string_view> aContentEncoding)
+{
+    if (aContentEncoding.second.empty())
+        return coding(aContentEncoding.first);
+    std::string sValue(aContentEncoding.first);
+    sValue += aContentEncoding.second;
+    return coding(sValue);
+}
+
+HttpContentDecoder::HttpContentDecoder(coding_t aCoding)
+: m_Coding(aCoding)
+{
+}
+
+HttpContentDecoder::~HttpContentDecoder()
+{
+    if (m_Stream != nullptr)
+    {
+        inflateEnd(m_Stream);
+        delete m_Stream;
+    }
+}
+
+void HttpContentDecoder::reset(coding_t aCoding)
+{
+    m_Coding = aCoding;
+    m_StreamReady = false;
+    m_HasFirstByte = false;
+    m_FirstByte = 0;
+    m_CurrentPos = 0;
+    m_Produced = 0;
+}
+
+status_t HttpContentDecoder::initStream(int aWindowBits)
+{
+    int sRes;
+    if (m_Stream == nullptr)
+    {
+        m_Stream = new (std::nothrow) z_stream{};
+        if (m_Stream == nullptr)
+            return ERROR_OUT_OF_MEMORY;
+        sRes = inflateInit2(m_Stream, aWindowBits);
+        if (sRes != Z_OK)
+        {
+            delete m_Stream;
+            m_Stream = nullptr;
+        }
+    }
+    else
+    {
+        sRes = inflateReset2(m_Stream, aWindowBits);
+    }
+    if (sRes == Z_MEM_ERROR)
+        return ERROR_OUT_OF_MEMORY;
+    if (sRes != Z_OK)
+        return ERROR_CORRUPTED_DATA;
+    m_StreamReady = true;
+    return 0;
+}
+
+status_t HttpContentDecoder::inflateImpl(const char*& aPos, const char* aEnd, char*& aOut, char* aOutEnd)
+{
+    // One more call is needed even without input if the previous one filled the buffer.
+    do
+    {
+        m_Stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(aPos));
+        m_Stream->avail_in = std::min<size_t>(aEnd - aPos, UINT_MAX);
+        m_Stream->next_out = reinterpret_cast<Bytef*>(aOut);
+        m_Stream->avail_out = std::min<size_t>(aOutEnd - aOut, UINT_MAX);
+        int sRes = inflate(m_Stream, Z_NO_FLUSH);
+        const char* sWasPos = aPos;
+        char* sWasOut = aOut;
+        aPos = reinterpret_cast<const char*>(m_Stream->next_in);
+        aOut = reinterpret_cast<char*>(m_Stream->next_out);
+        if (sRes == Z_STREAM_END)
+            return SUCCESS;
+        if (sRes == Z_MEM_ERROR)
+            return ERROR_OUT_OF_MEMORY;
+        // Z_BUF_ERROR only means that no progress was possible.
+        if (sRes != Z_OK && sRes != Z_BUF_ERROR)
+            return ERROR_CORRUPTED_DATA;
+        if (aPos == sWasPos && aOut == sWasOut)
+            break;
+    } while (aPos != aEnd && aOut != aOutEnd);
+    return 0;
+}
+
+size_t HttpContentDecoder::decode(const char* aBegin, const char* aEnd, char* aOut, size_t aOutSize,
+                                  size_t& aProduced, status_t& aStatus)
+{
+    aProduced = 0;
+    aStatus = 0;
+
+    if (m_Coding == IDENTITY)
+    {
+        size_t sSize = std::min(size_t(aEnd - aBegin), aOutSize);
+        memcpy(aOut, aBegin, sSize);
+        aProduced = sSize;
+        m_CurrentPos += sSize;
+        m_Produced += sSize;
+        return sSize;
+    }
+    if (m_Coding == UNKNOWN)
+    {
+        aStatus = ERROR_UNKNOWN_CODING;
+        return 0;
+    }
+
+    const char* sPos = aBegin;
+    char* sOut = aOut;
+    char* sOutEnd = aOut + aOutSize;
+    if (!m_StreamReady)
+    {
+        int sWindowBits = GZIP_WINDOW_BITS;
+        if (m_Coding == DEFLATE)
+        {
+            // "deflate" is meant to be in zlib wrapper, but some servers send raw
+            // deflate data; the first two bytes tell which one it is.
+            if (!m_HasFirstByte && sPos != aEnd)
+            {
+                m_FirstByte = *sPos++;
+                m_HasFirstByte = true;
+            }
+            if (sPos == aEnd)
+            {
+                m_CurrentPos += sPos - aBegin;
+                return sPos - aBegin;
+            }
+            sWindowBits = isZlibHeader(m_FirstByte, *sPos) ? ZLIB_WINDOW_BITS : RAW_WINDOW_BITS;
+        }
+        aStatus = initStream(sWindowBits);
+        if (aStatus == 0 && m_HasFirstByte)
+        {
+            const char* sFirst = &m_FirstByte;
+            aStatus = inflateImpl(sFirst, sFirst + 1, sOut, sOutEnd);
+            m_HasFirstByte = false;
+        }
+    }
+    if (aStatus == 0)
+        aStatus = inflateImpl(sPos, aEnd, sOut, sOutEnd);
+
+    aProduced = sOut - aOut;
+    m_CurrentPos += sPos - aBegin;
+    m_Produced += aProduced;
+    return sPos - aBegin;
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+// Streaming decoder of body with content coding (RFC7231, section 3.1.2.2): gzip
+// and deflate (with or without zlib wrapper, as some servers send it), identity.
+// Works after the body framing, i.e. on the span of data that HttpChunkedDecoder gives
+// out or on Content-Length bytes of the body; the input comes in pieces of any size.
+// Decoded data is written to caller-owned buffers of any size, so the memory is bounded:
+// besides them the decoder uses only the state of zlib (about 40KB with the window).
+// The coding is chosen by the value of Content-Encoding header, see coding().
+// Usage:
+//  HttpContentDecoder d(HttpContentDecoder::coding(getCachedFragment(p, sock, CONTENT_ENCODING)));
+//  while (status == 0) { eaten = d.decode(body, out, sizeof(out), produced, status); ... }
+
+struct z_stream_s;
+
+class HttpContentDecoder
+{
+public:
+    // Value of Accept-Encoding header of a request that allows all supported codings.
+    static constexpr std::string_view ACCEPT_ENCODING = "gzip, deflate";
+
+    // Supported content codings.
+    enum coding_t
+    {
+        IDENTITY = 0,
+        GZIP,
+        DEFLATE,
+        // Some other coding or several of them, the body can't be decoded.
+        UNKNOWN,
+    };
+
+    // Get the coding by the value of Content-Encoding header (empty if there's no header).
+    // Names are case insensitive, identity in a list of codings is ignored.
+    static coding_t coding(std::string_view aContentEncoding);
+    // The same for the value that is split into two parts, see getCachedFragment.
+    static coding_t coding(std::pair<std::string_view, std::string_view> aContentEncoding);
+
+    // Type of result of decoding.
+    using status_t = uint16_t;
+    enum status_value_t
+    {
+        IN_PROGRESS = 0,
+        SUCCESS,
+        ERROR_UNKNOWN_CODING,
+        ERROR_CORRUPTED_DATA,
+        ERROR_OUT_OF_MEMORY,
+        STATUS_END,
+    };
+
+    explicit HttpContentDecoder(coding_t aCoding = IDENTITY);
+    ~HttpContentDecoder();
+    HttpContentDecoder(const HttpContentDecoder&) = delete;
+    HttpContentDecoder& operator=(const HttpContentDecoder&) = delete;
+
+    // Decode next piece of the input to the buffer [aOut, aOut + aOutSize).
+    // The number of written bytes is stored to aProduced. aStatus is set to SUCCESS
+    // after the end of compressed stream (never for identity, its end is the end of
+    // the body), to appropriate error if the input is invalid and to zero otherwise.
+    // Only in the last case further decoding is allowed.
+    // Return number of eaten characters. It can be less than the size of input only if
+    // the buffer is full (call again with the rest and another buffer) or aStatus is not
+    // zero. Decoded data may be pending even if all the input is eaten, so while the
+    // buffer gets full the decoder must be called again, even with empty input.
+    size_t decode(const char* aBegin, const char* aEnd, char* aOut, size_t aOutSize,
+                  size_t& aProduced, status_t& aStatus);
+    inline size_t decode(std::string_view aInput, char* aOut, size_t aOutSize,
+                         size_t& aProduced, status_t& aStatus);
+
+    // Return number of eaten characters.
+    inline size_t count() const;
+    // Return number of decoded characters.
+    inline size_t produced() const;
+    inline coding_t currentCoding() const;
+
+    // Reset decoding state to the initial, the state of zlib is reused.
+    void reset(coding_t aCoding);
+
+    // Get a description of error status. Actually it's a null-terminating string.
+    static const std::string_view getErrorStr(status_t s);
+
+
+    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
+//private:
+
+    // Initialize zlib for the given window bits (see inflateInit2).
+    status_t initStream(int aWindowBits);
+    // Inflate [aPos, aEnd) to [aOut, aOutEnd), advance both positions, return status.
+    status_t inflateImpl(const char*& aPos, const char* aEnd, char*& aOut, char* aOutEnd);
+
+    coding_t m_Coding;
+    // State of zlib, allocated on the first use.
+    z_stream_s* m_Stream = nullptr;
+    // Whether m_Stream was initialized for the current coding.
+    bool m_StreamReady = false;
+    // Deflate: the first byte that was fed before the wrapper could be checked.
+    bool m_HasFirstByte = false;
+    char m_FirstByte = 0;
+    uint64_t m_CurrentPos = 0;
+    uint64_t m_Produced = 0;
+};
+
+//////////////////////////////////// IMPLEMENTATION ////////////////////////////////////
+size_t HttpContentDecoder::decode(std::string_view aInput, char* aOut, size_t aOutSize,
+                                  size_t& aProduced, status_t& aStatus)
+{
+    return decode(aInput.data(), aInput.data() + aInput.size(), aOut, aOutSize, aProduced, aStatus);
+}
+
+size_t HttpContentDecoder::count() const
+{
+    return m_CurrentPos;
+}
+
+size_t HttpContentDecoder::produced() const
+{
+    return m_Produced;
+}
+
+HttpContentDecoder::coding_t HttpContentDecoder::currentCoding() const
+{
+    return m_Coding;
+}
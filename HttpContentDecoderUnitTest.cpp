@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <HttpContentDecoder.hpp>
+
+#include <assert.h>
+#include <zlib.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <HttpChunkedDecoder.hpp>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+void check_err(HttpContentDecoder::status_t status, std::string_view str)
+{
+    check(HttpContentDecoder::getErrorStr(status) == str, "unexpected error message");
+}
+
+// Compress with zlib, aWindowBits selects the format as in deflateInit2.
+std::string compress(std::string_view aData, int aWindowBits)
+{
+    z_stream sStream{};
+    check(deflateInit2(&sStream, Z_BEST_COMPRESSION, Z_DEFLATED, aWindowBits, 8, Z_DEFAULT_STRATEGY) == Z_OK, "deflateInit2");
+    std::string sRes(deflateBound(&sStream, aData.size()), '\0');
+    sStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(aData.data()));
+    sStream.avail_in = aData.size();
+    sStream.next_out = reinterpret_cast<Bytef*>(sRes.data());
+    sStream.avail_out = sRes.size();
+    check(deflate(&sStream, Z_FINISH) == Z_STREAM_END, "deflate");
+    sRes.resize(sStream.total_out);
+    deflateEnd(&sStream);
+    return sRes;
+}
+
+std::string gzip(std::string_view aData) { return compress(aData, MAX_WBITS + 16); }
+std::string zlib(std::string_view aData) { return compress(aData, MAX_WBITS); }
+std::string raw(std::string_view aData) { return compress(aData, -MAX_WBITS); }
+
+// Decode the input given by pieces of aPieceSize bytes to a buffer of aOutSize bytes.
+// Return decoded data, status and number of eaten bytes.
+struct Result
+{
+    std::string m_Data;
+    HttpContentDecoder::status_t m_Status = 0;
+    size_t m_Eaten = 0;
+};
+
+Result decode(HttpContentDecoder& d, std::string_view aInput, size_t aPieceSize, size_t aOutSize)
+{
+    Result sRes;
+    std::string sOut(aOutSize, '\0');
+    while (sRes.m_Eaten < aInput.size() && 0 == sRes.m_Status)
+    {
+        std::string_view sPiece = aInput.substr(sRes.m_Eaten, aPieceSize);
+        size_t sProduced = aOutSize;
+        // Continue while the buffer gets full: some output may be pending.
+        while ((!sPiece.empty() || sProduced == aOutSize) && 0 == sRes.m_Status)
+        {
+            size_t sEaten = d.decode(sPiece, sOut.data(), aOutSize, sProduced, sRes.m_Status);
+            check(sEaten <= sPiece.size() && sProduced <= aOutSize, "Out of bounds");
+            check(sEaten == sPiece.size() || sProduced == aOutSize || sRes.m_Status != 0, "Stopped without a reason");
+            sRes.m_Data.append(sOut.data(), sProduced);
+            sRes.m_Eaten += sEaten;
+            sPiece.remove_prefix(sEaten);
+        }
+    }
+    check(d.count() == sRes.m_Eaten, "Wrong count");
+    check(d.produced() == sRes.m_Data.size(), "Wrong produced");
+    return sRes;
+}
+
+void test_pass(HttpContentDecoder::coding_t aCoding, std::string_view aBody, std::string_view aData)
+{
+    // Something after the compressed stream must not be eaten.
+    std::string sInput = std::string(aBody) + "HTTP/1.1 200 OK\r\n";
+    HttpContentDecoder d;
+    for (size_t sPieceSize : {size_t(1), size_t(2), size_t(3), size_t(7), size_t(64), sInput.size()})
+    {
+        for (size_t sOutSize : {size_t(1), size_t(5), size_t(100), aData.size() + 1})
+        {
+            d.reset(aCoding);
+            Result sRes = decode(d, aCoding == HttpContentDecoder::IDENTITY ? aBody : sInput, sPieceSize, sOutSize);
+            HttpContentDecoder::status_t sExpected =
+                aCoding == HttpContentDecoder::IDENTITY ? HttpContentDecoder::IN_PROGRESS : HttpContentDecoder::SUCCESS;
+            check(sRes.m_Status == sExpected, "Wrong status");
+            check(sRes.m_Eaten == aBody.size(), "Wrong number of eaten bytes");
+            check(sRes.m_Data == aData, "Wrong data");
+        }
+    }
+}
+
+void test_fail(HttpContentDecoder::coding_t aCoding, std::string_view aBody, HttpContentDecoder::status_t aExpected)
+{
+    HttpContentDecoder d(aCoding);
+    for (size_t sPieceSize = 1; sPieceSize <= aBody.size(); sPieceSize++)
+    {
+        d.reset(aCoding);
+        Result sRes = decode(d, aBody, sPieceSize, 16);
+        check(sRes.m_Status == aExpected, "Wrong result");
+    }
+}
+
+void test_coding()
+{
+    using D = HttpContentDecoder;
+    check(D::coding("") == D::IDENTITY, "Empty");
+    check(D::coding("identity") == D::IDENTITY, "identity");
+    check(D::coding("gzip") == D::GZIP, "gzip");
+    check(D::coding(" GZip\t") == D::GZIP, "GZip");
+    check(D::coding("x-gzip") == D::GZIP, "x-gzip");
+    check(D::coding("deflate") == D::DEFLATE, "deflate");
+    check(D::coding("identity, deflate,") == D::DEFLATE, "list");
+    check(D::coding("gzip, deflate") == D::UNKNOWN, "two codings");
+    check(D::coding("br") == D::UNKNOWN, "br");
+    check(D::coding("zstd") == D::UNKNOWN, "zstd");
+    check(D::coding("gzipp") == D::UNKNOWN, "gzipp");
+    check(D::coding({"gz", "ip"}) == D::GZIP, "split");
+    check(D::coding({"deflate", ""}) == D::DEFLATE, "not split");
+}
+
+void test_chunked()
+{
+    // Content coding is decoded after the transfer coding.
+    std::string sData(10000, 'x');
+    for (size_t i = 0; i < sData.size(); i += 7)
+        sData[i] = 'a' + i % 26;
+    std::string sCompressed = gzip(sData);
+    std::string sBody;
+    for (size_t i = 0; i < sCompressed.size(); i += 100)
+    {
+        std::string_view sChunk = std::string_view(sCompressed).substr(i, 100);
+        char sSizeLine[32];
+        snprintf(sSizeLine, sizeof(sSizeLine), "%zx\r\n", sChunk.size());
+        sBody += sSizeLine + std::string(sChunk) + "\r\n";
+    }
+    sBody += "0\r\n\r\n";
+
+    HttpChunkedDecoder c;
+    HttpContentDecoder d(HttpContentDecoder::GZIP);
+    std::string sRes;
+    char sOut[333];
+    HttpChunkedDecoder::status_t sChunkedStatus = 0;
+    HttpContentDecoder::status_t sStatus = 0;
+    std::string_view sInput = sBody;
+    while (sChunkedStatus == 0)
+    {
+        std::string_view sSpan;
+        sInput.remove_prefix(c.decode(sInput, sSpan, sChunkedStatus));
+        size_t sProduced = sizeof(sOut);
+        while ((!sSpan.empty() || sProduced == sizeof(sOut)) && sStatus == 0)
+        {
+            sSpan.remove_prefix(d.decode(sSpan, sOut, sizeof(sOut), sProduced, sStatus));
+            sRes.append(sOut, sProduced);
+        }
+    }
+    check(sChunkedStatus == HttpChunkedDecoder::SUCCESS && sStatus == HttpContentDecoder::SUCCESS, "Not success");
+    check(sRes == sData, "Wrong data");
+}
+
+int main()
+{
+    try
+    {
+        check_err(HttpContentDecoder::SUCCESS, "Success");
+        check_err(HttpContentDecoder::ERROR_UNKNOWN_CODING, "Unknown content coding");
+        check_err(HttpContentDecoder::ERROR_CORRUPTED_DATA, "Corrupted compressed data");
+        check_err(HttpContentDecoder::ERROR_OUT_OF_MEMORY, "Out of memory");
+
+        test_coding();
+
+        std::string sText;
+        for (size_t i = 0; i < 300; i++)
+            sText += "line " + std::to_string(i % 17) + " of some text\r\n";
+        for (std::string_view sData : {std::string_view(""), std::string_view("a"), std::string_view(sText)})
+        {
+            test_pass(HttpContentDecoder::IDENTITY, sData, sData);
+            test_pass(HttpContentDecoder::GZIP, gzip(sData), sData);
+            test_pass(HttpContentDecoder::DEFLATE, zlib(sData), sData);
+            test_pass(HttpContentDecoder::DEFLATE, raw(sData), sData);
+        }
+
+        std::string sGzip = gzip(sText);
+        test_fail(HttpContentDecoder::UNKNOWN, sGzip, HttpContentDecoder::ERROR_UNKNOWN_CODING);
+        test_fail(HttpContentDecoder::GZIP, zlib(sText), HttpContentDecoder::ERROR_CORRUPTED_DATA);
+        test_fail(HttpContentDecoder::GZIP, sText, HttpContentDecoder::ERROR_CORRUPTED_DATA);
+        test_fail(HttpContentDecoder::DEFLATE, sGzip, HttpContentDecoder::ERROR_CORRUPTED_DATA);
+        std::string sBroken = sGzip;
+        sBroken[sBroken.size() - 6] ^= 1; // CRC32
+        test_fail(HttpContentDecoder::GZIP, sBroken, HttpContentDecoder::ERROR_CORRUPTED_DATA);
+        test_fail(HttpContentDecoder::GZIP, sGzip.substr(0, sGzip.size() - 1), HttpContentDecoder::IN_PROGRESS);
+
+        test_chunked();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Well done!" << std::endl;
+}
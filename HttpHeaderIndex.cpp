@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <HttpHeaderIndex.hpp>
+
+void HttpHeaderIndex::reset()
+{
+    m_Size = 0;
+    m_CurrentHash = HASH_BASIS;
+    m_SavedTagOffsets.fill(0);
+    m_Buckets.fill(NOT_FOUND);
+}
+
+void HttpHeaderIndex::store(uint32_t aHash, bool aEmptyValue)
+{
+    if (aEmptyValue)
+        m_SavedTagOffsets[VALUE_END] = m_SavedTagOffsets[VALUE_BEGIN];
+
+    size_t sIndex = m_Size++;
+    if (sIndex >= m_Capacity)
+        return;
+
+    Entry& e = m_Entries[sIndex];
+    e.m_NameBegin = m_SavedTagOffsets[NAME_BEGIN];
+    e.m_NameEnd = m_SavedTagOffsets[NAME_END];
+    e.m_ValueBegin = m_SavedTagOffsets[VALUE_BEGIN];
+    e.m_ValueEnd = m_SavedTagOffsets[VALUE_END];
+    e.m_Hash = aHash;
+    e.m_Next = NOT_FOUND;
+
+    // Append to the end of the bucket to keep the order of repeated headers.
+    size_t sBucket = e.m_Hash % NUM_BUCKETS;
+    if (m_Buckets[sBucket] == NOT_FOUND)
+        m_Buckets[sBucket] = sIndex;
+    else
+        m_Entries[m_Tails[sBucket]].m_Next = sIndex;
+    m_Tails[sBucket] = sIndex;
+}
+
+bool HttpHeaderIndex::equalNames(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (simpleToLower(a[i]) != simpleToLower(b[i]))
+            return false;
+    return true;
+}
+
+size_t HttpHeaderIndex::find(std::string_view aInput, std::string_view aName) const
+{
+    uint32_t sHash = hash(aName);
+    for (uint32_t i = m_Buckets[sHash % NUM_BUCKETS]; i != NOT_FOUND; i = m_Entries[i].m_Next)
+        if (m_Entries[i].m_Hash == sHash && equalNames(getNameStr(aInput, i), aName))
+            return i;
+    return NOT_FOUND;
+}
+
+size_t HttpHeaderIndex::findNext(std::string_view aInput, size_t aIndex) const
+{
+    const Entry& e = m_Entries[aIndex];
+    std::string_view sName = getNameStr(aInput, aIndex);
+    for (uint32_t i = e.m_Next; i != NOT_FOUND; i = m_Entries[i].m_Next)
+        if (m_Entries[i].m_Hash == e.m_Hash && equalNames(getNameStr(aInput, i), sName))
+            return i;
+    return NOT_FOUND;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+// Index of all header lines of an HTTP response.
+// HttpResponseParser stores only the headers that are known in advance; this index
+// records name and value of every header into a fixed array that is provided by the user,
+// so arbitrary headers can be found later without parsing the response again.
+// The index is filled by the parser itself, see HttpResponseParser::feed with an index:
+// the transitions of its state machine save offsets of names and values in the input
+// stream and calculate a case insensitive hash of every name, in the same pass over
+// the input. So the rules are exactly the parser's ones: the status line is skipped,
+// a line is finished by "\r\n", whitespaces around the value are ignored, lines that
+// are not "name: value" (the name consists of visible characters) are skipped.
+// Names are put in a small hash table, so lookup by name does not rescan the headers.
+
+class HttpHeaderIndex
+{
+public:
+    // Stored header line, offsets in the input stream and the hash of the name.
+    struct Entry
+    {
+        size_t m_NameBegin;
+        size_t m_NameEnd;
+        size_t m_ValueBegin;
+        size_t m_ValueEnd;
+        uint32_t m_Hash;
+        // Next entry in the same hash bucket, NOT_FOUND if none.
+        uint32_t m_Next;
+    };
+    static constexpr size_t NOT_FOUND = UINT32_MAX;
+
+    // Entries are stored to aEntries, no more than aCapacity of them.
+    inline HttpHeaderIndex(Entry* aEntries, size_t aCapacity);
+    template <size_t N>
+    explicit HttpHeaderIndex(std::array<Entry, N>& aEntries) : HttpHeaderIndex(aEntries.data(), N) {}
+
+    // Drop all entries, must be done together with reset (or restart) of the parser.
+    void reset();
+
+    // Number of stored entries, in the order of the input.
+    inline size_t size() const;
+    inline const Entry& operator[](size_t aIndex) const;
+    // Check that there were more headers than the capacity; the rest are not stored.
+    inline bool isOverflowed() const;
+
+    // Case insensitive hash of a header name, the same as calculated during parsing.
+    static constexpr uint32_t hash(std::string_view aName);
+
+    // Find the first entry with the given name (case insensitive), return its number
+    // or NOT_FOUND. aInput is the whole input stream, names are compared with it.
+    size_t find(std::string_view aInput, std::string_view aName) const;
+    // Find the next entry with the same name as aIndex entry has (for repeated headers).
+    size_t findNext(std::string_view aInput, size_t aIndex) const;
+
+    // Wrappers that extract name and value of an entry from whole stream.
+    inline std::string_view getNameStr(std::string_view aInput, size_t aIndex) const;
+    inline std::string_view getValueStr(std::string_view aInput, size_t aIndex) const;
+
+
+    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
+//private:
+
+    // Type of a tag ID - offset that is saved by the parser.
+    using tag_t = uint8_t;
+    enum tag_value_t
+    {
+        DUMMY_TAG = 0,
+        NAME_BEGIN,
+        NAME_END,
+        VALUE_BEGIN,
+        VALUE_END,
+        NUM_TAGS
+    };
+
+    // Number of buckets of hash table, power of two.
+    static constexpr size_t NUM_BUCKETS = 64;
+    // FNV-1a parameters.
+    static constexpr uint32_t HASH_BASIS = 2166136261u;
+    static constexpr uint32_t HASH_PRIME = 16777619u;
+    static constexpr uint8_t simpleToLower(unsigned char c) { return c < 'A' || c > 'Z' ? c : c + 'a' - 'A'; }
+    static constexpr uint32_t hashStep(uint32_t aHash, unsigned char c) { return (aHash ^ simpleToLower(c)) * HASH_PRIME; }
+
+    // Store an entry by saved tags, the line is finished.
+    // If aEmptyValue, the value is empty and VALUE_BEGIN is the end of the line.
+    void store(uint32_t aHash, bool aEmptyValue);
+
+    // Hash of the current name, an accumulator of the parser.
+    uint32_t m_CurrentHash = HASH_BASIS;
+    // Tag positions that are saved by the parser.
+    std::array<size_t, NUM_TAGS> m_SavedTagOffsets = {};
+
+private:
+    // Case insensitive comparison of names.
+    static bool equalNames(std::string_view a, std::string_view b);
+
+    // User's storage of entries.
+    Entry* m_Entries;
+    size_t m_Capacity;
+    // Number of found header lines, can be greater than capacity.
+    size_t m_Size = 0;
+    // First entry of each bucket.
+    std::array<uint32_t, NUM_BUCKETS> m_Buckets;
+    // Last entry of each bucket, valid only if the bucket is not empty.
+    std::array<uint32_t, NUM_BUCKETS> m_Tails;
+};
+
+//////////////////////////////////// IMPLEMENTATION ////////////////////////////////////
+HttpHeaderIndex::HttpHeaderIndex(Entry* aEntries, size_t aCapacity)
+    : m_Entries(aEntries), m_Capacity(aCapacity < NOT_FOUND ? aCapacity : NOT_FOUND - 1)
+{
+    m_Buckets.fill(NOT_FOUND);
+}
+
+size_t HttpHeaderIndex::size() const
+{
+    return m_Size < m_Capacity ? m_Size : m_Capacity;
+}
+
+const HttpHeaderIndex::Entry& HttpHeaderIndex::operator[](size_t aIndex) const
+{
+    return m_Entries[aIndex];
+}
+
+bool HttpHeaderIndex::isOverflowed() const
+{
+    return m_Size > m_Capacity;
+}
+
+constexpr uint32_t HttpHeaderIndex::hash(std::string_view aName)
+{
+    uint32_t sRes = HASH_BASIS;
+    for (char c : aName)
+        sRes = hashStep(sRes, c);
+    return sRes;
+}
+
+std::string_view HttpHeaderIndex::getNameStr(std::string_view aInput, size_t aIndex) const
+{
+    const Entry& e = m_Entries[aIndex];
+    return aInput.substr(e.m_NameBegin, e.m_NameEnd - e.m_NameBegin);
+}
+
+std::string_view HttpHeaderIndex::getValueStr(std::string_view aInput, size_t aIndex) const
+{
+    const Entry& e = m_Entries[aIndex];
+    return aInput.substr(e.m_ValueBegin, e.m_ValueEnd - e.m_ValueBegin);
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <HttpHeaderIndex.hpp>
+#include <HttpResponseParser.hpp>
+
+#include <assert.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+static_assert(HttpHeaderIndex::hash("Content-Length") == HttpHeaderIndex::hash("content-LENGTH"), "Must be case insensitive");
+static_assert(HttpHeaderIndex::hash("Content-Length") != HttpHeaderIndex::hash("Content-Type"), "Bad hash?");
+
+using Header = std::pair<std::string_view, std::string_view>;
+
+// Parse the whole input with the index.
+template <class PARSER>
+void parse(PARSER& aParser, HttpHeaderIndex& aIndex, std::string_view aInput, size_t aPieceSize = SIZE_MAX)
+{
+    HttpResponseParser::status_t res = 0;
+    size_t sEaten = 0;
+    while (res == 0 && sEaten < aInput.size())
+        sEaten += aParser.feed(aInput.substr(sEaten, aPieceSize), res, aIndex);
+    check(res == HttpResponseParser::SUCCESS, "Not success");
+    check(sEaten == aInput.size() && aParser.count() == aInput.size(), "Wrong count");
+}
+
+// Index the input given by pieces of aPieceSize bytes and compare with expected headers.
+void test_index(std::string_view aInput, const std::vector<Header>& aExpected, size_t aPieceSize)
+{
+    std::array<HttpHeaderIndex::Entry, 8> sEntries;
+    HttpHeaderIndex sIndex(sEntries);
+    HttpResponseParser p;
+    parse(p, sIndex, aInput, aPieceSize);
+
+    check(sIndex.isOverflowed() == (aExpected.size() > sEntries.size()), "Wrong overflow");
+    check(sIndex.size() == std::min(aExpected.size(), sEntries.size()), "Wrong size");
+    for (size_t i = 0; i < sIndex.size(); i++)
+    {
+        check(sIndex.getNameStr(aInput, i) == aExpected[i].first, "Wrong name");
+        check(sIndex.getValueStr(aInput, i) == aExpected[i].second, "Wrong value");
+        check(sIndex[i].m_Hash == HttpHeaderIndex::hash(aExpected[i].first), "Wrong hash");
+    }
+}
+
+void test_index(std::string_view aInput, const std::vector<Header>& aExpected)
+{
+    for (size_t sPieceSize = 1; sPieceSize <= aInput.size(); sPieceSize++)
+        test_index(aInput, aExpected, sPieceSize);
+}
+
+void test_lines()
+{
+    test_index("HTTP/1.1 200 OK\r\n\r\n", {});
+    test_index("HTTP/1.1 200 OK\r\nA: b\r\n\r\n", {{"A", "b"}});
+    test_index("HTTP/1.1 200 OK\r\nContent-Length: 12\r\nX-Custom:  some value \t\r\n\r\n",
+               {{"Content-Length", "12"}, {"X-Custom", "some value"}});
+    // Empty values.
+    test_index("HTTP/1.1 200 OK\r\nA:\r\nB: \t \r\nC: c\r\n\r\n", {{"A", ""}, {"B", ""}, {"C", "c"}});
+    // Single '\r' and '\n' do not finish a line.
+    test_index("HTTP/1.1 200 OK\r\r\nA: b\rc\nd\r\r\n\r\n", {{"A", "b\rc\nd"}});
+    // Lines without ':' are skipped, ':' in the value is a part of it.
+    test_index("HTTP/1.1 200 OK\r\nnot a header\r\n: no name\r\nLocation: http://x:80/\r\n\r\n",
+               {{"Location", "http://x:80/"}});
+    // A name is visible characters only, the parser skips such lines too.
+    test_index("HTTP/1.1 200 OK\r\n\nA: b\r\nB : c\r\nLoca tion: d\r\nE\1: f\r\n\r\n", {});
+    // Names that begin as the names of the parser do.
+    test_index("HTTP/1.1 200 OK\r\nLoc: a\r\nLocations: b\r\ncontent-length: 12\r\nContent-Lengthy: 5\r\n\r\n",
+               {{"Loc", "a"}, {"Locations", "b"}, {"content-length", "12"}, {"Content-Lengthy", "5"}});
+    // Overflow.
+    std::string sMany = "HTTP/1.1 200 OK\r\n";
+    std::vector<Header> sExpected;
+    static const std::string_view sNames[] = {"a", "b", "c", "d", "e", "f", "g", "h", "i", "j"};
+    for (std::string_view sName : sNames)
+    {
+        sMany += std::string(sName) + ": " + std::string(sName) + "\r\n";
+        sExpected.emplace_back(sName, sName);
+    }
+    sMany += "\r\n";
+    test_index(sMany, sExpected);
+}
+
+void test_find()
+{
+    std::string_view sInput = "HTTP/1.1 200 OK\r\n"
+                              "Set-Cookie: a=1\r\n"
+                              "Content-Type: text/plain\r\n"
+                              "set-cookie: b=2\r\n"
+                              "X-Empty:\r\n"
+                              "SET-COOKIE: c=3\r\n"
+                              "\r\n";
+    std::array<HttpHeaderIndex::Entry, 16> sEntries;
+    HttpHeaderIndex sIndex(sEntries);
+    HttpResponseParser p;
+    parse(p, sIndex, sInput);
+
+    size_t i = sIndex.find(sInput, "content-type");
+    check(i != HttpHeaderIndex::NOT_FOUND && sIndex.getValueStr(sInput, i) == "text/plain", "Wrong value");
+    check(sIndex.findNext(sInput, i) == HttpHeaderIndex::NOT_FOUND, "Must be single");
+    i = sIndex.find(sInput, "X-EMPTY");
+    check(i != HttpHeaderIndex::NOT_FOUND && sIndex.getValueStr(sInput, i).empty(), "Wrong value");
+    check(sIndex.find(sInput, "Content-Length") == HttpHeaderIndex::NOT_FOUND, "Must not be found");
+    check(sIndex.find(sInput, "Set-Cookie-2") == HttpHeaderIndex::NOT_FOUND, "Must not be found");
+
+    // Repeated headers are found in the order of input.
+    std::string sCookies;
+    for (i = sIndex.find(sInput, "Set-Cookie"); i != HttpHeaderIndex::NOT_FOUND; i = sIndex.findNext(sInput, i))
+        sCookies += sIndex.getValueStr(sInput, i);
+    check(sCookies == "a=1b=2c=3", "Wrong repeated headers");
+
+    // Reset drops everything.
+    sIndex.reset();
+    check(sIndex.size() == 0, "Must be empty");
+    check(sIndex.find(sInput, "Set-Cookie") == HttpHeaderIndex::NOT_FOUND, "Must not be found");
+}
+
+void test_collisions()
+{
+    // More names than buckets, all must be found.
+    std::string sInput = "HTTP/1.1 200 OK\r\n";
+    std::vector<std::string> sNames;
+    for (size_t i = 0; i < 300; i++)
+    {
+        sNames.push_back("X-Header-" + std::to_string(i));
+        sInput += sNames.back() + ": " + std::to_string(i) + "\r\n";
+    }
+    sInput += "\r\n";
+    std::vector<HttpHeaderIndex::Entry> sEntries(sNames.size());
+    HttpHeaderIndex sIndex(sEntries.data(), sEntries.size());
+    HttpResponseParser p;
+    parse(p, sIndex, sInput);
+    check(sIndex.size() == sNames.size() && !sIndex.isOverflowed(), "Wrong size");
+    for (size_t i = 0; i < sNames.size(); i++)
+    {
+        size_t sFound = sIndex.find(sInput, sNames[i]);
+        check(sFound == i, "Wrong entry");
+        check(sIndex.getValueStr(sInput, sFound) == std::to_string(i), "Wrong value");
+    }
+}
+
+void test_repeated()
+{
+    // A lot of lines with the same name, all in one bucket.
+    std::string sInput = "HTTP/1.1 200 OK\r\n";
+    for (size_t i = 0; i < 50; i++)
+        sInput += "Set-Cookie: " + std::to_string(i) + "\r\nX-" + std::to_string(i) + ": x\r\n";
+    sInput += "\r\n";
+    std::vector<HttpHeaderIndex::Entry> sEntries(100);
+    HttpHeaderIndex sIndex(sEntries.data(), sEntries.size());
+    HttpResponseParser p;
+    parse(p, sIndex, sInput);
+    size_t sCount = 0;
+    for (size_t i = sIndex.find(sInput, "set-cookie"); i != HttpHeaderIndex::NOT_FOUND; i = sIndex.findNext(sInput, i))
+        check(sIndex.getValueStr(sInput, i) == std::to_string(sCount++), "Wrong order of repeated headers");
+    check(sCount == 50, "Wrong number of repeated headers");
+}
+
+void test_parser()
+{
+    // Index and known headers of the parser must agree.
+    std::string_view sInput = "HTTP/1.1 301 Moved\r\n"
+                              "Server: test\r\n"
+                              "content-length:  0 \r\n"
+                              "Location: /there\r\n"
+                              "\r\n"
+                              "HTTP/1.1 200 OK\r\n";
+    HttpResponseParser p;
+    std::array<HttpHeaderIndex::Entry, 4> sEntries;
+    HttpHeaderIndex sIndex(sEntries);
+    HttpResponseParser::status_t res = 0;
+    size_t sEaten = 0;
+    for (size_t sPiece = 1; res == 0 && sEaten < sInput.size(); sPiece++)
+        sEaten += p.feed(sInput.substr(sEaten, sPiece), res, sIndex);
+    check(res == HttpResponseParser::SUCCESS, "Not success");
+    check(sEaten == sInput.size() - 17, "Must stop at the end of the header");
+    check(sIndex.size() == 3, "Wrong size");
+    for (HttpResponseParser::fragment_t f = HttpResponseParser::CONTENT_TYPE; f < HttpResponseParser::HEADER_MAX; f++)
+    {
+        size_t i = sIndex.find(sInput, HttpResponseParser::HeaderNames[f - HttpResponseParser::SPECIAL_MAX]);
+        check((i != HttpHeaderIndex::NOT_FOUND) == p.isFragmentFound(f), "Must be found by both");
+        if (i != HttpHeaderIndex::NOT_FOUND)
+            check(sIndex.getValueStr(sInput, i) == p.getFragmentStr(sInput, f), "Must be the same");
+    }
+    check(sIndex.getValueStr(sInput, sIndex.find(sInput, "server")) == "test", "Wrong value");
+}
+
+int main()
+{
+    try
+    {
+        test_lines();
+        test_find();
+        test_collisions();
+        test_repeated();
+        test_parser();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Well done!" << std::endl;
+}
@@ -25,9 +25,18 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <array>
-#include <climits>
+#include <cstdint>
+#include <limits>
+#include <string>
 #include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include <HttpHeaderIndex.hpp>
+#include <HttpResponseParserBase.hpp>
+#include <HttpResponseStateMachine.hpp>
 
 // RFC7230 status line and header parser of an HTTP response.
 // The parser is implemented for the fastest parsing of incoming byte stream, so
@@ -35,51 +44,35 @@
 // The parser stores a fixed number of tag pairs. Each tag is an offset (byte number)
 // in the input stream; a pair of tags thus represents a fragment in the input stream in standard
 // way: offset of the first byte and offset of the next after the last byte of the fragment.
+// The set of headers to store is given by template parameters - references to header names
+// (case insensitive, visible characters only), for example:
+//  using Parser = BasicHttpResponseParser<HttpHeaderName::ETAG, HttpHeaderName::LAST_MODIFIED>;
+// Each set of headers has its own state machine, built in compile time.
+// OFFSET is an unsigned integer type of stored offsets. A narrow type makes the parser
+// smaller (that matters when there is a parser per connection and a lot of connections)
+// but limits the size of the header: ERROR_HEADER_TOO_LONG is returned when the header
+// does not fit. BasicHttpResponseParser has size_t offsets, i.e. no practical limit.
 
-class HttpResponseParser
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+class GenericHttpResponseParser : public HttpResponseParserBase
 {
 public:
-    // Standard fragments that will be stored.
-    enum special_t
+    static_assert(std::is_unsigned_v<OFFSET>, "Offset must be of an unsigned type");
+    // Maximal number of characters in the header.
+    static constexpr size_t MAX_HEADER_SIZE = std::numeric_limits<OFFSET>::max();
+    // Number of stored headers.
+    static constexpr size_t NUM_HEADERS = sizeof...(HEADER_NAMES);
+    // Header-value fragments follow special fragments in the order of template parameters.
+    static constexpr fragment_t HEADER_MAX = SPECIAL_MAX + NUM_HEADERS;
+    // Get fragment ID of a header by its name (must be one of HEADER_NAMES).
+    // Defined here to be usable in the header IDs of derived classes.
+    static constexpr fragment_t header(std::string_view aName)
     {
-        MAJOR_VERSION = 0,
-        MINOR_VERSION,
-        STATUS_CODE,
-        REASON_PHRASE,
-        SPECIAL_MAX
-    };
-
-    // Header-value fragments to store.
-    // If you need any other header to store, just add into that enum
-    //  any desired header name and fix corresponding m_HeaderNames in cpp file.
-    enum header_t
-    {
-        CONTENT_TYPE = SPECIAL_MAX,
-        CONTENT_LENGTH,
-        TRANSFER_ENCODING,
-        LOCATION,
-        HEADER_MAX
-    };
-
-    // Type of ID of fragment. One of header_t or special_t.
-    using fragment_t = uint16_t;
-    // Type of a tag ID - beginning or end position of a fragment.
-    using tag_t = fragment_t;
-    // Type of ID of a parsing state.
-    using state_t = uint32_t;
-    // Type of result of parsing one byte of the stream.
-    using status_t = uint16_t;
-    enum status_value_t
-    {
-        IN_PROGRESS = 0,
-        SUCCESS,
-        ERROR_NOT_HTTP,
-        ERROR_NOT_A_DIGIT_MAJOR_VERSION,
-        ERROR_NOT_A_DIGIT_MINOR_VERSION,
-        ERROR_NOT_A_DIGIT_STATUS_CODE,
-        ERROR_WRONG_LENGTH_OF_STATUS_CODE,
-        STATUS_END,
-    };
+        fragment_t sRes = SPECIAL_MAX;
+        while (sRes < HEADER_MAX && HeaderNames[sRes - SPECIAL_MAX] != aName)
+            sRes++;
+        return sRes;
+    }
 
     // Feed the parser another character.
     // If it is the last character in the header - return SUCCESS.
@@ -87,130 +80,509 @@ public:
     // Otherwise - return 0. Only in this case further feeding is allowed.
     inline status_t feed(char c);
 
+    // Feed the parser a range of characters, same as calling feed(char) for each of them.
+    // Stops right after the character that gave nonzero status (SUCCESS or some error),
+    // or at the end of the range. The status is stored to aStatus (zero if more data is needed).
+    // Return number of characters eaten from the range; the rest (for instance the beginning
+    // of the body) is left untouched and can be handed on.
+    inline size_t feed(const char* aBegin, const char* aEnd, status_t& aStatus);
+    inline size_t feed(std::string_view aData, status_t& aStatus);
+    // Same as above, but also record all header lines (not only HEADER_NAMES) to aIndex.
+    // That is done by the transitions of the parser in the same pass (by another state
+    // machine that has index actions), so a stream must be fed either always with an index
+    // or always without it. aIndex must be reset together with the parser (and at restart).
+    inline size_t feed(const char* aBegin, const char* aEnd, status_t& aStatus, HttpHeaderIndex& aIndex);
+    inline size_t feed(std::string_view aData, status_t& aStatus, HttpHeaderIndex& aIndex);
+    // Same as feed, but stop with an error when the header exceeds aLimits, see Limits.
+    // aLimits is kept for the stream, it follows reset and restart of the parser by itself.
+    inline size_t feed(const char* aBegin, const char* aEnd, status_t& aStatus, Limits& aLimits);
+    inline size_t feed(std::string_view aData, status_t& aStatus, Limits& aLimits);
+
+    // Feed several independent (different) parsers, each with its own range of characters, at once.
+    // The same as calling aParsers[i]->feed(aData[i], aStatus[i]) for each parser and
+    // storing its result to aEaten[i], but the streams are advanced in lockstep: the steps
+    // of different streams do not depend on each other, so the CPU can overlap their
+    // table lookups instead of waiting for each of them.
+    // Makes sense for several connections that have their buffers ready at the same time.
+    // PARSER is GenericHttpResponseParser or a class derived from it.
+    template <class PARSER>
+    static void feedMany(size_t aCount, PARSER* const* aParsers,
+                         const std::string_view* aData, status_t* aStatus, size_t* aEaten);
+
     // Return number of eaten characters.
     inline size_t count() const;
 
     // Reset parsing state to the initial.
     inline void reset();
+    // Continue with the next response in the same stream, for pipelined HTTP/1.1 responses
+    // that follow each other in one buffer. The next response begins aSkip bytes (for instance
+    // the body of the current response) after the current position.
+    // Unlike reset, the position keeps counting from the beginning of the stream, so fragments
+    // of all the responses are offsets in the same buffer, and saved tags are not cleared.
+    // The position is limited by MAX_HEADER_SIZE as the header itself is.
+    inline void restart(size_t aSkip = 0);
 
-    // Get a description of error status. Actually it's a null-terminating string.
-    static const std::string_view getErrorStr(status_t s);
-
-    // Check that a fragment (special_t or header_t) was found in the input stream.
+    // Check that a fragment (special_t or header) was found in the input stream.
     inline bool isFragmentFound(fragment_t aFragment) const;
     // Get begin and end offsets of a fragment (return (0, 0) if not found after a successful parsing).
     // isFragmentFound must be checked before using that if the parsing was not finished successfully!
     inline std::pair<size_t, size_t> getFragment(fragment_t aFragment) const;
     // Wrapper that extracts fragment substring from whole stream (empty if not found).
-    inline std::string_view getFragmentStr(std::string_view sInput, fragment_t aFragment);
+    inline std::string_view getFragmentStr(std::string_view sInput, fragment_t aFragment) const;
+    // Same as above, but the input stream consists of two parts, for instance when it
+    // is stored in a cycled buffer: aFirst is followed by aSecond. The fragment is returned
+    // as one (and an empty second) or two parts if it is split by the border.
+    inline std::pair<std::string_view, std::string_view>
+    getFragmentStr(std::string_view aFirst, std::string_view aSecond, fragment_t aFragment) const;
+
+    // Numeric values that are calculated during parsing, valid after a successful parsing.
+    // Status code as a number.
+    inline uint64_t statusCode() const;
+    // Value of Content-Length header if it is one of HEADER_NAMES, found and is a valid
+    // decimal number of up to MAX_CONTENT_LENGTH_DIGITS significant digits; INVALID_NUMBER otherwise.
+    inline uint64_t contentLength() const;
+
+    // Report of the state machine profile: hot states and transitions, see HttpResponseParserProfile.
+    // Nothing is counted unless the code is built with HTTP_RESPONSE_PARSER_PROFILE.
+    static std::string profileReport(size_t aTop = 20);
 
 
     //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
-    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
-    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
-    // All staff below must be actually a private part of a class.
-    // But that would significantly complicate constexpr building of the state machine in cpp file.
-    // I think that public internals is lesser evil than huge header file or extern friend functions/classes.
 //private:
 
     // Total number of tags.
     static constexpr size_t NUM_TAGS = HEADER_MAX * 2 + 1;
-    // Storage offset for the beginning of the fragment.
-    static constexpr tag_t tagBegin(fragment_t frag) { return (frag * 2) + 1; }
-    // Storage offset for the end of the fragment.
-    static constexpr tag_t tagEnd  (fragment_t frag) { return (frag + 1) * 2; }
-    // Special offseat in a storage that stores useless thing; private part of implementation.
-    static constexpr tag_t DUMMY_TAG = 0;
 
-    // State machine!
+    static constexpr std::array<std::string_view, NUM_HEADERS> HeaderNames = {HEADER_NAMES...};
+    // Fragment of Content-Length header, HEADER_MAX if it's not stored.
+    static constexpr fragment_t CONTENT_LENGTH_FRAGMENT =
+        SPECIAL_MAX + details::findContentLength(HeaderNames.data(), NUM_HEADERS);
 
-    // Transition from one state to another.
-    struct Transition
-    {
-        // This transition leads to that state.
-        state_t m_State = 0;
-        // In that tag the current position must be saved.
-        tag_t m_Tag = DUMMY_TAG;
-        // Status after this transition: zero if more bytes are needed,
-        // nonzero if this is a final transition (SUCCESS or some ERROR..).
-        status_t m_Status = 0;
-    };
+    // The instances of the state machine, built in compile time.
+    // The full state machine is not used for parsing, it is kept for comparison.
+    static constexpr state_t MAX_NUM_CONDITIONS = details::maxNumConditions(HeaderNames.data(), NUM_HEADERS);
+    static constexpr StateMachine<MAX_NUM_CONDITIONS> TheStateMachine =
+        details::makeStateMachine<MAX_NUM_CONDITIONS>(HeaderNames.data(), NUM_HEADERS);
+    static constexpr state_t NUM_CONDITIONS = TheStateMachine.m_NumConditions;
+    static constexpr size_t NUM_CLASSES = details::countByteClasses(TheStateMachine);
+    static constexpr CompactStateMachine<NUM_CONDITIONS, NUM_CLASSES> TheCompactStateMachine =
+        details::makeCompactStateMachine<NUM_CONDITIONS, NUM_CLASSES>(TheStateMachine);
 
-    // A set of transitions by each input byte.
-    struct Conditions
+    // The same with index actions, see feed with an index. It is built only if that feed
+    // is used: members of a class template are instantiated on use.
+    template <bool INDEXED = true>
+    struct Indexed
     {
-        // Transitions by each input byte.
-        static constexpr size_t NUM_TRANSITIONS = 1 << CHAR_BIT;
-        std::array<Transition, NUM_TRANSITIONS> m_Transitions;
+        static constexpr state_t MAX_NUM_CONDITIONS = details::maxNumConditions(HeaderNames.data(), NUM_HEADERS, INDEXED);
+        static constexpr StateMachine<MAX_NUM_CONDITIONS> TheStateMachine =
+            details::makeStateMachine<MAX_NUM_CONDITIONS>(HeaderNames.data(), NUM_HEADERS, INDEXED);
+        static constexpr state_t NUM_CONDITIONS = TheStateMachine.m_NumConditions;
+        static constexpr size_t NUM_CLASSES = details::countByteClasses(TheStateMachine);
+        static constexpr CompactStateMachine<NUM_CONDITIONS, NUM_CLASSES> TheCompactStateMachine =
+            details::makeCompactStateMachine<NUM_CONDITIONS, NUM_CLASSES>(TheStateMachine);
 
-        const Transition& operator[](unsigned char c) const { return m_Transitions[c]; }
+        static_assert(details::checkStatusLinePrefix(TheStateMachine), "Unexpected status line states");
+        static_assert(NUM_CONDITIONS * NUM_CLASSES <= UINT16_MAX, "Too many headers");
     };
 
-    // Conditions of each state. The start in state 0.
-    struct StateMachine
-    {
-        static constexpr state_t MAX_NUM_CONDITIONS = 128;
-        state_t m_NumConditions = 0;
-        std::array<Conditions, MAX_NUM_CONDITIONS> m_Conditions = {};
-
-        const Conditions& operator[](state_t s) const { return m_Conditions[s]; }
-    };
+    static_assert(details::checkUnrollSafety(TheStateMachine), "First states must not save tags");
+    static_assert(details::checkStatusLinePrefix(TheStateMachine), "Unexpected status line states");
+    static_assert(details::checkLineStart(TheStateMachine), "Unexpected line start state");
+    static_assert(NUM_CONDITIONS * NUM_CLASSES <= UINT16_MAX, "Too many headers");
+    static_assert(NUM_TAGS <= UINT8_MAX, "Too many headers");
+    static_assert(STATUS_END <= UINT8_MAX, "Overflow?");
 
 private:
+    // Maximal number of streams that are advanced in lockstep, see feedMany.
+    // States of all of them are expected to be kept in registers.
+    static constexpr size_t FEED_MANY_MAX = 8;
+    // feedMany for no more than FEED_MANY_MAX streams.
+    template <class PARSER>
+    static void feedGroup(size_t aCount, PARSER* const* aParsers,
+                          const std::string_view* aData, status_t* aStatus, size_t* aEaten);
+    // Advance N streams (given by indexes in aIndex) by aLength characters in lockstep.
+    // Stop earlier at a final transition in any stream.
+    template <size_t N, class PARSER>
+    static void feedLockstep(const size_t* aIndex, size_t aLength, PARSER* const* aParsers,
+                             const std::string_view* aData, status_t* aStatus, size_t* aEaten);
+    // Call feedLockstep<N> with N == aNumActive.
+    template <size_t N, class PARSER>
+    static void dispatchLockstep(size_t aNumActive, const size_t* aIndex, size_t aLength, PARSER* const* aParsers,
+                                 const std::string_view* aData, status_t* aStatus, size_t* aEaten);
 
-    // The instance of the state machine.
-    // It could be made as static constexpr instance but that would make us
-    //  to include all the construction to the header.
-    // Let it be extern reference to a constexpr instance.
-    static const StateMachine& TheStateMachine;
-
-    // Variables of parsing state.
-    // State in state machine.
+protected:
+    // Variables of parsing state, the widest first to avoid padding.
+    // Calculated numbers.
+    Numbers m_Numbers;
+    // State in compact state machine (offset of its row).
     state_t m_CurrentState = 0;
     // Number of characters that was consumed.
-    state_t m_CurrentPos = 0;
+    OFFSET m_CurrentPos = 0;
     // Saved tag positions.
-    std::array<size_t, NUM_TAGS> m_SavedTagOffsets = {};
+    std::array<OFFSET, NUM_TAGS> m_SavedTagOffsets = {};
+};
+
+template <const std::string_view& ...HEADER_NAMES>
+using BasicHttpResponseParser = GenericHttpResponseParser<size_t, HEADER_NAMES...>;
+
+// Names of some headers, to be used as template parameters of BasicHttpResponseParser.
+struct HttpHeaderName
+{
+    static constexpr std::string_view CONTENT_TYPE = "Content-Type";
+    static constexpr std::string_view CONTENT_LENGTH = "Content-Length";
+    static constexpr std::string_view CONTENT_RANGE = "Content-Range";
+    static constexpr std::string_view CONTENT_ENCODING = "Content-Encoding";
+    static constexpr std::string_view TRANSFER_ENCODING = "Transfer-Encoding";
+    static constexpr std::string_view LOCATION = "Location";
+    static constexpr std::string_view CONNECTION = "Connection";
+    static constexpr std::string_view ETAG = "ETag";
+    static constexpr std::string_view LAST_MODIFIED = "Last-Modified";
 };
 
+// The default set of headers with the given type of offsets.
+template <class OFFSET>
+class HttpResponseParserWithOffset : public GenericHttpResponseParser<OFFSET,
+                                                                      HttpHeaderName::CONTENT_TYPE,
+                                                                      HttpHeaderName::CONTENT_LENGTH,
+                                                                      HttpHeaderName::TRANSFER_ENCODING,
+                                                                      HttpHeaderName::LOCATION>
+{
+public:
+    using Base = GenericHttpResponseParser<OFFSET,
+                                           HttpHeaderName::CONTENT_TYPE,
+                                           HttpHeaderName::CONTENT_LENGTH,
+                                           HttpHeaderName::TRANSFER_ENCODING,
+                                           HttpHeaderName::LOCATION>;
+
+    // Header-value fragments to store. IDs are taken by the names, so any other header
+    // needs only its name here and in the template arguments above (that is checked).
+    enum header_t
+    {
+        CONTENT_TYPE = Base::header(HttpHeaderName::CONTENT_TYPE),
+        CONTENT_LENGTH = Base::header(HttpHeaderName::CONTENT_LENGTH),
+        TRANSFER_ENCODING = Base::header(HttpHeaderName::TRANSFER_ENCODING),
+        LOCATION = Base::header(HttpHeaderName::LOCATION),
+        HEADER_MAX = Base::HEADER_MAX
+    };
+    static_assert(CONTENT_TYPE < HEADER_MAX && CONTENT_LENGTH < HEADER_MAX &&
+                  TRANSFER_ENCODING < HEADER_MAX && LOCATION < HEADER_MAX, "Header is not stored");
+};
+
+// The default parser.
+class HttpResponseParser : public HttpResponseParserWithOffset<size_t>
+{
+};
+
+// The default set of headers and Connection, that is needed to reuse the connection
+// (see keepAliveFromCache). It's not in the default set to keep HttpResponseParser16
+// in a cache line.
+class KeepAliveHttpResponseParser : public GenericHttpResponseParser<size_t,
+                                                                     HttpHeaderName::CONTENT_TYPE,
+                                                                     HttpHeaderName::CONTENT_LENGTH,
+                                                                     HttpHeaderName::TRANSFER_ENCODING,
+                                                                     HttpHeaderName::LOCATION,
+                                                                     HttpHeaderName::CONNECTION>
+{
+public:
+    using Base = GenericHttpResponseParser<size_t,
+                                           HttpHeaderName::CONTENT_TYPE,
+                                           HttpHeaderName::CONTENT_LENGTH,
+                                           HttpHeaderName::TRANSFER_ENCODING,
+                                           HttpHeaderName::LOCATION,
+                                           HttpHeaderName::CONNECTION>;
+
+    // The same as in HttpResponseParserWithOffset.
+    enum header_t
+    {
+        CONTENT_TYPE = Base::header(HttpHeaderName::CONTENT_TYPE),
+        CONTENT_LENGTH = Base::header(HttpHeaderName::CONTENT_LENGTH),
+        TRANSFER_ENCODING = Base::header(HttpHeaderName::TRANSFER_ENCODING),
+        LOCATION = Base::header(HttpHeaderName::LOCATION),
+        CONNECTION = Base::header(HttpHeaderName::CONNECTION),
+        HEADER_MAX = Base::HEADER_MAX
+    };
+    static_assert(CONTENT_TYPE < HEADER_MAX && CONTENT_LENGTH < HEADER_MAX && TRANSFER_ENCODING < HEADER_MAX &&
+                  LOCATION < HEADER_MAX && CONNECTION < HEADER_MAX, "Header is not stored");
+};
+
+// The default parser with narrow offsets, for a lot of simultaneous connections.
+// HttpResponseParser16 fits in a cache line, but its header is limited by 64KB.
+using HttpResponseParser16 = HttpResponseParserWithOffset<uint16_t>;
+using HttpResponseParser32 = HttpResponseParserWithOffset<uint32_t>;
+
 //////////////////////////////////// IMPLEMENTATION ////////////////////////////////////
-HttpResponseParser::status_t HttpResponseParser::feed(char c)
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+HttpResponseParserBase::status_t GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::feed(char c)
+{
+    return feedImpl(TheCompactStateMachine, m_CurrentState, m_CurrentPos, m_SavedTagOffsets, m_Numbers, c);
+}
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+size_t GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::feed(const char* aBegin, const char* aEnd, status_t& aStatus)
+{
+    return feedImpl(TheCompactStateMachine, m_CurrentState, m_CurrentPos, m_SavedTagOffsets, m_Numbers,
+                    aBegin, aEnd, aStatus);
+}
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+size_t GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::feed(std::string_view aData, status_t& aStatus)
+{
+    return feed(aData.data(), aData.data() + aData.size(), aStatus);
+}
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+size_t GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::feed(const char* aBegin, const char* aEnd, status_t& aStatus,
+                                                                HttpHeaderIndex& aIndex)
+{
+    return indexedFeedImpl(Indexed<>::TheCompactStateMachine, m_CurrentState, m_CurrentPos, m_SavedTagOffsets, m_Numbers,
+                           aIndex, aBegin, aEnd, aStatus);
+}
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+size_t GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::feed(std::string_view aData, status_t& aStatus,
+                                                                HttpHeaderIndex& aIndex)
+{
+    return feed(aData.data(), aData.data() + aData.size(), aStatus, aIndex);
+}
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+size_t GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::feed(const char* aBegin, const char* aEnd, status_t& aStatus,
+                                                                Limits& aLimits)
+{
+    return limitedFeedImpl(TheCompactStateMachine, m_CurrentState, m_CurrentPos, m_SavedTagOffsets, m_Numbers, aLimits,
+                           aBegin, aEnd, aStatus);
+}
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+size_t GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::feed(std::string_view aData, status_t& aStatus,
+                                                                Limits& aLimits)
 {
-    const Transition& t = TheStateMachine[m_CurrentState][c];
-    m_CurrentState = t.m_State;
-    m_SavedTagOffsets[t.m_Tag] = m_CurrentPos++;
-    return t.m_Status;
+    return feed(aData.data(), aData.data() + aData.size(), aStatus, aLimits);
+}
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+template <class PARSER>
+void GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::feedMany(size_t aCount, PARSER* const* aParsers,
+                                                                  const std::string_view* aData, status_t* aStatus, size_t* aEaten)
+{
+    static_assert(std::is_base_of_v<GenericHttpResponseParser, PARSER>, "Wrong parser type");
+    std::fill(aStatus, aStatus + aCount, 0);
+    std::fill(aEaten, aEaten + aCount, 0);
+    for (size_t i = 0; i < aCount; i += FEED_MANY_MAX)
+    {
+        size_t sCount = std::min(aCount - i, FEED_MANY_MAX);
+        feedGroup(sCount, aParsers + i, aData + i, aStatus + i, aEaten + i);
+    }
+}
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+template <class PARSER>
+void GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::feedGroup(size_t aCount, PARSER* const* aParsers,
+                                                                   const std::string_view* aData, status_t* aStatus, size_t* aEaten)
+{
+    while (true)
+    {
+        // Collect streams that are in progress and have more data.
+        size_t sIndex[FEED_MANY_MAX];
+        size_t sNumActive = 0;
+        size_t sMinLeft = SIZE_MAX;
+        for (size_t i = 0; i < aCount; i++)
+        {
+            if (0 != aStatus[i])
+                continue;
+            size_t sLeft = aData[i].size() - aEaten[i];
+            if (sLeft == 0)
+                continue;
+            if constexpr (isLimitedPos<OFFSET>())
+            {
+                // Do not let offsets overflow, the same as feed does.
+                size_t sRoom = MAX_HEADER_SIZE - aParsers[i]->m_CurrentPos;
+                if (sRoom == 0)
+                {
+                    aStatus[i] = ERROR_HEADER_TOO_LONG;
+                    continue;
+                }
+                sLeft = std::min(sLeft, sRoom);
+            }
+            GenericHttpResponseParser* p = aParsers[i];
+            const char* sBegin = aData[i].data() + aEaten[i];
+            if (statusLineImpl(TheCompactStateMachine, p->m_CurrentState, p->m_CurrentPos, p->m_Numbers.accumulator(),
+                               p->m_SavedTagOffsets, p->m_Numbers, sBegin, sBegin + sLeft))
+            {
+                aEaten[i] += STATUS_LINE_PREFIX_SIZE;
+                sLeft -= STATUS_LINE_PREFIX_SIZE;
+                if (sLeft == 0)
+                    continue;
+            }
+            sIndex[sNumActive++] = i;
+            sMinLeft = std::min(sMinLeft, sLeft);
+        }
+        if (sNumActive == 0)
+            return;
+        dispatchLockstep<FEED_MANY_MAX>(sNumActive, sIndex, sMinLeft, aParsers, aData, aStatus, aEaten);
+    }
+}
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+template <size_t N, class PARSER>
+void GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::dispatchLockstep(size_t aNumActive, const size_t* aIndex, size_t aLength,
+                                                                          PARSER* const* aParsers, const std::string_view* aData,
+                                                                          status_t* aStatus, size_t* aEaten)
+{
+    if constexpr (N == 1)
+    {
+        // Nothing to interleave with.
+        size_t i = aIndex[0];
+        const char* sBegin = aData[i].data() + aEaten[i];
+        aEaten[i] += aParsers[i]->feed(sBegin, aData[i].data() + aData[i].size(), aStatus[i]);
+    }
+    else
+    {
+        if (aNumActive == N)
+            feedLockstep<N>(aIndex, aLength, aParsers, aData, aStatus, aEaten);
+        else
+            dispatchLockstep<N - 1>(aNumActive, aIndex, aLength, aParsers, aData, aStatus, aEaten);
+    }
 }
 
-size_t HttpResponseParser::count() const
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+template <size_t N, class PARSER>
+void GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::feedLockstep(const size_t* aIndex, size_t aLength,
+                                                                      PARSER* const* aParsers, const std::string_view* aData,
+                                                                      status_t* aStatus, size_t* aEaten)
+{
+    // Only states and accumulators are changed, they are to be kept in registers.
+    std::array<GenericHttpResponseParser*, N> sParsers;
+    std::array<const char*, N> sData;
+    std::array<OFFSET*, N> sOffsets;
+    std::array<OFFSET, N> sCount;
+    std::array<state_t, N> sState;
+    std::array<uint64_t, N> sAccumulator;
+    for (size_t k = 0; k < N; k++)
+    {
+        size_t i = aIndex[k];
+        sParsers[k] = aParsers[i];
+        sData[k] = aData[i].data() + aEaten[i];
+        sOffsets[k] = sParsers[k]->m_SavedTagOffsets.data();
+        sCount[k] = sParsers[k]->m_CurrentPos;
+        sState[k] = sParsers[k]->m_CurrentState;
+        sAccumulator[k] = sParsers[k]->m_Numbers.accumulator();
+    }
+
+    // Make a step in each stream in turn until the end of data or a final
+    // transition in any stream, i.e. streams before the final one make one step more.
+    size_t sDone = 0;
+    size_t sFinal = N;
+    status_t sStatus = 0;
+    for (; sDone < aLength; sDone++)
+    {
+        for (size_t k = 0; k < N; k++)
+        {
+            char c = sData[k][sDone];
+            const CompactTransition& t = TheCompactStateMachine.get(sState[k], c);
+            profileHit(TheCompactStateMachine, t);
+            sState[k] = t.m_State;
+            sOffsets[k][t.m_Tag] = OFFSET(sCount[k] + sDone);
+            numberImpl(sAccumulator[k], sParsers[k]->m_Numbers, t.m_Number, c);
+            if (0 != t.m_Status)
+            {
+                sFinal = k;
+                sStatus = t.m_Status;
+                break;
+            }
+        }
+        if (sFinal != N)
+            break;
+    }
+
+    // Store streams back.
+    for (size_t k = 0; k < N; k++)
+    {
+        size_t i = aIndex[k];
+        size_t sEaten = sDone + (k <= sFinal && sFinal != N);
+        GenericHttpResponseParser* p = sParsers[k];
+        p->m_CurrentState = sState[k];
+        p->m_Numbers.accumulator() = sAccumulator[k];
+        p->m_CurrentPos += sEaten;
+        aEaten[i] += sEaten;
+    }
+    if (sFinal != N)
+        aStatus[aIndex[sFinal]] = sStatus;
+}
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+std::string GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::profileReport(size_t aTop)
+{
+    return HttpResponseParserProfile::report(&TheCompactStateMachine, HeaderNames.data(), NUM_HEADERS, aTop);
+}
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+size_t GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::count() const
 {
     return m_CurrentPos;
 }
 
-void HttpResponseParser::reset()
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+void GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::reset()
 {
     m_CurrentState = 0;
     m_CurrentPos = 0;
     m_SavedTagOffsets.fill(0);
+    m_Numbers.reset();
 }
 
-bool HttpResponseParser::isFragmentFound(fragment_t aFragment) const
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+void GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::restart(size_t aSkip)
 {
-    // Due to HTTP prefix no fragment can start with zero offset.
+    restartImpl(m_CurrentState, m_CurrentPos, m_SavedTagOffsets, m_Numbers, aSkip);
+}
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+bool GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::isFragmentFound(fragment_t aFragment) const
+{
+    // Due to HTTP prefix any fragment ends after the beginning of major version, that is
+    // zero after reset and the beginning of the response after restart.
     // It is guaranteed that if the end of a fragment is set then the beginning is also set.
-    return m_SavedTagOffsets[tagEnd(aFragment)] != 0;
+    return m_SavedTagOffsets[tagEnd(aFragment)] > m_SavedTagOffsets[tagBegin(MAJOR_VERSION)];
 }
 
-std::pair<size_t, size_t> HttpResponseParser::getFragment(fragment_t aFragment) const
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+std::pair<size_t, size_t> GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::getFragment(fragment_t aFragment) const
 {
+    if (!isFragmentFound(aFragment))
+        return {0, 0};
     size_t b =  m_SavedTagOffsets[tagBegin(aFragment)];
     size_t e = m_SavedTagOffsets[tagEnd(aFragment)];
     return {b, e};
 }
 
-std::string_view HttpResponseParser::getFragmentStr(std::string_view sInput, fragment_t aFragment)
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+std::string_view GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::getFragmentStr(std::string_view sInput, fragment_t aFragment) const
 {
-    size_t b =  m_SavedTagOffsets[tagBegin(aFragment)];
-    size_t e = m_SavedTagOffsets[tagEnd(aFragment)];
+    auto [b, e] = getFragment(aFragment);
     return sInput.substr(b, e - b);
 }
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+std::pair<std::string_view, std::string_view>
+GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::getFragmentStr(std::string_view aFirst, std::string_view aSecond,
+                                                                   fragment_t aFragment) const
+{
+    auto [b, e] = getFragment(aFragment);
+    return splitFragmentImpl(aFirst, aSecond, b, e);
+}
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+uint64_t GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::statusCode() const
+{
+    return m_Numbers.m_Values[STATUS_CODE_NUMBER];
+}
+
+template <class OFFSET, const std::string_view& ...HEADER_NAMES>
+uint64_t GenericHttpResponseParser<OFFSET, HEADER_NAMES...>::contentLength() const
+{
+    if constexpr (CONTENT_LENGTH_FRAGMENT == HEADER_MAX)
+        return INVALID_NUMBER;
+    else
+        return m_Numbers.m_Values[CONTENT_LENGTH_NUMBER];
+}
@@ -0,0 +1,875 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <utility>
+
+#include <HttpHeaderIndex.hpp>
+#include <HttpResponseParserProfile.hpp>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Common part of RFC7230 status line and header parsers of an HTTP response,
+// that does not depend on the set of headers to store.
+// See BasicHttpResponseParser for description.
+
+class HttpResponseParserBase
+{
+public:
+    // Standard fragments that will be stored.
+    // Header-value fragments follow them, see BasicHttpResponseParser.
+    enum special_t
+    {
+        MAJOR_VERSION = 0,
+        MINOR_VERSION,
+        STATUS_CODE,
+        REASON_PHRASE,
+        SPECIAL_MAX
+    };
+
+    // Type of ID of fragment. One of special_t or header fragment.
+    using fragment_t = uint16_t;
+    // Type of a tag ID - beginning or end position of a fragment.
+    using tag_t = fragment_t;
+    // Type of ID of a parsing state.
+    using state_t = uint32_t;
+    // Type of result of parsing one byte of the stream.
+    using status_t = uint16_t;
+    enum status_value_t
+    {
+        IN_PROGRESS = 0,
+        SUCCESS,
+        ERROR_NOT_HTTP,
+        ERROR_NOT_A_DIGIT_MAJOR_VERSION,
+        ERROR_NOT_A_DIGIT_MINOR_VERSION,
+        ERROR_NOT_A_DIGIT_STATUS_CODE,
+        ERROR_WRONG_LENGTH_OF_STATUS_CODE,
+        ERROR_HEADER_TOO_LONG,
+        ERROR_LINE_TOO_LONG,
+        ERROR_TOO_MANY_HEADERS,
+        STATUS_END,
+    };
+
+    // Get a description of error status. Actually it's a null-terminating string.
+    static const std::string_view getErrorStr(status_t s);
+
+    // Whether the connection can be reused for the next request after the response, by
+    // MINOR_VERSION fragment and the value of Connection header (empty if there's none):
+    // in HTTP/1.1 unless there's "close" option, in HTTP/1.0 only with "keep-alive" option.
+    // The value can be given in two parts, see getFragmentStr.
+    static bool keepAlive(std::string_view aMinorVersion, std::string_view aConnection);
+    static bool keepAlive(std::string_view aMinorVersion, std::pair<std::string_view, std::string_view> aConnection);
+
+    // Value of a number that was not found in the input stream or is not a valid number.
+    static constexpr uint64_t INVALID_NUMBER = UINT64_MAX;
+    // Content-Length with more significant digits is considered to be overflowed.
+    static constexpr size_t MAX_CONTENT_LENGTH_DIGITS = 18;
+    // A number that reaches that before another digit gets too many digits.
+    static constexpr uint64_t NUMBER_OVERFLOW_BOUND = 100000000000000000ull;
+
+    // Limits of the header that bound memory and CPU spent on a broken or malicious stream:
+    // parsing stops with an error right at the byte that exceeds a limit:
+    //  total size of the header (status line, header lines and the empty line) - ERROR_HEADER_TOO_LONG;
+    //  size of a line including "\r\n" - ERROR_LINE_TOO_LONG;
+    //  number of header lines (not counting the status line and the empty line) - ERROR_TOO_MANY_HEADERS.
+    // Lines are those of the state machine, they are checked by the feed loop itself as the
+    // state machine finishes them (see feed with limits); for instance a single '\n' that
+    // the parser ignores does not end a line.
+    // Besides the limits it keeps the beginning of the current line and the number of lines,
+    // i.e. one object is needed per stream; that starts over by itself whenever the parser
+    // is at the beginning of a response (after reset or restart). The parser itself has no
+    // room for that: HttpResponseParser16 takes a whole cache line.
+    class Limits
+    {
+    public:
+        // Zero means no limit.
+        explicit Limits(size_t aMaxHeaderSize = 0, size_t aMaxLineSize = 0, size_t aMaxHeaders = 0);
+
+        //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
+    //private:
+        // Start the header if the parser in aState is at the beginning of a response, that
+        // is at aPos of the stream. Return the end of the range [aBegin, aEnd) that the header
+        // may take, set aError to ERROR_HEADER_TOO_LONG if the range is cut.
+        inline const char* headerStop(state_t aState, size_t aPos, const char* aBegin, const char* aEnd,
+                                      status_t& aError);
+        // The state machine has come to the beginning of the next line at aPos.
+        inline void nextLine(size_t aPos);
+        // Return the end of the range [aBegin, aEnd) at aPos that the current line may take,
+        // set aError to the error for the case the line doesn't end before it.
+        inline const char* lineStop(size_t aPos, const char* aBegin, const char* aEnd, status_t& aError) const;
+
+        // Limits, SIZE_MAX if not set.
+        size_t m_MaxHeaderSize;
+        size_t m_MaxLineSize;
+        size_t m_MaxHeaders;
+        // Positions of the beginning of the header and of the current line in the stream.
+        size_t m_HeaderBegin = 0;
+        size_t m_LineBegin = 0;
+        // Number of finished lines, including the status line.
+        size_t m_Lines = 0;
+    };
+
+
+    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
+    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
+    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
+    // All staff below must be actually a private part of a class.
+    // But that would significantly complicate constexpr building of the state machine.
+    // I think that public internals is lesser evil than extern friend functions/classes.
+//private:
+
+    // Storage offset for the beginning of the fragment.
+    static constexpr tag_t tagBegin(fragment_t frag) { return (frag * 2) + 1; }
+    // Storage offset for the end of the fragment.
+    static constexpr tag_t tagEnd  (fragment_t frag) { return (frag + 1) * 2; }
+    // Special offseat in a storage that stores useless thing; private part of implementation.
+    static constexpr tag_t DUMMY_TAG = 0;
+    // Number of characters that bulk feed processes between status checks.
+    // The state machine guarantees that the first FEED_UNROLL - 1 steps from the initial
+    // state save DUMMY_TAG and DUMMY_NUMBER only, so the steps made after a final transition
+    // are harmless.
+    static constexpr size_t FEED_UNROLL = 4;
+    // Whether parsing collects HttpResponseParserProfile.
+#if defined(HTTP_RESPONSE_PARSER_PROFILE)
+    static constexpr bool PROFILE = true;
+#else
+    static constexpr bool PROFILE = false;
+#endif
+
+    // Kinds of states that are left only by a few bytes: all other bytes lead to
+    // the same state and save no tags, numbers and status. Bulk feed searches for
+    // the next of those few bytes instead of walking the table byte by byte.
+    enum skip_t
+    {
+        SKIP_NONE = 0,
+        // Only '\r' leaves the state, for instance a skipped header line.
+        SKIP_TO_CR,
+        // Only whitespace (SP, HT, CR, LF) leaves the state, for instance a header value.
+        SKIP_TO_WS,
+    };
+    // Whether the byte can leave a state of given skip kind.
+    static constexpr bool isSkipStop(uint8_t aSkip, unsigned char c)
+    {
+        return c == '\r' || (aSkip == SKIP_TO_WS && (c == ' ' || c == '\t' || c == '\n'));
+    }
+    // Find the first byte in [aBegin, aEnd) that can leave a state of given kind (not
+    // SKIP_NONE), return aEnd if there's no such byte. Vectorized if SSE2/AVX2 is available.
+    static const char* skipImpl(uint8_t aSkip, const char* aBegin, const char* aEnd);
+    // The same without vectorization.
+    static const char* skipScalarImpl(uint8_t aSkip, const char* aBegin, const char* aEnd);
+
+    // Almost every response begins with "HTTP/d.d ddd ". Bulk feed checks such a prefix
+    // with a couple of word operations and jumps over it right to the reason phrase.
+    static constexpr size_t STATUS_LINE_PREFIX_SIZE = 13;
+    // Number of the reason phrase state in the (not compact) state machine.
+    static constexpr state_t REASON_PHRASE_CONDITION = 13;
+    // Number of the state at the beginning of a header line. The state machine comes there
+    // only by '\n' that finishes the previous line, feed with limits relies on that.
+    static constexpr state_t LINE_START_CONDITION = 18;
+    // Positions of tags DUMMY_TAG..tagEnd(STATUS_CODE) in the prefix, exactly as the state
+    // machine saves them. Other tags are not saved in the prefix.
+    static constexpr std::array<uint8_t, 7> StatusLinePrefixTags = {11, 5, 6, 7, 8, 9, 12};
+    // Word that has the same memory representation as the given 8 bytes.
+    static constexpr uint64_t memoryWord(std::string_view aBytes)
+    {
+        uint64_t sRes = 0;
+        for (size_t i = 0; i < sizeof(sRes); i++)
+        {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            sRes |= uint64_t(uint8_t(aBytes[i])) << (CHAR_BIT * (sizeof(sRes) - 1 - i));
+#else
+            sRes |= uint64_t(uint8_t(aBytes[i])) << (CHAR_BIT * i);
+#endif
+        }
+        return sRes;
+    }
+
+    // Numbers that are calculated during parsing, without a second pass over fragments.
+    // Digits are accumulated in a single accumulator that is stored to the number after
+    // each transition. Like tags, all other transitions store it to the dummy number,
+    // that also keeps the accumulator between feeds.
+    enum number_t
+    {
+        DUMMY_NUMBER = 0,
+        STATUS_CODE_NUMBER,
+        CONTENT_LENGTH_NUMBER,
+        NUM_NUMBERS
+    };
+
+    // Actions with the accumulator that are done by transitions.
+    enum number_action_t
+    {
+        NUMBER_NONE = 0,
+        STATUS_CODE_FIRST,
+        STATUS_CODE_NEXT,
+        CONTENT_LENGTH_FIRST,
+        CONTENT_LENGTH_NEXT,
+        CONTENT_LENGTH_INVALID,
+        NUMBER_ACTION_MAX
+    };
+
+    // Branchless implementation of an action:
+    // accumulator = (accumulator & m_Keep) * 10 + ((digit & m_DigitMask) | m_Invalid),
+    // or INVALID_NUMBER if the kept value is NUMBER_OVERFLOW_BOUND or more (that keeps
+    // INVALID_NUMBER too). Only 'and', the comparison, multiplication by 10, addition
+    // and 'or' depend on the previous value.
+    struct NumberAction
+    {
+        uint64_t m_Keep;
+        uint64_t m_DigitMask;
+        uint64_t m_Invalid;
+        // Where the accumulator must be stored.
+        uint64_t m_Number;
+    };
+
+    static constexpr NumberAction NumberActions[NUMBER_ACTION_MAX] = {
+        {0, 0, 0, DUMMY_NUMBER},
+        {0, UINT64_MAX, 0, STATUS_CODE_NUMBER},
+        {UINT64_MAX, UINT64_MAX, 0, STATUS_CODE_NUMBER},
+        {0, UINT64_MAX, 0, CONTENT_LENGTH_NUMBER},
+        {UINT64_MAX, UINT64_MAX, 0, CONTENT_LENGTH_NUMBER},
+        {0, 0, INVALID_NUMBER, CONTENT_LENGTH_NUMBER},
+    };
+
+    // Calculated numbers.
+    struct Numbers
+    {
+        std::array<uint64_t, NUM_NUMBERS> m_Values = {0, INVALID_NUMBER, INVALID_NUMBER};
+
+        uint64_t& accumulator() { return m_Values[DUMMY_NUMBER]; }
+        void reset() { *this = Numbers{}; }
+    };
+
+    // Recording of all header lines to HttpHeaderIndex, done by the same transitions
+    // that parse the header (see feed with an index). Positions are saved in the tags of
+    // the index, the hash of a name is calculated in an accumulator like numbers are.
+    enum index_action_t
+    {
+        INDEX_NONE = 0,
+        // The first character of a name.
+        INDEX_NAME_FIRST,
+        // Next character of a name.
+        INDEX_NAME_NEXT,
+        // ':' after a name.
+        INDEX_NAME_END,
+        // The first character of a value.
+        INDEX_VALUE_BEGIN,
+        // Whitespace after a value (not necessarily the last one).
+        INDEX_VALUE_END,
+        // The line is finished, store the entry.
+        INDEX_STORE,
+        // The same, but the value is empty.
+        INDEX_STORE_EMPTY,
+        INDEX_ACTION_MAX
+    };
+
+    // Branchless implementation of an action:
+    // hash = hashStep((hash & m_Keep) | m_Basis, c) in bits of m_HashMask,
+    // the position is saved to m_Tag of the index.
+    struct IndexAction
+    {
+        uint32_t m_Keep;
+        uint32_t m_Basis;
+        uint32_t m_HashMask;
+        uint8_t m_Tag;
+        // Whether the entry must be stored and whether its value is empty.
+        bool m_Store;
+        bool m_EmptyValue;
+    };
+
+    static constexpr IndexAction IndexActions[INDEX_ACTION_MAX] = {
+        {0, 0, 0, HttpHeaderIndex::DUMMY_TAG, false, false},
+        {0, HttpHeaderIndex::HASH_BASIS, UINT32_MAX, HttpHeaderIndex::NAME_BEGIN, false, false},
+        {UINT32_MAX, 0, UINT32_MAX, HttpHeaderIndex::DUMMY_TAG, false, false},
+        {0, 0, 0, HttpHeaderIndex::NAME_END, false, false},
+        {0, 0, 0, HttpHeaderIndex::VALUE_BEGIN, false, false},
+        {0, 0, 0, HttpHeaderIndex::VALUE_END, false, false},
+        {0, 0, 0, HttpHeaderIndex::DUMMY_TAG, true, false},
+        {0, 0, 0, HttpHeaderIndex::VALUE_BEGIN, true, true},
+    };
+
+    // State machine!
+
+    // Transition from one state to another.
+    struct Transition
+    {
+        // This transition leads to that state.
+        state_t m_State = 0;
+        // In that tag the current position must be saved.
+        tag_t m_Tag = DUMMY_TAG;
+        // Status after this transition: zero if more bytes are needed,
+        // nonzero if this is a final transition (SUCCESS or some ERROR..).
+        status_t m_Status = 0;
+        // Action with the number accumulator, one of number_action_t.
+        uint8_t m_Number = NUMBER_NONE;
+        // Action with the header index, one of index_action_t.
+        uint8_t m_Index = INDEX_NONE;
+    };
+
+    // A set of transitions by each input byte.
+    struct Conditions
+    {
+        // Transitions by each input byte.
+        static constexpr size_t NUM_TRANSITIONS = 1 << CHAR_BIT;
+        std::array<Transition, NUM_TRANSITIONS> m_Transitions;
+
+        const Transition& operator[](unsigned char c) const { return m_Transitions[c]; }
+    };
+
+    // Conditions of each state. The start in state 0.
+    template <state_t MAX>
+    struct StateMachine
+    {
+        static constexpr state_t MAX_NUM_CONDITIONS = MAX;
+        state_t m_NumConditions = 0;
+        std::array<Conditions, MAX_NUM_CONDITIONS> m_Conditions = {};
+
+        const Conditions& operator[](state_t s) const { return m_Conditions[s]; }
+    };
+
+    // The state machine above is huge (256 transitions per state) and does not fit
+    // in L1 cache. But most of input bytes lead to the same transitions in any state;
+    // such bytes are merged into one byte class. The compact state machine is a map
+    // of bytes to classes plus a table of narrow transitions by classes, one row per state.
+
+    // Narrow version of Transition, the state is an offset of the row in the table.
+    // Aligned to 8 bytes for the table to be indexed without additional multiplication.
+    struct alignas(8) CompactTransition
+    {
+        uint16_t m_State = 0;
+        uint8_t m_Tag = DUMMY_TAG;
+        uint8_t m_Status = 0;
+        uint8_t m_Number = NUMBER_NONE;
+        // skip_t of the state this transition leads to.
+        uint8_t m_Skip = SKIP_NONE;
+        uint8_t m_Index = INDEX_NONE;
+    };
+
+    template <state_t NUM_CONDITIONS, size_t NUM_CLASSES>
+    struct CompactStateMachine
+    {
+        static constexpr state_t m_NumConditions = NUM_CONDITIONS;
+        static constexpr size_t m_NumClasses = NUM_CLASSES;
+        // Class of each input byte.
+        std::array<uint8_t, Conditions::NUM_TRANSITIONS> m_Classes = {};
+        // Transitions by classes, m_NumClasses transitions in each row.
+        std::array<CompactTransition, NUM_CONDITIONS * NUM_CLASSES> m_Transitions = {};
+
+        constexpr const CompactTransition& get(state_t s, unsigned char c) const { return m_Transitions[s + m_Classes[c]]; }
+        constexpr const CompactTransition* transitions() const { return m_Transitions.data(); }
+        static constexpr size_t numClasses() { return NUM_CLASSES; }
+        // Size of the memory that is used during parsing.
+        static constexpr size_t footprint() { return sizeof(m_Classes) + sizeof(m_Transitions); }
+    };
+
+protected:
+    // Parsing engine that is shared by all parsers.
+    // MACHINE is a compact state machine, OFFSETS is an array of saved tag positions,
+    // POS is an unsigned integer type of the position; the header can't be longer than
+    // its maximal value, ERROR_HEADER_TOO_LONG is returned when it is reached.
+    template <class MACHINE, class OFFSETS, class POS>
+    static status_t feedImpl(const MACHINE& aMachine, state_t& aState, POS& aPos,
+                             OFFSETS& aOffsets, Numbers& aNumbers, char c);
+    template <class MACHINE, class OFFSETS, class POS>
+    static size_t feedImpl(const MACHINE& aMachine, state_t& aState, POS& aPos,
+                           OFFSETS& aOffsets, Numbers& aNumbers,
+                           const char* aBegin, const char* aEnd, status_t& aStatus);
+    // The same as bulk feedImpl, but also do index actions of transitions with aIndex.
+    // MACHINE must be built with index actions.
+    template <class MACHINE, class OFFSETS, class POS>
+    static size_t indexedFeedImpl(const MACHINE& aMachine, state_t& aState, POS& aPos,
+                                  OFFSETS& aOffsets, Numbers& aNumbers, HttpHeaderIndex& aIndex,
+                                  const char* aBegin, const char* aEnd, status_t& aStatus);
+    // Jump over STATUS_LINE_PREFIX_SIZE bytes from the initial state if they are "HTTP/d.d ddd ",
+    // return false and change nothing otherwise. aEnd must be already limited by POS.
+    template <class MACHINE, class OFFSETS, class POS>
+    static bool statusLineImpl(const MACHINE& aMachine, state_t& aState, POS& aPos, uint64_t& aAccumulator,
+                               OFFSETS& aOffsets, Numbers& aNumbers, const char* aBegin, const char* aEnd);
+    // Start parsing of the next response in the same stream, aSkip bytes after the current position.
+    // Tags are not cleared: the beginning of the response is saved in tagBegin(MAJOR_VERSION),
+    // the first tag that the state machine saves in a response; all fragments that end before
+    // it are left from previous responses.
+    template <class OFFSETS, class POS>
+    static void restartImpl(state_t& aState, POS& aPos, OFFSETS& aOffsets, Numbers& aNumbers, size_t aSkip);
+    // The same as bulk feedImpl, but also check the header against aLimits: the end of each
+    // line is seen as the state machine comes to LINE_START_CONDITION.
+    template <class MACHINE, class OFFSETS, class POS>
+    static size_t limitedFeedImpl(const MACHINE& aMachine, state_t& aState, POS& aPos,
+                                  OFFSETS& aOffsets, Numbers& aNumbers, Limits& aLimits,
+                                  const char* aBegin, const char* aEnd, status_t& aStatus);
+    // Profiling hooks, they do nothing unless PROFILE. A transition taken, aCount bytes
+    // consumed in aState without the table, a status line prefix jumped over.
+    template <class MACHINE>
+    static void profileHit(const MACHINE& aMachine, const CompactTransition& t);
+    template <class MACHINE>
+    static void profileSkip(const MACHINE& aMachine, state_t aState, size_t aCount);
+    template <class MACHINE>
+    static void profileStatusLine(const MACHINE& aMachine);
+    // Whether a position of type POS can reach its maximal value.
+    template <class POS>
+    static constexpr bool isLimitedPos() { return sizeof(POS) < sizeof(size_t); }
+
+    // Do the action of a transition by the character c.
+    static void numberImpl(uint64_t& aAccumulator, Numbers& aNumbers, uint8_t aAction, char c);
+    // Do the index action of a transition by the character c at aPos.
+    static void indexImpl(HttpHeaderIndex& aIndex, uint32_t& aHash, uint8_t aAction, size_t aPos, char c);
+
+    // Substring [aBegin, aEnd) of input stream that consists of two parts.
+    static std::pair<std::string_view, std::string_view>
+    splitFragmentImpl(std::string_view aFirst, std::string_view aSecond, size_t aBegin, size_t aEnd);
+};
+
+//////////////////////////////////// IMPLEMENTATION ////////////////////////////////////
+inline void HttpResponseParserBase::numberImpl(uint64_t& aAccumulator, Numbers& aNumbers, uint8_t aAction, char c)
+{
+    const NumberAction& a = NumberActions[aAction];
+    uint64_t sDigit = uint8_t(c - '0');
+    uint64_t sKept = aAccumulator & a.m_Keep;
+    uint64_t sOverflow = 0 - uint64_t(sKept >= NUMBER_OVERFLOW_BOUND);
+    aAccumulator = (sKept * 10 + ((sDigit & a.m_DigitMask) | a.m_Invalid)) | sOverflow;
+    aNumbers.m_Values[a.m_Number] = aAccumulator;
+}
+
+inline void HttpResponseParserBase::indexImpl(HttpHeaderIndex& aIndex, uint32_t& aHash, uint8_t aAction, size_t aPos, char c)
+{
+    const IndexAction& a = IndexActions[aAction];
+    uint32_t sNext = HttpHeaderIndex::hashStep((aHash & a.m_Keep) | a.m_Basis, c);
+    aHash = (sNext & a.m_HashMask) | (aHash & ~a.m_HashMask);
+    aIndex.m_SavedTagOffsets[a.m_Tag] = aPos;
+    if (a.m_Store)
+        aIndex.store(aHash, a.m_EmptyValue);
+}
+
+inline const char* HttpResponseParserBase::skipScalarImpl(uint8_t aSkip, const char* aBegin, const char* aEnd)
+{
+    while (aBegin != aEnd && !isSkipStop(aSkip, *aBegin))
+        ++aBegin;
+    return aBegin;
+}
+
+inline const char* HttpResponseParserBase::skipImpl(uint8_t aSkip, const char* aBegin, const char* aEnd)
+{
+#if defined(__AVX2__)
+    const __m256i sCR = _mm256_set1_epi8('\r');
+    const __m256i sSP = _mm256_set1_epi8(' ');
+    const __m256i sHT = _mm256_set1_epi8('\t');
+    const __m256i sLF = _mm256_set1_epi8('\n');
+    for (; aEnd - aBegin >= 32; aBegin += 32)
+    {
+        __m256i sData = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aBegin));
+        __m256i sFound = _mm256_cmpeq_epi8(sData, sCR);
+        if (aSkip == SKIP_TO_WS)
+            sFound = _mm256_or_si256(_mm256_or_si256(sFound, _mm256_cmpeq_epi8(sData, sSP)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(sData, sHT), _mm256_cmpeq_epi8(sData, sLF)));
+        uint32_t sMask = _mm256_movemask_epi8(sFound);
+        if (0 != sMask)
+            return aBegin + __builtin_ctz(sMask);
+    }
+#elif defined(__SSE2__)
+    const __m128i sCR = _mm_set1_epi8('\r');
+    const __m128i sSP = _mm_set1_epi8(' ');
+    const __m128i sHT = _mm_set1_epi8('\t');
+    const __m128i sLF = _mm_set1_epi8('\n');
+    for (; aEnd - aBegin >= 16; aBegin += 16)
+    {
+        __m128i sData = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aBegin));
+        __m128i sFound = _mm_cmpeq_epi8(sData, sCR);
+        if (aSkip == SKIP_TO_WS)
+            sFound = _mm_or_si128(_mm_or_si128(sFound, _mm_cmpeq_epi8(sData, sSP)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(sData, sHT), _mm_cmpeq_epi8(sData, sLF)));
+        uint32_t sMask = _mm_movemask_epi8(sFound);
+        if (0 != sMask)
+            return aBegin + __builtin_ctz(sMask);
+    }
+#endif
+    return skipScalarImpl(aSkip, aBegin, aEnd);
+}
+
+inline std::pair<std::string_view, std::string_view>
+HttpResponseParserBase::splitFragmentImpl(std::string_view aFirst, std::string_view aSecond, size_t aBegin, size_t aEnd)
+{
+    size_t sSize = aFirst.size();
+    if (aEnd <= sSize)
+        return {aFirst.substr(aBegin, aEnd - aBegin), std::string_view()};
+    if (aBegin >= sSize)
+        return {aSecond.substr(aBegin - sSize, aEnd - aBegin), std::string_view()};
+    return {aFirst.substr(aBegin), aSecond.substr(0, aEnd - sSize)};
+}
+
+// Sum that stays SIZE_MAX instead of overflow.
+inline size_t saturatingAdd(size_t a, size_t b)
+{
+    return b > SIZE_MAX - a ? SIZE_MAX : a + b;
+}
+
+const char* HttpResponseParserBase::Limits::headerStop(state_t aState, size_t aPos,
+                                                       const char* aBegin, const char* aEnd, status_t& aError)
+{
+    if (0 == aState)
+    {
+        m_HeaderBegin = m_LineBegin = aPos;
+        m_Lines = 0;
+    }
+    size_t sHeaderEnd = saturatingAdd(m_HeaderBegin, m_MaxHeaderSize);
+    size_t sRoom = sHeaderEnd > aPos ? sHeaderEnd - aPos : 0;
+    if (size_t(aEnd - aBegin) <= sRoom)
+        return aEnd;
+    aError = ERROR_HEADER_TOO_LONG;
+    return aBegin + sRoom;
+}
+
+void HttpResponseParserBase::Limits::nextLine(size_t aPos)
+{
+    m_LineBegin = aPos;
+    m_Lines++;
+}
+
+const char* HttpResponseParserBase::Limits::lineStop(size_t aPos, const char* aBegin, const char* aEnd,
+                                                     status_t& aError) const
+{
+    // After m_MaxHeaders header lines only the empty line may follow.
+    bool sLast = m_Lines > m_MaxHeaders;
+    size_t sLineEnd = saturatingAdd(m_LineBegin, sLast ? std::min<size_t>(m_MaxLineSize, 2) : m_MaxLineSize);
+    size_t sRoom = sLineEnd > aPos ? sLineEnd - aPos : 0;
+    if (size_t(aEnd - aBegin) <= sRoom)
+        return aEnd;
+    aError = sLast ? ERROR_TOO_MANY_HEADERS : ERROR_LINE_TOO_LONG;
+    return aBegin + sRoom;
+}
+template <class MACHINE>
+void HttpResponseParserBase::profileHit([[maybe_unused]] const MACHINE& aMachine, [[maybe_unused]] const CompactTransition& t)
+{
+    if constexpr (PROFILE)
+        HttpResponseParserProfile::counters(&aMachine).hit(&t - aMachine.transitions());
+}
+
+template <class MACHINE>
+void HttpResponseParserBase::profileSkip([[maybe_unused]] const MACHINE& aMachine,
+                                         [[maybe_unused]] state_t aState, [[maybe_unused]] size_t aCount)
+{
+    if constexpr (PROFILE)
+        if (0 != aCount)
+            HttpResponseParserProfile::counters(&aMachine).skip(aState, aCount);
+}
+
+template <class MACHINE>
+void HttpResponseParserBase::profileStatusLine([[maybe_unused]] const MACHINE& aMachine)
+{
+    if constexpr (PROFILE)
+        HttpResponseParserProfile::counters(&aMachine).m_StatusLines++;
+}
+
+template <class OFFSETS, class POS>
+void HttpResponseParserBase::restartImpl(state_t& aState, POS& aPos, OFFSETS& aOffsets, Numbers& aNumbers, size_t aSkip)
+{
+    // The next feed fails with ERROR_HEADER_TOO_LONG if the position does not fit.
+    size_t sRoom = std::numeric_limits<POS>::max() - aPos;
+    aPos = aSkip > sRoom ? std::numeric_limits<POS>::max() : aPos + aSkip;
+    aState = 0;
+    aOffsets[tagBegin(MAJOR_VERSION)] = aPos;
+    aNumbers.reset();
+}
+
+template <class MACHINE, class OFFSETS, class POS>
+bool HttpResponseParserBase::statusLineImpl(const MACHINE& aMachine, state_t& aState, POS& aPos, uint64_t& aAccumulator,
+                                            OFFSETS& aOffsets, Numbers& aNumbers, const char* aBegin, const char* aEnd)
+{
+    if (0 != aState || size_t(aEnd - aBegin) < STATUS_LINE_PREFIX_SIZE)
+        return false;
+
+    // Two overlapping words: "HTTP/d.d" and "d.d ddd ". After xor with the pattern
+    // other bytes must be zero and digits must be less than 10; adding 0x7f or 0x76
+    // sets the high bit of a byte otherwise. There are no carries between bytes
+    // since high bits of all bytes are checked too.
+    constexpr uint64_t HIGH_BITS = 0x8080808080808080ull;
+    uint64_t sWord1, sWord2;
+    memcpy(&sWord1, aBegin, sizeof(sWord1));
+    memcpy(&sWord2, aBegin + 5, sizeof(sWord2));
+    sWord1 ^= memoryWord("HTTP/0.0");
+    sWord2 ^= memoryWord("0.0 000 ");
+    uint64_t sCheck1 = sWord1 | (sWord1 + memoryWord("\x7f\x7f\x7f\x7f\x7f\x76\x7f\x76"));
+    uint64_t sCheck2 = sWord2 | (sWord2 + memoryWord("\x76\x7f\x76\x7f\x76\x76\x76\x7f"));
+    if (0 != ((sCheck1 | sCheck2) & HIGH_BITS))
+        return false;
+
+    for (size_t i = 0; i < StatusLinePrefixTags.size(); i++)
+        aOffsets[i] = aPos + StatusLinePrefixTags[i];
+    aNumbers.m_Values[STATUS_CODE_NUMBER] = (aBegin[9] - '0') * 100 + (aBegin[10] - '0') * 10 + (aBegin[11] - '0');
+    aAccumulator = 0;
+    aState = REASON_PHRASE_CONDITION * aMachine.numClasses();
+    aPos += STATUS_LINE_PREFIX_SIZE;
+    profileStatusLine(aMachine);
+    return true;
+}
+
+template <class MACHINE, class OFFSETS, class POS>
+HttpResponseParserBase::status_t
+HttpResponseParserBase::feedImpl(const MACHINE& aMachine, state_t& aState, POS& aPos,
+                                 OFFSETS& aOffsets, Numbers& aNumbers, char c)
+{
+    if constexpr (isLimitedPos<POS>())
+        if (aPos == std::numeric_limits<POS>::max())
+            return ERROR_HEADER_TOO_LONG;
+    const CompactTransition& t = aMachine.get(aState, c);
+    profileHit(aMachine, t);
+    aState = t.m_State;
+    aOffsets[t.m_Tag] = aPos++;
+    uint64_t sAccumulator = aNumbers.accumulator();
+    numberImpl(sAccumulator, aNumbers, t.m_Number, c);
+    aNumbers.accumulator() = sAccumulator;
+    return t.m_Status;
+}
+
+template <class MACHINE, class OFFSETS, class POS>
+size_t HttpResponseParserBase::feedImpl(const MACHINE& aMachine, state_t& aState, POS& aPos,
+                                        OFFSETS& aOffsets, Numbers& aNumbers,
+                                        const char* aBegin, const char* aEnd, status_t& aStatus)
+{
+    // Stop at the maximal position, the check is done once per call.
+    bool sLimited = false;
+    if constexpr (isLimitedPos<POS>())
+    {
+        size_t sRoom = std::numeric_limits<POS>::max() - aPos;
+        if (size_t(aEnd - aBegin) > sRoom)
+        {
+            aEnd = aBegin + sRoom;
+            sLimited = true;
+        }
+    }
+
+    // The prefix is checked before the state is loaded to local variables, otherwise
+    // it raises register pressure in the loops below.
+    const char* sPos = aBegin;
+    if (statusLineImpl(aMachine, aState, aPos, aNumbers.accumulator(), aOffsets, aNumbers, sPos, aEnd))
+        sPos += STATUS_LINE_PREFIX_SIZE;
+
+    state_t sState = aState;
+    POS sCount = aPos;
+    uint64_t sAccumulator = aNumbers.accumulator();
+    status_t sStatus = 0;
+
+    // Unrolled part: check status once per FEED_UNROLL characters.
+    while (size_t(aEnd - sPos) >= FEED_UNROLL)
+    {
+        state_t sWasState = sState;
+        uint64_t sWasAccumulator = sAccumulator;
+        uint8_t sSkip = SKIP_NONE;
+        for (size_t i = 0; i < FEED_UNROLL; i++)
+        {
+            const CompactTransition& t = aMachine.get(sState, sPos[i]);
+            sState = t.m_State;
+            aOffsets[t.m_Tag] = sCount + i;
+            numberImpl(sAccumulator, aNumbers, t.m_Number, sPos[i]);
+            sStatus |= t.m_Status;
+            sSkip = t.m_Skip;
+        }
+        if (0 != sStatus)
+        {
+            // Some final transition is in the block, replay it carefully below.
+            sState = sWasState;
+            sAccumulator = sWasAccumulator;
+            sStatus = 0;
+            break;
+        }
+        if constexpr (PROFILE)
+        {
+            // Count the block only when it is not rolled back.
+            for (size_t i = 0; i < FEED_UNROLL; i++)
+            {
+                const CompactTransition& t = aMachine.get(sWasState, sPos[i]);
+                profileHit(aMachine, t);
+                sWasState = t.m_State;
+            }
+        }
+        sPos += FEED_UNROLL;
+        sCount += FEED_UNROLL;
+
+        if (SKIP_NONE != sSkip)
+        {
+            // The skipped bytes would only reset the accumulator.
+            const char* sStop = skipImpl(sSkip, sPos, aEnd);
+            profileSkip(aMachine, sState, sStop - sPos);
+            sAccumulator = sStop == sPos ? sAccumulator : 0;
+            sCount += sStop - sPos;
+            sPos = sStop;
+        }
+    }
+
+    // Tail (or the block with final transition): check status after each character.
+    while (sPos != aEnd && 0 == sStatus)
+    {
+        const CompactTransition& t = aMachine.get(sState, *sPos);
+        profileHit(aMachine, t);
+        sState = t.m_State;
+        aOffsets[t.m_Tag] = sCount++;
+        numberImpl(sAccumulator, aNumbers, t.m_Number, *sPos++);
+        sStatus = t.m_Status;
+    }
+
+    if (sLimited && 0 == sStatus)
+        sStatus = ERROR_HEADER_TOO_LONG;
+    aState = sState;
+    aPos = sCount;
+    aNumbers.accumulator() = sAccumulator;
+    aStatus = sStatus;
+    return sPos - aBegin;
+}
+
+template <class MACHINE, class OFFSETS, class POS>
+size_t HttpResponseParserBase::indexedFeedImpl(const MACHINE& aMachine, state_t& aState, POS& aPos,
+                                               OFFSETS& aOffsets, Numbers& aNumbers, HttpHeaderIndex& aIndex,
+                                               const char* aBegin, const char* aEnd, status_t& aStatus)
+{
+    bool sLimited = false;
+    if constexpr (isLimitedPos<POS>())
+    {
+        size_t sRoom = std::numeric_limits<POS>::max() - aPos;
+        if (size_t(aEnd - aBegin) > sRoom)
+        {
+            aEnd = aBegin + sRoom;
+            sLimited = true;
+        }
+    }
+
+    const char* sPos = aBegin;
+    if (statusLineImpl(aMachine, aState, aPos, aNumbers.accumulator(), aOffsets, aNumbers, sPos, aEnd))
+        sPos += STATUS_LINE_PREFIX_SIZE;
+
+    state_t sState = aState;
+    POS sCount = aPos;
+    uint64_t sAccumulator = aNumbers.accumulator();
+    uint32_t sHash = aIndex.m_CurrentHash;
+    status_t sStatus = 0;
+
+    // Names are hashed byte by byte, so there's no point in unrolling; values
+    // and skipped lines are still skipped (index actions are done at their ends).
+    while (sPos != aEnd && 0 == sStatus)
+    {
+        const CompactTransition& t = aMachine.get(sState, *sPos);
+        profileHit(aMachine, t);
+        sState = t.m_State;
+        aOffsets[t.m_Tag] = sCount;
+        indexImpl(aIndex, sHash, t.m_Index, sCount, *sPos);
+        numberImpl(sAccumulator, aNumbers, t.m_Number, *sPos);
+        sStatus = t.m_Status;
+        ++sPos;
+        ++sCount;
+
+        if (SKIP_NONE != t.m_Skip)
+        {
+            const char* sStop = skipImpl(t.m_Skip, sPos, aEnd);
+            profileSkip(aMachine, sState, sStop - sPos);
+            sAccumulator = sStop == sPos ? sAccumulator : 0;
+            sCount += sStop - sPos;
+            sPos = sStop;
+        }
+    }
+
+    if (sLimited && 0 == sStatus)
+        sStatus = ERROR_HEADER_TOO_LONG;
+    aState = sState;
+    aPos = sCount;
+    aNumbers.accumulator() = sAccumulator;
+    aIndex.m_CurrentHash = sHash;
+    aStatus = sStatus;
+    return sPos - aBegin;
+}
+
+template <class MACHINE, class OFFSETS, class POS>
+size_t HttpResponseParserBase::limitedFeedImpl(const MACHINE& aMachine, state_t& aState, POS& aPos,
+                                               OFFSETS& aOffsets, Numbers& aNumbers, Limits& aLimits,
+                                               const char* aBegin, const char* aEnd, status_t& aStatus)
+{
+    status_t sEndError = 0;
+    if constexpr (isLimitedPos<POS>())
+    {
+        size_t sRoom = std::numeric_limits<POS>::max() - aPos;
+        if (size_t(aEnd - aBegin) > sRoom)
+        {
+            aEnd = aBegin + sRoom;
+            sEndError = ERROR_HEADER_TOO_LONG;
+        }
+    }
+    aEnd = aLimits.headerStop(aState, aPos, aBegin, aEnd, sEndError);
+
+    // The status line prefix has no line end, it only has to fit in the line.
+    status_t sLineError = 0;
+    const char* sPos = aBegin;
+    if (statusLineImpl(aMachine, aState, aPos, aNumbers.accumulator(), aOffsets, aNumbers, sPos,
+                       aLimits.lineStop(aPos, sPos, aEnd, sLineError)))
+        sPos += STATUS_LINE_PREFIX_SIZE;
+
+    const state_t sLineStart = LINE_START_CONDITION * aMachine.numClasses();
+    state_t sState = aState;
+    POS sCount = aPos;
+    uint64_t sAccumulator = aNumbers.accumulator();
+    status_t sStatus = 0;
+    const char* sStop = aLimits.lineStop(sCount, sPos, aEnd, sLineError);
+
+    // Byte by byte, as every line end must be seen; values and skipped lines
+    // are still skipped, but not further than the current line may go.
+    while (sPos != sStop && 0 == sStatus)
+    {
+        const CompactTransition& t = aMachine.get(sState, *sPos);
+        profileHit(aMachine, t);
+        sState = t.m_State;
+        aOffsets[t.m_Tag] = sCount;
+        numberImpl(sAccumulator, aNumbers, t.m_Number, *sPos);
+        sStatus = t.m_Status;
+        ++sPos;
+        ++sCount;
+
+        if (sLineStart == sState)
+        {
+            aLimits.nextLine(sCount);
+            sStop = aLimits.lineStop(sCount, sPos, aEnd, sLineError);
+        }
+        else if (SKIP_NONE != t.m_Skip)
+        {
+            const char* sSkipStop = skipImpl(t.m_Skip, sPos, sStop);
+            profileSkip(aMachine, sState, sSkipStop - sPos);
+            sAccumulator = sSkipStop == sPos ? sAccumulator : 0;
+            sCount += sSkipStop - sPos;
+            sPos = sSkipStop;
+        }
+    }
+
+    if (0 == sStatus)
+        sStatus = sPos != aEnd ? sLineError : sEndError;
+    aState = sState;
+    aPos = sCount;
+    aNumbers.accumulator() = sAccumulator;
+    aStatus = sStatus;
+    return sPos - aBegin;
+}
@@ -0,0 +1,482 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <DynamicHttpResponseParser.hpp>
+#include <HashedHttpResponseParser.hpp>
+#include <HttpResponseParser.hpp>
+#include <HttpResponsePipeline.hpp>
+#include <PerfCounters.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Benchmark of the parser engines on a corpus of realistic response headers.
+// Each corpus entry is repeated to fill a buffer of about BUFFER_SIZE bytes, and the
+// buffer is parsed by each engine several times (runs). For each entry and engine
+// there are reported percentiles of time per response over the runs and, if hardware
+// counters are available (see PerfCounters), medians of cycles and instructions per
+// byte and branch misses per response.
+// Usage: HttpResponseParserBenchmark [--runs N] [--filter TEXT] [--json FILE] [FILE...]
+//  --runs N       number of runs of each engine on each entry (default 15);
+//  --filter TEXT  run only entries and engines whose "entry/engine" contains TEXT;
+//  --json FILE    write results to FILE in JSON ("-" for stdout), to be kept and
+//                 compared between versions;
+//  FILE...        more corpus entries, one response header per file, named by the file.
+
+namespace {
+
+const size_t BUFFER_SIZE = 1024 * 1024;
+
+struct Entry
+{
+    std::string m_Name;
+    std::string m_Data;
+};
+
+// Deterministic pseudo-random text for cookies and the like.
+std::string filler(size_t aSize, uint32_t aSeed)
+{
+    static constexpr std::string_view ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    std::string sRes(aSize, ' ');
+    for (char& c : sRes)
+    {
+        aSeed = aSeed * 1103515245 + 12345;
+        c = ALPHABET[(aSeed >> 16) % ALPHABET.size()];
+    }
+    return sRes;
+}
+
+std::string typical_headers(std::string_view aEol)
+{
+    std::string sRes;
+    auto add = [&](std::string_view aLine) { sRes.append(aLine).append(aEol); };
+    add("HTTP/1.1 200 OK");
+    add("Server: nginx/1.18.0");
+    add("Date: Mon, 12 Oct 2026 10:00:00 GMT");
+    add("Content-Type: text/html; charset=utf-8");
+    add("Content-Length: 18734");
+    add("Connection: keep-alive");
+    add("Cache-Control: private, max-age=0");
+    add("Vary: Accept-Encoding");
+    add("ETag: W/\"492e-5f8c1b2a\"");
+    add("Last-Modified: Sun, 11 Oct 2026 08:30:00 GMT");
+    add("X-Request-Id: " + filler(32, 7));
+    add("Strict-Transport-Security: max-age=31536000; includeSubDomains");
+    add("Accept-Ranges: bytes");
+    add("");
+    return sRes;
+}
+
+std::vector<Entry> make_corpus()
+{
+    std::vector<Entry> sRes;
+    sRes.push_back({"not_modified",
+                    "HTTP/1.1 304 Not Modified\r\n"
+                    "Date: Mon, 12 Oct 2026 10:00:00 GMT\r\n"
+                    "ETag: \"5f8c1b2a-3e8\"\r\n"
+                    "Cache-Control: max-age=0, must-revalidate\r\n"
+                    "Server: nginx\r\n\r\n"});
+    sRes.push_back({"no_content", "HTTP/1.1 204 No Content\r\nDate: Mon, 12 Oct 2026 10:00:00 GMT\r\nServer: envoy\r\n\r\n"});
+    sRes.push_back({"typical", typical_headers("\r\n")});
+    sRes.push_back({"redirect",
+                    "HTTP/1.1 302 Found\r\n"
+                    "Location: https://www.example.com/login?return_to=%2Faccount%2Fsettings%3Ftab%3D" + filler(256, 3) + "\r\n"
+                    "Content-Length: 0\r\n"
+                    "Connection: keep-alive\r\n\r\n"});
+
+    std::string sCookies = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 512\r\n";
+    for (uint32_t i = 0; i < 4; i++)
+        sCookies += "Set-Cookie: session" + std::to_string(i) + "=" + filler(600, i) +
+                    "; Path=/; Domain=.example.com; Secure; HttpOnly; SameSite=Lax\r\n";
+    sRes.push_back({"big_cookies", sCookies + "\r\n"});
+
+    std::string sMany = "HTTP/1.1 200 OK\r\n";
+    for (int i = 0; i < 48; i++)
+        sMany += "X-Amz-Meta-Field-" + std::to_string(i) + ": value-" + filler(12, i) + "\r\n";
+    sRes.push_back({"many_headers", sMany + "Content-Length: 100\r\n\r\n"});
+
+    sRes.push_back({"mixed_case",
+                    "HTTP/1.1 200 OK\r\n"
+                    "server: envoy\r\n"
+                    "date: Mon, 12 Oct 2026 10:00:00 GMT\r\n"
+                    "CONTENT-TYPE: text/plain\r\n"
+                    "content-length: 42\r\n"
+                    "LoCaTiOn: /somewhere\r\n"
+                    "x-envoy-upstream-service-time: 3\r\n\r\n"});
+    sRes.push_back({"chunked",
+                    "HTTP/1.1 200 OK\r\n"
+                    "Content-Type: text/event-stream\r\n"
+                    "Transfer-Encoding: chunked\r\n"
+                    "Cache-Control: no-cache\r\n"
+                    "Connection: keep-alive\r\n\r\n"});
+    // Bare LF line endings are not accepted by the parser (it never finishes), kept to
+    // see the cost of such a stream.
+    sRes.push_back({"lf_only", typical_headers("\n")});
+    return sRes;
+}
+
+// Engines: parse the buffer, return the number of parsed responses.
+// Parsers are reset (or restarted) after each response, errors included.
+using engine_t = size_t (*)(std::string_view aData);
+
+template <class PARSER>
+size_t bulk(PARSER& p, std::string_view aData)
+{
+    size_t sCount = 0;
+    p.reset();
+    while (!aData.empty())
+    {
+        HttpResponseParserBase::status_t sStatus;
+        aData.remove_prefix(p.feed(aData, sStatus));
+        if (0 != sStatus)
+        {
+            sCount++;
+            p.reset();
+        }
+    }
+    return sCount;
+}
+
+size_t engine_bytewise(std::string_view aData) __attribute__((noinline));
+size_t engine_bytewise(std::string_view aData)
+{
+    size_t sCount = 0;
+    HttpResponseParser p;
+    for (char c : aData)
+    {
+        if (0 != p.feed(c))
+        {
+            sCount++;
+            p.reset();
+        }
+    }
+    return sCount;
+}
+
+size_t engine_bulk(std::string_view aData) __attribute__((noinline));
+size_t engine_bulk(std::string_view aData)
+{
+    HttpResponseParser p;
+    return bulk(p, aData);
+}
+
+size_t engine_hashed(std::string_view aData) __attribute__((noinline));
+size_t engine_hashed(std::string_view aData)
+{
+    HashedHttpResponseParser p;
+    return bulk(p, aData);
+}
+
+size_t engine_dynamic(std::string_view aData) __attribute__((noinline));
+size_t engine_dynamic(std::string_view aData)
+{
+    static const DynamicHttpResponseParser::Machine sMachine(
+        {"Content-Type", "Content-Length", "Transfer-Encoding", "Location"});
+    DynamicHttpResponseParser p(sMachine);
+    return bulk(p, aData);
+}
+
+size_t engine_pipelined(std::string_view aData) __attribute__((noinline));
+size_t engine_pipelined(std::string_view aData)
+{
+    size_t sCount = 0;
+    HttpResponseParser p;
+    HttpResponsePipeline<HttpResponseParser> sPipe(p, aData);
+    while (sPipe.next() == HttpResponseParser::SUCCESS)
+        sCount++;
+    return sCount;
+}
+
+struct Engine
+{
+    const char* m_Name;
+    engine_t m_Func;
+};
+
+const Engine engines[] =
+    {
+        {"bytewise", engine_bytewise},
+        {"bulk", engine_bulk},
+        {"hashed", engine_hashed},
+        {"dynamic", engine_dynamic},
+        {"pipelined", engine_pipelined},
+    };
+
+// Value at the given percentile (nearest rank) of sorted values.
+double percentile(const std::vector<double>& aSorted, double aPercent)
+{
+    size_t sRank = size_t(std::ceil(aPercent / 100 * aSorted.size()));
+    return aSorted[std::max<size_t>(sRank, 1) - 1];
+}
+
+double median(std::vector<double> aValues)
+{
+    std::sort(aValues.begin(), aValues.end());
+    return percentile(aValues, 50);
+}
+
+struct Result
+{
+    std::string m_Entry;
+    std::string m_Engine;
+    size_t m_ResponseSize;
+    std::string m_Status;
+    // Time per response, ns.
+    double m_Min, m_Median, m_P90, m_P99;
+    double m_MBps;
+    std::optional<double> m_CyclesPerByte;
+    std::optional<double> m_InstructionsPerByte;
+    std::optional<double> m_BranchMissesPerResponse;
+};
+
+Result measure(const Entry& aEntry, const Engine& aEngine, size_t aRuns, PerfCounters& aCounters)
+{
+    size_t sCopies = std::max<size_t>(1, BUFFER_SIZE / aEntry.m_Data.size());
+    std::string sBuffer;
+    sBuffer.reserve(sCopies * aEntry.m_Data.size());
+    for (size_t i = 0; i < sCopies; i++)
+        sBuffer += aEntry.m_Data;
+
+    HttpResponseParser p;
+    HttpResponseParser::status_t sStatus = 0;
+    p.feed(aEntry.m_Data, sStatus);
+
+    Result sRes{aEntry.m_Name, aEngine.m_Name, aEntry.m_Data.size(),
+                sStatus == 0 ? "In progress" : std::string(HttpResponseParser::getErrorStr(sStatus)),
+                0, 0, 0, 0, 0, {}, {}, {}};
+
+    // Warm up caches and branch predictors.
+    size_t sExpected = aEngine.m_Func(sBuffer);
+    std::vector<double> sTimes;
+    std::vector<double> sValues[PerfCounters::NUM_COUNTERS];
+    for (size_t r = 0; r < aRuns; r++)
+    {
+        aCounters.start();
+        auto sBegin = std::chrono::steady_clock::now();
+        size_t sCount = aEngine.m_Func(sBuffer);
+        auto sEnd = std::chrono::steady_clock::now();
+        aCounters.stop();
+        if (sCount != sExpected)
+            throw std::runtime_error("Unstable result of " + sRes.m_Engine + " on " + sRes.m_Entry);
+        sTimes.push_back(std::chrono::duration<double, std::nano>(sEnd - sBegin).count() / sCopies);
+        for (size_t c = 0; c < PerfCounters::NUM_COUNTERS; c++)
+            sValues[c].push_back(double(aCounters.value(PerfCounters::counter_t(c))));
+    }
+
+    std::sort(sTimes.begin(), sTimes.end());
+    sRes.m_Min = sTimes.front();
+    sRes.m_Median = percentile(sTimes, 50);
+    sRes.m_P90 = percentile(sTimes, 90);
+    sRes.m_P99 = percentile(sTimes, 99);
+    sRes.m_MBps = aEntry.m_Data.size() / sRes.m_Median * 1000;
+    double sBytes = double(sBuffer.size());
+    if (aCounters.isAvailable(PerfCounters::CYCLES))
+        sRes.m_CyclesPerByte = median(sValues[PerfCounters::CYCLES]) / sBytes;
+    if (aCounters.isAvailable(PerfCounters::INSTRUCTIONS))
+        sRes.m_InstructionsPerByte = median(sValues[PerfCounters::INSTRUCTIONS]) / sBytes;
+    if (aCounters.isAvailable(PerfCounters::BRANCH_MISSES))
+        sRes.m_BranchMissesPerResponse = median(sValues[PerfCounters::BRANCH_MISSES]) / sCopies;
+    return sRes;
+}
+
+std::string json_string(std::string_view aStr)
+{
+    std::string sRes = "\"";
+    for (char c : aStr)
+    {
+        if (c == '"' || c == '\\')
+        {
+            sRes += '\\';
+            sRes += c;
+        }
+        else if (uint8_t(c) < 0x20)
+        {
+            char sBuf[8];
+            snprintf(sBuf, sizeof(sBuf), "\\u%04x", unsigned(c));
+            sRes += sBuf;
+        }
+        else
+        {
+            sRes += c;
+        }
+    }
+    return sRes + "\"";
+}
+
+std::string json_number(std::optional<double> aValue)
+{
+    if (!aValue)
+        return "null";
+    std::ostringstream sStream;
+    sStream << std::setprecision(6) << *aValue;
+    return sStream.str();
+}
+
+void write_json(std::ostream& aOut, const std::vector<Result>& aResults, size_t aRuns, const PerfCounters& aCounters)
+{
+    aOut << "{\n";
+    aOut << "  \"benchmark\": \"HttpResponseParser\",\n";
+    aOut << "  \"runs\": " << aRuns << ",\n";
+    aOut << "  \"buffer_size\": " << BUFFER_SIZE << ",\n";
+    aOut << "  \"counters\": {";
+    for (size_t c = 0; c < PerfCounters::NUM_COUNTERS; c++)
+    {
+        PerfCounters::counter_t sCounter = PerfCounters::counter_t(c);
+        aOut << (c == 0 ? "" : ", ") << json_string(PerfCounters::name(sCounter)) << ": "
+             << (aCounters.isAvailable(sCounter) ? "true" : "false");
+    }
+    aOut << "},\n";
+    aOut << "  \"results\": [\n";
+    for (size_t i = 0; i < aResults.size(); i++)
+    {
+        const Result& r = aResults[i];
+        aOut << "    {\"entry\": " << json_string(r.m_Entry)
+             << ", \"engine\": " << json_string(r.m_Engine)
+             << ", \"response_size\": " << r.m_ResponseSize
+             << ", \"status\": " << json_string(r.m_Status)
+             << ", \"ns_per_response\": {\"min\": " << json_number(r.m_Min)
+             << ", \"median\": " << json_number(r.m_Median)
+             << ", \"p90\": " << json_number(r.m_P90)
+             << ", \"p99\": " << json_number(r.m_P99) << "}"
+             << ", \"mb_per_sec\": " << json_number(r.m_MBps)
+             << ", \"cycles_per_byte\": " << json_number(r.m_CyclesPerByte)
+             << ", \"instructions_per_byte\": " << json_number(r.m_InstructionsPerByte)
+             << ", \"branch_misses_per_response\": " << json_number(r.m_BranchMissesPerResponse)
+             << "}" << (i + 1 == aResults.size() ? "" : ",") << "\n";
+    }
+    aOut << "  ]\n";
+    aOut << "}\n";
+}
+
+void write_table(std::ostream& aOut, const std::vector<Result>& aResults)
+{
+    aOut << std::left << std::setw(14) << "entry" << std::setw(11) << "engine" << std::right
+         << std::setw(7) << "size" << std::setw(10) << "median" << std::setw(10) << "p90"
+         << std::setw(10) << "p99" << std::setw(9) << "MB/s" << std::setw(9) << "cyc/B"
+         << std::setw(9) << "ins/B" << std::setw(9) << "bm/resp" << "  status\n";
+    for (const Result& r : aResults)
+    {
+        auto opt = [](std::optional<double> v)
+        {
+            std::ostringstream sStream;
+            if (v)
+                sStream << std::fixed << std::setprecision(2) << *v;
+            else
+                sStream << "-";
+            return sStream.str();
+        };
+        aOut << std::left << std::setw(14) << r.m_Entry << std::setw(11) << r.m_Engine << std::right
+             << std::setw(7) << r.m_ResponseSize << std::fixed << std::setprecision(1)
+             << std::setw(10) << r.m_Median << std::setw(10) << r.m_P90 << std::setw(10) << r.m_P99
+             << std::setw(9) << std::setprecision(0) << r.m_MBps
+             << std::setw(9) << opt(r.m_CyclesPerByte) << std::setw(9) << opt(r.m_InstructionsPerByte)
+             << std::setw(9) << opt(r.m_BranchMissesPerResponse) << "  " << r.m_Status << "\n";
+    }
+    aOut << "Times are ns per response.\n";
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    size_t sRuns = 15;
+    std::string sFilter;
+    std::string sJson;
+    std::vector<Entry> sCorpus = make_corpus();
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view sArg = argv[i];
+        if ((sArg == "--runs" || sArg == "--filter" || sArg == "--json") && i + 1 < argc)
+        {
+            const char* sValue = argv[++i];
+            if (sArg == "--runs")
+                sRuns = std::max(1, atoi(sValue));
+            else if (sArg == "--filter")
+                sFilter = sValue;
+            else
+                sJson = sValue;
+        }
+        else
+        {
+            std::ifstream sFile(argv[i], std::ios::binary);
+            if (!sFile)
+            {
+                std::cerr << "Can't read " << sArg << std::endl;
+                return EXIT_FAILURE;
+            }
+            std::ostringstream sData;
+            sData << sFile.rdbuf();
+            if (sData.str().empty())
+                continue;
+            std::string sName(sArg.substr(sArg.find_last_of('/') + 1));
+            sCorpus.push_back({sName, sData.str()});
+        }
+    }
+
+    PerfCounters sCounters;
+    if (!sCounters.isAnyAvailable())
+        std::cerr << "Hardware counters are not available, only time is measured" << std::endl;
+
+    std::vector<Result> sResults;
+    try
+    {
+        for (const Entry& sEntry : sCorpus)
+            for (const Engine& sEngine : engines)
+                if ((sEntry.m_Name + "/" + sEngine.m_Name).find(sFilter) != std::string::npos)
+                    sResults.push_back(measure(sEntry, sEngine, sRuns, sCounters));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    write_table(sJson == "-" ? std::cerr : std::cout, sResults);
+    if (sJson == "-")
+    {
+        write_json(std::cout, sResults, sRuns, sCounters);
+    }
+    else if (!sJson.empty())
+    {
+        std::ofstream sOut(sJson);
+        write_json(sOut, sResults, sRuns, sCounters);
+        if (!sOut)
+        {
+            std::cerr << "Can't write " << sJson << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+}
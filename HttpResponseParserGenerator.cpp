@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+// Generator of a direct-threaded HTTP response parser for a given set of headers.
+// The state machine that HttpResponseStateMachine.hpp builds is turned into straight
+// code: a label per state, a byte is dispatched by range checks (bytes that lead to the
+// same transition are merged), the transition is a jump right to the label of the next
+// state. There is no transition table, that may be faster for small sets of headers.
+// The generated class is derived from BasicHttpResponseParser for the same headers and
+// replaces its bulk feed only; the rest (including the state) is shared, and the
+// generated header checks that it matches the state machine it was generated from.
+// Profile hooks are generated too, the profile is the same as of the table.
+// Usage: HttpResponseParserGenerator <output file> <class name> <header name>...
+
+#include <DynamicHttpResponseParser.hpp>
+#include <HttpResponseParserProfile.hpp>
+#include <HttpResponseStateMachine.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+    using Base = HttpResponseParserBase;
+    using Transition = Base::Transition;
+    using state_t = Base::state_t;
+
+    std::string hex(unsigned aValue)
+    {
+        char sBuf[16];
+        snprintf(sBuf, sizeof(sBuf), "0x%02x", aValue);
+        return sBuf;
+    }
+
+    // Name of a header in enum, like CONTENT_LENGTH.
+    std::string enumName(std::string_view aName)
+    {
+        std::string sRes;
+        for (unsigned char c : aName)
+            sRes += std::isalnum(c) ? char(std::toupper(c)) : '_';
+        if (std::isdigit(static_cast<unsigned char>(sRes[0])))
+            sRes.insert(0, "_");
+        return sRes;
+    }
+
+    // Condition that c is one of aBytes (sorted): a check per run of consecutive bytes.
+    std::string condition(const std::vector<unsigned>& aBytes)
+    {
+        std::string sRes;
+        for (size_t i = 0; i < aBytes.size();)
+        {
+            size_t j = i;
+            while (j + 1 < aBytes.size() && aBytes[j + 1] == aBytes[j] + 1)
+                j++;
+            if (!sRes.empty())
+                sRes += " || ";
+            if (i == j)
+                sRes += "c == " + hex(aBytes[i]);
+            else
+                sRes += "uint8_t(c - " + hex(aBytes[i]) + ") <= " + std::to_string(aBytes[j] - aBytes[i]);
+            i = j + 1;
+        }
+        return sRes;
+    }
+
+    // Whether some transition from the state adds a digit to the accumulator.
+    bool keepsNumber(const Base::Conditions& aCond)
+    {
+        for (const Transition& t : aCond.m_Transitions)
+            if (Base::NumberActions[t.m_Number].m_Keep != 0)
+                return true;
+        return false;
+    }
+
+    // Actions of a transition and the jump. Other transitions reset the accumulator, but
+    // that matters only if the next state can continue the number.
+    std::string action(const Transition& t, size_t aNumClasses, const std::vector<bool>& aKeeps)
+    {
+        std::string sRes;
+        if (t.m_Tag != Base::DUMMY_TAG)
+            sRes += "m_SavedTagOffsets[" + std::to_string(t.m_Tag) + "] = sBase + (sPos - aBegin) - 1; ";
+        if (t.m_Number != Base::NUMBER_NONE)
+            sRes += "numberImpl(sAccumulator, m_Numbers, " + std::to_string(t.m_Number) + ", c); ";
+        else if (aKeeps[t.m_State])
+            sRes += "sAccumulator = 0; ";
+        if (t.m_Status != 0)
+            sRes += "sStatus = " + std::to_string(t.m_Status) + "; sState = " +
+                    std::to_string(t.m_State * aNumClasses) + "; goto finish;";
+        else
+            sRes += "goto S" + std::to_string(t.m_State) + ";";
+        return sRes;
+    }
+
+    std::string generate(const std::string& aClass, const std::vector<std::string_view>& aNames)
+    {
+        details::RuntimeStateMachine sWide;
+        sWide.m_Conditions.resize(details::maxNumConditions(aNames.data(), aNames.size()));
+        sWide.m_NumConditions = details::buildStateMachine(sWide, aNames.data(), aNames.size());
+        uint8_t sClasses[Base::Conditions::NUM_TRANSITIONS];
+        unsigned char sClassBytes[Base::Conditions::NUM_TRANSITIONS];
+        size_t sNumClasses = details::buildByteClasses(sWide, sClasses, sClassBytes);
+
+        std::vector<bool> sKeeps;
+        for (state_t s = 0; s < sWide.m_NumConditions; s++)
+            sKeeps.push_back(keepsNumber(sWide.m_Conditions[s]));
+
+        std::string sNames = aClass + "Names";
+        std::string sParams;
+        for (size_t i = 0; i < aNames.size(); i++)
+            sParams += std::string(i == 0 ? "" : ", ") + sNames + "::NAME_" + std::to_string(i);
+
+        std::ostringstream o;
+        o << "// Generated by HttpResponseParserGenerator, do not edit.\n"
+          << "#pragma once\n\n"
+          << "#include <HttpResponseParser.hpp>\n\n"
+          << "struct " << sNames << "\n{\n";
+        for (size_t i = 0; i < aNames.size(); i++)
+            o << "    static constexpr std::string_view NAME_" << i << " = \"" << aNames[i] << "\";\n";
+        o << "};\n\n"
+          << "// Direct-threaded BasicHttpResponseParser, see HttpResponseParserGenerator.cpp.\n"
+          << "class " << aClass << " : public BasicHttpResponseParser<" << sParams << ">\n{\n"
+          << "public:\n"
+          << "    using Base = BasicHttpResponseParser<" << sParams << ">;\n\n"
+          << "    enum header_t\n    {\n";
+        for (size_t i = 0; i < aNames.size(); i++)
+            o << "        " << enumName(aNames[i]) << (i == 0 ? " = SPECIAL_MAX" : "") << ",\n";
+        o << "        HEADER_MAX\n    };\n\n"
+          << "    using Base::feed;\n"
+          << "    inline size_t feed(const char* aBegin, const char* aEnd, status_t& aStatus);\n"
+          << "    inline size_t feed(std::string_view aData, status_t& aStatus);\n"
+          << "};\n\n"
+          << "static_assert(" << aClass << "::HEADER_MAX == " << aClass << "::Base::HEADER_MAX, \"Wrong headers\");\n"
+          << "static_assert(" << aClass << "::NUM_CONDITIONS == " << sWide.m_NumConditions << " &&\n"
+          << "              " << aClass << "::TheCompactStateMachine.numClasses() == " << sNumClasses << " &&\n"
+          << "              details::stateMachineChecksum(" << aClass << "::TheStateMachine) == "
+          << details::stateMachineChecksum(sWide) << "ull,\n"
+          << "              \"The state machine was changed, the parser must be generated again\");\n\n"
+          << "//////////////////////////////////// IMPLEMENTATION ////////////////////////////////////\n"
+          << "inline size_t " << aClass << "::feed(const char* aBegin, const char* aEnd, status_t& aStatus)\n{\n"
+          << "    const char* sPos = aBegin;\n"
+          << "    if (statusLineImpl(TheCompactStateMachine, m_CurrentState, m_CurrentPos, m_Numbers.accumulator(),\n"
+          << "                       m_SavedTagOffsets, m_Numbers, sPos, aEnd))\n"
+          << "        sPos += STATUS_LINE_PREFIX_SIZE;\n"
+          << "    const size_t sBase = m_CurrentPos - (sPos - aBegin);\n"
+          << "    uint64_t sAccumulator = m_Numbers.accumulator();\n"
+          << "    status_t sStatus = 0;\n"
+          << "    state_t sState = 0;\n"
+          << "    unsigned char c = 0;\n\n"
+          << "    switch (m_CurrentState)\n    {\n";
+        for (state_t s = 0; s < sWide.m_NumConditions; s++)
+            o << "        case " << s * sNumClasses << ": goto S" << s << ";\n";
+        o << "        default: return 0;\n    }\n\n";
+
+        for (state_t s = 0; s < sWide.m_NumConditions; s++)
+        {
+            const Base::Conditions& sCond = sWide.m_Conditions[s];
+            o << "S" << s << ": // " << HttpResponseParserProfile::stateName(aNames.data(), aNames.size(), s) << "\n";
+            uint8_t sSkip = details::skipKind(sWide, s);
+            if (sSkip != Base::SKIP_NONE)
+                o << "    {\n"
+                  << "        const char* sStop = skipImpl(" << (sSkip == Base::SKIP_TO_CR ? "SKIP_TO_CR" : "SKIP_TO_WS")
+                  << ", sPos, aEnd);\n"
+                  << "        profileSkip(TheCompactStateMachine, " << s * sNumClasses << ", sStop - sPos);\n"
+                  << "        sPos = sStop;\n"
+                  << "    }\n";
+            o << "    if (sPos == aEnd)\n"
+              << "    {\n"
+              << "        sState = " << s * sNumClasses << ";\n"
+              << "        goto finish;\n"
+              << "    }\n"
+              << "    c = *sPos++;\n"
+              << "    if constexpr (PROFILE)\n"
+              << "        profileHit(TheCompactStateMachine, TheCompactStateMachine.get(" << s * sNumClasses << ", c));\n";
+
+            // Bytes by transitions, the most common transition is the default.
+            std::map<std::tuple<state_t, unsigned, unsigned, unsigned>, std::vector<unsigned>> sGroups;
+            for (unsigned b = 0; b < Base::Conditions::NUM_TRANSITIONS; b++)
+            {
+                const Transition& t = sCond.m_Transitions[b];
+                sGroups[{t.m_State, t.m_Tag, t.m_Status, t.m_Number}].push_back(b);
+            }
+            auto sDefault = sGroups.begin();
+            for (auto sItr = sGroups.begin(); sItr != sGroups.end(); ++sItr)
+                if (sItr->second.size() > sDefault->second.size())
+                    sDefault = sItr;
+            // Check the groups in the order of bytes for stable output.
+            std::vector<const std::vector<unsigned>*> sOrder;
+            for (auto sItr = sGroups.begin(); sItr != sGroups.end(); ++sItr)
+                if (sItr != sDefault)
+                    sOrder.push_back(&sItr->second);
+            std::sort(sOrder.begin(), sOrder.end(), [](auto a, auto b) { return a->front() < b->front(); });
+            for (const std::vector<unsigned>* sBytes : sOrder)
+                o << "    if (" << condition(*sBytes) << ")\n"
+                  << "    {\n"
+                  << "        " << action(sCond.m_Transitions[sBytes->front()], sNumClasses, sKeeps) << "\n"
+                  << "    }\n";
+            o << "    " << action(sCond.m_Transitions[sDefault->second.front()], sNumClasses, sKeeps) << "\n\n";
+        }
+
+        o << "finish:\n"
+          << "    m_CurrentState = sState;\n"
+          << "    m_CurrentPos = sBase + (sPos - aBegin);\n"
+          << "    m_Numbers.accumulator() = sAccumulator;\n"
+          << "    aStatus = sStatus;\n"
+          << "    return sPos - aBegin;\n"
+          << "}\n\n"
+          << "inline size_t " << aClass << "::feed(std::string_view aData, status_t& aStatus)\n{\n"
+          << "    return feed(aData.data(), aData.data() + aData.size(), aStatus);\n"
+          << "}\n";
+        return o.str();
+    }
+} // namespace {
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <output file> <class name> <header name>..." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<std::string_view> sNames(argv + 3, argv + argc);
+    try
+    {
+        // Checks the names the same way as the parser does.
+        DynamicHttpResponseParser::Machine sCheck(sNames);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string sCode = generate(argv[2], sNames);
+    std::ofstream sFile(argv[1]);
+    sFile << sCode;
+    if (!sFile.flush())
+    {
+        std::cerr << "Failed to write " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -23,19 +23,47 @@
  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#include <HashedHttpResponseParser.hpp>
 #include <HttpResponseParser.hpp>
+#include <HttpResponsePipeline.hpp>
+#include <DynamicHttpResponseParser.hpp>
+#include <GeneratedAllHeadersParser.hpp>
+#include <GeneratedHttpResponseParser.hpp>
 
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <iostream>
+#include <vector>
 
 const size_t N = 4 * 1024 * 1024;
 const char req1[] = "HTTP/1.0 200 OK\r\nContent-Length:111\r\n\r\n";
 const size_t M1 = sizeof(req1) - 1;
 const char req2[] = "HTTP/1.0 200 OK\r\nContent-Type:222\r\nContent-Length:111\r\nLocation:here\r\nSomething:more\r\n\r\n";
 const size_t M2 = sizeof(req2) - 1;
+// Response with long headers that are not stored, as real cookies and policies.
+const char req3[] = "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/html; charset=utf-8\r\n"
+    "Set-Cookie: session=8d9f0b6c2e4a4f1c9a7e3b5d1f2c4e6a8b0d2f4a6c8e0b2d4f6a8c0e2b4d6f8a; Path=/; Domain=.example.com; Expires=Wed, 21 Oct 2026 07:28:00 GMT; Secure; HttpOnly; SameSite=Lax\r\n"
+    "Set-Cookie: preferences=eyJ0aGVtZSI6ImRhcmsiLCJsYW5ndWFnZSI6ImVuLVVTIiwidGltZXpvbmUiOiJVVEMiLCJub3RpZmljYXRpb25zIjp0cnVlfQ; Path=/; Max-Age=31536000; Secure\r\n"
+    "Content-Security-Policy: default-src 'self'; script-src 'self' 'unsafe-inline' https://cdn.example.com https://analytics.example.com; style-src 'self' 'unsafe-inline' https://fonts.googleapis.com; img-src 'self' data: https:; font-src 'self' https://fonts.gstatic.com; connect-src 'self' https://api.example.com wss://ws.example.com; frame-ancestors 'none'; base-uri 'self'; form-action 'self'\r\n"
+    "Strict-Transport-Security: max-age=63072000; includeSubDomains; preload\r\n"
+    "Content-Length: 12345\r\n"
+    "\r\n";
+const size_t M3 = sizeof(req3) - 1;
+// Keep the same total size of data for long responses.
+const size_t N3 = N * M2 / M3;
 char reqs[N * std::max(M1, M2)];
 
+// Parsers with a longer set of headers.
+template <template <const std::string_view&...> class PARSER>
+using WithAllHeaders = PARSER<HttpHeaderName::CONTENT_TYPE, HttpHeaderName::CONTENT_LENGTH,
+                              HttpHeaderName::CONTENT_RANGE, HttpHeaderName::TRANSFER_ENCODING,
+                              HttpHeaderName::LOCATION, HttpHeaderName::CONNECTION,
+                              HttpHeaderName::ETAG, HttpHeaderName::LAST_MODIFIED>;
+using AllHeadersParser = WithAllHeaders<BasicHttpResponseParser>;
+using HashedAllHeadersParser = WithAllHeaders<BasicHashedHttpResponseParser>;
+
 static void checkpoint(const char* aText = "", size_t aOpCount = 0, size_t aDataSize = 0)
 {
     using namespace std::chrono;
@@ -69,6 +97,169 @@ static size_t test(std::string_view data)
     return count;
 }
 
+template <class PARSER>
+static size_t test_bulk(PARSER& p, std::string_view data) __attribute__((noinline));
+template <class PARSER>
+static size_t test_bulk(PARSER& p, std::string_view data)
+{
+    size_t count = 0;
+
+    while (!data.empty())
+    {
+        HttpResponseParserBase::status_t status;
+        data.remove_prefix(p.feed(data, status));
+        if (0 != status)
+        {
+            count++;
+            p.reset();
+        }
+    }
+    return count;
+}
+
+// The same as test_bulk(), but responses are pipelined: the parser is restarted instead of reset.
+static size_t test_pipelined(std::string_view data) __attribute__((noinline));
+static size_t test_pipelined(std::string_view data)
+{
+    size_t count = 0;
+
+    HttpResponseParser p;
+    HttpResponsePipeline<HttpResponseParser> pipe(p, data);
+    while (pipe.next() == HttpResponseParserBase::SUCCESS)
+        count++;
+    return count;
+}
+
+// The same as test_bulk(), but also indexes all headers.
+static size_t test_indexed(std::string_view data) __attribute__((noinline));
+static size_t test_indexed(std::string_view data)
+{
+    size_t count = 0;
+
+    HttpResponseParser p;
+    std::array<HttpHeaderIndex::Entry, 16> entries;
+    HttpHeaderIndex index(entries);
+    while (!data.empty())
+    {
+        HttpResponseParser::status_t status;
+        data.remove_prefix(p.feed(data, status, index));
+        if (0 != status)
+        {
+            count += index.size();
+            p.reset();
+            index.reset();
+        }
+    }
+    return count;
+}
+
+// The same as test(), but uses the full (not compact) state machine,
+// i.e. what HttpResponseParser::feed did before byte classes were introduced.
+static size_t test_wide(std::string_view data) __attribute__((noinline));
+static size_t test_wide(std::string_view data)
+{
+    size_t count = 0;
+
+    const auto& m = HttpResponseParser::TheStateMachine;
+    std::array<size_t, HttpResponseParser::NUM_TAGS> tags = {};
+    HttpResponseParser::state_t state = 0;
+    HttpResponseParser::state_t pos = 0;
+    for (char c : data)
+    {
+        const HttpResponseParser::Transition& t = m[state][c];
+        state = t.m_State;
+        tags[t.m_Tag] = pos++;
+        if (0 != t.m_Status)
+        {
+            count++;
+            pos = 0;
+            tags.fill(0);
+        }
+    }
+    return count;
+}
+
+// Split the data into L streams (at boundaries of messages of the given size)
+// and parse them in lockstep with HttpResponseParser::feedMany.
+template <size_t L>
+static size_t test_interleaved(std::string_view data, size_t msg_size) __attribute__((noinline));
+template <size_t L>
+static size_t test_interleaved(std::string_view data, size_t msg_size)
+{
+    size_t count = 0;
+
+    std::array<HttpResponseParser, L> parsers;
+    std::array<HttpResponseParser*, L> ptrs;
+    std::array<std::string_view, L> streams;
+    std::array<HttpResponseParser::status_t, L> status;
+    std::array<size_t, L> eaten;
+    size_t stream_size = data.size() / msg_size / L * msg_size;
+    for (size_t i = 0; i < L; i++)
+    {
+        ptrs[i] = &parsers[i];
+        streams[i] = data.substr(i * stream_size, i + 1 < L ? stream_size : data.npos);
+    }
+
+    bool more = true;
+    while (more)
+    {
+        more = false;
+        HttpResponseParser::feedMany(L, ptrs.data(), streams.data(), status.data(), eaten.data());
+        for (size_t i = 0; i < L; i++)
+        {
+            streams[i].remove_prefix(eaten[i]);
+            if (0 != status[i])
+            {
+                count++;
+                parsers[i].reset();
+            }
+            more = more || !streams[i].empty();
+        }
+    }
+    return count;
+}
+
+// Simulate a lot of connections that receive their responses by small chunks
+// in turn, so that every feed works with a parser that is not in CPU cache.
+// The data is the same for all connections, the parsers are different.
+template <class PARSER>
+static size_t test_connections(std::vector<PARSER>& parsers, std::string_view data, size_t chunk_size) __attribute__((noinline));
+template <class PARSER>
+static size_t test_connections(std::vector<PARSER>& parsers, std::string_view data, size_t chunk_size)
+{
+    size_t count = 0;
+    for (size_t offset = 0; offset < data.size(); offset += chunk_size)
+    {
+        std::string_view chunk = data.substr(offset, chunk_size);
+        for (PARSER& p : parsers)
+        {
+            typename PARSER::status_t status;
+            p.feed(chunk, status);
+            count += status;
+        }
+    }
+    for (PARSER& p : parsers)
+        p.reset();
+    return count;
+}
+
+template <class PARSER>
+static size_t test_footprint(const char* name, std::string_view data)
+{
+    const size_t CONNECTIONS = 256 * 1024;
+    const size_t CHUNK = 16;
+    const size_t ROUNDS = 8;
+    std::vector<PARSER> parsers(CONNECTIONS);
+    std::cout << name << ": " << sizeof(PARSER) << " bytes per connection, "
+              << sizeof(PARSER) * CONNECTIONS / 1024 << " KB for " << CONNECTIONS << " connections" << std::endl;
+    size_t s = 0;
+    checkpoint();
+    for (size_t i = 0; i < ROUNDS; i++)
+        s += test_connections(parsers, data, CHUNK);
+    checkpoint(name, CONNECTIONS * ROUNDS, CONNECTIONS * ROUNDS * data.size());
+    return s;
+}
+
 static bool starts_with(std::string_view str, std::string_view prefix)
 {
     return str.size() >= prefix.size() && str.substr(0, prefix.size()) == prefix;
@@ -169,12 +360,65 @@ int main()
     srand(time(nullptr));
     size_t s = 0;
 
+    const auto& wide = HttpResponseParser::TheStateMachine;
+    const auto& compact = HttpResponseParser::TheCompactStateMachine;
+    std::cout << "Wide table    : " << wide.m_NumConditions * sizeof(HttpResponseParser::Conditions)
+              << " bytes, " << wide.m_NumConditions << " states" << std::endl;
+    std::cout << "Compact table : " << compact.footprint() << " bytes, "
+              << compact.m_NumConditions << " states, " << compact.m_NumClasses << " byte classes" << std::endl;
+
+    HttpResponseParser p;
+    const auto& names = HttpResponseParser::HeaderNames;
+    DynamicHttpResponseParser::Machine dm(std::vector<std::string_view>(names.begin(), names.end()));
+    DynamicHttpResponseParser dp(dm);
+    HashedHttpResponseParser hp;
+    AllHeadersParser ap;
+    HashedAllHeadersParser hap;
+    GeneratedHttpResponseParser gp;
+    GeneratedAllHeadersParser gap;
+    std::cout << "Dynamic table : " << dm.footprint() << " bytes, "
+              << dm.numConditions() << " states, " << dm.numClasses() << " byte classes" << std::endl;
+
     for (size_t i = 0; i < N; i++)
         std::copy(req1, req1 + M1, reqs + i * M1);
     checkpoint();
     s += test(std::string_view(reqs, N * M1));
     checkpoint("Result simple ", N, N * M1);
     checkpoint();
+    s += test_wide(std::string_view(reqs, N * M1));
+    checkpoint("Result wide simple ", N, N * M1);
+    checkpoint();
+    s += test_bulk(p, std::string_view(reqs, N * M1));
+    checkpoint("Result bulk simple ", N, N * M1);
+    s += test_bulk(gp, std::string_view(reqs, N * M1));
+    checkpoint("Result generated simple ", N, N * M1);
+    checkpoint();
+    s += test_pipelined(std::string_view(reqs, N * M1));
+    checkpoint("Result pipelined simple ", N, N * M1);
+    checkpoint();
+    s += test_indexed(std::string_view(reqs, N * M1));
+    checkpoint("Result indexed simple ", N, N * M1);
+    checkpoint();
+    s += test_bulk(dp, std::string_view(reqs, N * M1));
+    checkpoint("Result dynamic simple ", N, N * M1);
+    checkpoint();
+    s += test_bulk(hp, std::string_view(reqs, N * M1));
+    checkpoint("Result hashed simple ", N, N * M1);
+    checkpoint();
+    s += test_bulk(ap, std::string_view(reqs, N * M1));
+    checkpoint("Result bulk 8 headers simple ", N, N * M1);
+    s += test_bulk(gap, std::string_view(reqs, N * M1));
+    checkpoint("Result generated 8 headers simple ", N, N * M1);
+    checkpoint();
+    s += test_bulk(hap, std::string_view(reqs, N * M1));
+    checkpoint("Result hashed 8 headers simple ", N, N * M1);
+    checkpoint();
+    s += test_interleaved<4>(std::string_view(reqs, N * M1), M1);
+    checkpoint("Result interleaved x4 simple ", N, N * M1);
+    checkpoint();
+    s += test_interleaved<8>(std::string_view(reqs, N * M1), M1);
+    checkpoint("Result interleaved x8 simple ", N, N * M1);
+    checkpoint();
     s += naive(std::string_view(reqs, N * M1));
     checkpoint("Naive simple  ", N, N * M1);
 
@@ -184,8 +428,77 @@ int main()
     s += test(std::string_view(reqs, N * M2));
     checkpoint("Result complex", N, N * M2);
     checkpoint();
+    s += test_wide(std::string_view(reqs, N * M2));
+    checkpoint("Result wide complex", N, N * M2);
+    checkpoint();
+    s += test_bulk(p, std::string_view(reqs, N * M2));
+    checkpoint("Result bulk complex", N, N * M2);
+    s += test_bulk(gp, std::string_view(reqs, N * M2));
+    checkpoint("Result generated complex", N, N * M2);
+    checkpoint();
+    s += test_pipelined(std::string_view(reqs, N * M2));
+    checkpoint("Result pipelined complex", N, N * M2);
+    checkpoint();
+    s += test_indexed(std::string_view(reqs, N * M2));
+    checkpoint("Result indexed complex", N, N * M2);
+    checkpoint();
+    s += test_bulk(dp, std::string_view(reqs, N * M2));
+    checkpoint("Result dynamic complex", N, N * M2);
+    checkpoint();
+    s += test_bulk(hp, std::string_view(reqs, N * M2));
+    checkpoint("Result hashed complex", N, N * M2);
+    checkpoint();
+    s += test_bulk(ap, std::string_view(reqs, N * M2));
+    checkpoint("Result bulk 8 headers complex", N, N * M2);
+    s += test_bulk(gap, std::string_view(reqs, N * M2));
+    checkpoint("Result generated 8 headers complex", N, N * M2);
+    checkpoint();
+    s += test_bulk(hap, std::string_view(reqs, N * M2));
+    checkpoint("Result hashed 8 headers complex", N, N * M2);
+    checkpoint();
+    s += test_interleaved<4>(std::string_view(reqs, N * M2), M2);
+    checkpoint("Result interleaved x4 complex", N, N * M2);
+    checkpoint();
+    s += test_interleaved<8>(std::string_view(reqs, N * M2), M2);
+    checkpoint("Result interleaved x8 complex", N, N * M2);
+    checkpoint();
     s += naive(std::string_view(reqs, N * M2));
     checkpoint("Naive complex ", N, N * M2);
 
+    for (size_t i = 0; i < N3; i++)
+        std::copy(req3, req3 + M3, reqs + i * M3);
+    checkpoint();
+    s += test(std::string_view(reqs, N3 * M3));
+    checkpoint("Result long   ", N3, N3 * M3);
+    checkpoint();
+    s += test_bulk(p, std::string_view(reqs, N3 * M3));
+    checkpoint("Result bulk long   ", N3, N3 * M3);
+    s += test_bulk(gp, std::string_view(reqs, N3 * M3));
+    checkpoint("Result generated long   ", N3, N3 * M3);
+    checkpoint();
+    s += test_pipelined(std::string_view(reqs, N3 * M3));
+    checkpoint("Result pipelined long   ", N3, N3 * M3);
+    checkpoint();
+    s += test_bulk(dp, std::string_view(reqs, N3 * M3));
+    checkpoint("Result dynamic long   ", N3, N3 * M3);
+    checkpoint();
+    s += test_bulk(hp, std::string_view(reqs, N3 * M3));
+    checkpoint("Result hashed long   ", N3, N3 * M3);
+    checkpoint();
+    s += test_bulk(ap, std::string_view(reqs, N3 * M3));
+    checkpoint("Result bulk 8 headers long   ", N3, N3 * M3);
+    s += test_bulk(gap, std::string_view(reqs, N3 * M3));
+    checkpoint("Result generated 8 headers long   ", N3, N3 * M3);
+    checkpoint();
+    s += test_bulk(hap, std::string_view(reqs, N3 * M3));
+    checkpoint("Result hashed 8 headers long   ", N3, N3 * M3);
+    checkpoint();
+    s += naive(std::string_view(reqs, N3 * M3));
+    checkpoint("Naive long    ", N3, N3 * M3);
+
+    s += test_footprint<HttpResponseParser>("Connections size_t", std::string_view(req2, M2));
+    s += test_footprint<HttpResponseParser32>("Connections uint32", std::string_view(req2, M2));
+    s += test_footprint<HttpResponseParser16>("Connections uint16", std::string_view(req2, M2));
+
     std::cout << "Side effect: " << s << std::endl;
 }
\ No newline at end of file
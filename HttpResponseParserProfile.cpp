@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <HttpResponseParserProfile.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <numeric>
+
+#include <HttpResponseStateMachine.hpp>
+
+namespace
+{
+    using Conditions = HttpResponseParserBase::Conditions;
+    using state_t = HttpResponseParserBase::state_t;
+    using Counters = HttpResponseParserProfile::Counters;
+
+    std::map<const void*, Counters> TheCounters;
+    // The last found counters, usually the only ones.
+    const void* TheLastMachine = nullptr;
+    Counters* TheLastCounters = nullptr;
+
+    // Full state machine with labels of states, rebuilt for the report.
+    struct WideStateMachine : details::RuntimeStateMachine
+    {
+        std::vector<details::StateLabel> m_Labels;
+
+        WideStateMachine(const std::string_view* aNames, size_t aCount)
+        {
+            m_Conditions.resize(details::maxNumConditions(aNames, aCount));
+            m_Labels.resize(m_Conditions.size());
+            m_NumConditions = details::buildStateMachine(*this, aNames, aCount, m_Labels.data());
+        }
+    };
+
+    std::string fragmentName(const std::string_view* aNames, size_t aCount, HttpResponseParserBase::fragment_t aFrag)
+    {
+        switch (aFrag)
+        {
+            case HttpResponseParserBase::MAJOR_VERSION: return "major version";
+            case HttpResponseParserBase::MINOR_VERSION: return "minor version";
+            case HttpResponseParserBase::STATUS_CODE: return "status code";
+            case HttpResponseParserBase::REASON_PHRASE: return "reason phrase";
+        }
+        size_t sHeader = aFrag - HttpResponseParserBase::SPECIAL_MAX;
+        return sHeader < aCount ? std::string(aNames[sHeader]) : "unknown header";
+    }
+
+    std::string labelName(const std::string_view* aNames, size_t aCount, const details::StateLabel& aLabel)
+    {
+        std::string sFrag = fragmentName(aNames, aCount, aLabel.m_Fragment);
+        switch (aLabel.m_Kind)
+        {
+            case details::LABEL_PREFIX:
+                return "\"HTTP/\" byte " + std::to_string(aLabel.m_Position);
+            case details::LABEL_VERSION_FIRST: return sFrag + " first digit";
+            case details::LABEL_VERSION_NEXT: return sFrag + " next digits";
+            case details::LABEL_STATUS_DIGIT:
+                return sFrag + " digit " + std::to_string(aLabel.m_Position);
+            case details::LABEL_STATUS_SPACE: return sFrag + " trailing space";
+            case details::LABEL_WAIT_VALUE: return sFrag + " leading WS";
+            case details::LABEL_WAIT_VALUE_LF: return sFrag + " leading CR";
+            case details::LABEL_VALUE: return sFrag + " value";
+            case details::LABEL_TRAILING_WS: return sFrag + " trailing WS";
+            case details::LABEL_TRAILING_CR: return sFrag + " trailing CR";
+            case details::LABEL_NUMBER: return sFrag + " number";
+            case details::LABEL_NUMBER_TRAILING_WS: return sFrag + " number trailing WS";
+            case details::LABEL_NUMBER_TRAILING_CR: return sFrag + " number trailing CR";
+            case details::LABEL_NEW_LINE: return "new line";
+            case details::LABEL_SKIP_LINE: return "skipped line";
+            case details::LABEL_SEARCH_LF: return "line CR";
+            case details::LABEL_SEARCH_FINAL_LF: return "empty line CR";
+            case details::LABEL_NAME:
+                // Name states are shared by names with common prefix, show the prefix.
+                if (aLabel.m_Position == sFrag.size())
+                    return sFrag + " name";
+                return sFrag + " name \"" + sFrag.substr(0, aLabel.m_Position) + "\"";
+        }
+        return "unknown";
+    }
+
+    // Bytes of a byte class: a few bytes are listed, otherwise just counted.
+    std::string className(const uint8_t* aClasses, size_t aClass)
+    {
+        std::string sList;
+        size_t sSize = 0;
+        for (size_t i = 0; i < Conditions::NUM_TRANSITIONS; i++)
+        {
+            if (aClasses[i] != aClass)
+                continue;
+            if (sSize++ > 0)
+                sList += ' ';
+            char sBuf[8];
+            if (i > ' ' && i < 127)
+                snprintf(sBuf, sizeof(sBuf), "'%c'", char(i));
+            else
+                snprintf(sBuf, sizeof(sBuf), "0x%02zx", i);
+            sList += sBuf;
+        }
+        return sSize <= 4 ? sList : std::to_string(sSize) + " bytes";
+    }
+
+    std::string share(uint64_t aPart, uint64_t aTotal)
+    {
+        char sBuf[16];
+        snprintf(sBuf, sizeof(sBuf), "%5.1f%%", aTotal == 0 ? 0. : 100. * aPart / aTotal);
+        return sBuf;
+    }
+} // namespace {
+
+HttpResponseParserProfile::Counters& HttpResponseParserProfile::counters(const void* aMachine)
+{
+    if (aMachine != TheLastMachine)
+    {
+        TheLastMachine = aMachine;
+        TheLastCounters = &TheCounters[aMachine];
+    }
+    return *TheLastCounters;
+}
+
+void HttpResponseParserProfile::reset()
+{
+    TheCounters.clear();
+    TheLastMachine = nullptr;
+    TheLastCounters = nullptr;
+}
+
+std::string HttpResponseParserProfile::stateName(const std::string_view* aNames, size_t aCount, uint32_t aState)
+{
+    WideStateMachine sWide(aNames, aCount);
+    return aState < sWide.m_NumConditions ? labelName(aNames, aCount, sWide.m_Labels[aState]) : "unknown";
+}
+
+std::string HttpResponseParserProfile::report(const void* aMachine, const std::string_view* aNames, size_t aCount, size_t aTop)
+{
+    WideStateMachine sWide(aNames, aCount);
+    uint8_t sClasses[Conditions::NUM_TRANSITIONS];
+    unsigned char sClassBytes[Conditions::NUM_TRANSITIONS];
+    size_t sNumClasses = details::buildByteClasses(sWide, sClasses, sClassBytes);
+
+    const Counters& sCounters = counters(aMachine);
+    std::vector<uint64_t> sHits = sCounters.m_Hits;
+    sHits.resize(sWide.m_NumConditions * sNumClasses);
+    std::vector<uint64_t> sVisits(sWide.m_NumConditions);
+    std::vector<uint64_t> sSkipped(sWide.m_NumConditions);
+    for (size_t i = 0; i < sHits.size(); i++)
+        sVisits[i / sNumClasses] += sHits[i];
+    for (size_t i = 0; i < sCounters.m_Skipped.size() && i / sNumClasses < sSkipped.size(); i++)
+        sSkipped[i / sNumClasses] += sCounters.m_Skipped[i];
+
+    uint64_t sPrefixBytes = sCounters.m_StatusLines * HttpResponseParserBase::STATUS_LINE_PREFIX_SIZE;
+    uint64_t sTotal = sPrefixBytes + std::accumulate(sVisits.begin(), sVisits.end(), uint64_t(0)) +
+                      std::accumulate(sSkipped.begin(), sSkipped.end(), uint64_t(0));
+
+    std::string sRes = "Parsed bytes: " + std::to_string(sTotal) + ", status line prefixes jumped over: " +
+                       std::to_string(sCounters.m_StatusLines) + " (" + share(sPrefixBytes, sTotal) + ")\n";
+
+    std::vector<state_t> sStates(sWide.m_NumConditions);
+    std::iota(sStates.begin(), sStates.end(), 0);
+    std::stable_sort(sStates.begin(), sStates.end(), [&](state_t a, state_t b)
+    {
+        return sVisits[a] + sSkipped[a] > sVisits[b] + sSkipped[b];
+    });
+    sRes += "Hot states:\n";
+    sRes += "   share      table    skipped  state\n";
+    for (size_t i = 0; i < sStates.size() && i < aTop; i++)
+    {
+        state_t s = sStates[i];
+        if (sVisits[s] + sSkipped[s] == 0)
+            break;
+        char sBuf[64];
+        snprintf(sBuf, sizeof(sBuf), "  %s %10llu %10llu  ", share(sVisits[s] + sSkipped[s], sTotal).c_str(),
+                 (unsigned long long)sVisits[s], (unsigned long long)sSkipped[s]);
+        sRes += sBuf + labelName(aNames, aCount, sWide.m_Labels[s]) + "\n";
+    }
+
+    std::vector<size_t> sTransitions(sHits.size());
+    std::iota(sTransitions.begin(), sTransitions.end(), 0);
+    std::stable_sort(sTransitions.begin(), sTransitions.end(), [&](size_t a, size_t b)
+    {
+        return sHits[a] > sHits[b];
+    });
+    sRes += "Hot transitions:\n";
+    sRes += "        hits  state -> next state, by bytes\n";
+    for (size_t i = 0; i < sTransitions.size() && i < aTop; i++)
+    {
+        size_t sIndex = sTransitions[i];
+        if (sHits[sIndex] == 0)
+            break;
+        state_t s = sIndex / sNumClasses;
+        size_t sClass = sIndex % sNumClasses;
+        const auto& t = sWide.m_Conditions[s].m_Transitions[sClassBytes[sClass]];
+        std::string sNext = t.m_Status != 0 ? "end: " + std::string(HttpResponseParserBase::getErrorStr(t.m_Status))
+                                            : labelName(aNames, aCount, sWide.m_Labels[t.m_State]);
+        char sBuf[32];
+        snprintf(sBuf, sizeof(sBuf), "  %10llu  ", (unsigned long long)sHits[sIndex]);
+        sRes += sBuf + labelName(aNames, aCount, sWide.m_Labels[s]) + " -> " + sNext + ", by " +
+                className(sClasses, sClass) + "\n";
+    }
+    return sRes;
+}
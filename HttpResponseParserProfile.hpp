@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Profile of the response parser state machines: how many times each transition was
+// taken and how many bytes each state consumed without the transition table (skipped
+// by vectorized search or jumped over by header name lookup of the hashed parser).
+// Collected by all parsing paths of all parsers only if the code is built with
+// HTTP_RESPONSE_PARSER_PROFILE defined (the cmake option of the same name); otherwise
+// nothing is collected and the parsers are not changed a bit.
+// States and transitions are identified by their indexes in the compact state machine,
+// the report maps them back to what buildStateMachine made them for.
+// Counters are not synchronized, profile one thread at a time.
+class HttpResponseParserProfile
+{
+public:
+    struct Counters
+    {
+        // Number of times each transition was taken, by its index in the compact table.
+        std::vector<uint64_t> m_Hits;
+        // Number of bytes consumed without the table, by compact state.
+        std::vector<uint64_t> m_Skipped;
+        // Number of status line prefixes that bulk feed jumped over.
+        uint64_t m_StatusLines = 0;
+
+        void hit(size_t aIndex);
+        void skip(size_t aState, size_t aCount);
+    };
+
+    // Counters of a state machine, created on the first call.
+    static Counters& counters(const void* aMachine);
+    // Drop all the counters.
+    static void reset();
+
+    // Report of the state machine, that was built for the given header names: the
+    // number of parsed bytes, aTop hottest states with the share of bytes they consumed,
+    // aTop hottest transitions.
+    static std::string report(const void* aMachine, const std::string_view* aNames, size_t aCount, size_t aTop);
+    // Human readable name of a state, like "Content-Length value" or "reason phrase trailing WS".
+    static std::string stateName(const std::string_view* aNames, size_t aCount, uint32_t aState);
+};
+
+//////////////////////////////////// IMPLEMENTATION ////////////////////////////////////
+inline void HttpResponseParserProfile::Counters::hit(size_t aIndex)
+{
+    if (aIndex >= m_Hits.size())
+        m_Hits.resize(aIndex + 1);
+    m_Hits[aIndex]++;
+}
+
+inline void HttpResponseParserProfile::Counters::skip(size_t aState, size_t aCount)
+{
+    if (aState >= m_Skipped.size())
+        m_Skipped.resize(aState + 1);
+    m_Skipped[aState] += aCount;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <DynamicHttpResponseParser.hpp>
+#include <GeneratedHttpResponseParser.hpp>
+#include <HashedHttpResponseParser.hpp>
+#include <HttpResponseParser.hpp>
+
+#include <assert.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// This test is built with HTTP_RESPONSE_PARSER_PROFILE.
+static_assert(HttpResponseParserBase::PROFILE, "Profiling must be on");
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+const std::string_view RESPONSE =
+    "HTTP/1.1 200 OK\r\n"
+    "Server: nginx\r\n"
+    "Content-Type: text/html; charset=utf-8\r\n"
+    "Content-Length:  1234 \r\n"
+    "Set-Cookie: id=a3fWa; Expires=Thu, 21 Oct 2021 07:28:00 GMT; Secure; HttpOnly\r\n"
+    "Location: http://example.com/some/long/path/to/the/resource\r\n"
+    "\r\n";
+
+using Parser = HttpResponseParser::GenericHttpResponseParser;
+using state_t = HttpResponseParserBase::state_t;
+constexpr const auto& Machine = Parser::TheCompactStateMachine;
+constexpr size_t NUM_CLASSES = Machine.numClasses();
+constexpr size_t NUM_CONDITIONS = Machine.m_NumConditions;
+
+// Bytes consumed in each (not compact) state.
+std::vector<uint64_t> stateBytes(const void* aMachine, size_t aNumClasses, size_t aNumConditions)
+{
+    const HttpResponseParserProfile::Counters& c = HttpResponseParserProfile::counters(aMachine);
+    std::vector<uint64_t> sRes(aNumConditions);
+    for (size_t i = 0; i < c.m_Hits.size(); i++)
+        sRes[i / aNumClasses] += c.m_Hits[i];
+    for (size_t i = 0; i < c.m_Skipped.size(); i++)
+        sRes[i / aNumClasses] += c.m_Skipped[i];
+    return sRes;
+}
+
+uint64_t totalBytes(const std::vector<uint64_t>& aBytes, const void* aMachine)
+{
+    uint64_t sRes = HttpResponseParserProfile::counters(aMachine).m_StatusLines * HttpResponseParserBase::STATUS_LINE_PREFIX_SIZE;
+    for (uint64_t n : aBytes)
+        sRes += n;
+    return sRes;
+}
+
+state_t wideState(std::string_view aInput)
+{
+    return details::walkCompactStateMachine(Machine, 0, aInput) / NUM_CLASSES;
+}
+
+void test_labels()
+{
+    const auto& sNames = Parser::HeaderNames;
+    auto name = [&](state_t s) { return HttpResponseParserProfile::stateName(sNames.data(), sNames.size(), s); };
+    check(name(0) == "\"HTTP/\" byte 0", "Labels: prefix");
+    check(name(wideState("HTTP/")) == "major version first digit", "Labels: major");
+    check(name(wideState("HTTP/1.")) == "minor version first digit", "Labels: minor");
+    check(name(wideState("HTTP/1.1 2")) == "status code digit 1", "Labels: status code");
+    check(name(wideState("HTTP/1.1 200")) == "status code trailing space", "Labels: status space");
+    check(name(wideState("HTTP/1.1 200 ")) == "reason phrase leading WS", "Labels: reason");
+    check(name(wideState("HTTP/1.1 200 OK")) == "reason phrase value", "Labels: reason value");
+    check(name(wideState("HTTP/1.1 200 OK ")) == "reason phrase trailing WS", "Labels: reason trailing WS");
+    check(name(wideState("HTTP/1.1 200 OK\r\n")) == "new line", "Labels: new line");
+    check(name(wideState("HTTP/1.1 200 OK\r\nServer")) == "skipped line", "Labels: skipped");
+    check(name(wideState("HTTP/1.1 200 OK\r\nServer\r")) == "line CR", "Labels: line CR");
+    check(name(wideState("HTTP/1.1 200 OK\r\n\r")) == "empty line CR", "Labels: empty line CR");
+    check(name(wideState("HTTP/1.1 200 OK\r\ncontent-")) == "Content-Type name \"Content-\"", "Labels: shared name");
+    check(name(wideState("HTTP/1.1 200 OK\r\ncontent-l")) == "Content-Length name \"Content-L\"", "Labels: name");
+    check(name(wideState("HTTP/1.1 200 OK\r\nContent-Length")) == "Content-Length name", "Labels: full name");
+    check(name(wideState("HTTP/1.1 200 OK\r\nContent-Length: 1")) == "Content-Length number", "Labels: number");
+    check(name(wideState("HTTP/1.1 200 OK\r\nContent-Length: 1\r")) == "Content-Length number trailing CR", "Labels: number CR");
+    check(name(wideState("HTTP/1.1 200 OK\r\nContent-Length: x")) == "Content-Length value", "Labels: not a number");
+    check(name(wideState("HTTP/1.1 200 OK\r\nLocation: x\t")) == "Location trailing WS", "Labels: value");
+    check(name(NUM_CONDITIONS) == "unknown", "Labels: out of range");
+}
+
+void test_bytewise()
+{
+    HttpResponseParserProfile::reset();
+    Parser p;
+    Parser::status_t res = 0;
+    size_t i = 0;
+    while (i < RESPONSE.size() && res == 0)
+        res = p.feed(RESPONSE[i++]);
+    check(res == Parser::SUCCESS && i == RESPONSE.size(), "Bytewise: not parsed");
+
+    const HttpResponseParserProfile::Counters& c = HttpResponseParserProfile::counters(&Machine);
+    check(c.m_StatusLines == 0 && c.m_Skipped.empty(), "Bytewise: nothing must be skipped");
+    std::vector<uint64_t> sBytes = stateBytes(&Machine, NUM_CLASSES, NUM_CONDITIONS);
+    check(totalBytes(sBytes, &Machine) == RESPONSE.size(), "Bytewise: wrong total");
+    for (state_t s = 0; s < HttpResponseParserBase::REASON_PHRASE_CONDITION; s++)
+        check(sBytes[s] == 1, "Bytewise: status line states are visited once");
+    check(sBytes[wideState("HTTP/1.1 200 OK\r\n")] == 6, "Bytewise: wrong new line visits");
+
+    // The hottest transition stays in a value.
+    size_t sHot = 0;
+    for (size_t j = 0; j < c.m_Hits.size(); j++)
+        sHot = c.m_Hits[j] > c.m_Hits[sHot] ? j : sHot;
+    check(Machine.transitions()[sHot].m_State == sHot / NUM_CLASSES * NUM_CLASSES, "Bytewise: wrong hot transition");
+
+    std::string sReport = Parser::profileReport(5);
+    check(sReport.find("Parsed bytes: " + std::to_string(RESPONSE.size())) == 0, "Bytewise: wrong report total");
+    check(sReport.find("Location value") != std::string::npos, "Bytewise: hot state is not reported");
+    check(sReport.find("Hot transitions:") != std::string::npos, "Bytewise: no transitions");
+}
+
+// Bulk feed must consume bytes in the same states as bytewise, apart from the
+// status line prefix that is jumped over.
+template <class PARSER>
+void test_bulk(size_t aStep)
+{
+    HttpResponseParserProfile::reset();
+    PARSER p;
+    typename PARSER::status_t res = 0;
+    for (size_t sPos = 0; sPos < RESPONSE.size() && res == 0; sPos += aStep)
+        p.feed(RESPONSE.substr(sPos, aStep), res);
+    check(res == PARSER::SUCCESS, "Bulk: not parsed");
+    // Each type of offsets has its own instance of the state machine.
+    const void* sMachine = &PARSER::TheCompactStateMachine;
+    std::vector<uint64_t> sBytes = stateBytes(sMachine, NUM_CLASSES, NUM_CONDITIONS);
+    check(totalBytes(sBytes, sMachine) == RESPONSE.size(), "Bulk: wrong total");
+
+    HttpResponseParserProfile::reset();
+    Parser sBytewise;
+    for (char c : RESPONSE)
+        sBytewise.feed(c);
+    std::vector<uint64_t> sExpected = stateBytes(&Machine, NUM_CLASSES, NUM_CONDITIONS);
+    for (state_t s = HttpResponseParserBase::REASON_PHRASE_CONDITION; s < NUM_CONDITIONS; s++)
+        check(sBytes[s] == sExpected[s], "Bulk: wrong bytes of a state");
+}
+
+void test_hashed()
+{
+    HttpResponseParserProfile::reset();
+    HashedHttpResponseParser p;
+    HashedHttpResponseParser::status_t res = 0;
+    p.feed(RESPONSE, res);
+    check(res == HashedHttpResponseParser::SUCCESS, "Hashed: not parsed");
+    std::vector<uint64_t> sBytes = stateBytes(&Machine, NUM_CLASSES, NUM_CONDITIONS);
+    check(totalBytes(sBytes, &Machine) == RESPONSE.size(), "Hashed: wrong total");
+    check(HttpResponseParserProfile::counters(&Machine).m_StatusLines == 1, "Hashed: prefix must be jumped over");
+}
+
+void test_many()
+{
+    HttpResponseParserProfile::reset();
+    std::vector<Parser> sParsers(3);
+    std::vector<Parser*> sPtrs = {&sParsers[0], &sParsers[1], &sParsers[2]};
+    std::vector<std::string_view> sData(3, RESPONSE);
+    std::vector<Parser::status_t> sStatus(3);
+    std::vector<size_t> sEaten(3);
+    Parser::feedMany(3, sPtrs.data(), sData.data(), sStatus.data(), sEaten.data());
+    for (size_t i = 0; i < 3; i++)
+        check(sStatus[i] == Parser::SUCCESS, "Many: not parsed");
+    std::vector<uint64_t> sBytes = stateBytes(&Machine, NUM_CLASSES, NUM_CONDITIONS);
+    check(totalBytes(sBytes, &Machine) == 3 * RESPONSE.size(), "Many: wrong total");
+}
+
+void test_dynamic()
+{
+    const std::vector<std::string_view> sNames = {"Set-Cookie", "Content-Length"};
+    DynamicHttpResponseParser::Machine m(sNames);
+    HttpResponseParserProfile::reset();
+    DynamicHttpResponseParser p(m);
+    DynamicHttpResponseParser::status_t res = 0;
+    p.feed(RESPONSE, res);
+    check(res == DynamicHttpResponseParser::SUCCESS, "Dynamic: not parsed");
+    std::vector<uint64_t> sBytes = stateBytes(&m, m.numClasses(), m.numConditions());
+    check(totalBytes(sBytes, &m) == RESPONSE.size(), "Dynamic: wrong total");
+
+    std::string sReport = m.profileReport(3);
+    check(sReport.find("Set-Cookie value") != std::string::npos, "Dynamic: hot state is not reported");
+    check(sReport.find("Location") == std::string::npos, "Dynamic: wrong names");
+}
+
+int main()
+{
+    try
+    {
+        test_labels();
+        test_bytewise();
+        for (size_t sStep : {1, 3, 7, 16, 1000})
+        {
+            test_bulk<Parser>(sStep);
+            test_bulk<HttpResponseParser16>(sStep);
+            test_bulk<GeneratedHttpResponseParser>(sStep);
+        }
+        test_hashed();
+        test_many();
+        test_dynamic();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Well done!" << std::endl;
+}
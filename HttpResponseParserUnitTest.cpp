@@ -23,11 +23,16 @@
  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#include <HashedHttpResponseParser.hpp>
 #include <HttpResponseParser.hpp>
 
 #include <assert.h>
 
 #include <iostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 void check(bool aExpession, const char* aMessage)
 {
@@ -60,6 +65,40 @@ void test_fail(const char* data, HttpResponseParser::status_t expected)
         res = p.feed(*c);
 
     check(res == expected, "wrong result after reset");
+
+    // Bulk feed must stop at the same character.
+    std::string_view sData(data);
+    for (size_t sChunk = 1; sChunk <= sData.size(); sChunk++)
+    {
+        p.reset();
+        res = 0;
+        size_t sFed = 0;
+        while (sFed < sData.size() && res == 0)
+            sFed += p.feed(sData.substr(sFed, sChunk), res);
+
+        check(res == expected, "wrong result of bulk feed");
+        check(sFed == p.count(), "wrong count of bulk feed");
+    }
+}
+
+void test_bulk(std::string_view resp, std::string_view length)
+{
+    // Response followed by a body and by the next response.
+    std::string sData = std::string(resp) + "BODY" + std::string(resp);
+    HttpResponseParser p;
+    for (size_t sChunk = 1; sChunk <= sData.size(); sChunk++)
+    {
+        p.reset();
+        HttpResponseParser::status_t res = 0;
+        size_t sFed = 0;
+        while (sFed < sData.size() && res == 0)
+            sFed += p.feed(std::string_view(sData).substr(sFed, sChunk), res);
+
+        check(res == HttpResponseParser::SUCCESS, "Bulk: not success");
+        check(sFed == resp.size(), "Bulk: wrong count of eaten characters");
+        check(p.count() == resp.size(), "Bulk: wrong count");
+        check(p.getFragmentStr(sData, HttpResponseParser::CONTENT_LENGTH) == length, "Bulk: wrong content length");
+    }
 }
 
 void test_pass(std::string_view resp,
@@ -101,6 +140,8 @@ void test_pass(std::string_view resp,
     check(p.getFragmentStr(resp, HttpResponseParser::CONTENT_TYPE) == type, "Wrong content type after restart");
     check(p.getFragmentStr(resp, HttpResponseParser::LOCATION) == location, "Wrong location after restart");
     check(p.getFragmentStr(resp, HttpResponseParser::TRANSFER_ENCODING) == trenc, "Wrong trasfer encoding after restart");
+
+    test_bulk(resp, length);
 }
 
 void test_misc()
@@ -140,6 +181,631 @@ void test_misc()
     check(!p.isFragmentFound(HttpResponseParser::TRANSFER_ENCODING), "Encoding was found");
 }
 
+void test_custom_headers()
+{
+    using Parser = BasicHttpResponseParser<HttpHeaderName::ETAG, HttpHeaderName::LAST_MODIFIED, HttpHeaderName::CONNECTION>;
+    constexpr HttpResponseParser::fragment_t ETAG = Parser::header(HttpHeaderName::ETAG);
+    constexpr HttpResponseParser::fragment_t LAST_MODIFIED = Parser::header(HttpHeaderName::LAST_MODIFIED);
+    constexpr HttpResponseParser::fragment_t CONNECTION = Parser::header(HttpHeaderName::CONNECTION);
+    static_assert(ETAG == Parser::SPECIAL_MAX && CONNECTION + 1 == Parser::HEADER_MAX, "Wrong header IDs");
+    static_assert(Parser::header("Content-Length") == Parser::HEADER_MAX, "Unexpected header");
+
+    using Empty = BasicHttpResponseParser<>;
+    static_assert(Empty::NUM_CONDITIONS < Parser::NUM_CONDITIONS, "Wrong number of states");
+    static_assert(Parser::NUM_CONDITIONS != HttpResponseParser::NUM_CONDITIONS, "Wrong number of states");
+
+    std::string_view data = "HTTP/1.1 304 Not Modified\r\nContent-Length: 12\r\nEtag: \"abc\"\r\n"
+                            "connection: keep-alive\r\nLast-Modified: Wed, 21 Oct 2015 07:28:00 GMT\r\n\r\n";
+    Parser p;
+    Parser::status_t res = 0;
+    check(p.feed(data, res) == data.size(), "Not all data was fed");
+    check(res == Parser::SUCCESS, "Not success");
+    check(p.getFragmentStr(data, Parser::STATUS_CODE) == "304", "Wrong status");
+    check(p.getFragmentStr(data, ETAG) == "\"abc\"", "Wrong ETag");
+    check(p.getFragmentStr(data, LAST_MODIFIED) == "Wed, 21 Oct 2015 07:28:00 GMT", "Wrong Last-Modified");
+    check(p.getFragmentStr(data, CONNECTION) == "keep-alive", "Wrong Connection");
+
+    Empty e;
+    check(e.feed(data, res) == data.size(), "Not all data was fed");
+    check(res == Empty::SUCCESS, "Not success");
+    check(e.getFragmentStr(data, Empty::REASON_PHRASE) == "Not Modified", "Wrong reason phrase");
+}
+
+void test_keep_alive()
+{
+    using Parser = BasicHttpResponseParser<HttpHeaderName::CONNECTION>;
+    constexpr HttpResponseParser::fragment_t CONNECTION = Parser::header(HttpHeaderName::CONNECTION);
+    auto sKeepAlive = [](std::string_view aData)
+    {
+        Parser p;
+        Parser::status_t res = 0;
+        p.feed(aData, res);
+        check(res == Parser::SUCCESS, "Not success");
+        return Parser::keepAlive(p.getFragmentStr(aData, Parser::MINOR_VERSION), p.getFragmentStr(aData, CONNECTION));
+    };
+    check(sKeepAlive("HTTP/1.1 200 OK\r\n\r\n"), "HTTP/1.1 is not persistent");
+    check(!sKeepAlive("HTTP/1.0 200 OK\r\n\r\n"), "HTTP/1.0 is persistent");
+    check(!sKeepAlive("HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n"), "Close is ignored");
+    check(!sKeepAlive("HTTP/1.1 200 OK\r\nconnection: Upgrade,\tCLOSE \r\n\r\n"), "Close is ignored");
+    check(sKeepAlive("HTTP/1.0 200 OK\r\nConnection: Keep-Alive\r\n\r\n"), "Keep-alive is ignored");
+    check(!sKeepAlive("HTTP/1.0 200 OK\r\nConnection: keep-alive, close\r\n\r\n"), "Close is ignored");
+    check(!sKeepAlive("HTTP/1.0 200 OK\r\nConnection: keep-alive-not\r\n\r\n"), "Wrong option");
+    check(!HttpResponseParserBase::keepAlive("1", {"cl", "ose"}), "Split value");
+    check(HttpResponseParserBase::keepAlive("0", {"keep-", "alive"}), "Split value");
+}
+
+void test_split()
+{
+    std::string_view data = "HTTP/1.1 200 OK\r\nLocation: /a/b/c\r\nContent-Type: text/plain\r\n\r\n";
+    HttpResponseParser p;
+    HttpResponseParser::status_t res = 0;
+    p.feed(data, res);
+    check(res == HttpResponseParser::SUCCESS, "Not success");
+    for (size_t i = 0; i <= data.size(); i++)
+    {
+        std::string_view first = data.substr(0, i);
+        std::string_view second = data.substr(i);
+        for (HttpResponseParser::fragment_t f = 0; f < HttpResponseParser::HEADER_MAX; f++)
+        {
+            auto [b, e] = p.getFragment(f);
+            auto [part1, part2] = p.getFragmentStr(first, second, f);
+            std::string_view whole = p.getFragmentStr(data, f);
+            check(std::string(part1).append(part2) == whole, "Wrong split fragment");
+            check(part2.empty() == (b >= i || e <= i), "Wrong split");
+            check(part1.empty() == whole.empty(), "Wrong first part");
+        }
+    }
+}
+
+void test_number(std::string_view data, uint64_t status, uint64_t length)
+{
+    HttpResponseParser p;
+    HttpResponseParser::status_t res = 0;
+    check(p.feed(data, res) == data.size(), "Not all data was fed");
+    check(res == HttpResponseParser::SUCCESS, "Not success");
+    check(p.statusCode() == status, "Wrong status code");
+    check(p.contentLength() == length, "Wrong content length");
+
+    p.reset();
+    check(p.statusCode() == HttpResponseParser::INVALID_NUMBER, "Status code after reset");
+    check(p.contentLength() == HttpResponseParser::INVALID_NUMBER, "Content length after reset");
+    for (char c : data)
+        if ((res = p.feed(c)) != 0)
+            break;
+    check(res == HttpResponseParser::SUCCESS, "Not success");
+    check(p.statusCode() == status, "Wrong status code");
+    check(p.contentLength() == length, "Wrong content length");
+}
+
+void test_numbers()
+{
+    constexpr uint64_t INVALID = HttpResponseParser::INVALID_NUMBER;
+    test_number("HTTP/1.1 200 OK\r\n\r\n", 200, INVALID);
+    test_number("HTTP/1.1 007 OK\r\nContent-Length: 0\r\n\r\n", 7, 0);
+    test_number("HTTP/1.1 404 Not Found\r\ncontent-length:123\r\n\r\n", 404, 123);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: \t 4567 \t\r\n\r\n", 200, 4567);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length:\r\r\r89\n\n\r\n\r\n", 200, 89);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n", 200, 2);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: 999999999999999999\r\n\r\n", 200, 999999999999999999ull);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: 0000000000000000001\r\n\r\n", 200, 1);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: 0000000000000000000005\r\n\r\n", 200, 5);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: 0999999999999999999\r\n\r\n", 200, 999999999999999999ull);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: 1000000000000000000\r\n\r\n", 200, INVALID);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: 99999999999999999999999\r\n\r\n", 200, INVALID);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: 12a\r\n\r\n", 200, INVALID);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: a12\r\n\r\n", 200, INVALID);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: 12 34\r\n\r\n", 200, INVALID);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: -1\r\n\r\n", 200, INVALID);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: 12\r\nContent-Length: x\r\n\r\n", 200, INVALID);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: x\r\nContent-Length: 12\r\n\r\n", 200, 12);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length: \r\n\r\n", 200, INVALID);
+    test_number("HTTP/1.1 200 OK\r\nContent-Length1: 12\r\nLocation: 34\r\n\r\n", 200, INVALID);
+
+    using Parser = BasicHttpResponseParser<HttpHeaderName::ETAG>;
+    std::string_view data = "HTTP/1.1 304 OK\r\nContent-Length: 12\r\n\r\n";
+    Parser p;
+    Parser::status_t res = 0;
+    p.feed(data, res);
+    check(res == Parser::SUCCESS, "Not success");
+    check(p.statusCode() == 304, "Wrong status code");
+    check(p.contentLength() == Parser::INVALID_NUMBER, "Content-Length is not stored");
+}
+
+void test_feed_many()
+{
+    const std::string_view samples[] = {
+        "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nHELLO",
+        "HTTP/1.0 404 Not Found\r\nContent-Type: text/html\r\nLocation: there\r\n\r\n",
+        "HTTP/1.1 2000 OK\r\n\r\n",
+        "HTTP/1.1 301 Moved\r\nLocation: /x\r\n\r\nHTTP/1.1 200 OK\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nContent-Len",
+        "HTTP",
+        "",
+        "XTTP/1.1 200 OK\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nContent-Length: 12345\r\n\r\n0\r\n\r\n",
+    };
+    constexpr size_t NUM_SAMPLES = std::size(samples);
+
+    for (size_t n = 1; n <= 40; n++)
+    {
+        std::vector<HttpResponseParser> parsers(n);
+        std::vector<HttpResponseParser*> ptrs(n);
+        std::vector<std::string_view> data(n);
+        std::vector<HttpResponseParser::status_t> status(n);
+        std::vector<size_t> eaten(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            ptrs[i] = &parsers[i];
+            data[i] = samples[(i * 7 + n) % NUM_SAMPLES];
+        }
+
+        // Feed in two parts to check continuation of partially fed streams.
+        std::vector<std::string_view> part(n);
+        for (size_t i = 0; i < n; i++)
+            part[i] = data[i].substr(0, i % 23);
+        HttpResponseParser::feedMany(n, ptrs.data(), part.data(), status.data(), eaten.data());
+        std::vector<HttpResponseParser::status_t> status2(n);
+        std::vector<size_t> eaten2(n);
+        for (size_t i = 0; i < n; i++)
+            part[i] = status[i] != 0 ? std::string_view() : data[i].substr(eaten[i]);
+        HttpResponseParser::feedMany(n, ptrs.data(), part.data(), status2.data(), eaten2.data());
+
+        for (size_t i = 0; i < n; i++)
+        {
+            HttpResponseParser single;
+            HttpResponseParser::status_t res = 0;
+            size_t sEaten = single.feed(data[i], res);
+            check((status[i] != 0 ? status[i] : status2[i]) == res, "Wrong status");
+            check(eaten[i] + eaten2[i] == sEaten, "Wrong number of eaten characters");
+            check(parsers[i].count() == sEaten, "Wrong count");
+            if (res != HttpResponseParser::SUCCESS)
+                continue;
+            for (HttpResponseParser::fragment_t f = 0; f < HttpResponseParser::HEADER_MAX; f++)
+                check(parsers[i].getFragment(f) == single.getFragment(f), "Wrong fragment");
+            check(parsers[i].statusCode() == single.statusCode(), "Wrong status code");
+            check(parsers[i].contentLength() == single.contentLength(), "Wrong content length");
+        }
+    }
+}
+
+static_assert(sizeof(HttpResponseParser16) <= 64, "Must fit in a cache line");
+static_assert(sizeof(HttpResponseParser32) < sizeof(HttpResponseParser), "Must be smaller");
+
+template <class PARSER>
+void test_offsets(std::string_view data, bool aBulk)
+{
+    HttpResponseParser p;
+    PARSER narrow;
+    HttpResponseParser::status_t res = 0;
+    HttpResponseParser::status_t narrow_res = 0;
+    size_t eaten = p.feed(data, res);
+    size_t narrow_eaten = 0;
+    if (aBulk)
+    {
+        // Feed in parts of different sizes.
+        for (size_t i = 1; narrow_res == 0 && narrow_eaten < data.size(); i = i * 3 + 1)
+            narrow_eaten += narrow.feed(data.substr(narrow_eaten, i), narrow_res);
+    }
+    else
+    {
+        for (; narrow_res == 0 && narrow_eaten < data.size(); narrow_eaten++)
+            narrow_res = narrow.feed(data[narrow_eaten]);
+        if (narrow_res == PARSER::ERROR_HEADER_TOO_LONG)
+            narrow_eaten--; // the character was not eaten.
+    }
+
+    if (res != 0 && eaten > PARSER::MAX_HEADER_SIZE)
+    {
+        check(narrow_res == PARSER::ERROR_HEADER_TOO_LONG, "Must be too long");
+        check(narrow_eaten == PARSER::MAX_HEADER_SIZE, "Wrong number of eaten characters");
+        check(narrow.count() == PARSER::MAX_HEADER_SIZE, "Wrong count");
+        // Further feeding fails immediately.
+        check(narrow.feed(data.substr(narrow_eaten), narrow_res) == 0, "Must not eat");
+        check(narrow_res == PARSER::ERROR_HEADER_TOO_LONG, "Must be too long");
+        check(narrow.feed('\n') == PARSER::ERROR_HEADER_TOO_LONG, "Must be too long");
+        return;
+    }
+    check(narrow_res == res, "Wrong status");
+    check(narrow_eaten == eaten, "Wrong number of eaten characters");
+    if (res != HttpResponseParser::SUCCESS)
+        return;
+    for (HttpResponseParser::fragment_t f = 0; f < HttpResponseParser::HEADER_MAX; f++)
+        check(narrow.getFragment(f) == p.getFragment(f), "Wrong fragment");
+    check(narrow.statusCode() == p.statusCode(), "Wrong status code");
+    check(narrow.contentLength() == p.contentLength(), "Wrong content length");
+}
+
+void test_offsets()
+{
+    std::string prefix = "HTTP/1.1 200 OK\r\nContent-Length: 42\r\nX-Long: ";
+    std::string suffix = "\r\nLocation: here\r\n\r\n";
+    // Total sizes around the limit of 16 bit offsets.
+    const size_t total_sizes[] = {65535 - 1000, 65535 - 1, 65535, 65535 + 1, 65535 + 2, 100000};
+    for (size_t total : total_sizes)
+    {
+        size_t fill = total - prefix.size() - suffix.size();
+        std::string data = prefix + std::string(fill, 'x') + suffix;
+        for (bool bulk : {false, true})
+        {
+            test_offsets<HttpResponseParser16>(data, bulk);
+            test_offsets<HttpResponseParser32>(data, bulk);
+        }
+    }
+
+    // The same limit for lockstep feeding.
+    std::string data = prefix + std::string(70000, 'x') + suffix;
+    std::string good = "HTTP/1.1 200 OK\r\n\r\n";
+    HttpResponseParser16 parsers[2];
+    HttpResponseParser16* ptrs[2] = {&parsers[0], &parsers[1]};
+    std::string_view streams[2] = {data, good};
+    HttpResponseParser16::status_t status[2];
+    size_t eaten[2];
+    HttpResponseParser16::feedMany(2, ptrs, streams, status, eaten);
+    check(status[0] == HttpResponseParser16::ERROR_HEADER_TOO_LONG, "Must be too long");
+    check(eaten[0] == HttpResponseParser16::MAX_HEADER_SIZE, "Wrong number of eaten characters");
+    check(status[1] == HttpResponseParser16::SUCCESS, "Must be success");
+    check(eaten[1] == good.size(), "Wrong number of eaten characters");
+}
+
+void test_skip()
+{
+    // Vectorized search must give the same as scalar one.
+    const char sAlphabet[] = "ab \t\r\n";
+    std::string sData;
+    uint32_t sRand = 1;
+    for (size_t i = 0; i < 4096; i++)
+    {
+        sRand = sRand * 1103515245 + 12345;
+        // Mostly ordinary characters.
+        size_t sRoll = (sRand >> 16) % 64;
+        sData += sRoll < sizeof(sAlphabet) - 1 ? sAlphabet[sRoll] : 'x';
+    }
+    for (uint8_t sSkip : {HttpResponseParser::SKIP_TO_CR, HttpResponseParser::SKIP_TO_WS})
+    {
+        for (size_t b = 0; b < 256; b++)
+        {
+            for (size_t e = b; e < b + 200; e++)
+            {
+                const char* sBegin = sData.data() + b;
+                const char* sEnd = sData.data() + e;
+                check(HttpResponseParser::skipImpl(sSkip, sBegin, sEnd) ==
+                      HttpResponseParser::skipScalarImpl(sSkip, sBegin, sEnd), "Wrong skip");
+            }
+        }
+    }
+
+    // The state machine must have states of both kinds.
+    bool sHasCR = false;
+    bool sHasWS = false;
+    for (const auto& t : HttpResponseParser::TheCompactStateMachine.m_Transitions)
+    {
+        sHasCR = sHasCR || t.m_Skip == HttpResponseParser::SKIP_TO_CR;
+        sHasWS = sHasWS || t.m_Skip == HttpResponseParser::SKIP_TO_WS;
+    }
+    check(sHasCR && sHasWS, "No skip states");
+
+    // Bulk feed (that skips) must give the same as feed by characters (that does not).
+    std::string sLong(300, 'z');
+    const std::string sResponses[] = {
+        "HTTP/1.1 200 Long reason phrase " + sLong + " \t \r\n"
+        "Set-Cookie: " + sLong + "; " + sLong + "\r\n"
+        "Location: " + sLong + " \t" + sLong + "\r" + sLong + "\n" + sLong + "  \r\n"
+        "Content-Length: 12\r\n"
+        "X-Long: \r" + sLong + "\r\r" + sLong + "\n\n" + sLong + "\r\n"
+        "\r\n",
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: " + std::string(100, '1') + "\r\n"
+        "Content-Type:" + std::string(100, ' ') + sLong + std::string(100, '\t') + "\r\n"
+        "\r\n",
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length:" + sLong + "\r\n"
+        "Content-Length: " + sLong + "\r" + "\r\n"
+        "\r\n",
+    };
+    for (const std::string& sResp : sResponses)
+    {
+        std::string sInput = sResp + "BODY";
+        HttpResponseParser single;
+        HttpResponseParser::status_t res = 0;
+        size_t sSingleEaten = 0;
+        for (; res == 0 && sSingleEaten < sInput.size(); sSingleEaten++)
+            res = single.feed(sInput[sSingleEaten]);
+        check(res == HttpResponseParser::SUCCESS, "Not success");
+        check(sSingleEaten == sResp.size(), "Wrong count");
+
+        for (size_t sChunk : {4, 5, 17, 33, 100, 1000, 100000})
+        {
+            HttpResponseParser p;
+            HttpResponseParser::status_t bulk_res = 0;
+            size_t sEaten = 0;
+            while (bulk_res == 0 && sEaten < sInput.size())
+                sEaten += p.feed(std::string_view(sInput).substr(sEaten, sChunk), bulk_res);
+            check(bulk_res == res, "Wrong status");
+            check(sEaten == sSingleEaten && p.count() == single.count(), "Wrong count");
+            for (HttpResponseParser::fragment_t f = 0; f < HttpResponseParser::HEADER_MAX; f++)
+                check(p.getFragment(f) == single.getFragment(f), "Wrong fragment");
+            check(p.statusCode() == single.statusCode(), "Wrong status code");
+            check(p.contentLength() == single.contentLength(), "Wrong content length");
+        }
+    }
+}
+
+// The hashed engine can't record the header index, such a feed must not compile.
+template <class PARSER, class = void>
+struct FeedsIndex : std::false_type {};
+template <class PARSER>
+struct FeedsIndex<PARSER, std::void_t<decltype(std::declval<PARSER&>().feed(
+    std::string_view(), std::declval<typename PARSER::status_t&>(), std::declval<HttpHeaderIndex&>()))>>
+    : std::true_type {};
+static_assert(FeedsIndex<HttpResponseParser>::value, "Index feed is missing");
+static_assert(!FeedsIndex<HashedHttpResponseParser>::value, "Hashed index feed must be deleted");
+
+// Hashed engine must give exactly the same as the state machine, for any split of the input.
+template <class HASHED, class PARSER>
+void test_hashed(std::string_view aInput)
+{
+    PARSER single;
+    typename PARSER::status_t res = 0;
+    size_t sSingleEaten = single.feed(aInput, res);
+
+    for (size_t sChunk = 1; sChunk <= aInput.size(); sChunk++)
+    {
+        HASHED p;
+        typename PARSER::status_t hashed_res = 0;
+        size_t sEaten = 0;
+        while (hashed_res == 0 && sEaten < aInput.size())
+            sEaten += p.feed(aInput.substr(sEaten, sChunk), hashed_res);
+        check(hashed_res == res, "Hashed: wrong status");
+        check(sEaten == sSingleEaten && p.count() == single.count(), "Hashed: wrong count");
+        for (typename PARSER::fragment_t f = 0; f < PARSER::HEADER_MAX; f++)
+            check(p.getFragment(f) == single.getFragment(f), "Hashed: wrong fragment");
+        check(p.statusCode() == single.statusCode(), "Hashed: wrong status code");
+        check(p.contentLength() == single.contentLength(), "Hashed: wrong content length");
+    }
+}
+
+void test_hashed()
+{
+    using AllHeaders = BasicHttpResponseParser<HttpHeaderName::CONTENT_TYPE, HttpHeaderName::CONTENT_LENGTH,
+                                               HttpHeaderName::CONTENT_RANGE, HttpHeaderName::TRANSFER_ENCODING,
+                                               HttpHeaderName::LOCATION, HttpHeaderName::CONNECTION,
+                                               HttpHeaderName::ETAG, HttpHeaderName::LAST_MODIFIED>;
+    using HashedAllHeaders = BasicHashedHttpResponseParser<HttpHeaderName::CONTENT_TYPE, HttpHeaderName::CONTENT_LENGTH,
+                                                           HttpHeaderName::CONTENT_RANGE, HttpHeaderName::TRANSFER_ENCODING,
+                                                           HttpHeaderName::LOCATION, HttpHeaderName::CONNECTION,
+                                                           HttpHeaderName::ETAG, HttpHeaderName::LAST_MODIFIED>;
+    std::string sLong(100, 'z');
+    const std::string sResponses[] = {
+        "HTTP/1.1 200 OK\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nLocation: here\r\nContent-Length: 12\r\n\r\nBODY",
+        "HTTP/1.1 200 OK\r\nlocation: a\r\nLOCATION: b\r\nLoCaTiOn:c\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nLocation : a\r\nLocatio: b\r\nLocationn: c\r\nLocatiom: d\r\n\r\n",
+        "HTTP/1.1 200 OK\r\n: a\r\n:\r\nLoc\ration: b\r\nLocation\r\n: c\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nContent-Type: x\r\nContent-Length: 5\r\nContent-Range: y\r\nContent: z\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nX: 1\r\nETag: \"abc\"\r\nEtag2: x\r\nETa@: y\r\nETa`: z\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nConnection: close\r\nConnection:keep-alive\r\nLast-Modified: today\r\n\r\n",
+        "HTTP/1.1 200 OK\r\n" + sLong + ": " + sLong + "\r\nLocation" + sLong + ": x\r\n" + sLong + "\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nSet-Cookie: " + sLong + "\r\nLocation: " + sLong + "\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nLocation\n: a\r\nLocation\t: b\r\n\nLocation: c\r\n\r\n",
+        "HTTP/1.1 200 OK\r\n\rLocation: a\r\n\r\n",
+        "HTTP/1.1 2000 OK\r\n\r\n",
+    };
+    for (const std::string& sResp : sResponses)
+    {
+        test_hashed<HashedHttpResponseParser, HttpResponseParser>(sResp);
+        test_hashed<HashedAllHeaders, AllHeaders>(sResp);
+    }
+
+    // Names that differ from stored ones in one character, some of them
+    // must fall into the same slots of the hash table.
+    std::string sMutated = "HTTP/1.1 200 OK\r\n";
+    for (std::string_view sName : AllHeaders::HeaderNames)
+    {
+        for (size_t i = 0; i < sName.size(); i++)
+        {
+            for (char c : {'q', '-', '@', '`', '0'})
+            {
+                std::string sOther(sName);
+                sOther[i] = c;
+                sMutated += sOther + ": " + sOther + "\r\n";
+            }
+        }
+    }
+    sMutated += "\r\n";
+    test_hashed<HashedHttpResponseParser, HttpResponseParser>(sMutated);
+    test_hashed<HashedAllHeaders, AllHeaders>(sMutated);
+}
+
+template <class PARSER>
+void test_status_line(std::string_view aInput)
+{
+    // Byte by byte feed does not use the status line prefix shortcut.
+    PARSER single;
+    typename PARSER::status_t res = 0;
+    size_t sSingleEaten = 0;
+    while (res == 0 && sSingleEaten < aInput.size())
+        res = single.feed(aInput[sSingleEaten++]);
+
+    auto check_same = [&](const PARSER& p, typename PARSER::status_t aRes, size_t aEaten)
+    {
+        check(aRes == res, "Status line: wrong status");
+        check(aEaten == sSingleEaten && p.count() == single.count(), "Status line: wrong count");
+        for (typename PARSER::fragment_t f = 0; f < PARSER::HEADER_MAX; f++)
+            check(p.getFragment(f) == single.getFragment(f), "Status line: wrong fragment");
+        check(p.statusCode() == single.statusCode(), "Status line: wrong status code");
+        check(p.contentLength() == single.contentLength(), "Status line: wrong content length");
+    };
+
+    PARSER bulk;
+    typename PARSER::status_t bulk_res = 0;
+    size_t sEaten = bulk.feed(aInput, bulk_res);
+    check_same(bulk, bulk_res, sEaten);
+
+    constexpr size_t N = 3;
+    PARSER many[N];
+    PARSER* ptrs[N] = {&many[0], &many[1], &many[2]};
+    std::string_view data[N] = {aInput, aInput, aInput};
+    typename PARSER::status_t status[N];
+    size_t eaten[N];
+    PARSER::feedMany(N, ptrs, data, status, eaten);
+    for (size_t i = 0; i < N; i++)
+        check_same(many[i], status[i], eaten[i]);
+}
+
+void test_status_line()
+{
+    const std::string_view sResponses[] = {
+        "HTTP/1.1 304 Not Modified\r\n\r\n",
+        "HTTP/1.0 204 \r\nContent-Length: 0\r\n\r\n",
+        "HTTP/0.9 000 \r\n\r\n",
+        "HTTP/9.9 999 x",
+        "HTTP/1.1 200 ",
+        "HTTP/1.1 200",
+        "HTTP/12.34 567 OK\r\n\r\n",
+        "HTTP/1.1 200  \t OK \r\nLocation: x\r\n\r\n",
+        "HTTP/1.1 200 \r\n\r\n",
+    };
+    for (std::string_view sResp : sResponses)
+    {
+        test_status_line<HttpResponseParser>(sResp);
+        test_status_line<HttpResponseParser16>(sResp);
+    }
+
+    // Any byte in any position of the prefix.
+    std::string sResp = "HTTP/1.1 304 Not Modified\r\nContent-Length: 0\r\n\r\n";
+    for (size_t i = 0; i < HttpResponseParser::STATUS_LINE_PREFIX_SIZE; i++)
+    {
+        for (size_t c = 0; c <= UCHAR_MAX; c++)
+        {
+            std::string sMutated = sResp;
+            sMutated[i] = char(c);
+            test_status_line<HttpResponseParser>(sMutated);
+            test_hashed<HashedHttpResponseParser, HttpResponseParser>(sMutated.substr(0, 20));
+        }
+    }
+}
+
+// Feed aInput with limits in pieces of aStep bytes, return the status and eaten size.
+template <class PARSER>
+std::pair<typename PARSER::status_t, size_t> feed_limited(std::string_view aInput, const typename PARSER::Limits& aLimits, size_t aStep)
+{
+    PARSER p;
+    typename PARSER::Limits sLimits = aLimits;
+    typename PARSER::status_t res = 0;
+    size_t sEaten = 0;
+    for (size_t i = 0; i < aInput.size() && res == 0; i += aStep)
+    {
+        std::string_view sPiece = aInput.substr(i, aStep);
+        size_t sSize = p.feed(sPiece, res, sLimits);
+        check(res != 0 || sSize == sPiece.size(), "Limits: must eat everything in progress");
+        sEaten += sSize;
+    }
+    check(sEaten == p.count(), "Limits: wrong count");
+    return {res, sEaten};
+}
+
+template <class PARSER>
+void test_limits(std::string_view aInput, const typename PARSER::Limits& aLimits,
+                 typename PARSER::status_t aStatus, size_t aEaten)
+{
+    for (size_t sStep : {aInput.size(), size_t(1), size_t(2), size_t(7)})
+    {
+        auto [res, sEaten] = feed_limited<PARSER>(aInput, aLimits, sStep);
+        check(res == aStatus, "Limits: wrong status");
+        check(sEaten == aEaten, "Limits: wrong eaten size");
+    }
+    // Any split into two parts.
+    for (size_t i = 0; i <= aInput.size(); i++)
+    {
+        PARSER p;
+        typename PARSER::Limits sLimits = aLimits;
+        typename PARSER::status_t res = 0;
+        size_t sEaten = p.feed(aInput.substr(0, i), res, sLimits);
+        if (res == 0)
+            sEaten += p.feed(aInput.substr(i), res, sLimits);
+        check(res == aStatus && sEaten == aEaten, "Limits: wrong split result");
+    }
+}
+
+template <class PARSER>
+void test_limits()
+{
+    using Limits = typename PARSER::Limits;
+    constexpr auto SUCCESS = PARSER::SUCCESS;
+    // Lines of 17, 20, 11 and 2 bytes.
+    const std::string sHeader = "HTTP/1.1 200 OK\r\nContent-Type: text\r\nServer: x\r\n\r\n";
+    const std::string sResp = sHeader + "body\nwith\nlines\n";
+    const size_t sSize = sHeader.size();
+
+    test_limits<PARSER>(sResp, Limits(), SUCCESS, sSize);
+    test_limits<PARSER>(sResp, Limits(sSize, 20, 2), SUCCESS, sSize);
+
+    test_limits<PARSER>(sResp, Limits(sSize - 1), PARSER::ERROR_HEADER_TOO_LONG, sSize - 1);
+    test_limits<PARSER>(sResp, Limits(10), PARSER::ERROR_HEADER_TOO_LONG, 10);
+    test_limits<PARSER>(sResp, Limits(1), PARSER::ERROR_HEADER_TOO_LONG, 1);
+
+    test_limits<PARSER>(sResp, Limits(0, 19), PARSER::ERROR_LINE_TOO_LONG, 17 + 19);
+    test_limits<PARSER>(sResp, Limits(0, 16), PARSER::ERROR_LINE_TOO_LONG, 16);
+    test_limits<PARSER>(sResp, Limits(0, 17), PARSER::ERROR_LINE_TOO_LONG, 17 + 17);
+    test_limits<PARSER>(sResp, Limits(40, 19), PARSER::ERROR_LINE_TOO_LONG, 17 + 19);
+    test_limits<PARSER>(sResp, Limits(20, 19), PARSER::ERROR_HEADER_TOO_LONG, 20);
+
+    // Only the empty line may follow the last allowed header.
+    test_limits<PARSER>(sResp, Limits(0, 0, 1), PARSER::ERROR_TOO_MANY_HEADERS, 17 + 20 + 2);
+    test_limits<PARSER>("HTTP/1.1 200 OK\r\nServer: x\r\nA\nB: c\r\n\r\n", Limits(0, 0, 1),
+                        PARSER::ERROR_TOO_MANY_HEADERS, 17 + 11 + 2);
+    test_limits<PARSER>("HTTP/1.1 200 OK\r\nServer: x\r\n\r\n", Limits(0, 0, 1), SUCCESS, 17 + 11 + 2);
+    test_limits<PARSER>("HTTP/1.1 200 OK\r\n\r\n", Limits(0, 0, 1), SUCCESS, 19);
+
+    // A single '\n' in a value doesn't end the line, the same as for the parser: the line
+    // goes on up to "\r\n" (14 bytes), that is not the end of the header.
+    const std::string sFolded = "HTTP/1.1 200 OK\r\nLocation: a\n\r\nContent-Type: t\r\n\r\nbody";
+    test_limits<PARSER>(sFolded, Limits(), SUCCESS, sFolded.size() - 4);
+    test_limits<PARSER>(sFolded, Limits(0, 17, 2), SUCCESS, sFolded.size() - 4);
+    test_limits<PARSER>(sFolded, Limits(0, 17, 1), PARSER::ERROR_TOO_MANY_HEADERS, 17 + 14 + 2);
+    test_limits<PARSER>("HTTP/1.1 200 OK\r\nLocation: aaaaaa\nbbbbbbbb\r\n\r\n", Limits(0, 20),
+                        PARSER::ERROR_LINE_TOO_LONG, 17 + 20);
+
+    // Endless garbage is stopped.
+    std::string sGarbage = "HTTP/1.1 200 OK\r\nContent-Length: " + std::string(1000, '1');
+    test_limits<PARSER>(sGarbage, Limits(0, 100), PARSER::ERROR_LINE_TOO_LONG, 17 + 100);
+    std::string sManyLines = "HTTP/1.1 200 OK\r\n";
+    for (size_t i = 0; i < 100; i++)
+        sManyLines += "X-Header: value\r\n";
+    test_limits<PARSER>(sManyLines, Limits(0, 0, 50), PARSER::ERROR_TOO_MANY_HEADERS, 17 + 50 * 17 + 2);
+
+    // Parsing errors are reported as usual.
+    test_limits<PARSER>("HTTP/1.1 2x0 OK\r\n\r\n", Limits(100, 100, 100), PARSER::ERROR_NOT_A_DIGIT_STATUS_CODE, 11);
+
+    // The same limits for the next header of a new parser or after restart, without a reset.
+    Limits sLimits(sSize, 20, 2);
+    for (size_t i = 0; i < 3; i++)
+    {
+        PARSER p;
+        typename PARSER::status_t res = 0;
+        check(p.feed(sResp, res, sLimits) == sSize && res == SUCCESS, "Limits: new parser does not work");
+    }
+    const std::string sPipelined = sHeader + sHeader + sHeader;
+    PARSER p;
+    for (size_t i = 0; i < 3; i++)
+    {
+        typename PARSER::status_t res = 0;
+        p.restart();
+        while (res == 0)
+            p.feed(std::string_view(sPipelined).substr(p.count(), 5), res, sLimits);
+        check(res == SUCCESS && p.count() == (i + 1) * sSize, "Limits: restart does not work");
+    }
+}
+
+void test_limits()
+{
+    check_err(HttpResponseParser::ERROR_LINE_TOO_LONG, "Header line is too long");
+    check_err(HttpResponseParser::ERROR_TOO_MANY_HEADERS, "Too many header lines");
+    test_limits<HttpResponseParser>();
+    test_limits<HttpResponseParser16>();
+    test_limits<HashedHttpResponseParser>();
+}
+
 void test_massive()
 {
     const size_t COUNT = 64 * 1024;
@@ -240,6 +906,14 @@ void test_massive()
 
         for (size_t j = 0; j < NUM_FRAGS; j++)
             check(frags[j] == p.getFragmentStr(req, j), "wrong fragment");
+
+        HttpResponseParser::status_t sBulkRes = 0;
+        p.reset();
+        check(p.feed(req, sBulkRes) == req.size(), "Bulk: not all data was fed");
+        check(sBulkRes == res, "Bulk: wrong result");
+
+        for (size_t j = 0; j < NUM_FRAGS; j++)
+            check(frags[j] == p.getFragmentStr(req, j), "Bulk: wrong fragment");
     }
 }
 
@@ -253,6 +927,7 @@ int main()
         check_err(HttpResponseParser::ERROR_NOT_A_DIGIT_MINOR_VERSION, "Not a digit in minor version");
         check_err(HttpResponseParser::ERROR_NOT_A_DIGIT_STATUS_CODE, "Not a digit in status code");
         check_err(HttpResponseParser::ERROR_WRONG_LENGTH_OF_STATUS_CODE, "Wrong length of status code");
+        check_err(HttpResponseParser::ERROR_HEADER_TOO_LONG, "Header is too long");
 
         test_fail("HTTP\r\n\r\n", HttpResponseParser::ERROR_NOT_HTTP);
         test_fail("http/1.1 200 OK\r\n\r\n", HttpResponseParser::ERROR_NOT_HTTP);
@@ -304,6 +979,20 @@ int main()
 
         test_misc();
 
+        test_custom_headers();
+        test_keep_alive();
+
+        test_numbers();
+
+        test_split();
+
+        test_feed_many();
+        test_offsets();
+        test_skip();
+        test_hashed();
+        test_status_line();
+        test_limits();
+
         test_massive();
     }
     catch (const std::exception& e)
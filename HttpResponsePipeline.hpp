@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <algorithm>
+#include <string_view>
+
+#include <HttpResponseParserBase.hpp>
+
+// Parsing of pipelined HTTP/1.1 responses that are packed in one buffer, for instance
+// several small responses that were returned by one recv on a keep-alive connection.
+// The parser is not reset between responses but restarted (see restart), so its offsets
+// keep counting from the beginning of the buffer: fragments of each response are found
+// right in the buffer, without rebasing offsets or clearing saved tags.
+// Bodies are not parsed, their sizes are given by the user (Content-Length, zero for
+// 204 and 304 responses and responses to HEAD requests and so on).
+// Usage:
+//  HttpResponseParser p;
+//  HttpResponsePipeline<HttpResponseParser> sPipe(p, sBuffer);
+//  while (sPipe.next() == HttpResponseParser::SUCCESS)
+//  {
+//      ... use sPipe.fragment(HttpResponseParser::LOCATION), p.statusCode() ...
+//      sPipe.skipBody(sBodySize);
+//  }
+//  ... sPipe.consumed() bytes are handled, the rest is the beginning of an incomplete
+//  response that must be parsed again when more data comes, or sPipe.bodyLeft() bytes
+//  of the last body are not received yet ...
+// PARSER is BasicHttpResponseParser (or derived) or DynamicHttpResponseParser.
+// Positions are limited by the offset type of the parser, so with narrow offsets
+// the buffer must not be larger than MAX_HEADER_SIZE.
+
+template <class PARSER>
+class HttpResponsePipeline
+{
+public:
+    using status_t = HttpResponseParserBase::status_t;
+    using fragment_t = HttpResponseParserBase::fragment_t;
+
+    // The parser is reset; it and the buffer must outlive the pipeline.
+    inline HttpResponsePipeline(PARSER& aParser, std::string_view aBuffer);
+
+    // Parse the header of the next response, after the body of the previous one.
+    // Return SUCCESS if the header is complete, an error if the stream is broken
+    // (the same error is returned then), or 0 if the buffer ends before the end of
+    // the header or the body of the previous response.
+    inline status_t next();
+    // Skip the body of the current response, aSize bytes that follow its header.
+    inline void skipBody(size_t aSize);
+
+    // Fragment of the current response as a part of the buffer (empty if not found).
+    inline std::string_view fragment(fragment_t aFragment) const;
+    // Offset of the beginning of the current response in the buffer.
+    size_t begin() const { return m_Begin; }
+    // Size of the header of the current response (valid after SUCCESS).
+    size_t headerSize() const { return m_Parser.count() - m_Begin; }
+    // Number of bytes of the buffer that are completely handled: the beginning of
+    // the current response if its header is incomplete, the end of its header or
+    // body otherwise.
+    inline size_t consumed() const;
+    // Number of bytes of the body of the last response that are beyond the buffer.
+    size_t bodyLeft() const { return m_BodyLeft; }
+
+private:
+    PARSER& m_Parser;
+    std::string_view m_Buffer;
+    // Status of the current response.
+    status_t m_Status = 0;
+    // Offset of the beginning of the current response.
+    size_t m_Begin = 0;
+    // Size of the body of the current response, given by skipBody.
+    size_t m_BodySize = 0;
+    size_t m_BodyLeft = 0;
+};
+
+//////////////////////////////////// IMPLEMENTATION ////////////////////////////////////
+template <class PARSER>
+HttpResponsePipeline<PARSER>::HttpResponsePipeline(PARSER& aParser, std::string_view aBuffer)
+    : m_Parser(aParser), m_Buffer(aBuffer)
+{
+    m_Parser.reset();
+}
+
+template <class PARSER>
+typename HttpResponsePipeline<PARSER>::status_t HttpResponsePipeline<PARSER>::next()
+{
+    if (m_Status == HttpResponseParserBase::SUCCESS)
+    {
+        if (m_BodyLeft != 0)
+            return 0;
+        m_Parser.restart(m_BodySize);
+        m_Begin = m_Parser.count();
+        m_BodySize = 0;
+        m_Status = 0;
+    }
+    if (m_Status != 0)
+        return m_Status;
+    if (m_Parser.count() < m_Buffer.size())
+        m_Parser.feed(m_Buffer.substr(m_Parser.count()), m_Status);
+    return m_Status;
+}
+
+template <class PARSER>
+void HttpResponsePipeline<PARSER>::skipBody(size_t aSize)
+{
+    size_t sRest = m_Buffer.size() - m_Parser.count();
+    m_BodySize = aSize;
+    m_BodyLeft = aSize - std::min(aSize, sRest);
+}
+
+template <class PARSER>
+std::string_view HttpResponsePipeline<PARSER>::fragment(fragment_t aFragment) const
+{
+    return m_Parser.getFragmentStr(m_Buffer, aFragment);
+}
+
+template <class PARSER>
+size_t HttpResponsePipeline<PARSER>::consumed() const
+{
+    if (m_Status != HttpResponseParserBase::SUCCESS)
+        return m_Begin;
+    return m_Parser.count() + m_BodySize - m_BodyLeft;
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <DynamicHttpResponseParser.hpp>
+#include <HashedHttpResponseParser.hpp>
+#include <HttpResponseParser.hpp>
+#include <HttpResponsePipeline.hpp>
+
+#include <assert.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+const std::string_view ONE = "HTTP/1.1 200 OK\r\nLocation: here\r\nContent-Length: 5\r\n\r\n";
+const std::string_view TWO = "HTTP/1.0 304 Not Modified\r\nContent-Type: text/plain\r\n\r\n";
+const std::string_view THREE = "HTTP/1.1 204 \r\n\r\n";
+const std::string_view FOUR = "HTTP/1.1 301 Moved\r\nContent-Length: 3\r\nLocation: /there\r\n\r\n";
+
+// Parse aFirst and aSecond that follow each other with restart and compare the
+// second with a fresh parser.
+template <class PARSER>
+void test_restart(PARSER& p, PARSER& fresh, size_t aHeaderMax, std::string_view aFirst, std::string_view aSecond, size_t aSkip)
+{
+    std::string sStream = std::string(aFirst) + std::string(aSkip, 'x') + std::string(aSecond);
+    typename PARSER::status_t res = 0;
+    p.reset();
+    check(p.feed(sStream, res) == aFirst.size() && res == PARSER::SUCCESS, "Restart: first is not parsed");
+    p.restart(aSkip);
+    check(p.count() == aFirst.size() + aSkip, "Restart: wrong count");
+    for (typename PARSER::fragment_t f = 0; f < aHeaderMax; f++)
+        check(!p.isFragmentFound(f), "Restart: fragment before parsing");
+    size_t sBase = p.count();
+    size_t sEaten = p.feed(std::string_view(sStream).substr(sBase), res);
+
+    fresh.reset();
+    typename PARSER::status_t fresh_res = 0;
+    check(sEaten == fresh.feed(aSecond, fresh_res), "Restart: wrong size");
+    check(res == fresh_res, "Restart: wrong status");
+    for (typename PARSER::fragment_t f = 0; f < aHeaderMax; f++)
+    {
+        check(p.isFragmentFound(f) == fresh.isFragmentFound(f), "Restart: wrong found");
+        if (!fresh.isFragmentFound(f))
+        {
+            check(p.getFragment(f) == std::pair<size_t, size_t>(0, 0), "Restart: stale fragment");
+            continue;
+        }
+        auto [b, e] = fresh.getFragment(f);
+        check(p.getFragment(f) == std::make_pair(b + sBase, e + sBase), "Restart: wrong fragment");
+        check(p.getFragmentStr(sStream, f) == fresh.getFragmentStr(aSecond, f), "Restart: wrong fragment string");
+    }
+    check(p.statusCode() == fresh.statusCode(), "Restart: wrong status code");
+    check(p.contentLength() == fresh.contentLength(), "Restart: wrong content length");
+}
+
+template <class PARSER>
+void test_restart(PARSER& p, PARSER& fresh, size_t aHeaderMax)
+{
+    const std::string_view sResponses[] = {ONE, TWO, THREE, FOUR, "HTTP/1.1 20 OK\r\n\r\n", "HTTP/1.1 200 OK\r\nContent-Len"};
+    for (std::string_view sFirst : {ONE, TWO, THREE, FOUR})
+        for (std::string_view sSecond : sResponses)
+            for (size_t sSkip : {0, 1, 5})
+                test_restart(p, fresh, aHeaderMax, sFirst, sSecond, sSkip);
+}
+
+void test_restart()
+{
+    {
+        HttpResponseParser p, fresh;
+        test_restart(p, fresh, HttpResponseParser::HEADER_MAX);
+    }
+    {
+        HttpResponseParser16 p, fresh;
+        test_restart(p, fresh, HttpResponseParser16::HEADER_MAX);
+    }
+    {
+        HashedHttpResponseParser p, fresh;
+        test_restart(p, fresh, HashedHttpResponseParser::HEADER_MAX);
+    }
+    {
+        DynamicHttpResponseParser::Machine m({"Location", "Content-Length", "Content-Type"});
+        DynamicHttpResponseParser p(m), fresh(m);
+        test_restart(p, fresh, m.headerMax());
+    }
+
+    // The position does not wrap around.
+    HttpResponseParser16 p;
+    p.restart(HttpResponseParser16::MAX_HEADER_SIZE - 1);
+    p.restart(2);
+    check(p.count() == HttpResponseParser16::MAX_HEADER_SIZE, "Restart: position overflow");
+    HttpResponseParser16::status_t res = 0;
+    check(p.feed(THREE, res) == 0 && res == HttpResponseParser16::ERROR_HEADER_TOO_LONG, "Restart: must be too long");
+}
+
+// What is found in a response.
+struct Found
+{
+    uint64_t m_StatusCode;
+    std::string_view m_Location;
+    size_t m_Begin;
+    size_t m_HeaderSize;
+    bool operator==(const Found& a) const
+    {
+        return m_StatusCode == a.m_StatusCode && m_Location == a.m_Location &&
+               m_Begin == a.m_Begin && m_HeaderSize == a.m_HeaderSize;
+    }
+};
+
+// Iterate over responses in aBuffer (that is at aOffset in the stream), append them to aFound.
+// Return the pipeline to check its final state.
+template <class PARSER>
+HttpResponsePipeline<PARSER> pipeline(PARSER& p, std::string_view aBuffer, size_t aOffset, std::vector<Found>& aFound)
+{
+    constexpr typename PARSER::fragment_t LOCATION = PARSER::header(HttpHeaderName::LOCATION);
+    HttpResponsePipeline<PARSER> sPipe(p, aBuffer);
+    while (sPipe.next() == PARSER::SUCCESS)
+    {
+        std::string_view sLocation = sPipe.fragment(LOCATION);
+        aFound.push_back({p.statusCode(), sLocation, aOffset + sPipe.begin(), sPipe.headerSize()});
+        check(sLocation.empty() == !p.isFragmentFound(LOCATION), "Pipeline: wrong location");
+        uint64_t sLength = p.contentLength();
+        sPipe.skipBody(sLength == PARSER::INVALID_NUMBER ? 0 : sLength);
+    }
+    return sPipe;
+}
+
+template <class PARSER>
+void test_pipeline()
+{
+    std::string sStream = std::string(ONE) + "Hello" + std::string(TWO) + std::string(THREE) +
+                          std::string(FOUR) + "Bye" + std::string(THREE) + std::string(ONE) + "World";
+    std::vector<Found> sExpected = {
+        {200, "here", 0, ONE.size()},
+        {304, "", ONE.size() + 5, TWO.size()},
+        {204, "", ONE.size() + 5 + TWO.size(), THREE.size()},
+        {301, "/there", ONE.size() + 5 + TWO.size() + THREE.size(), FOUR.size()},
+        {204, "", ONE.size() + 5 + TWO.size() + THREE.size() + FOUR.size() + 3, THREE.size()},
+        {200, "here", sStream.size() - 5 - ONE.size(), ONE.size()},
+    };
+
+    PARSER p;
+    std::vector<Found> sFound;
+    HttpResponsePipeline<PARSER> sPipe = pipeline(p, sStream, 0, sFound);
+    check(sFound == sExpected, "Pipeline: wrong responses");
+    check(sPipe.consumed() == sStream.size() && sPipe.bodyLeft() == 0, "Pipeline: must be consumed");
+    check(sPipe.next() == 0, "Pipeline: no more responses");
+
+    // The stream comes in two buffers, the second begins with the rest of the first one.
+    for (size_t sCut = 0; sCut <= sStream.size(); sCut++)
+    {
+        sFound.clear();
+        HttpResponsePipeline<PARSER> sFirst = pipeline(p, std::string_view(sStream).substr(0, sCut), 0, sFound);
+        check(sFirst.consumed() <= sCut, "Pipeline: consumed too much");
+        check(sFirst.bodyLeft() == 0 || sFirst.consumed() == sCut, "Pipeline: wrong body left");
+        size_t sNext = sFirst.consumed() + sFirst.bodyLeft();
+        HttpResponsePipeline<PARSER> sSecond = pipeline(p, std::string_view(sStream).substr(sNext), sNext, sFound);
+        check(sFound == sExpected, "Pipeline: wrong responses in two buffers");
+        check(sSecond.consumed() == sStream.size() - sNext, "Pipeline: second must be consumed");
+    }
+
+    // Broken stream.
+    sFound.clear();
+    std::string sBroken = std::string(ONE) + "Hello" + "HTTP/1.1 2x0 OK\r\n\r\n" + std::string(THREE);
+    HttpResponsePipeline<PARSER> sBad = pipeline(p, sBroken, 0, sFound);
+    check(sFound.size() == 1, "Pipeline: only the first must be found");
+    check(sBad.next() == PARSER::ERROR_NOT_A_DIGIT_STATUS_CODE, "Pipeline: must be broken");
+    check(sBad.consumed() == ONE.size() + 5, "Pipeline: wrong consumed of broken");
+}
+
+int main()
+{
+    try
+    {
+        test_restart();
+        test_pipeline<HttpResponseParser>();
+        test_pipeline<HttpResponseParser16>();
+        test_pipeline<HashedHttpResponseParser>();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Well done!" << std::endl;
+}
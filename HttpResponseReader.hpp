@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <assert.h>
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <HttpContentDecoder.hpp>
+#include <HttpResponseParserBase.hpp>
+#include <PlainSocket.hpp>
+
+// Zero-copy parsing of HTTP response header right in the cache of PlainSocket.
+// The response must begin at the beginning of cached data. The parser is fed with
+// cached data that it has not seen yet, from one or two parts of the cycled cache,
+// so feedFromCache can be called after each recvSome until nonzero status is returned.
+// The cached data must not be dropped or consumed (recv*) until the end of parsing.
+// Usage:
+//  HttpResponseParser p;
+//  HttpResponseParser::status_t s = 0;
+//  size_t sHeaderSize = feedFromCache(p, sock, s);
+//  while (s == 0) { sock.recvSome(1, sShutDown); sHeaderSize = feedFromCache(p, sock, s); }
+//  ... use getCachedFragment(p, sock, HttpResponseParser::LOCATION) ...
+//  sock.dropCache(sHeaderSize); // Now the body is at the beginning of the cache.
+// PARSER is BasicHttpResponseParser (or derived) or DynamicHttpResponseParser.
+
+// Feed the parser, store the status to aStatus.
+// Return the number of cached bytes that are parsed, i.e. the size of the header
+// that must be dropped with dropCache when the parsing is finished.
+template <class PARSER>
+size_t feedFromCache(PARSER& aParser, const PlainSocket& aSocket, HttpResponseParserBase::status_t& aStatus);
+// Same with limits of the header, that bound the cache a slow or broken server can occupy.
+template <class PARSER>
+size_t feedFromCache(PARSER& aParser, const PlainSocket& aSocket, HttpResponseParserBase::status_t& aStatus,
+                     HttpResponseParserBase::Limits& aLimits);
+
+// Get a fragment that was found by feedFromCache. It is returned as one part or
+// two parts if it is split by the end of the cycled cache. Valid until dropCache.
+template <class PARSER>
+std::pair<std::string_view, std::string_view>
+getCachedFragment(const PARSER& aParser, const PlainSocket& aSocket, HttpResponseParserBase::fragment_t aFragment);
+
+// Whether the connection can be reused after the response that was parsed by feedFromCache,
+// see HttpResponseParserBase::keepAlive. aConnection is the fragment of Connection header,
+// that the parser must store (for instance, KeepAliveHttpResponseParser::CONNECTION;
+// the default HttpResponseParser doesn't store it).
+// Must be called before dropCache of the header.
+template <class PARSER>
+bool keepAliveFromCache(const PARSER& aParser, const PlainSocket& aSocket, HttpResponseParserBase::fragment_t aConnection);
+
+// Decode the body right from the cache (after dropCache of the header) to the buffer
+// [aOut, aOut + aOutSize), aBodySize is the number of bytes of the body that are left
+// (the rest of Content-Length, SIZE_MAX if the body lasts until the connection is closed).
+// The eaten bytes are dropped from the cache, that is free for the next recvSome then.
+// The number of decoded bytes is stored to aProduced, see HttpContentDecoder::decode.
+// Return the number of eaten bytes.
+inline size_t decodeFromCache(HttpContentDecoder& aDecoder, PlainSocket& aSocket, size_t aBodySize,
+                              char* aOut, size_t aOutSize, size_t& aProduced, HttpContentDecoder::status_t& aStatus);
+
+//////////////////////////////////// IMPLEMENTATION ////////////////////////////////////
+template <class PARSER>
+size_t feedFromCache(PARSER& aParser, const PlainSocket& aSocket, HttpResponseParserBase::status_t& aStatus)
+{
+    auto [sFirst, sSecond] = aSocket.cachedData();
+    aStatus = 0;
+    if (aParser.count() < sFirst.size())
+        aParser.feed(sFirst.substr(aParser.count()), aStatus);
+    if (0 == aStatus && aParser.count() >= sFirst.size())
+        aParser.feed(sSecond.substr(aParser.count() - sFirst.size()), aStatus);
+    return aParser.count();
+}
+
+template <class PARSER>
+size_t feedFromCache(PARSER& aParser, const PlainSocket& aSocket, HttpResponseParserBase::status_t& aStatus,
+                     HttpResponseParserBase::Limits& aLimits)
+{
+    auto [sFirst, sSecond] = aSocket.cachedData();
+    aStatus = 0;
+    if (aParser.count() < sFirst.size())
+        aParser.feed(sFirst.substr(aParser.count()), aStatus, aLimits);
+    if (0 == aStatus && aParser.count() >= sFirst.size())
+        aParser.feed(sSecond.substr(aParser.count() - sFirst.size()), aStatus, aLimits);
+    return aParser.count();
+}
+
+template <class PARSER>
+std::pair<std::string_view, std::string_view>
+getCachedFragment(const PARSER& aParser, const PlainSocket& aSocket, HttpResponseParserBase::fragment_t aFragment)
+{
+    auto [sFirst, sSecond] = aSocket.cachedData();
+    return aParser.getFragmentStr(sFirst, sSecond, aFragment);
+}
+
+template <class PARSER>
+bool keepAliveFromCache(const PARSER& aParser, const PlainSocket& aSocket, HttpResponseParserBase::fragment_t aConnection)
+{
+    assert(aConnection < PARSER::HEADER_MAX && "Connection header is not stored");
+    auto sConnection = getCachedFragment(aParser, aSocket, aConnection);
+    // The version may have several digits, so it can be split too.
+    auto [sMinor1, sMinor2] = getCachedFragment(aParser, aSocket, HttpResponseParserBase::MINOR_VERSION);
+    if (sMinor2.empty())
+        return HttpResponseParserBase::keepAlive(sMinor1, sConnection);
+    return HttpResponseParserBase::keepAlive(std::string(sMinor1).append(sMinor2), sConnection);
+}
+
+size_t decodeFromCache(HttpContentDecoder& aDecoder, PlainSocket& aSocket, size_t aBodySize,
+                       char* aOut, size_t aOutSize, size_t& aProduced, HttpContentDecoder::status_t& aStatus)
+{
+    auto [sFirst, sSecond] = aSocket.cachedData();
+    sFirst = sFirst.substr(0, aBodySize);
+    sSecond = sSecond.substr(0, aBodySize - sFirst.size());
+    size_t sEaten = aDecoder.decode(sFirst, aOut, aOutSize, aProduced, aStatus);
+    if (0 == aStatus && sEaten == sFirst.size() && aProduced < aOutSize)
+    {
+        size_t sProduced = 0;
+        sEaten += aDecoder.decode(sSecond, aOut + aProduced, aOutSize - aProduced, sProduced, aStatus);
+        aProduced += sProduced;
+    }
+    aSocket.dropCache(sEaten);
+    return sEaten;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <HttpResponseReader.hpp>
+
+#include <HttpResponseParser.hpp>
+#include <NetException.hpp>
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <iostream>
+#include <string>
+#include <thread>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+constexpr std::string_view HEADER =
+    "HTTP/1.0 302 Found\r\nLocation: /over/the/rainbow\r\nConnection: keep-alive\r\nContent-Length: 5\r\n\r\n";
+constexpr std::string_view BODY = "HELLO";
+constexpr size_t MAX_PREFIX = 64;
+
+// Compressed response, it is sent after all the responses with a prefix.
+std::string GZIP_DATA;
+std::string GZIP_RESPONSE;
+// Something after the body that must be left in the cache.
+constexpr std::string_view NEXT = "NEXT";
+
+void make_gzip_response()
+{
+    for (size_t i = 0; i < 1000; i++)
+        GZIP_DATA += "chunk " + std::to_string(i % 10) + " of the body\n";
+    z_stream sStream{};
+    check(deflateInit2(&sStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK, "deflateInit2");
+    std::string sBody(deflateBound(&sStream, GZIP_DATA.size()), '\0');
+    sStream.next_in = reinterpret_cast<Bytef*>(GZIP_DATA.data());
+    sStream.avail_in = GZIP_DATA.size();
+    sStream.next_out = reinterpret_cast<Bytef*>(sBody.data());
+    sStream.avail_out = sBody.size();
+    check(deflate(&sStream, Z_FINISH) == Z_STREAM_END, "deflate");
+    sBody.resize(sStream.total_out);
+    deflateEnd(&sStream);
+    GZIP_RESPONSE = "HTTP/1.1 200 OK\r\nContent-Encoding: gzip\r\nContent-Length: " + std::to_string(sBody.size()) +
+                    "\r\n\r\n" + sBody + std::string(NEXT);
+}
+
+// Accept connections one by one and send a response with a growing prefix of garbage,
+// in small pieces, so that the response is split by the end of the cycled cache.
+void server(int aListen)
+{
+    for (size_t i = 0; i <= MAX_PREFIX; i++)
+    {
+        int s = accept(aListen, nullptr, nullptr);
+        check(s >= 0, "accept");
+        std::string sData(i, '#');
+        sData.append(HEADER);
+        sData.append(BODY);
+        for (size_t sPos = 0; sPos < sData.size(); sPos += 16)
+        {
+            size_t sSize = std::min(sData.size() - sPos, size_t(16));
+            check(send(s, sData.data() + sPos, sSize, MSG_NOSIGNAL) == ssize_t(sSize), "send");
+            usleep(100);
+        }
+        close(s);
+    }
+
+    int s = accept(aListen, nullptr, nullptr);
+    check(s >= 0, "accept");
+    for (size_t sPos = 0; sPos < GZIP_RESPONSE.size(); sPos += 100)
+    {
+        size_t sSize = std::min(GZIP_RESPONSE.size() - sPos, size_t(100));
+        check(send(s, GZIP_RESPONSE.data() + sPos, sSize, MSG_NOSIGNAL) == ssize_t(sSize), "send");
+        usleep(100);
+    }
+    close(s);
+}
+
+// Return true if the Location was split by the end of the cache.
+bool test_cached(const char* aPort, size_t aPrefix)
+{
+    char sCache[HEADER.size() + 8];
+    PlainSocket s(sCache, "127.0.0.1", aPort, 1000000);
+    bool sShutDown = false;
+
+    // Read and drop the prefix, that moves the beginning of cached data.
+    if (aPrefix != 0)
+    {
+        s.recvSome(aPrefix, sShutDown);
+        s.dropCache(aPrefix);
+    }
+
+    // Exact limits of the header for odd prefixes.
+    KeepAliveHttpResponseParser p;
+    HttpResponseParser::Limits sLimits(HEADER.size(), HEADER.size(), 10);
+    auto sFeed = [&](HttpResponseParser::status_t& aStatus)
+    {
+        return aPrefix % 2 == 0 ? feedFromCache(p, s, aStatus) : feedFromCache(p, s, aStatus, sLimits);
+    };
+    HttpResponseParser::status_t res = 0;
+    size_t sHeaderSize = sFeed(res);
+    while (res == 0)
+    {
+        s.recvSome(1, sShutDown);
+        check(!sShutDown, "Unexpected shutdown");
+        sHeaderSize = sFeed(res);
+    }
+    check(res == HttpResponseParser::SUCCESS, "Not success");
+    check(sHeaderSize == HEADER.size(), "Wrong header size");
+    check(p.statusCode() == 302, "Wrong status code");
+    check(p.contentLength() == BODY.size(), "Wrong content length");
+
+    auto [sFirst, sSecond] = getCachedFragment(p, s, KeepAliveHttpResponseParser::LOCATION);
+    check(std::string(sFirst).append(sSecond) == "/over/the/rainbow", "Wrong location");
+    check(keepAliveFromCache(p, s, KeepAliveHttpResponseParser::CONNECTION), "Keep-alive is not found");
+    auto [sCached1, sCached2] = s.cachedData();
+    check(sFirst.data() >= sCached1.data() && sFirst.data() < sCache + sizeof(sCache), "Fragment is not in place");
+
+    s.dropCache(sHeaderSize);
+    char sBody[BODY.size()];
+    s.recvOrDie(sBody);
+    check(std::string_view(sBody, sizeof(sBody)) == BODY, "Wrong body");
+    return !sSecond.empty();
+}
+
+// Decode the compressed body right from the cache, with a small cache and a small buffer.
+void test_gzip(const char* aPort)
+{
+    char sCache[128];
+    PlainSocket s(sCache, "127.0.0.1", aPort, 1000000);
+    bool sShutDown = false;
+
+    BasicHttpResponseParser<HttpHeaderName::CONTENT_ENCODING, HttpHeaderName::CONTENT_LENGTH> p;
+    const auto CONTENT_ENCODING = p.header(HttpHeaderName::CONTENT_ENCODING);
+    HttpResponseParser::status_t res = 0;
+    size_t sHeaderSize = feedFromCache(p, s, res);
+    while (res == 0)
+    {
+        s.recvSome(1, sShutDown);
+        sHeaderSize = feedFromCache(p, s, res);
+    }
+    check(res == HttpResponseParser::SUCCESS, "Not success");
+
+    HttpContentDecoder d(HttpContentDecoder::coding(getCachedFragment(p, s, CONTENT_ENCODING)));
+    check(d.currentCoding() == HttpContentDecoder::GZIP, "Wrong coding");
+    s.dropCache(sHeaderSize);
+
+    std::string sData;
+    char sOut[100];
+    size_t sBodyLeft = p.contentLength();
+    HttpContentDecoder::status_t sStatus = 0;
+    while (sStatus == 0)
+    {
+        size_t sProduced = 0;
+        sBodyLeft -= decodeFromCache(d, s, sBodyLeft, sOut, sizeof(sOut), sProduced, sStatus);
+        sData.append(sOut, sProduced);
+        if (sStatus == 0 && sProduced < sizeof(sOut))
+            s.recvSome(1, sShutDown);
+    }
+    check(sStatus == HttpContentDecoder::SUCCESS, "Decoding failed");
+    check(sBodyLeft == 0, "Body is not eaten");
+    check(sData == GZIP_DATA, "Wrong decoded body");
+
+    char sNext[NEXT.size()];
+    s.recvOrDie(sNext);
+    check(std::string_view(sNext, sizeof(sNext)) == NEXT, "Eaten after the body");
+}
+
+int main()
+{
+    try
+    {
+        int sListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        check(sListen >= 0, "socket");
+        struct sockaddr_in sAddr{};
+        sAddr.sin_family = AF_INET;
+        sAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t sAddrLen = sizeof(sAddr);
+        check(bind(sListen, (sockaddr*)&sAddr, sizeof(sAddr)) == 0, "bind");
+        check(listen(sListen, 16) == 0, "listen");
+        check(getsockname(sListen, (sockaddr*)&sAddr, &sAddrLen) == 0, "getsockname");
+        std::string sPort = std::to_string(ntohs(sAddr.sin_port));
+
+        make_gzip_response();
+        std::thread srv(server, sListen);
+        size_t sSplit = 0;
+        for (size_t i = 0; i <= MAX_PREFIX; i++)
+            sSplit += test_cached(sPort.c_str(), i);
+        test_gzip(sPort.c_str());
+        srv.join();
+        check(sSplit != 0, "Split fragments were not tested");
+        close(sListen);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const NetException& e)
+    {
+        std::cerr << e.what() << ": " << e.how() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Well done!" << std::endl;
+}
@@ -0,0 +1,682 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <vector>
+
+#include <HttpResponseParserBase.hpp>
+
+// Construction of the state machine of HTTP response parser for a given set of
+// header names. All the functions are constexpr, so the state machine can be built
+// in compile time; MACHINE is a storage with m_Conditions and m_NumConditions
+// members, for instance HttpResponseParserBase::StateMachine or, in runtime,
+// details::RuntimeStateMachine.
+
+namespace details {
+
+using Transition = HttpResponseParserBase::Transition;
+using Conditions = HttpResponseParserBase::Conditions;
+using CompactTransition = HttpResponseParserBase::CompactTransition;
+
+using fragment_t = HttpResponseParserBase::fragment_t;
+using tag_t = HttpResponseParserBase::tag_t;
+using state_t = HttpResponseParserBase::state_t;
+using status_t = HttpResponseParserBase::status_t;
+
+// Storage of the full state machine that is built in runtime.
+struct RuntimeStateMachine
+{
+    state_t m_NumConditions = 0;
+    std::vector<Conditions> m_Conditions;
+};
+
+constexpr Transition final(status_t aStatus)
+{
+    return Transition{0, HttpResponseParserBase::DUMMY_TAG, aStatus};
+}
+
+constexpr Transition normal(state_t aNextState, tag_t aTag = HttpResponseParserBase::DUMMY_TAG,
+                            uint8_t aNumber = HttpResponseParserBase::NUMBER_NONE,
+                            uint8_t aIndex = HttpResponseParserBase::INDEX_NONE)
+{
+    return Transition{aNextState, aTag, 0, aNumber, aIndex};
+}
+
+constexpr Conditions buildConditions(Transition aDefault)
+{
+    Conditions sRes{};
+    // array::fill is not constexp..
+    for (size_t i = 0; i < Conditions::NUM_TRANSITIONS; i++)
+        sRes.m_Transitions[i] = aDefault;
+    return sRes;
+}
+
+constexpr Conditions buildConditions(Transition aDefault, unsigned char c, Transition t)
+{
+    Conditions sRes = buildConditions(aDefault);
+    sRes.m_Transitions[c] = t;
+    return sRes;
+}
+
+constexpr Conditions buildConditions(Transition aDefault, unsigned char c1, Transition t1, unsigned char c2, Transition t2)
+{
+    Conditions sRes = buildConditions(aDefault);
+    sRes.m_Transitions[c1] = t1;
+    sRes.m_Transitions[c2] = t2;
+    return sRes;
+}
+
+// Primitive constexpr tolower and toupper: works only for 26 english letters.
+constexpr char simple_tolower(char c) { return c < 'A' || c > 'Z' ? c : c + 'a' - 'A'; }
+constexpr char simple_toupper(char c) { return c < 'a' || c > 'z' ? c : c + 'A' - 'a'; }
+
+// Case insensitive comparison of header names.
+constexpr bool equalHeaderNames(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (simple_tolower(a[i]) != simple_tolower(b[i]))
+            return false;
+    return true;
+}
+
+// What a state does, for profiling reports; see HttpResponseParserProfile.
+enum label_t
+{
+    LABEL_PREFIX = 0,
+    LABEL_VERSION_FIRST,
+    LABEL_VERSION_NEXT,
+    LABEL_STATUS_DIGIT,
+    LABEL_STATUS_SPACE,
+    LABEL_WAIT_VALUE,
+    LABEL_WAIT_VALUE_LF,
+    LABEL_VALUE,
+    LABEL_TRAILING_WS,
+    LABEL_TRAILING_CR,
+    LABEL_NUMBER,
+    LABEL_NUMBER_TRAILING_WS,
+    LABEL_NUMBER_TRAILING_CR,
+    LABEL_NEW_LINE,
+    LABEL_SKIP_LINE,
+    LABEL_SEARCH_LF,
+    LABEL_SEARCH_FINAL_LF,
+    LABEL_NAME,
+    LABEL_MAX
+};
+
+struct StateLabel
+{
+    // One of label_t.
+    uint8_t m_Kind = LABEL_PREFIX;
+    // Fragment that is read in the state; for LABEL_NAME - fragment of the header
+    // which name created the state.
+    fragment_t m_Fragment = 0;
+    // Position in "HTTP/" or in status code; for LABEL_NAME - number of read name characters.
+    uint16_t m_Position = 0;
+};
+
+// Set label of a state if labels are requested.
+constexpr void setLabel(StateLabel* aLabels, state_t aState, uint8_t aKind,
+                        fragment_t aFragment = 0, uint16_t aPosition = 0)
+{
+    if (nullptr != aLabels)
+        aLabels[aState] = StateLabel{aKind, aFragment, aPosition};
+}
+
+// Characters of a header name that is recorded to HttpHeaderIndex: visible ones except ':'.
+constexpr bool isNameChar(unsigned char c) { return c > ' ' && c < 127 && c != ':'; }
+
+// Fragment of a header value that is not stored by the parser (but is recorded to the index).
+constexpr fragment_t NO_FRAGMENT = UINT16_MAX;
+
+// Header which value is parsed as a number.
+constexpr std::string_view CONTENT_LENGTH_NAME = "Content-Length";
+
+// Index of Content-Length in aNames, aCount if it's not there.
+constexpr size_t findContentLength(const std::string_view* aNames, size_t aCount)
+{
+    for (size_t i = 0; i < aCount; i++)
+        if (equalHeaderNames(aNames[i], CONTENT_LENGTH_NAME))
+            return i;
+    return aCount;
+}
+
+// Number of states of status line part of the state machine.
+constexpr state_t NUM_STATUS_LINE_CONDITIONS = 5 + 2 * 2 + 4 + 5;
+// Number of states that are common for all headers.
+constexpr state_t NUM_HEADER_LINE_CONDITIONS = 4;
+// Number of states of reading header value.
+constexpr state_t NUM_VALUE_CONDITIONS = 5;
+// Number of additional states of reading numeric header value.
+constexpr state_t NUM_NUMBER_VALUE_CONDITIONS = 3;
+// Number of additional states of reading any other header line, for indexing.
+constexpr state_t NUM_INDEXED_LINE_CONDITIONS = 1 + NUM_VALUE_CONDITIONS;
+
+// Upper bound of number of states for the given header names.
+constexpr state_t maxNumConditions(const std::string_view* aNames, size_t aCount, bool aIndexed = false)
+{
+    state_t sRes = NUM_STATUS_LINE_CONDITIONS + NUM_HEADER_LINE_CONDITIONS;
+    if (aIndexed)
+        sRes += NUM_INDEXED_LINE_CONDITIONS;
+    for (size_t i = 0; i < aCount; i++)
+        sRes += aNames[i].size() + NUM_VALUE_CONDITIONS;
+    if (findContentLength(aNames, aCount) != aCount)
+        sRes += NUM_NUMBER_VALUE_CONDITIONS;
+    return sRes;
+}
+
+// Set transitions of reading a value and storing it as a fragment.
+// Ignore leading and trailing whitespaces.
+// From RFC: optional whitespaces OWS = *( SP / HTAB ),
+// but we also ignore single '/r' and '/n'.
+// The value is finished by "\r\n", that leads to aNextLine.
+// If aLabels is not null, labels of the states are set there, as in buildStateMachine.
+// If aIndexed, the value and the end of the line are also recorded to the index.
+template <class MACHINE>
+constexpr void buildValue(MACHINE& aRes, state_t& aState, fragment_t aFrag, state_t aNextLine,
+                          StateLabel* aLabels = nullptr, bool aIndexed = false)
+{
+    tag_t sTagBegin = aFrag == NO_FRAGMENT ? HttpResponseParserBase::DUMMY_TAG : HttpResponseParserBase::tagBegin(aFrag);
+    tag_t sTagEnd = aFrag == NO_FRAGMENT ? HttpResponseParserBase::DUMMY_TAG : HttpResponseParserBase::tagEnd(aFrag);
+
+    // Below NS - non-space.
+    state_t sWaitNS = aState++;
+    state_t sWaitNSLF = aState++;
+    state_t sFoundNS = aState++;
+    state_t sTralingWS = aState++;
+    state_t sTralingCR = aState++;
+    setLabel(aLabels, sWaitNS, LABEL_WAIT_VALUE, aFrag);
+    setLabel(aLabels, sWaitNSLF, LABEL_WAIT_VALUE_LF, aFrag);
+    setLabel(aLabels, sFoundNS, LABEL_VALUE, aFrag);
+    setLabel(aLabels, sTralingWS, LABEL_TRAILING_WS, aFrag);
+    setLabel(aLabels, sTralingCR, LABEL_TRAILING_CR, aFrag);
+
+    // Skip all whitespaces, wait for first non-space char.
+    aRes.m_Conditions[sWaitNS] = buildConditions(normal(sFoundNS, sTagBegin));
+    aRes.m_Conditions[sWaitNS].m_Transitions[' '] = normal(sWaitNS);
+    aRes.m_Conditions[sWaitNS].m_Transitions['\t'] = normal(sWaitNS);
+    aRes.m_Conditions[sWaitNS].m_Transitions['\r'] = normal(sWaitNSLF);
+    aRes.m_Conditions[sWaitNS].m_Transitions['\n'] = normal(sWaitNS);
+
+    // Same as above, but previous char is '\r', so '\n' means empty string.
+    aRes.m_Conditions[sWaitNSLF] = buildConditions(normal(sFoundNS, sTagBegin));
+    aRes.m_Conditions[sWaitNSLF].m_Transitions[' '] = normal(sWaitNS);
+    aRes.m_Conditions[sWaitNSLF].m_Transitions['\t'] = normal(sWaitNS);
+    aRes.m_Conditions[sWaitNSLF].m_Transitions['\r'] = normal(sWaitNSLF);
+    aRes.m_Conditions[sWaitNSLF].m_Transitions['\n'] = normal(aNextLine);
+
+    // Non-whitespace have been found, now looking for whitespace.
+    aRes.m_Conditions[sFoundNS] = buildConditions(normal(sFoundNS));
+    aRes.m_Conditions[sFoundNS].m_Transitions[' '] = normal(sTralingWS, sTagEnd);
+    aRes.m_Conditions[sFoundNS].m_Transitions['\t'] = normal(sTralingWS, sTagEnd);
+    aRes.m_Conditions[sFoundNS].m_Transitions['\r'] = normal(sTralingCR, sTagEnd);
+    aRes.m_Conditions[sFoundNS].m_Transitions['\n'] = normal(sTralingWS, sTagEnd);
+
+    // Previous char is whitespace, look for non-space again or '\r'.
+    aRes.m_Conditions[sTralingWS] = buildConditions(normal(sFoundNS));
+    aRes.m_Conditions[sTralingWS].m_Transitions[' '] = normal(sTralingWS);
+    aRes.m_Conditions[sTralingWS].m_Transitions['\t'] = normal(sTralingWS);
+    aRes.m_Conditions[sTralingWS].m_Transitions['\r'] = normal(sTralingCR);
+    aRes.m_Conditions[sTralingWS].m_Transitions['\n'] = normal(sTralingWS);
+
+    // Previous char is '\r', same as above except exit on '\n'.
+    aRes.m_Conditions[sTralingCR] = buildConditions(normal(sFoundNS));
+    aRes.m_Conditions[sTralingCR].m_Transitions[' '] = normal(sTralingWS);
+    aRes.m_Conditions[sTralingCR].m_Transitions['\t'] = normal(sTralingWS);
+    aRes.m_Conditions[sTralingCR].m_Transitions['\r'] = normal(sTralingCR);
+    aRes.m_Conditions[sTralingCR].m_Transitions['\n'] = normal(aNextLine);
+
+    if (aIndexed)
+    {
+        for (state_t s : {sWaitNS, sWaitNSLF})
+            for (Transition& t : aRes.m_Conditions[s].m_Transitions)
+                if (t.m_State == sFoundNS)
+                    t.m_Index = HttpResponseParserBase::INDEX_VALUE_BEGIN;
+        for (unsigned char c : {' ', '\t', '\r', '\n'})
+            aRes.m_Conditions[sFoundNS].m_Transitions[c].m_Index = HttpResponseParserBase::INDEX_VALUE_END;
+        aRes.m_Conditions[sWaitNSLF].m_Transitions['\n'].m_Index = HttpResponseParserBase::INDEX_STORE_EMPTY;
+        aRes.m_Conditions[sTralingCR].m_Transitions['\n'].m_Index = HttpResponseParserBase::INDEX_STORE;
+    }
+}
+
+// Same as buildValue, but also calculate the value as a decimal number.
+// While the value consists of digits, it is parsed by additional states; any
+// other non-whitespace character invalidates the number and switches to the
+// states of ordinary value.
+template <class MACHINE>
+constexpr void buildNumberValue(MACHINE& aRes, state_t& aState, fragment_t aFrag, state_t aNextLine,
+                                StateLabel* aLabels = nullptr, bool aIndexed = false)
+{
+    tag_t sTagBegin = HttpResponseParserBase::tagBegin(aFrag);
+    tag_t sTagEnd = HttpResponseParserBase::tagEnd(aFrag);
+    constexpr uint8_t sFirst = HttpResponseParserBase::CONTENT_LENGTH_FIRST;
+    constexpr uint8_t sNext = HttpResponseParserBase::CONTENT_LENGTH_NEXT;
+    constexpr uint8_t sInvalid = HttpResponseParserBase::CONTENT_LENGTH_INVALID;
+    uint8_t sValueBegin = aIndexed ? HttpResponseParserBase::INDEX_VALUE_BEGIN : HttpResponseParserBase::INDEX_NONE;
+
+    state_t sWaitNS = aState;
+    state_t sWaitNSLF = aState + 1;
+    state_t sFoundNS = aState + 2;
+    buildValue(aRes, aState, aFrag, aNextLine, aLabels, aIndexed);
+    state_t sNumFound = aState++;
+    state_t sNumTralingWS = aState++;
+    state_t sNumTralingCR = aState++;
+    setLabel(aLabels, sNumFound, LABEL_NUMBER, aFrag);
+    setLabel(aLabels, sNumTralingWS, LABEL_NUMBER_TRAILING_WS, aFrag);
+    setLabel(aLabels, sNumTralingCR, LABEL_NUMBER_TRAILING_CR, aFrag);
+
+    for (state_t s : {sWaitNS, sWaitNSLF})
+    {
+        for (Transition& t : aRes.m_Conditions[s].m_Transitions)
+            if (t.m_State == sFoundNS)
+                t.m_Number = sInvalid;
+        for (unsigned char c = '0'; c <= '9'; c++)
+            aRes.m_Conditions[s].m_Transitions[c] = normal(sNumFound, sTagBegin, sFirst, sValueBegin);
+    }
+
+    // Digits have been found, now looking for whitespace.
+    aRes.m_Conditions[sNumFound] = buildConditions(normal(sFoundNS, HttpResponseParserBase::DUMMY_TAG, sInvalid));
+    for (unsigned char c = '0'; c <= '9'; c++)
+        aRes.m_Conditions[sNumFound].m_Transitions[c] = normal(sNumFound, HttpResponseParserBase::DUMMY_TAG, sNext);
+    aRes.m_Conditions[sNumFound].m_Transitions[' '] = normal(sNumTralingWS, sTagEnd);
+    aRes.m_Conditions[sNumFound].m_Transitions['\t'] = normal(sNumTralingWS, sTagEnd);
+    aRes.m_Conditions[sNumFound].m_Transitions['\r'] = normal(sNumTralingCR, sTagEnd);
+    aRes.m_Conditions[sNumFound].m_Transitions['\n'] = normal(sNumTralingWS, sTagEnd);
+
+    // Previous char is whitespace after the number, nothing but whitespace is expected.
+    aRes.m_Conditions[sNumTralingWS] = buildConditions(normal(sFoundNS, HttpResponseParserBase::DUMMY_TAG, sInvalid));
+    aRes.m_Conditions[sNumTralingWS].m_Transitions[' '] = normal(sNumTralingWS);
+    aRes.m_Conditions[sNumTralingWS].m_Transitions['\t'] = normal(sNumTralingWS);
+    aRes.m_Conditions[sNumTralingWS].m_Transitions['\r'] = normal(sNumTralingCR);
+    aRes.m_Conditions[sNumTralingWS].m_Transitions['\n'] = normal(sNumTralingWS);
+
+    // Previous char is '\r', same as above except exit on '\n'.
+    aRes.m_Conditions[sNumTralingCR] = buildConditions(normal(sFoundNS, HttpResponseParserBase::DUMMY_TAG, sInvalid));
+    aRes.m_Conditions[sNumTralingCR].m_Transitions[' '] = normal(sNumTralingWS);
+    aRes.m_Conditions[sNumTralingCR].m_Transitions['\t'] = normal(sNumTralingWS);
+    aRes.m_Conditions[sNumTralingCR].m_Transitions['\r'] = normal(sNumTralingCR);
+    aRes.m_Conditions[sNumTralingCR].m_Transitions['\n'] = normal(aNextLine);
+
+    if (aIndexed)
+    {
+        for (unsigned char c : {' ', '\t', '\r', '\n'})
+            aRes.m_Conditions[sNumFound].m_Transitions[c].m_Index = HttpResponseParserBase::INDEX_VALUE_END;
+        aRes.m_Conditions[sNumTralingCR].m_Transitions['\n'].m_Index = HttpResponseParserBase::INDEX_STORE;
+    }
+}
+
+// Conditions of a state that reads a header name: the beginning of a line (aFirst)
+// or a state after some characters of a name.
+// Without indexing anything but the known names is skipped, i.e. aOtherName and aOtherValue
+// must be aSkipLine. With indexing other names lead to aOtherName, that reads the rest of
+// the name, and ':' after a name that is not known leads to aOtherValue.
+constexpr Conditions nameConditions(bool aFirst, bool aIndexed, state_t aSkipLine, state_t aNextCR,
+                                    state_t aOtherName, state_t aOtherValue)
+{
+    Conditions sRes = buildConditions(normal(aSkipLine), '\r', normal(aNextCR));
+    if (!aIndexed)
+        return sRes;
+    uint8_t sAction = aFirst ? HttpResponseParserBase::INDEX_NAME_FIRST : HttpResponseParserBase::INDEX_NAME_NEXT;
+    for (size_t i = 0; i < Conditions::NUM_TRANSITIONS; i++)
+        if (isNameChar(i))
+            sRes.m_Transitions[i] = normal(aOtherName, HttpResponseParserBase::DUMMY_TAG,
+                                           HttpResponseParserBase::NUMBER_NONE, sAction);
+    if (!aFirst)
+        sRes.m_Transitions[':'] = normal(aOtherValue, HttpResponseParserBase::DUMMY_TAG,
+                                         HttpResponseParserBase::NUMBER_NONE, HttpResponseParserBase::INDEX_NAME_END);
+    return sRes;
+}
+
+// Build the state machine that stores values of given headers.
+// aRes must have room for maxNumConditions(aNames, aCount, aIndexed) states.
+// If aLabels is not null, it must have the same room; the label of each state is set there.
+// If aIndexed, transitions also record every header line to HttpHeaderIndex (see
+// index_action_t); lines with other names are then read by their own states instead of
+// being skipped. Return the number of states.
+template <class MACHINE>
+constexpr state_t buildStateMachine(MACHINE& aRes, const std::string_view* aNames, size_t aCount,
+                                    StateLabel* aLabels = nullptr, bool aIndexed = false)
+{
+    state_t sState = 0;
+
+    // Read prefix.
+    {
+        constexpr std::string_view sPrefix("HTTP/");
+        for (size_t i = 0; i < sPrefix.size(); i++)
+        {
+            Transition sFin = final(HttpResponseParserBase::ERROR_NOT_HTTP);
+            aRes.m_Conditions[sState] = buildConditions(sFin, sPrefix[i], normal(sState + 1));
+            setLabel(aLabels, sState, LABEL_PREFIX, 0, i);
+            sState++;
+        }
+    }
+
+    // Read major and minor version.
+    for (size_t i = 0; i < 2; i++)
+    {
+        fragment_t sSaveFragment = i == 0 ? HttpResponseParserBase::MAJOR_VERSION : HttpResponseParserBase::MINOR_VERSION;
+        status_t sError = i == 0 ? HttpResponseParserBase::ERROR_NOT_A_DIGIT_MAJOR_VERSION : HttpResponseParserBase::ERROR_NOT_A_DIGIT_MINOR_VERSION;
+        unsigned char sExitChar = i == 0 ? '.' : ' ';
+        tag_t sTagBegin = HttpResponseParserBase::tagBegin(sSaveFragment);
+        tag_t sTagEnd = HttpResponseParserBase::tagEnd(sSaveFragment);
+
+        // First, required digit.
+        aRes.m_Conditions[sState] = buildConditions(final(sError));
+        for (unsigned char c = '0'; c <= '9'; c++)
+            aRes.m_Conditions[sState].m_Transitions[c] = normal(sState + 1, sTagBegin);
+        setLabel(aLabels, sState, LABEL_VERSION_FIRST, sSaveFragment);
+        sState++;
+
+        // More digits.
+        aRes.m_Conditions[sState] = buildConditions(final(sError));
+        for (unsigned char c = '0'; c <= '9'; c++)
+            aRes.m_Conditions[sState].m_Transitions[c] = normal(sState);
+        aRes.m_Conditions[sState].m_Transitions[sExitChar] = normal(sState + 1, sTagEnd);
+        setLabel(aLabels, sState, LABEL_VERSION_NEXT, sSaveFragment);
+        sState++;
+    }
+
+    // Read status code.
+    {
+        tag_t sTagBegin = HttpResponseParserBase::tagBegin(HttpResponseParserBase::STATUS_CODE);
+        tag_t sTagEnd = HttpResponseParserBase::tagEnd(HttpResponseParserBase::STATUS_CODE);
+
+        // Exactly 3 digits.
+        for (size_t i = 0; i < 3; i++)
+        {
+            tag_t sTag = (0 == i) ? sTagBegin : HttpResponseParserBase::DUMMY_TAG;
+            uint8_t sNumber = (0 == i) ? HttpResponseParserBase::STATUS_CODE_FIRST : HttpResponseParserBase::STATUS_CODE_NEXT;
+
+            Transition sFin = final(HttpResponseParserBase::ERROR_NOT_A_DIGIT_STATUS_CODE);
+            Transition sFin2 = final(HttpResponseParserBase::ERROR_WRONG_LENGTH_OF_STATUS_CODE);
+            aRes.m_Conditions[sState] = buildConditions(sFin);
+            for (unsigned char c = '0'; c <= '9'; c++)
+                aRes.m_Conditions[sState].m_Transitions[c] = normal(sState + 1, sTag, sNumber);
+            aRes.m_Conditions[sState].m_Transitions[' '] = sFin2;
+            setLabel(aLabels, sState, LABEL_STATUS_DIGIT, HttpResponseParserBase::STATUS_CODE, i);
+            sState++;
+        }
+
+        // Must be a space.
+        Transition sFin = final(HttpResponseParserBase::ERROR_WRONG_LENGTH_OF_STATUS_CODE);
+        aRes.m_Conditions[sState] = buildConditions(sFin, ' ', normal(sState + 1, sTagEnd));
+        setLabel(aLabels, sState, LABEL_STATUS_SPACE, HttpResponseParserBase::STATUS_CODE);
+        sState++;
+    }
+
+    // Read reason phrase, the next line (first header line) follows it.
+    buildValue(aRes, sState, HttpResponseParserBase::REASON_PHRASE, sState + NUM_VALUE_CONDITIONS, aLabels);
+
+    // Read header values.
+    // Following newest RFC ignore obsolete line folding.
+    state_t sNewLine = sState++;
+    state_t sSkipLine = sState++;
+    state_t sSearchLF = sState++;
+    state_t sSearchFinalLF = sState++;
+    setLabel(aLabels, sNewLine, LABEL_NEW_LINE);
+    setLabel(aLabels, sSkipLine, LABEL_SKIP_LINE);
+    setLabel(aLabels, sSearchLF, LABEL_SEARCH_LF);
+    setLabel(aLabels, sSearchFinalLF, LABEL_SEARCH_FINAL_LF);
+
+    // Lines with names that are not known.
+    state_t sOtherName = sSkipLine;
+    state_t sOtherValue = sSkipLine;
+    if (aIndexed)
+    {
+        sOtherName = sState++;
+        sOtherValue = sState;
+        setLabel(aLabels, sOtherName, LABEL_NAME, NO_FRAGMENT);
+        aRes.m_Conditions[sOtherName] = nameConditions(false, aIndexed, sSkipLine, sSearchLF, sOtherName, sOtherValue);
+        buildValue(aRes, sState, NO_FRAGMENT, sNewLine, aLabels, aIndexed);
+    }
+
+    aRes.m_Conditions[sNewLine] = nameConditions(true, aIndexed, sSkipLine, sSearchFinalLF, sOtherName, sOtherValue);
+    aRes.m_Conditions[sSkipLine] = buildConditions(normal(sSkipLine), '\r', normal(sSearchLF));
+    aRes.m_Conditions[sSearchLF] = buildConditions(normal(sSkipLine), '\r', normal(sSearchLF), '\n', normal(sNewLine));
+    aRes.m_Conditions[sSearchFinalLF] = buildConditions(normal(sSkipLine), '\r', normal(sSearchLF), '\n', final(HttpResponseParserBase::SUCCESS));
+
+    size_t sContentLength = findContentLength(aNames, aCount);
+    for (size_t i = 0; i < aCount; i++)
+    {
+        const std::string_view sName = aNames[i];
+        fragment_t sFrag = HttpResponseParserBase::SPECIAL_MAX + i;
+        state_t s = sNewLine;
+        for (size_t j = 0; j < sName.size(); j++)
+        {
+            unsigned char c = sName[j];
+            if (aRes.m_Conditions[s].m_Transitions[c].m_State == sOtherName)
+            {
+                // Create new path.
+                state_t sNext = sState++;
+                aRes.m_Conditions[s].m_Transitions[simple_tolower(c)].m_State = sNext;
+                aRes.m_Conditions[s].m_Transitions[simple_toupper(c)].m_State = sNext;
+                aRes.m_Conditions[sNext] = nameConditions(false, aIndexed, sSkipLine, sSearchLF, sOtherName, sOtherValue);
+                setLabel(aLabels, sNext, LABEL_NAME, sFrag, j + 1);
+            }
+            s = aRes.m_Conditions[s].m_Transitions[c].m_State;
+        }
+        aRes.m_Conditions[s].m_Transitions[':'].m_State = sState;
+
+        // Read and store fragment until the end of line.
+        if (i == sContentLength)
+            buildNumberValue(aRes, sState, sFrag, sNewLine, aLabels, aIndexed);
+        else
+            buildValue(aRes, sState, sFrag, sNewLine, aLabels, aIndexed);
+    }
+
+    return sState;
+}
+
+// Whether two bytes lead to the same transitions in every state.
+template <class MACHINE>
+constexpr bool sameTransitions(const MACHINE& aMachine, unsigned char c1, unsigned char c2)
+{
+    for (state_t s = 0; s < aMachine.m_NumConditions; s++)
+    {
+        const Transition& t1 = aMachine.m_Conditions[s].m_Transitions[c1];
+        const Transition& t2 = aMachine.m_Conditions[s].m_Transitions[c2];
+        if (t1.m_State != t2.m_State || t1.m_Tag != t2.m_Tag || t1.m_Status != t2.m_Status ||
+            t1.m_Number != t2.m_Number || t1.m_Index != t2.m_Index)
+            return false;
+    }
+    return true;
+}
+
+// Split bytes into classes: set class of each byte in aClasses (256 items) and
+// remember one byte of each class in aClassBytes (up to 256 items).
+// Return the number of classes.
+template <class MACHINE>
+constexpr size_t buildByteClasses(const MACHINE& aMachine, uint8_t* aClasses, unsigned char* aClassBytes)
+{
+    size_t sNumClasses = 0;
+    for (size_t i = 0; i < Conditions::NUM_TRANSITIONS; i++)
+    {
+        unsigned char c = i;
+        size_t sClass = 0;
+        while (sClass < sNumClasses && !sameTransitions(aMachine, aClassBytes[sClass], c))
+            sClass++;
+        if (sClass == sNumClasses)
+            aClassBytes[sNumClasses++] = c;
+        aClasses[c] = sClass;
+    }
+    return sNumClasses;
+}
+
+template <class MACHINE>
+constexpr size_t countByteClasses(const MACHINE& aMachine)
+{
+    std::array<uint8_t, Conditions::NUM_TRANSITIONS> sClasses = {};
+    std::array<unsigned char, Conditions::NUM_TRANSITIONS> sClassBytes = {};
+    return buildByteClasses(aMachine, sClasses.data(), sClassBytes.data());
+}
+
+// Kind of the state for bulk feed, see HttpResponseParserBase::skip_t.
+template <class MACHINE>
+constexpr uint8_t skipKind(const MACHINE& aMachine, state_t aState)
+{
+    uint8_t sRes = HttpResponseParserBase::SKIP_TO_CR;
+    for (size_t i = 0; i < Conditions::NUM_TRANSITIONS; i++)
+    {
+        unsigned char c = i;
+        const Transition& t = aMachine.m_Conditions[aState].m_Transitions[c];
+        bool sStays = t.m_State == aState && t.m_Tag == HttpResponseParserBase::DUMMY_TAG &&
+                      t.m_Status == 0 && t.m_Number == HttpResponseParserBase::NUMBER_NONE &&
+                      t.m_Index == HttpResponseParserBase::INDEX_NONE;
+        if (sStays || HttpResponseParserBase::isSkipStop(sRes, c))
+            continue;
+        if (HttpResponseParserBase::isSkipStop(HttpResponseParserBase::SKIP_TO_WS, c))
+            sRes = HttpResponseParserBase::SKIP_TO_WS;
+        else
+            return HttpResponseParserBase::SKIP_NONE;
+    }
+    return sRes;
+}
+
+// Fill the table of compact transitions, replace state IDs with offsets of their rows.
+template <class MACHINE>
+constexpr void buildCompactTransitions(const MACHINE& aMachine, const unsigned char* aClassBytes,
+                                       size_t aNumClasses, CompactTransition* aRes)
+{
+    for (state_t s = 0; s < aMachine.m_NumConditions; s++)
+    {
+        for (size_t sClass = 0; sClass < aNumClasses; sClass++)
+        {
+            const Transition& t = aMachine.m_Conditions[s].m_Transitions[aClassBytes[sClass]];
+            CompactTransition& sCompact = aRes[s * aNumClasses + sClass];
+            sCompact.m_State = t.m_State * aNumClasses;
+            sCompact.m_Tag = t.m_Tag;
+            sCompact.m_Status = t.m_Status;
+            sCompact.m_Number = t.m_Number;
+            sCompact.m_Index = t.m_Index;
+            sCompact.m_Skip = t.m_Status == 0 ? skipKind(aMachine, t.m_State) : uint8_t(HttpResponseParserBase::SKIP_NONE);
+        }
+    }
+}
+
+// Bulk feed relies on that, see FEED_UNROLL.
+template <class MACHINE>
+constexpr bool checkUnrollSafety(const MACHINE& aMachine)
+{
+    for (state_t s = 0; s + 1 < HttpResponseParserBase::FEED_UNROLL; s++)
+        for (const Transition& t : aMachine.m_Conditions[s].m_Transitions)
+            if (t.m_Tag != HttpResponseParserBase::DUMMY_TAG || t.m_Number != HttpResponseParserBase::NUMBER_NONE ||
+                t.m_Index != HttpResponseParserBase::INDEX_NONE)
+                return false;
+    return true;
+}
+
+// Check that the state machine comes to LINE_START_CONDITION after the status line and
+// every time by '\n' that ends a line only. Feed with limits relies on that.
+template <class MACHINE>
+constexpr bool checkLineStart(const MACHINE& aMachine)
+{
+    constexpr state_t sLineStart = HttpResponseParserBase::LINE_START_CONDITION;
+    state_t s = 0;
+    for (char c : std::string_view("HTTP/1.1 200 OK\r\n"))
+        s = aMachine.m_Conditions[s].m_Transitions[uint8_t(c)].m_State;
+    if (s != sLineStart)
+        return false;
+    for (s = 0; s < aMachine.m_NumConditions; s++)
+        for (size_t c = 0; c < 256; c++)
+        {
+            const Transition& t = aMachine.m_Conditions[s].m_Transitions[c];
+            if (t.m_Status == 0 && t.m_State == sLineStart && (c != '\n' || s == sLineStart))
+                return false;
+        }
+    return true;
+}
+
+// Check that the status line prefix leads to REASON_PHRASE_CONDITION, saves
+// StatusLinePrefixTags and the status code only. Bulk feed relies on that.
+template <class MACHINE>
+constexpr bool checkStatusLinePrefix(const MACHINE& aMachine)
+{
+    constexpr std::string_view sPrefix("HTTP/1.1 200 ");
+    static_assert(sPrefix.size() == HttpResponseParserBase::STATUS_LINE_PREFIX_SIZE);
+    const auto& sTags = HttpResponseParserBase::StatusLinePrefixTags;
+    std::array<size_t, HttpResponseParserBase::StatusLinePrefixTags.size()> sSaved = {};
+    state_t s = 0;
+    uint64_t sNumber = 0;
+    for (size_t i = 0; i < sPrefix.size(); i++)
+    {
+        const Transition& t = aMachine.m_Conditions[s].m_Transitions[uint8_t(sPrefix[i])];
+        if (t.m_Status != 0 || t.m_Tag >= sTags.size() || t.m_Index != HttpResponseParserBase::INDEX_NONE)
+            return false;
+        sSaved[t.m_Tag] = i;
+        if (t.m_Number == HttpResponseParserBase::STATUS_CODE_FIRST || t.m_Number == HttpResponseParserBase::STATUS_CODE_NEXT)
+            sNumber = sNumber * 10 + (sPrefix[i] - '0');
+        else if (t.m_Number != HttpResponseParserBase::NUMBER_NONE)
+            return false;
+        s = t.m_State;
+    }
+    for (size_t i = 0; i < sTags.size(); i++)
+        if (sSaved[i] != sTags[i])
+            return false;
+    return s == HttpResponseParserBase::REASON_PHRASE_CONDITION && sNumber == 200;
+}
+
+// Checksum (FNV-1a) of all transitions, to check that generated code matches the state machine.
+template <class MACHINE>
+constexpr uint64_t stateMachineChecksum(const MACHINE& aMachine)
+{
+    uint64_t sRes = 14695981039346656037ull;
+    auto sMix = [&sRes](uint64_t aValue) { sRes = (sRes ^ aValue) * 1099511628211ull; };
+    sMix(aMachine.m_NumConditions);
+    for (state_t s = 0; s < aMachine.m_NumConditions; s++)
+    {
+        for (const Transition& t : aMachine.m_Conditions[s].m_Transitions)
+        {
+            sMix(t.m_State);
+            sMix(t.m_Tag);
+            sMix(t.m_Status);
+            sMix(t.m_Number);
+            sMix(t.m_Index);
+        }
+    }
+    return sRes;
+}
+
+template <state_t MAX>
+constexpr HttpResponseParserBase::StateMachine<MAX> makeStateMachine(const std::string_view* aNames, size_t aCount,
+                                                                     bool aIndexed = false)
+{
+    HttpResponseParserBase::StateMachine<MAX> sRes;
+    sRes.m_NumConditions = buildStateMachine(sRes, aNames, aCount, nullptr, aIndexed);
+    return sRes;
+}
+
+template <state_t NUM_CONDITIONS, size_t NUM_CLASSES, class MACHINE>
+constexpr HttpResponseParserBase::CompactStateMachine<NUM_CONDITIONS, NUM_CLASSES> makeCompactStateMachine(const MACHINE& aMachine)
+{
+    HttpResponseParserBase::CompactStateMachine<NUM_CONDITIONS, NUM_CLASSES> sRes;
+    std::array<unsigned char, Conditions::NUM_TRANSITIONS> sClassBytes = {};
+    buildByteClasses(aMachine, sRes.m_Classes.data(), sClassBytes.data());
+    buildCompactTransitions(aMachine, sClassBytes.data(), NUM_CLASSES, sRes.m_Transitions.data());
+    return sRes;
+}
+
+} // namespace details {
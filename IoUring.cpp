@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <IoUring.hpp>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <NetException.hpp>
+
+namespace
+{
+    int io_uring_setup(unsigned aEntries, io_uring_params* aParams)
+    {
+        return syscall(__NR_io_uring_setup, aEntries, aParams);
+    }
+
+    int io_uring_enter(int aFd, unsigned aToSubmit, unsigned aMinComplete, unsigned aFlags)
+    {
+        return syscall(__NR_io_uring_enter, aFd, aToSubmit, aMinComplete, aFlags, nullptr, 0);
+    }
+
+    template <class T>
+    T* at(void* aBase, uint32_t aOffset)
+    {
+        return reinterpret_cast<T*>(static_cast<char*>(aBase) + aOffset);
+    }
+} // namespace {
+
+IoUring::IoUring(unsigned aEntries)
+{
+    io_uring_params sParams{};
+    m_Fd = io_uring_setup(aEntries, &sParams);
+    if (m_Fd < 0)
+        throw NetException("io_uring_setup failed", errno);
+    m_SqEntries = sParams.sq_entries;
+    m_CqEntries = sParams.cq_entries;
+
+    m_SqRingSize = sParams.sq_off.array + sParams.sq_entries * sizeof(unsigned);
+    m_CqRingSize = sParams.cq_off.cqes + sParams.cq_entries * sizeof(io_uring_cqe);
+    bool sSingle = sParams.features & IORING_FEAT_SINGLE_MMAP;
+    if (sSingle)
+        m_SqRingSize = m_CqRingSize = std::max(m_SqRingSize, m_CqRingSize);
+
+    m_SqRing = mmap(nullptr, m_SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_SQ_RING);
+    if (m_SqRing == MAP_FAILED)
+    {
+        int sErrNo = errno;
+        close(m_Fd);
+        throw NetException("io_uring mmap failed", sErrNo);
+    }
+    m_CqRing = sSingle ? m_SqRing :
+               mmap(nullptr, m_CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_CQ_RING);
+    if (m_CqRing != MAP_FAILED)
+        m_Sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sParams.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_SQES));
+    if (m_CqRing == MAP_FAILED || m_Sqes == MAP_FAILED)
+    {
+        int sErrNo = errno;
+        if (m_CqRing != MAP_FAILED && !sSingle)
+            munmap(m_CqRing, m_CqRingSize);
+        munmap(m_SqRing, m_SqRingSize);
+        close(m_Fd);
+        throw NetException("io_uring mmap failed", sErrNo);
+    }
+
+    m_SqHead = at<unsigned>(m_SqRing, sParams.sq_off.head);
+    m_SqTailPtr = at<unsigned>(m_SqRing, sParams.sq_off.tail);
+    m_SqMask = *at<unsigned>(m_SqRing, sParams.sq_off.ring_mask);
+    m_SqArray = at<unsigned>(m_SqRing, sParams.sq_off.array);
+    m_CqHead = at<unsigned>(m_CqRing, sParams.cq_off.head);
+    m_CqTail = at<unsigned>(m_CqRing, sParams.cq_off.tail);
+    m_CqMask = *at<unsigned>(m_CqRing, sParams.cq_off.ring_mask);
+    m_Cqes = at<io_uring_cqe>(m_CqRing, sParams.cq_off.cqes);
+    m_SqTail = m_Submitted = *m_SqTailPtr;
+}
+
+IoUring::~IoUring() noexcept
+{
+    munmap(m_Sqes, m_SqEntries * sizeof(io_uring_sqe));
+    if (m_CqRing != m_SqRing)
+        munmap(m_CqRing, m_CqRingSize);
+    munmap(m_SqRing, m_SqRingSize);
+    close(m_Fd);
+}
+
+io_uring_sqe* IoUring::getSqe()
+{
+    unsigned sHead = __atomic_load_n(m_SqHead, __ATOMIC_ACQUIRE);
+    if (m_SqTail - sHead >= m_SqEntries)
+        return nullptr;
+    unsigned sIndex = m_SqTail & m_SqMask;
+    io_uring_sqe* sSqe = &m_Sqes[sIndex];
+    memset(sSqe, 0, sizeof(*sSqe));
+    m_SqArray[sIndex] = sIndex;
+    ++m_SqTail;
+    return sSqe;
+}
+
+size_t IoUring::submit(unsigned aMinComplete)
+{
+    unsigned sToSubmit = m_SqTail - m_Submitted;
+    if (sToSubmit == 0 && aMinComplete == 0)
+        return 0;
+    __atomic_store_n(m_SqTailPtr, m_SqTail, __ATOMIC_RELEASE);
+    int r;
+    do
+    {
+        ++m_NumEnters;
+        r = io_uring_enter(m_Fd, sToSubmit, aMinComplete, aMinComplete != 0 ? IORING_ENTER_GETEVENTS : 0);
+    } while (r < 0 && errno == EINTR);
+    if (r < 0)
+        throw NetException("io_uring_enter failed", errno);
+    m_Submitted += r;
+    return r;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// Minimal io_uring wrapper over raw system calls, without liburing. The ring needs
+// Linux 5.1+, the RECVMSG/SENDMSG operations (as used by UringSocket) need 5.3+.
+// Submission queue entries are taken with getSqe, filled and then submitted all
+// at once with submit, that is one io_uring_enter for any number of operations,
+// for instance for operations of many sockets. Completions are consumed with reap.
+// Not thread safe, like the ring itself is meant to be used by one thread.
+
+class IoUring
+{
+public:
+    // Throws NetException, for instance if io_uring is not supported or not permitted.
+    explicit IoUring(unsigned aEntries = 256);
+    ~IoUring() noexcept;
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Get a zeroed submission entry to fill, nullptr if the submission queue is full
+    // (submit queued entries first).
+    io_uring_sqe* getSqe();
+    // Submit queued entries and wait for at least aMinComplete completions (if it's
+    // not zero). Does nothing if there's nothing to do. Return number of submitted
+    // entries. Throws NetException.
+    size_t submit(unsigned aMinComplete = 0);
+    // Call aFunc(const io_uring_cqe&) for each available completion, return their number.
+    template <class FUNC>
+    size_t reap(FUNC&& aFunc);
+
+    // Number of entries that are queued and not submitted yet.
+    size_t queued() const { return m_SqTail - m_Submitted; }
+    // Number of io_uring_enter calls, for statistics.
+    size_t numEnters() const { return m_NumEnters; }
+    unsigned sqEntries() const { return m_SqEntries; }
+    unsigned cqEntries() const { return m_CqEntries; }
+
+
+    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
+//private:
+
+    int m_Fd;
+    unsigned m_SqEntries;
+    unsigned m_CqEntries;
+    // Mapped rings, the completion ring may be the same mapping.
+    void* m_SqRing = nullptr;
+    size_t m_SqRingSize = 0;
+    void* m_CqRing = nullptr;
+    size_t m_CqRingSize = 0;
+    io_uring_sqe* m_Sqes = nullptr;
+
+    unsigned* m_SqHead;
+    unsigned* m_SqTailPtr;
+    unsigned m_SqMask;
+    unsigned* m_SqArray;
+    unsigned* m_CqHead;
+    unsigned* m_CqTail;
+    unsigned m_CqMask;
+    io_uring_cqe* m_Cqes;
+
+    // Local tail of the submission queue and the number of submitted entries.
+    unsigned m_SqTail = 0;
+    unsigned m_Submitted = 0;
+    size_t m_NumEnters = 0;
+};
+
+//////////////////////////////////// IMPLEMENTATION ////////////////////////////////////
+template <class FUNC>
+size_t IoUring::reap(FUNC&& aFunc)
+{
+    unsigned sHead = *m_CqHead;
+    unsigned sTail = __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE);
+    size_t sCount = sTail - sHead;
+    for (; sHead != sTail; ++sHead)
+        aFunc(static_cast<const io_uring_cqe&>(m_Cqes[sHead & m_CqMask]));
+    __atomic_store_n(m_CqHead, sHead, __ATOMIC_RELEASE);
+    return sCount;
+}
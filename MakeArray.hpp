@@ -91,7 +91,7 @@ T constructByIndexes(std::integer_sequence<size_t, I...>, Tuple& t)
 template <class T, class ...ArgGroups, class ...ARGS>
 auto makeArray(std::tuple<ArgGroups...>, ARGS&&... aArgs) -> std::array<T, sizeof...(ArgGroups)>
 {
-    std::tuple<ARGS&&...> sArgs(std::forward<ARGS>(aArgs)...);
+    [[maybe_unused]] std::tuple<ARGS&&...> sArgs(std::forward<ARGS>(aArgs)...);
     return std::array<T, sizeof...(ArgGroups)>{constructByIndexes<T>(ArgGroups{}, sArgs)...};
 }
 
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <PerfCounters.hpp>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace {
+
+constexpr std::string_view counter_names[PerfCounters::NUM_COUNTERS] =
+    {
+        "cycles",
+        "instructions",
+        "branch_misses",
+    };
+
+constexpr uint64_t counter_configs[PerfCounters::NUM_COUNTERS] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+// Value, time enabled, time running.
+using Reading = std::array<uint64_t, 3>;
+
+bool read_counter(int aFd, Reading& aReading)
+{
+    return aFd >= 0 && read(aFd, aReading.data(), sizeof(aReading)) == ssize_t(sizeof(aReading));
+}
+
+int open_counter(uint64_t aConfig)
+{
+    struct perf_event_attr sAttr;
+    memset(&sAttr, 0, sizeof(sAttr));
+    sAttr.size = sizeof(sAttr);
+    sAttr.type = PERF_TYPE_HARDWARE;
+    sAttr.config = aConfig;
+    sAttr.disabled = 1;
+    sAttr.exclude_kernel = 1;
+    sAttr.exclude_hv = 1;
+    sAttr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(SYS_perf_event_open, &sAttr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+} // anonymous namespace
+
+std::string_view PerfCounters::name(counter_t aCounter)
+{
+    return counter_names[aCounter];
+}
+
+PerfCounters::PerfCounters() noexcept
+{
+    for (size_t i = 0; i < NUM_COUNTERS; i++)
+        m_Fds[i] = open_counter(counter_configs[i]);
+}
+
+PerfCounters::~PerfCounters() noexcept
+{
+    for (int sFd : m_Fds)
+        if (sFd >= 0)
+            close(sFd);
+}
+
+bool PerfCounters::isAnyAvailable() const
+{
+    for (int sFd : m_Fds)
+        if (sFd >= 0)
+            return true;
+    return false;
+}
+
+void PerfCounters::start() noexcept
+{
+    for (size_t i = 0; i < NUM_COUNTERS; i++)
+    {
+        int sFd = m_Fds[i];
+        if (sFd < 0)
+            continue;
+        // Reset clears the value only, the times go on from the previous runs.
+        ioctl(sFd, PERF_EVENT_IOC_RESET, 0);
+        Reading sStart;
+        if (!read_counter(sFd, sStart))
+            sStart.fill(0);
+        m_Start[i] = sStart;
+        ioctl(sFd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void PerfCounters::stop() noexcept
+{
+    for (int sFd : m_Fds)
+        if (sFd >= 0)
+            ioctl(sFd, PERF_EVENT_IOC_DISABLE, 0);
+}
+
+uint64_t PerfCounters::value(counter_t aCounter) const noexcept
+{
+    Reading sData;
+    if (!read_counter(m_Fds[aCounter], sData))
+        return 0;
+    for (size_t i = 0; i < sData.size(); i++)
+        sData[i] -= m_Start[aCounter][i];
+    if (sData[2] == 0 || sData[2] == sData[1])
+        return sData[0];
+    return uint64_t(double(sData[0]) * sData[1] / sData[2]);
+}
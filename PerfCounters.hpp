@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// Hardware performance counters of the calling thread, read with perf_event_open.
+// Counters that are not supported by the CPU (or virtual machine) or not permitted
+// (see /proc/sys/kernel/perf_event_paranoid) are just unavailable: measurements are
+// done without them, no exceptions are thrown.
+// Only user space is counted. If the kernel multiplexes counters, values are scaled
+// by the time they were actually running.
+class PerfCounters
+{
+public:
+    enum counter_t
+    {
+        CYCLES = 0,
+        INSTRUCTIONS,
+        BRANCH_MISSES,
+        NUM_COUNTERS
+    };
+    // Name of a counter, like "cycles".
+    static std::string_view name(counter_t aCounter);
+
+    PerfCounters() noexcept;
+    ~PerfCounters() noexcept;
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool isAvailable(counter_t aCounter) const { return m_Fds[aCounter] >= 0; }
+    // Whether any counter is available.
+    bool isAnyAvailable() const;
+
+    // Reset and enable all available counters.
+    void start() noexcept;
+    // Disable all available counters, the values are kept.
+    void stop() noexcept;
+    // Value of a counter between start and stop, zero if it is not available.
+    uint64_t value(counter_t aCounter) const noexcept;
+
+private:
+    std::array<int, NUM_COUNTERS> m_Fds;
+    // Value, time enabled and time running at start.
+    std::array<std::array<uint64_t, 3>, NUM_COUNTERS> m_Start{};
+};
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <PerfCounters.hpp>
+
+#include <assert.h>
+
+#include <iostream>
+#include <stdexcept>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+volatile uint64_t side_effect = 0;
+
+void work()
+{
+    for (uint64_t i = 0; i < 1000000; i++)
+        side_effect = side_effect + i;
+}
+
+void test_counters()
+{
+    check(PerfCounters::name(PerfCounters::CYCLES) == "cycles", "Wrong name");
+    check(PerfCounters::name(PerfCounters::BRANCH_MISSES) == "branch_misses", "Wrong name");
+
+    // Counters may be not available (for instance in a virtual machine), that is not an error.
+    PerfCounters sCounters;
+    sCounters.start();
+    work();
+    sCounters.stop();
+    uint64_t sInstructions = sCounters.value(PerfCounters::INSTRUCTIONS);
+    for (size_t c = 0; c < PerfCounters::NUM_COUNTERS; c++)
+    {
+        PerfCounters::counter_t sCounter = PerfCounters::counter_t(c);
+        if (!sCounters.isAvailable(sCounter))
+            check(sCounters.value(sCounter) == 0, "Unavailable counter must be zero");
+    }
+    if (!sCounters.isAvailable(PerfCounters::INSTRUCTIONS))
+        return;
+    check(sInstructions >= 1000000, "Too few instructions");
+
+    // Stopped counters do not count, start resets them.
+    work();
+    check(sCounters.value(PerfCounters::INSTRUCTIONS) == sInstructions, "Must be stopped");
+    sCounters.start();
+    sCounters.stop();
+    check(sCounters.value(PerfCounters::INSTRUCTIONS) < sInstructions, "Must be reset");
+}
+
+int main()
+{
+    try
+    {
+        test_counters();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Well done!" << std::endl;
+}
@@ -26,7 +26,10 @@
 #include <PlainSocket.hpp>
 
 #include <assert.h>
+#include <errno.h>
 #include <limits.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/uio.h>
@@ -36,18 +39,29 @@
 #include <NetException.hpp>
 
 PlainSocket::PlainSocket(char* aCache, size_t aCacheSize,
-                         const char* aAddress, const char* aPort, unsigned long aUsecTimeout)
-: SocketBase(aAddress, aPort, aUsecTimeout), m_Cache(aCache), m_CacheSize(aCacheSize)
+                         const char* aAddress, const char* aPort, unsigned long aUsecTimeout, mode_t aMode,
+                         const SocketOptions& aOptions)
+: SocketBase(aAddress, aPort, aUsecTimeout, aMode, aOptions), m_Cache(aCache), m_CacheSize(aCacheSize)
 {
 }
 
 size_t PlainSocket::sendOrDie(OVec* aOVec, size_t aCount)
+{
+    return sendImpl(aOVec, aCount, false);
+}
+
+size_t PlainSocket::trySend(OVec*& aOVec, size_t& aCount)
+{
+    return sendImpl(aOVec, aCount, true);
+}
+
+size_t PlainSocket::sendImpl(OVec*& aOVec, size_t& aCount, bool aNonBlocking)
 {
     size_t sTotalSentSize = 0;
     while (true)
     {
         // Skip empty vectors if they was given.
-        while (aOVec->iov_len == 0 && aCount > 0)
+        while (aCount > 0 && aOVec->iov_len == 0)
         {
             ++aOVec;
             --aCount;
@@ -77,6 +91,8 @@ size_t PlainSocket::sendOrDie(OVec* aOVec, size_t aCount)
         } while (r < 0 && errno == EINTR);
         if (r <= 0)
         {
+            if (aNonBlocking && r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
             if (errno == EAGAIN || errno == EWOULDBLOCK)
                 throw NetException("send failed", "timeout exceeded");
             else
@@ -92,15 +108,19 @@ size_t PlainSocket::sendOrDie(OVec* aOVec, size_t aCount)
                 break;
             ++aOVec;
             --aCount;
-            if (sSent > 0 && aCount == 0)
-                throw NetException("can't be", "'send' returned more than was asked to send");
+            if (aCount == 0)
+            {
+                if (sSent > 0)
+                    throw NetException("can't be", "'send' returned more than was asked to send");
+                break;
+            }
         }
     }
     return sTotalSentSize;
 }
 
 size_t PlainSocket::recvImplSys(IVec* aIVec, ssize_t aCount,
-                                ssize_t aMinCount, ssize_t aMinSize, bool& aShutDownError)
+                                ssize_t aMinCount, ssize_t aMinSize, bool& aShutDownError, bool* aWouldBlock)
 {
     ssize_t sTotalRecvdSize = 0;
     ssize_t sTotalRecvdAndCachedSize = 0;
@@ -108,22 +128,7 @@ size_t PlainSocket::recvImplSys(IVec* aIVec, ssize_t aCount,
     // The last two OVecs are reserved for cache vectors.
     assert(aCount >= 2);
     ssize_t sCacheIVec = aCount - 2;
-    aCount -= 2;
-    // Set up cache iovecs. If the cache is not empty (there is cached data):
-    // 1) that means that there are no non-full user provided buffers.
-    // 2) cache empty space can consist of two iovecs.
-    assert(m_CachedBegPos < m_CacheSize);
-    assert(m_CachedBegPos != m_CachedEndPos || m_CachedBegPos == 0);
-    if (m_CachedEndPos != m_CacheSize)
-    {
-        aIVec[aCount  ].iov_base = m_Cache + m_CachedEndPos;
-        aIVec[aCount++].iov_len = m_CacheSize - m_CachedEndPos;
-    }
-    if (m_CachedBegPos != 0)
-    {
-        aIVec[aCount  ].iov_base = m_Cache;
-        aIVec[aCount++].iov_len = m_CachedBegPos;
-    }
+    aCount = addCacheIVecs(aIVec, aCount - 2);
 
     while (true)
     {
@@ -131,7 +136,11 @@ size_t PlainSocket::recvImplSys(IVec* aIVec, ssize_t aCount,
         while (aIVec[sCurIVec].iov_len == 0 && sCurIVec < sCacheIVec)
             ++sCurIVec;
         if (sCurIVec == aCount)
+        {
+            if (sCurIVec < aMinCount || sTotalRecvdAndCachedSize < aMinSize)
+                throw NetException("recv failed", "not enough cache for requested operation");
             break;
+        }
 
         // Prepare recvmsg arguments.
         struct msghdr hdr{};
@@ -159,12 +168,19 @@ size_t PlainSocket::recvImplSys(IVec* aIVec, ssize_t aCount,
                     break;
                 }
             }
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && aWouldBlock != nullptr)
+            {
+                *aWouldBlock = true;
+                break;
+            }
             if (errno == EAGAIN || errno == EWOULDBLOCK)
                 throw NetException("recv failed", "timeout exceeded");
             else
                 throw NetException("recv failed", errno);
         }
 
+        rearmQuickAck();
+
         // remove sent bytes from vec.
         size_t sRecvd = r;
         if (sCurIVec < sCacheIVec) // Don't take into account reads to cache
@@ -183,5 +199,69 @@ size_t PlainSocket::recvImplSys(IVec* aIVec, ssize_t aCount,
         if (sCurIVec >= aMinCount && sTotalRecvdAndCachedSize >= aMinSize)
             break;
     }
+
+    // Account data that was read to the cache.
+    addCachedSize(sTotalRecvdAndCachedSize - sTotalRecvdSize);
     return sTotalRecvdSize;
 }
+
+void PlainSocket::addCachedSize(size_t aSize)
+{
+    if (aSize != 0)
+    {
+        m_CachedEndPos += aSize;
+        if (m_CachedEndPos > m_CacheSize)
+            m_CachedEndPos -= m_CacheSize;
+    }
+}
+
+void PlainSocket::dropCache(size_t aSize)
+{
+    if (m_CachedBegPos > m_CachedEndPos)
+    {
+        size_t sTail = m_CacheSize - m_CachedBegPos;
+        if (aSize < sTail)
+        {
+            m_CachedBegPos += aSize;
+            return;
+        }
+        aSize -= sTail;
+        m_CachedBegPos = 0;
+    }
+    assert(aSize <= m_CachedEndPos - m_CachedBegPos);
+    m_CachedBegPos += aSize;
+    if (m_CachedBegPos == m_CachedEndPos)
+        m_CachedBegPos = m_CachedEndPos = 0;
+}
+
+void PlainSocket::rearmQuickAck()
+{
+    // Delayed ACK is turned on again by the kernel after some receives. A failure is
+    // ignored: the data is received already, and the option was checked by the
+    // constructor, so at worst an ACK is delayed.
+    if (m_QuickAck)
+    {
+        int sOne = 1;
+        setsockopt(m_Fd, IPPROTO_TCP, TCP_QUICKACK, &sOne, sizeof(sOne));
+    }
+}
+
+void PlainSocket::cork()
+{
+    int sOne = 1;
+    if (0 != setsockopt(m_Fd, IPPROTO_TCP, TCP_CORK, &sOne, sizeof(sOne)))
+        throw NetException("setsockopt TCP_CORK failed", errno);
+}
+
+void PlainSocket::uncork()
+{
+    int sZero = 0;
+    if (0 != setsockopt(m_Fd, IPPROTO_TCP, TCP_CORK, &sZero, sizeof(sZero)))
+        throw NetException("setsockopt TCP_CORK failed", errno);
+}
+
+void PlainSocket::exchange(SocketBase&& a)
+{
+    SocketBase::swap(a);
+    m_CachedBegPos = m_CachedEndPos = 0;
+}
@@ -25,6 +25,11 @@
  */
 #pragma once
 
+#include <assert.h>
+
+#include <string_view>
+#include <utility>
+
 #include <IOVec.hpp>
 #include <SocketBase.hpp>
 
@@ -33,14 +38,28 @@
 // That buffer is called 'cache' to distinguish it from 'buffer' arguments
 // in recv* methods.
 // There's no send buffering, instead a group of strings can be sent at once.
+// In non-blocking mode (see SocketBase) tryRecvSome and trySend must be used
+// instead of recv* and send* methods, that treat 'would block' as a timeout.
 class PlainSocket : private SocketBase
 {
 public:
+    using SocketBase::mode_t;
+    using SocketBase::BLOCKING;
+    using SocketBase::NON_BLOCKING;
+
     template <size_t N>
     PlainSocket(char (&aCache)[N],
-                const char* aAddress, const char* aPort, unsigned long aUsecTimeout = 0);
+                const char* aAddress, const char* aPort, unsigned long aUsecTimeout = 0,
+                mode_t aMode = BLOCKING, const SocketOptions& aOptions = SocketOptions());
     PlainSocket(char* aCache, size_t aCacheSize,
-                const char* aAddress, const char* aPort, unsigned long aUsecTimeout = 0);
+                const char* aAddress, const char* aPort, unsigned long aUsecTimeout = 0,
+                mode_t aMode = BLOCKING, const SocketOptions& aOptions = SocketOptions());
+
+    // The socket is movable, the moved one uses the same cache.
+    PlainSocket(PlainSocket&&) = default;
+
+    using SocketBase::fd;
+    using SocketBase::connectError;
 
     // Send expects strings, vectors, pointers followed by size etc (see OVec ctor).
     // Send all or throw.
@@ -65,37 +84,82 @@ public:
     template <class ...ARGS>
     size_t recvSome(size_t aMinSize, bool& aShutDownError, ARGS&&... aArgs);
 
+    // Non-blocking versions.
+    // Same as recvSome, but receive only what is available right now (with at most one
+    // system call), aWouldBlock is set if nothing was available. The rest of the
+    // arguments is the same as in recvSome; without buffers data is read to the cache.
+    // Receives nothing (and aWouldBlock is not set) if the cache is full.
+    template <class ...ARGS>
+    size_t tryRecvSome(bool& aShutDownError, bool& aWouldBlock, ARGS&&... aArgs);
+    // Send as much as possible without waiting. Sent data is skipped in given vectors,
+    // aOVec and aCount are set to the rest, that is to be sent when the socket becomes
+    // writable again; all is sent when aCount is zero. Return the number of sent bytes.
+    size_t trySend(OVec*& aOVec, size_t& aCount);
+
+    // TCP_CORK: hold partial segments until uncork, so that a request that is sent by
+    // several calls goes in full segments (even with TCP_NODELAY, see SocketOptions).
+    // Throws NetException.
+    void cork();
+    void uncork();
+
     // Begin and end end position in the internal buffer that was
     // used as a cache in previous recv call.
     size_t cachedBegPos() const { return m_CachedBegPos; }
     size_t cachedEndPos() const { return m_CachedEndPos; }
-    // Discard some data from the internal buffer.
+    // Cached data, that can be used in place (without copying) until dropCache.
+    // The cache is cycled, so the data may consist of two parts; the second
+    // part is empty if the data is contiguous.
+    std::pair<std::string_view, std::string_view> cachedData() const;
+    // Discard some data from the beginning of cached data.
     void dropCache(size_t aSize);
 
-    // Reset buffer and prepare to read from another socket.
+    // Reset buffer and prepare to read from another socket; the previous one is moved to a.
     void exchange(SocketBase&& a);
 
-private:
+protected:
+    // Append vectors of free space of the cache (zero, one or two) to aIVec[0..aCount),
+    // return the new count. The cache must be empty if there are non-full vectors before.
+    template <class VEC>
+    size_t addCacheIVecs(VEC* aIVec, size_t aCount);
+    // Account aSize bytes that were received to the vectors of addCacheIVecs.
+    void addCachedSize(size_t aSize);
+    // Set TCP_QUICKACK again after receiving if it's on (see SocketOptions).
+    void rearmQuickAck();
+
     // Inline part that tries to read from cache and calls recvImplSys if necessary.
     // The last two OVec must be the cache! Even if the cache in not splitted into
     // two parts, you have to pass one zero-size part!
+    // If aWouldBlock is given, 'would block' stops reading and sets it instead of an error.
     size_t recvImpl(IVec* aOVec, size_t aCount,
-                    ssize_t sMinCount, ssize_t sMinSize, bool& aShutDownError);
+                    ssize_t sMinCount, ssize_t sMinSize, bool& aShutDownError, bool* aWouldBlock = nullptr);
     // Extern part that reads from socket.
     size_t recvImplSys(IVec* aOVec, ssize_t aCount,
-                       ssize_t sMinCount, ssize_t sMinSize, bool& aShutDownError);
+                       ssize_t sMinCount, ssize_t sMinSize, bool& aShutDownError, bool* aWouldBlock);
+    // Common part of sendOrDie and trySend, the same arguments as trySend.
+    size_t sendImpl(OVec*& aOVec, size_t& aCount, bool aNonBlocking);
 
     char* const m_Cache;
     const size_t m_CacheSize;
     size_t m_CachedBegPos = 0; // Always less than m_CacheSize. Zero if nothing cached.
     size_t m_CachedEndPos = 0; // Can be less than m_CachedBegPos, cache is cycled.
+                               // Never reaches m_CachedBegPos in that case, so the
+                               // cycled cache always has at least one free byte.
 };
 
 template <size_t N>
 inline PlainSocket::PlainSocket(char (&aCache)[N], const char* aAddress,
-                                const char* aPort, unsigned long aUsecTimeout)
-: PlainSocket(aCache, N, aAddress, aPort, aUsecTimeout)
+                                const char* aPort, unsigned long aUsecTimeout, mode_t aMode,
+                                const SocketOptions& aOptions)
+: PlainSocket(aCache, N, aAddress, aPort, aUsecTimeout, aMode, aOptions)
+{
+}
+
+inline std::pair<std::string_view, std::string_view> PlainSocket::cachedData() const
 {
+    if (m_CachedBegPos <= m_CachedEndPos)
+        return {std::string_view(m_Cache + m_CachedBegPos, m_CachedEndPos - m_CachedBegPos), std::string_view()};
+    return {std::string_view(m_Cache + m_CachedBegPos, m_CacheSize - m_CachedBegPos),
+            std::string_view(m_Cache, m_CachedEndPos)};
 }
 
 template <class ...ARGS>
@@ -138,8 +202,49 @@ inline size_t PlainSocket::recvSome(size_t aMinSize, bool& aShutDownError, ARGS&
     return recvImpl(sIVecs.data(), sIVecs.size(), 0, aMinSize, aShutDownError);
 }
 
+template <class VEC>
+inline size_t PlainSocket::addCacheIVecs(VEC* aIVec, size_t aCount)
+{
+    // If the cache is not empty (there is cached data):
+    // 1) that means that there are no non-full user provided buffers.
+    // 2) cache empty space can consist of two iovecs.
+    // One byte before m_CachedBegPos is never filled, see m_CachedEndPos.
+    assert(m_CachedBegPos < m_CacheSize);
+    assert(m_CachedBegPos != m_CachedEndPos || m_CachedBegPos == 0);
+    if (m_CachedBegPos > m_CachedEndPos)
+    {
+        if (m_CachedBegPos - m_CachedEndPos > 1)
+        {
+            aIVec[aCount  ].iov_base = m_Cache + m_CachedEndPos;
+            aIVec[aCount++].iov_len = m_CachedBegPos - m_CachedEndPos - 1;
+        }
+    }
+    else
+    {
+        if (m_CachedEndPos != m_CacheSize)
+        {
+            aIVec[aCount  ].iov_base = m_Cache + m_CachedEndPos;
+            aIVec[aCount++].iov_len = m_CacheSize - m_CachedEndPos;
+        }
+        if (m_CachedBegPos > 1)
+        {
+            aIVec[aCount  ].iov_base = m_Cache;
+            aIVec[aCount++].iov_len = m_CachedBegPos - 1;
+        }
+    }
+    return aCount;
+}
+
+template <class ...ARGS>
+inline size_t PlainSocket::tryRecvSome(bool& aShutDownError, bool& aWouldBlock, ARGS&&... aArgs)
+{
+    auto sIVecs = makeIVec(std::forward<ARGS>(aArgs)..., m_Cache, m_CacheSize, m_Cache, 0);
+    aWouldBlock = false;
+    return recvImpl(sIVecs.data(), sIVecs.size(), 0, 0, aShutDownError, &aWouldBlock);
+}
+
 inline size_t PlainSocket::recvImpl(IVec* aIVec, size_t aCount,
-                                    ssize_t sMinCount, ssize_t sMinSize, bool& aShutDownError)
+                                    ssize_t sMinCount, ssize_t sMinSize, bool& aShutDownError, bool* aWouldBlock)
 {
     ssize_t sTotalRecvdSize = 0;
     ssize_t sCurIVec = 0;
@@ -169,5 +274,5 @@ inline size_t PlainSocket::recvImpl(IVec* aIVec, size_t aCount,
 
     return sTotalRecvdSize +
         recvImplSys(aIVec + sCurIVec, aCount - sCurIVec,
-                    sMinCount - sCurIVec, sMinSize - sTotalRecvdSize, aShutDownError);
+                    sMinCount - sCurIVec, sMinSize - sTotalRecvdSize, aShutDownError, aWouldBlock);
 }
\ No newline at end of file
@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <ResolverCache.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include <NetException.hpp>
+
+namespace {
+
+// File format: FileHeader and then FileRecord per address (or one per failed
+// resolve); records of one entry go one after another.
+constexpr char FILE_MAGIC[8] = {'R', 'S', 'L', 'V', 'C', 'A', 'C', 'H'};
+constexpr uint32_t FILE_VERSION = 1;
+constexpr size_t MAX_KEY_SIZE = 272;
+
+struct FileHeader
+{
+    char m_Magic[sizeof(FILE_MAGIC)];
+    uint32_t m_Version;
+    uint32_t m_NumRecords;
+};
+
+struct FileRecord
+{
+    // Microseconds since the epoch.
+    int64_t m_Expiry;
+    int32_t m_Error;
+    int32_t m_Family;
+    int32_t m_SockType;
+    int32_t m_Protocol;
+    uint32_t m_AddrLen;
+    uint32_t m_KeySize;
+    char m_Key[MAX_KEY_SIZE];
+    struct sockaddr_storage m_Addr;
+};
+
+static_assert(sizeof(FileHeader) % alignof(FileRecord) == 0, "Records are not aligned");
+
+using Clock = ResolverCache::Clock;
+using WallClock = std::chrono::system_clock;
+
+// Expiration times are steady in memory and wall clock in the file, they are
+// converted through the current time of both clocks.
+int64_t toFile(Clock::time_point aTime, Clock::time_point aNow, WallClock::time_point aWallNow)
+{
+    WallClock::time_point sWall = aWallNow + std::chrono::duration_cast<WallClock::duration>(aTime - aNow);
+    return std::chrono::duration_cast<std::chrono::microseconds>(sWall.time_since_epoch()).count();
+}
+
+Clock::time_point fromFile(int64_t aTime, Clock::time_point aNow, WallClock::time_point aWallNow)
+{
+    WallClock::time_point sWall(std::chrono::duration_cast<WallClock::duration>(std::chrono::microseconds(aTime)));
+    return aNow + std::chrono::duration_cast<Clock::duration>(sWall - aWallNow);
+}
+
+// Failures that are answers, not troubles of resolving.
+bool isCacheableError(int aError)
+{
+    return aError != EAI_AGAIN && aError != EAI_MEMORY && aError != EAI_SYSTEM;
+}
+
+// Closes a file descriptor, unmaps memory or removes a file at the end of the scope.
+template <class FUNC>
+struct Guard
+{
+    ~Guard() { m_Func(); }
+    FUNC m_Func;
+};
+template <class FUNC> Guard(FUNC) -> Guard<FUNC>;
+
+} // namespace {
+
+std::atomic<ResolverCache*> ResolverCache::s_Installed{nullptr};
+
+ResolverCache::Entry::Entry(const char* aHost, const char* aPort, int aFamily,
+                            Clock::duration aTtl, Clock::duration aNegativeTtl)
+{
+    struct addrinfo hints{};
+    hints.ai_family = aFamily;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* sInfo = nullptr;
+    m_Error = getaddrinfo(aHost, aPort, &hints, &sInfo);
+    m_Expiry = Clock::now() + (m_Error == 0 ? aTtl : aNegativeTtl);
+    if (m_Error != 0)
+        return;
+    for (const struct addrinfo* i = sInfo; i != nullptr; i = i->ai_next)
+    {
+        if (i->ai_addrlen > sizeof(struct sockaddr_storage))
+            continue;
+        m_Infos.push_back(*i);
+        m_Addrs.emplace_back();
+        std::memcpy(&m_Addrs.back(), i->ai_addr, i->ai_addrlen);
+    }
+    freeaddrinfo(sInfo);
+    link();
+}
+
+ResolverCache::Entry::Entry(int aError, Clock::time_point aExpiry)
+: m_Error(aError), m_Expiry(aExpiry)
+{
+}
+
+ResolverCache::Entry::Entry(const struct addrinfo* aInfos, const struct sockaddr_storage* aAddrs, size_t aCount,
+                            Clock::time_point aExpiry)
+: m_Infos(aInfos, aInfos + aCount), m_Addrs(aAddrs, aAddrs + aCount), m_Expiry(aExpiry)
+{
+    link();
+}
+
+void ResolverCache::Entry::link()
+{
+    for (size_t i = 0; i < m_Infos.size(); i++)
+    {
+        m_Infos[i].ai_addr = reinterpret_cast<struct sockaddr*>(&m_Addrs[i]);
+        m_Infos[i].ai_canonname = nullptr;
+        m_Infos[i].ai_next = i + 1 < m_Infos.size() ? &m_Infos[i + 1] : nullptr;
+    }
+}
+
+void ResolverCache::Entry::check() const
+{
+    if (m_Error != 0)
+        throw NetException("getaddrinfo failed", gai_strerror(m_Error));
+}
+
+const struct addrinfo* ResolverCache::Entry::get() const
+{
+    return m_Infos.empty() ? nullptr : m_Infos.data();
+}
+
+ResolverCache::ResolverCache(unsigned long aUsecTtl, unsigned long aUsecNegativeTtl)
+: m_Ttl(std::chrono::microseconds(aUsecTtl)), m_NegativeTtl(std::chrono::microseconds(aUsecNegativeTtl))
+{
+}
+
+std::string ResolverCache::key(const char* aHost, const char* aPort, int aFamily)
+{
+    std::string sKey(aHost != nullptr ? aHost : "");
+    sKey += '\0';
+    sKey += aPort != nullptr ? aPort : "";
+    sKey += '\0';
+    sKey += std::to_string(aFamily);
+    return sKey;
+}
+
+std::shared_ptr<const ResolverCache::Entry> ResolverCache::resolve(const char* aHost, const char* aPort, int aFamily)
+{
+    std::string sKey = key(aHost, aPort, aFamily);
+    std::shared_ptr<const Entry> sEntry;
+    {
+        std::lock_guard<std::mutex> sLock(m_Mutex);
+        auto sItr = m_Entries.find(sKey);
+        if (sItr != m_Entries.end() && sItr->second->expiry() > Clock::now())
+            sEntry = sItr->second;
+    }
+    if (sEntry != nullptr)
+    {
+        ++m_Hits;
+    }
+    else
+    {
+        // getaddrinfo can be slow, it's called without the lock; concurrent misses
+        // of the same key just resolve it twice.
+        ++m_Misses;
+        sEntry = std::make_shared<const Entry>(aHost, aPort, aFamily, m_Ttl, m_NegativeTtl);
+        if (sEntry->error() == 0 || isCacheableError(sEntry->error()))
+        {
+            std::lock_guard<std::mutex> sLock(m_Mutex);
+            m_Entries[sKey] = sEntry;
+        }
+    }
+    sEntry->check();
+    return sEntry;
+}
+
+size_t ResolverCache::size() const
+{
+    std::lock_guard<std::mutex> sLock(m_Mutex);
+    return m_Entries.size();
+}
+
+void ResolverCache::purge()
+{
+    Clock::time_point sNow = Clock::now();
+    std::lock_guard<std::mutex> sLock(m_Mutex);
+    for (auto sItr = m_Entries.begin(); sItr != m_Entries.end(); )
+    {
+        if (sItr->second->expiry() <= sNow)
+            sItr = m_Entries.erase(sItr);
+        else
+            ++sItr;
+    }
+}
+
+void ResolverCache::clear()
+{
+    std::lock_guard<std::mutex> sLock(m_Mutex);
+    m_Entries.clear();
+}
+
+void ResolverCache::save(const char* aPath) const
+{
+    std::vector<FileRecord> sRecords;
+    {
+        Clock::time_point sNow = Clock::now();
+        WallClock::time_point sWallNow = WallClock::now();
+        std::lock_guard<std::mutex> sLock(m_Mutex);
+        for (const auto& [sKey, sEntry] : m_Entries)
+        {
+            if (sEntry->expiry() <= sNow || sKey.size() > MAX_KEY_SIZE)
+                continue;
+            FileRecord sRecord{};
+            sRecord.m_Expiry = toFile(sEntry->expiry(), sNow, sWallNow);
+            sRecord.m_Error = sEntry->error();
+            sRecord.m_KeySize = sKey.size();
+            std::memcpy(sRecord.m_Key, sKey.data(), sKey.size());
+            if (sEntry->size() == 0)
+                sRecords.push_back(sRecord);
+            for (const struct addrinfo* sInfo = sEntry->get(); sInfo != nullptr; sInfo = sInfo->ai_next)
+            {
+                sRecord.m_Family = sInfo->ai_family;
+                sRecord.m_SockType = sInfo->ai_socktype;
+                sRecord.m_Protocol = sInfo->ai_protocol;
+                sRecord.m_AddrLen = sInfo->ai_addrlen;
+                std::memcpy(&sRecord.m_Addr, sInfo->ai_addr, sInfo->ai_addrlen);
+                sRecords.push_back(sRecord);
+            }
+        }
+    }
+
+    FileHeader sHeader{};
+    std::memcpy(sHeader.m_Magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    sHeader.m_Version = FILE_VERSION;
+    sHeader.m_NumRecords = sRecords.size();
+    size_t sSize = sizeof(sHeader) + sRecords.size() * sizeof(FileRecord);
+
+    // A unique temporary file in the same directory, so that concurrent saves don't
+    // mix and the rename is atomic. It's removed if anything fails.
+    std::string sTmpPath = std::string(aPath) + ".XXXXXX";
+    int sFd = mkstemp(sTmpPath.data());
+    if (sFd < 0)
+        throw NetException("mkstemp failed", errno);
+    bool sRenamed = false;
+    Guard sUnlink{[&sTmpPath, &sRenamed]() { if (!sRenamed) unlink(sTmpPath.c_str()); }};
+    {
+        Guard sClose{[sFd]() { close(sFd); }};
+        if (0 != fchmod(sFd, 0644))
+            throw NetException("fchmod failed", errno);
+        if (0 != ftruncate(sFd, sSize))
+            throw NetException("ftruncate failed", errno);
+        void* sMem = mmap(nullptr, sSize, PROT_READ | PROT_WRITE, MAP_SHARED, sFd, 0);
+        if (sMem == MAP_FAILED)
+            throw NetException("mmap failed", errno);
+        Guard sUnmap{[sMem, sSize]() { munmap(sMem, sSize); }};
+        std::memcpy(sMem, &sHeader, sizeof(sHeader));
+        std::memcpy(static_cast<char*>(sMem) + sizeof(sHeader), sRecords.data(), sRecords.size() * sizeof(FileRecord));
+        if (0 != msync(sMem, sSize, MS_SYNC))
+            throw NetException("msync failed", errno);
+    }
+    if (0 != rename(sTmpPath.c_str(), aPath))
+        throw NetException("rename failed", errno);
+    sRenamed = true;
+}
+
+size_t ResolverCache::load(const char* aPath)
+{
+    int sFd = open(aPath, O_RDONLY);
+    if (sFd < 0)
+    {
+        if (errno == ENOENT)
+            return 0;
+        throw NetException("open failed", errno);
+    }
+    Guard sClose{[sFd]() { close(sFd); }};
+    struct stat sStat;
+    if (0 != fstat(sFd, &sStat))
+        throw NetException("fstat failed", errno);
+    size_t sSize = sStat.st_size;
+    if (sSize < sizeof(FileHeader))
+        return 0;
+    void* sMem = mmap(nullptr, sSize, PROT_READ, MAP_PRIVATE, sFd, 0);
+    if (sMem == MAP_FAILED)
+        throw NetException("mmap failed", errno);
+    Guard sUnmap{[sMem, sSize]() { munmap(sMem, sSize); }};
+
+    const FileHeader* sHeader = static_cast<const FileHeader*>(sMem);
+    const FileRecord* sRecords = reinterpret_cast<const FileRecord*>(static_cast<const char*>(sMem) + sizeof(FileHeader));
+    if (0 != std::memcmp(sHeader->m_Magic, FILE_MAGIC, sizeof(FILE_MAGIC)) || sHeader->m_Version != FILE_VERSION ||
+        sSize != sizeof(FileHeader) + size_t(sHeader->m_NumRecords) * sizeof(FileRecord))
+        return 0;
+
+    size_t sLoaded = 0;
+    Clock::time_point sNow = Clock::now();
+    WallClock::time_point sWallNow = WallClock::now();
+    std::vector<struct addrinfo> sInfos;
+    std::vector<struct sockaddr_storage> sAddrs;
+    for (size_t i = 0, j = 0; i < sHeader->m_NumRecords; i = j)
+    {
+        // Records of the same entry.
+        const FileRecord& sFirst = sRecords[i];
+        if (sFirst.m_KeySize > MAX_KEY_SIZE)
+            return sLoaded;
+        std::string sKey(sFirst.m_Key, sFirst.m_KeySize);
+        sInfos.clear();
+        sAddrs.clear();
+        bool sValid = true;
+        for (j = i; j < sHeader->m_NumRecords && sRecords[j].m_KeySize == sFirst.m_KeySize &&
+                    std::memcmp(sRecords[j].m_Key, sFirst.m_Key, sFirst.m_KeySize) == 0; j++)
+        {
+            const FileRecord& sRecord = sRecords[j];
+            if (sRecord.m_Error != 0 || sRecord.m_AddrLen == 0)
+                continue;
+            sValid = sValid && sRecord.m_AddrLen <= sizeof(struct sockaddr_storage);
+            struct addrinfo sInfo{};
+            sInfo.ai_family = sRecord.m_Family;
+            sInfo.ai_socktype = sRecord.m_SockType;
+            sInfo.ai_protocol = sRecord.m_Protocol;
+            sInfo.ai_addrlen = sRecord.m_AddrLen;
+            sInfos.push_back(sInfo);
+            sAddrs.push_back(sRecord.m_Addr);
+        }
+        Clock::time_point sExpiry = fromFile(sFirst.m_Expiry, sNow, sWallNow);
+        if (!sValid || sExpiry <= sNow)
+            continue;
+        std::shared_ptr<const Entry> sEntry;
+        if (sFirst.m_Error != 0)
+            sEntry = std::make_shared<const Entry>(sFirst.m_Error, sExpiry);
+        else
+            sEntry = std::make_shared<const Entry>(sInfos.data(), sAddrs.data(), sInfos.size(), sExpiry);
+        std::lock_guard<std::mutex> sLock(m_Mutex);
+        m_Entries[sKey] = sEntry;
+        ++sLoaded;
+    }
+    return sLoaded;
+}
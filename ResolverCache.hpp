@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Thread safe cache of getaddrinfo results, per (host, port, family).
+// Successful results are kept for aUsecTtl, failures (like unknown host) for
+// aUsecNegativeTtl (temporary failures, EAI_AGAIN and the like, are not cached).
+// getaddrinfo gives no TTL of DNS records, so the time is the same for all entries.
+// The cache can be saved to a file and loaded by another process, so that it starts
+// warm; the file is written and read through mmap. Expiration is checked by the steady
+// clock, only the file has wall clock times.
+// If a cache is installed, SocketBase resolves addresses through it.
+// Usage:
+//  ResolverCache sCache;
+//  sCache.load("/tmp/resolver.cache");
+//  ResolverCache::install(&sCache);
+//  ... PlainSocket s(sBuf, "example.com", "80"); ...
+//  sCache.save("/tmp/resolver.cache");
+class ResolverCache
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Result of resolving: a list of addresses or an error.
+    class Entry
+    {
+    public:
+        // Call getaddrinfo and copy the result, it expires in aTtl, or in aNegativeTtl
+        // if getaddrinfo has failed.
+        Entry(const char* aHost, const char* aPort, int aFamily, Clock::duration aTtl, Clock::duration aNegativeTtl);
+        // Failed resolve with getaddrinfo error code.
+        Entry(int aError, Clock::time_point aExpiry);
+        // Take addresses from aInfos[0..aCount), ai_next and ai_addr are rebuilt.
+        Entry(const struct addrinfo* aInfos, const struct sockaddr_storage* aAddrs, size_t aCount,
+              Clock::time_point aExpiry);
+
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+
+        // getaddrinfo error code, zero on success.
+        int error() const { return m_Error; }
+        // Throws NetException if the resolve has failed.
+        void check() const;
+        // List of addresses, linked by ai_next; nullptr if empty.
+        const struct addrinfo* get() const;
+        size_t size() const { return m_Infos.size(); }
+        const struct sockaddr_storage& addr(size_t i) const { return m_Addrs[i]; }
+        Clock::time_point expiry() const { return m_Expiry; }
+
+    private:
+        // Link the lists.
+        void link();
+
+        int m_Error = 0;
+        std::vector<struct addrinfo> m_Infos;
+        std::vector<struct sockaddr_storage> m_Addrs;
+        Clock::time_point m_Expiry;
+    };
+
+    static constexpr unsigned long DEFAULT_TTL = 60000000;
+    static constexpr unsigned long DEFAULT_NEGATIVE_TTL = 5000000;
+
+    explicit ResolverCache(unsigned long aUsecTtl = DEFAULT_TTL, unsigned long aUsecNegativeTtl = DEFAULT_NEGATIVE_TTL);
+
+    ResolverCache(const ResolverCache&) = delete;
+    ResolverCache& operator=(const ResolverCache&) = delete;
+
+    // Get the result from the cache or call getaddrinfo. Throws NetException if
+    // the resolve has failed (now or, if cached, before).
+    // The result stays valid while it is held, even if it's evicted from the cache.
+    std::shared_ptr<const Entry> resolve(const char* aHost, const char* aPort, int aFamily = AF_UNSPEC);
+
+    // Number of entries (including expired ones that are not purged yet).
+    size_t size() const;
+    // Number of resolves that were answered from the cache and that were not.
+    size_t hits() const { return m_Hits; }
+    size_t misses() const { return m_Misses; }
+    // Remove expired entries.
+    void purge();
+    void clear();
+
+    // Write all unexpired entries to a file, atomically (through a unique temporary file
+    // in the same directory).
+    // Hosts with too long names are not saved. Throws NetException.
+    void save(const char* aPath) const;
+    // Add unexpired entries from a file, return the number of added entries.
+    // A missing file, or a file of wrong format, is ignored. Throws NetException.
+    size_t load(const char* aPath);
+
+    // Set the cache that SocketBase uses, nullptr to call getaddrinfo every time.
+    static void install(ResolverCache* aCache) { s_Installed = aCache; }
+    static ResolverCache* installed() { return s_Installed; }
+
+    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
+//private:
+
+    static std::string key(const char* aHost, const char* aPort, int aFamily);
+
+    const Clock::duration m_Ttl;
+    const Clock::duration m_NegativeTtl;
+    mutable std::mutex m_Mutex;
+    std::unordered_map<std::string, std::shared_ptr<const Entry>> m_Entries;
+    std::atomic<size_t> m_Hits{0};
+    std::atomic<size_t> m_Misses{0};
+
+    static std::atomic<ResolverCache*> s_Installed;
+};
@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <ResolverCache.hpp>
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <dirent.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <NetException.hpp>
+#include <SocketBase.hpp>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+// Host from /etc/hosts.
+constexpr const char* HOST = "localhost";
+// Service that is not in /etc/services, resolving fails without asking DNS.
+constexpr const char* UNKNOWN_SERVICE = "no-such-service";
+
+bool isLoopback(const ResolverCache::Entry& aEntry)
+{
+    for (size_t i = 0; i < aEntry.size(); i++)
+    {
+        const sockaddr_in& sAddr = reinterpret_cast<const sockaddr_in&>(aEntry.addr(i));
+        if (sAddr.sin_family == AF_INET && sAddr.sin_addr.s_addr == htonl(INADDR_LOOPBACK) && sAddr.sin_port == htons(80))
+            return true;
+    }
+    return false;
+}
+
+bool isFailed(ResolverCache& aCache)
+{
+    try
+    {
+        aCache.resolve(HOST, UNKNOWN_SERVICE);
+    }
+    catch (const NetException& e)
+    {
+        return true;
+    }
+    return false;
+}
+
+void test_simple()
+{
+    ResolverCache sCache;
+    auto sEntry = sCache.resolve(HOST, "80");
+    check(sEntry->error() == 0 && sEntry->get() != nullptr, "Not resolved");
+    check(isLoopback(*sEntry), "Wrong address");
+    check(sCache.resolve(HOST, "80") == sEntry, "Not cached");
+    check(sCache.hits() == 1 && sCache.misses() == 1, "Wrong stats");
+
+    // Another port or family is another entry.
+    check(sCache.resolve(HOST, "81") != sEntry, "Port is ignored");
+    check(sCache.resolve(HOST, "80", AF_INET) != sEntry, "Family is ignored");
+    check(sCache.size() == 3 && sCache.misses() == 3, "Wrong stats");
+}
+
+void test_expiry()
+{
+    ResolverCache sCache(100000, 100000);
+    auto sEntry = sCache.resolve(HOST, "80");
+    check(isFailed(sCache), "Unknown service is resolved");
+    usleep(150000);
+    auto sNext = sCache.resolve(HOST, "80");
+    check(sNext != sEntry, "Not expired");
+    check(isLoopback(*sEntry) && isLoopback(*sNext), "Wrong address");
+    check(sCache.hits() == 0 && sCache.misses() == 3, "Wrong stats");
+    sCache.purge();
+    check(sCache.size() == 1, "Not purged");
+    usleep(150000);
+    sCache.purge();
+    check(sCache.size() == 0, "Not purged");
+}
+
+void test_negative()
+{
+    ResolverCache sCache;
+    check(isFailed(sCache), "Unknown service is resolved");
+    check(isFailed(sCache), "Unknown service is resolved");
+    check(sCache.hits() == 1 && sCache.misses() == 1, "Failure is not cached");
+}
+
+void test_file()
+{
+    std::string sPath = "/tmp/ResolverCacheUnitTest." + std::to_string(getpid());
+    ResolverCache sCache;
+    check(sCache.load(sPath.c_str()) == 0, "Loaded a missing file");
+    auto sEntry = sCache.resolve(HOST, "80");
+    sCache.resolve(HOST, "81", AF_INET);
+    isFailed(sCache);
+    sCache.save(sPath.c_str());
+
+    ResolverCache sWarm;
+    check(sWarm.load(sPath.c_str()) == 3, "Wrong number of loaded entries");
+    auto sLoaded = sWarm.resolve(HOST, "80");
+    check(sLoaded->size() == sEntry->size(), "Wrong number of addresses");
+    // Expiration time is stored as wall clock time and converted back to the steady clock.
+    check(sLoaded->expiry() - sEntry->expiry() < std::chrono::milliseconds(100) &&
+          sEntry->expiry() - sLoaded->expiry() < std::chrono::milliseconds(100), "Wrong expiry");
+    for (const addrinfo *a = sEntry->get(), *b = sLoaded->get(); a != nullptr; a = a->ai_next, b = b->ai_next)
+    {
+        check(a->ai_family == b->ai_family && a->ai_socktype == b->ai_socktype && a->ai_protocol == b->ai_protocol,
+              "Wrong address info");
+        check(a->ai_addrlen == b->ai_addrlen && std::memcmp(a->ai_addr, b->ai_addr, a->ai_addrlen) == 0,
+              "Wrong address");
+    }
+    sWarm.resolve(HOST, "81", AF_INET);
+    check(isFailed(sWarm), "Failure is not loaded");
+    check(sWarm.misses() == 0, "Not warm");
+
+    // Expired entries are not saved.
+    ResolverCache sShort(1, 1);
+    sShort.resolve(HOST, "80");
+    usleep(1000);
+    sShort.save(sPath.c_str());
+    check(sWarm.load(sPath.c_str()) == 0, "Expired entries are saved");
+
+    // Files of wrong format are ignored.
+    std::ofstream(sPath) << "Not a cache at all, nothing to see here.";
+    check(sWarm.load(sPath.c_str()) == 0, "Loaded a wrong file");
+    std::remove(sPath.c_str());
+}
+
+// Names of the files in a directory, except . and ..
+std::vector<std::string> listDir(const std::string& aPath)
+{
+    std::vector<std::string> sNames;
+    DIR* sDir = opendir(aPath.c_str());
+    check(sDir != nullptr, "opendir");
+    while (const struct dirent* sEnt = readdir(sDir))
+    {
+        std::string sName = sEnt->d_name;
+        if (sName != "." && sName != "..")
+            sNames.push_back(sName);
+    }
+    closedir(sDir);
+    return sNames;
+}
+
+void test_temporary_file()
+{
+    std::string sDir = "/tmp/ResolverCacheUnitTest.XXXXXX";
+    check(mkdtemp(sDir.data()) != nullptr, "mkdtemp");
+    ResolverCache sCache;
+    sCache.resolve(HOST, "80");
+
+    // The temporary file is renamed.
+    std::string sPath = sDir + "/cache";
+    sCache.save(sPath.c_str());
+    sCache.save(sPath.c_str());
+    check(listDir(sDir) == std::vector<std::string>{"cache"}, "Temporary file is left");
+
+    // And removed if the rename fails.
+    std::remove(sPath.c_str());
+    std::string sSub = sDir + "/sub";
+    check(mkdir(sSub.c_str(), 0700) == 0, "mkdir");
+    bool sThrown = false;
+    try
+    {
+        sCache.save(sSub.c_str());
+    }
+    catch (const NetException&)
+    {
+        sThrown = true;
+    }
+    check(sThrown, "Saved over a directory");
+    check(listDir(sDir) == std::vector<std::string>{"sub"}, "Temporary file is left after a failure");
+    rmdir(sSub.c_str());
+    rmdir(sDir.c_str());
+}
+
+void test_socket()
+{
+    int sListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    check(sListen >= 0, "socket");
+    struct sockaddr_in sAddr{};
+    sAddr.sin_family = AF_INET;
+    sAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t sAddrLen = sizeof(sAddr);
+    check(bind(sListen, (sockaddr*)&sAddr, sizeof(sAddr)) == 0, "bind");
+    check(listen(sListen, 16) == 0, "listen");
+    check(getsockname(sListen, (sockaddr*)&sAddr, &sAddrLen) == 0, "getsockname");
+    std::string sPort = std::to_string(ntohs(sAddr.sin_port));
+
+    ResolverCache sCache;
+    ResolverCache::install(&sCache);
+    {
+        SocketBase s1(HOST, sPort.c_str());
+        SocketBase s2(HOST, sPort.c_str());
+    }
+    ResolverCache::install(nullptr);
+    check(sCache.hits() == 1 && sCache.misses() == 1, "Sockets don't use the cache");
+    {
+        SocketBase s3(HOST, sPort.c_str());
+    }
+    check(sCache.hits() == 1 && sCache.misses() == 1, "Sockets use the cache");
+    close(sListen);
+}
+
+void test_threads()
+{
+    constexpr size_t NUM_THREADS = 8;
+    constexpr size_t NUM_RESOLVES = 1000;
+    ResolverCache sCache;
+    std::vector<std::thread> sThreads;
+    for (size_t i = 0; i < NUM_THREADS; i++)
+    {
+        sThreads.emplace_back([&sCache]()
+        {
+            for (size_t j = 0; j < NUM_RESOLVES; j++)
+                check(isLoopback(*sCache.resolve(HOST, "80")), "Wrong address");
+        });
+    }
+    for (std::thread& t : sThreads)
+        t.join();
+    check(sCache.hits() + sCache.misses() == NUM_THREADS * NUM_RESOLVES, "Wrong stats");
+    check(sCache.misses() <= NUM_THREADS, "Too many misses");
+}
+
+int main()
+{
+    try
+    {
+        test_simple();
+        test_expiry();
+        test_negative();
+        test_file();
+        test_temporary_file();
+        test_socket();
+        test_threads();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const NetException& e)
+    {
+        std::cerr << e.what() << ": " << e.how() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Well done!" << std::endl;
+}
@@ -26,65 +26,49 @@
 #include <SocketBase.hpp>
 
 #include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
-#include <iterator>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
 
 #include <NetException.hpp>
+#include <ResolverCache.hpp>
 
 namespace {
 
-class AddrInfo
+// Resolve through the installed cache, if any; the result is held while connecting.
+std::shared_ptr<const ResolverCache::Entry> resolve(const char* aAddress, const char* aPort)
 {
-public:
-    AddrInfo(const char* aAddress, const char* aPort)
-    {
-        struct addrinfo hints{};
-        hints.ai_family = AF_UNSPEC;
-        hints.ai_socktype = SOCK_STREAM;
-
-        int rc = getaddrinfo(aAddress, aPort, &hints, &m_Info);
-        if (rc != 0)
-            throw NetException("getaddrinfo failed", gai_strerror(rc));
-    }
-
-    ~AddrInfo() noexcept
-    {
-        freeaddrinfo(m_Info);
-    }
-
-    class iterator : std::iterator<std::input_iterator_tag, const struct addrinfo>
-    {
-    private:
-        using T = const struct addrinfo;
-    public:
-        T& operator*() const { return *m_Info; }
-        T* operator->() const { return m_Info; }
-        bool operator==(const iterator& aItr) { return m_Info == aItr.m_Info; }
-        bool operator!=(const iterator& aItr) { return m_Info != aItr.m_Info; }
-        iterator& operator++() { m_Info = m_Info->ai_next; return *this; }
-        iterator operator++(int) { iterator sTmp = *this; m_Info = m_Info->ai_next; return sTmp; }
-
-    private:
-        friend class AddrInfo;
-        explicit iterator(const struct addrinfo* aInfo) : m_Info(aInfo) {}
-        T *m_Info;
-    };
-
-    iterator begin() const { return iterator(m_Info); }
-    iterator end() const { return iterator(nullptr); }
-
-private:
-    struct addrinfo* m_Info;
-};
+    if (ResolverCache* sCache = ResolverCache::installed())
+        return sCache->resolve(aAddress, aPort);
+    auto sEntry = std::make_shared<const ResolverCache::Entry>(aAddress, aPort, AF_UNSPEC,
+                                                               ResolverCache::Clock::duration::zero(),
+                                                               ResolverCache::Clock::duration::zero());
+    sEntry->check();
+    return sEntry;
+}
 
 enum fail_state_t
 {
     SOCKET_FAILED,
     CONNECT_FAILED,
+    POLL_FAILED,
+    FCNTL_FAILED,
+    RCVBUF_FAILED,
+    SNDBUF_FAILED,
+    NODELAY_FAILED,
+    FASTOPEN_FAILED,
+    QUICKACK_FAILED,
     SNDTIMEO_FAILED,
     RCVTIMEO_FAILED,
     WELL_DONE
@@ -94,67 +78,265 @@ const char* fail_msg[WELL_DONE] =
     {
         "socket failed",
         "connect failed",
+        "poll failed",
+        "fcntl failed",
+        "setsockopt SO_RCVBUF failed",
+        "setsockopt SO_SNDBUF failed",
+        "setsockopt TCP_NODELAY failed",
+        "setsockopt TCP_FASTOPEN_CONNECT failed",
+        "setsockopt TCP_QUICKACK failed",
         "setsockopt SO_SNDTIMEO failed",
         "setsockopt RCVTIMEO_FAILED failed"
     };
 
-} // anonymous namespace
+using Clock = std::chrono::steady_clock;
+
+int socketError(int aFd)
+{
+    int sError = 0;
+    socklen_t sLen = sizeof(sError);
+    if (0 != getsockopt(aFd, SOL_SOCKET, SO_ERROR, &sError, &sLen))
+        return errno;
+    return sError;
+}
+
+// Set options that must be set before connect, return WELL_DONE or what has failed.
+fail_state_t setConnectOptions(int aFd, const SocketOptions& aOptions)
+{
+    int sOne = 1;
+    if (aOptions.m_RecvBufSize != 0 &&
+        0 != setsockopt(aFd, SOL_SOCKET, SO_RCVBUF, &aOptions.m_RecvBufSize, sizeof(aOptions.m_RecvBufSize)))
+        return RCVBUF_FAILED;
+    if (aOptions.m_SendBufSize != 0 &&
+        0 != setsockopt(aFd, SOL_SOCKET, SO_SNDBUF, &aOptions.m_SendBufSize, sizeof(aOptions.m_SendBufSize)))
+        return SNDBUF_FAILED;
+    if (aOptions.m_NoDelay && 0 != setsockopt(aFd, IPPROTO_TCP, TCP_NODELAY, &sOne, sizeof(sOne)))
+        return NODELAY_FAILED;
+    if (aOptions.m_FastOpen && 0 != setsockopt(aFd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &sOne, sizeof(sOne)) &&
+        errno != ENOPROTOOPT && errno != EOPNOTSUPP)
+        return FASTOPEN_FAILED;
+    return WELL_DONE;
+}
+
+// Create a non-blocking socket and start connecting. Return the socket or -1 on failure.
+int startConnect(const struct addrinfo& aInfo, const SocketOptions& aOptions, bool& aInProgress,
+                 fail_state_t& aFailState, int& aError)
+{
+    int sFd = socket(aInfo.ai_family, aInfo.ai_socktype | SOCK_NONBLOCK, aInfo.ai_protocol);
+    if (sFd < 0)
+    {
+        aFailState = SOCKET_FAILED;
+        aError = errno;
+        return -1;
+    }
+    fail_state_t sOptionFail = setConnectOptions(sFd, aOptions);
+    if (sOptionFail != WELL_DONE)
+    {
+        aFailState = sOptionFail;
+        aError = errno;
+        close(sFd);
+        return -1;
+    }
+    aInProgress = false;
+    if (0 != connect(sFd, aInfo.ai_addr, aInfo.ai_addrlen))
+    {
+        if (errno != EINPROGRESS)
+        {
+            aFailState = CONNECT_FAILED;
+            aError = errno;
+            close(sFd);
+            return -1;
+        }
+        aInProgress = true;
+    }
+    return sFd;
+}
+
+// Non-blocking mode: the first socket that has started connecting.
+int connectFirst(const struct addrinfo* aInfo, const SocketOptions& aOptions, fail_state_t& aFailState, int& aError)
+{
+    for (; aInfo != nullptr; aInfo = aInfo->ai_next)
+    {
+        bool sInProgress;
+        int sFd = startConnect(*aInfo, aOptions, sInProgress, aFailState, aError);
+        if (sFd >= 0)
+            return sFd;
+    }
+    return -1;
+}
+
+// Order of connection attempts: the family of the first address goes first and then
+// the families alternate, for instance IPv6, IPv4, IPv6, IPv6.
+std::vector<const struct addrinfo*> raceOrder(const struct addrinfo* aInfo)
+{
+    std::vector<const struct addrinfo*> sPreferred;
+    std::vector<const struct addrinfo*> sOther;
+    for (const struct addrinfo* sInfo = aInfo; sInfo != nullptr; sInfo = sInfo->ai_next)
+        (sInfo->ai_family == aInfo->ai_family ? sPreferred : sOther).push_back(sInfo);
+    std::vector<const struct addrinfo*> sRes;
+    for (size_t i = 0; i < std::max(sPreferred.size(), sOther.size()); i++)
+    {
+        if (i < sPreferred.size())
+            sRes.push_back(sPreferred[i]);
+        if (i < sOther.size())
+            sRes.push_back(sOther[i]);
+    }
+    return sRes;
+}
 
-SocketBase::SocketBase(const char* aAddress, const char* aPort, size_t aUsecTimeout)
+// Blocking mode: race connection attempts, return the connected (still non-blocking)
+// socket or -1 if all the attempts have failed or the deadline is reached.
+int connectRace(const struct addrinfo* aInfo, unsigned long aUsecTimeout, const SocketOptions& aOptions,
+                fail_state_t& aFailState, int& aError)
 {
-    size_t sCount = 0;
-    fail_state_t fail_state{};
-    for (auto sInfo : AddrInfo(aAddress, aPort))
+    const std::vector<const struct addrinfo*> sAddrs = raceOrder(aInfo);
+    const Clock::time_point sDeadline = aUsecTimeout != 0 ?
+        Clock::now() + std::chrono::microseconds(aUsecTimeout) : Clock::time_point::max();
+    std::vector<struct pollfd> sAttempts;
+    size_t sNext = 0;
+    Clock::time_point sNextStart = Clock::now();
+    int sWinner = -1;
+    while (sWinner < 0)
     {
-        ++sCount;
-        m_Fd = socket(sInfo.ai_family, sInfo.ai_socktype, sInfo.ai_protocol);
-        if (m_Fd < 0)
+        Clock::time_point sNow = Clock::now();
+        if (sNext == sAddrs.size() && sAttempts.empty())
+            break;
+        // No new attempts after the deadline.
+        if (sNow >= sDeadline)
+        {
+            aFailState = CONNECT_FAILED;
+            aError = ETIMEDOUT;
+            break;
+        }
+        if (sNext < sAddrs.size() && (sNow >= sNextStart || sAttempts.empty()))
         {
-            fail_state = SOCKET_FAILED;
+            bool sInProgress;
+            int sFd = startConnect(*sAddrs[sNext++], aOptions, sInProgress, aFailState, aError);
+            if (sFd >= 0 && !sInProgress)
+                sWinner = sFd;
+            else if (sFd >= 0)
+                sAttempts.push_back(pollfd{sFd, POLLOUT, 0});
+            // The next attempt is started at once if this one has failed.
+            sNextStart = sFd >= 0 ? sNow + std::chrono::microseconds(SocketBase::CONNECT_ATTEMPT_DELAY) : sNow;
             continue;
         }
-        if (0 != aUsecTimeout)
+
+        Clock::time_point sWakeUp = sNext < sAddrs.size() ? std::min(sNextStart, sDeadline) : sDeadline;
+        int sMsecTimeout = -1;
+        if (sWakeUp != Clock::time_point::max())
+            sMsecTimeout = std::chrono::ceil<std::chrono::milliseconds>(sWakeUp - sNow).count();
+        if (poll(sAttempts.data(), sAttempts.size(), sMsecTimeout) < 0 && errno != EINTR)
         {
-            struct timeval tv;
-            tv.tv_sec = aUsecTimeout / 1000000;
-            tv.tv_usec = aUsecTimeout % 1000000;
-            int rc = setsockopt(m_Fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
-            if (0 != rc)
+            aFailState = POLL_FAILED;
+            aError = errno;
+            break;
+        }
+        for (size_t i = 0; i < sAttempts.size() && sWinner < 0; )
+        {
+            if (sAttempts[i].revents == 0)
             {
-                close(m_Fd);
-                fail_state = SNDTIMEO_FAILED;
+                ++i;
                 continue;
             }
-            rc = setsockopt(m_Fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-            if (0 != rc)
+            int sFd = sAttempts[i].fd;
+            sAttempts.erase(sAttempts.begin() + i);
+            int sError = socketError(sFd);
+            if (sError == 0)
             {
-                close(m_Fd);
-                fail_state = RCVTIMEO_FAILED;
-                continue;
+                sWinner = sFd;
+                break;
             }
+            close(sFd);
+            aFailState = CONNECT_FAILED;
+            aError = sError;
+            sNextStart = sNow;
         }
-        if (0 != connect(m_Fd,sInfo.ai_addr, sInfo.ai_addrlen))
-        {
-            close(m_Fd);
-            fail_state = CONNECT_FAILED;
-            continue;
-        }
-        return;
     }
-    // We return on success above, only errors below.
-    // Actually report the last error happend.
-    if (0 == sCount)
+    for (const struct pollfd& sAttempt : sAttempts)
+        close(sAttempt.fd);
+    return sWinner;
+}
+
+} // anonymous namespace
+
+SocketBase::SocketBase(const char* aAddress, const char* aPort, unsigned long aUsecTimeout, mode_t aMode,
+                       const SocketOptions& aOptions)
+: SocketBase(resolve(aAddress, aPort)->get(), aUsecTimeout, aMode, aOptions)
+{
+}
+
+SocketBase::SocketBase(const struct addrinfo* aInfo, unsigned long aUsecTimeout, mode_t aMode,
+                       const SocketOptions& aOptions)
+{
+    if (aInfo == nullptr)
         throw NetException("getaddrinfo", "unxpected empty result");
+    fail_state_t fail_state = WELL_DONE;
+    int sError = 0;
+    // Non-blocking connect is finished later, the result is given by connectError.
+    if (aMode == NON_BLOCKING)
+        m_Fd = connectFirst(aInfo, aOptions, fail_state, sError);
     else
-        throw NetException(fail_msg[fail_state], errno);
+        m_Fd = connectRace(aInfo, aUsecTimeout, aOptions, fail_state, sError);
+    if (m_Fd < 0)
+        throw NetException(fail_msg[fail_state], sError);
+
+    // Errors of other attempts don't matter anymore.
+    fail_state = WELL_DONE;
+    if (aMode == BLOCKING)
+    {
+        int sFlags = fcntl(m_Fd, F_GETFL);
+        if (sFlags < 0 || 0 != fcntl(m_Fd, F_SETFL, sFlags & ~O_NONBLOCK))
+            fail_state = FCNTL_FAILED;
+    }
+    if (fail_state == WELL_DONE && 0 != aUsecTimeout)
+    {
+        struct timeval tv;
+        tv.tv_sec = aUsecTimeout / 1000000;
+        tv.tv_usec = aUsecTimeout % 1000000;
+        if (0 != setsockopt(m_Fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)))
+            fail_state = SNDTIMEO_FAILED;
+        else if (0 != setsockopt(m_Fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)))
+            fail_state = RCVTIMEO_FAILED;
+    }
+    int sOne = 1;
+    if (fail_state == WELL_DONE && aOptions.m_QuickAck &&
+        0 != setsockopt(m_Fd, IPPROTO_TCP, TCP_QUICKACK, &sOne, sizeof(sOne)))
+        fail_state = QUICKACK_FAILED;
+    m_QuickAck = aOptions.m_QuickAck;
+    if (fail_state != WELL_DONE)
+    {
+        sError = errno;
+        close(m_Fd);
+        throw NetException(fail_msg[fail_state], sError);
+    }
+}
+
+SocketBase::SocketBase(SocketBase&& a) noexcept
+: m_Fd(a.m_Fd), m_QuickAck(a.m_QuickAck)
+{
+    a.m_Fd = -1;
+}
+
+SocketBase& SocketBase::operator=(SocketBase&& a) noexcept
+{
+    SocketBase sTmp(std::move(a));
+    swap(sTmp);
+    return *this;
 }
 
 SocketBase::~SocketBase() noexcept
 {
-    close(m_Fd);
+    if (m_Fd >= 0)
+        close(m_Fd);
 }
 
 void SocketBase::swap(SocketBase& a) noexcept
 {
     std::swap(m_Fd, a.m_Fd);
+    std::swap(m_QuickAck, a.m_QuickAck);
+}
+
+int SocketBase::connectError() const
+{
+    return socketError(m_Fd);
 }
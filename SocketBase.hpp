@@ -25,24 +25,80 @@
  */
 #pragma once
 
+struct addrinfo;
+
+// TCP tuning of a client socket, see SocketBase. Everything is off by default,
+// that is the system defaults are used.
+struct SocketOptions
+{
+    // TCP_NODELAY: small segments are sent at once, without waiting for the ACK of
+    // the previous one (Nagle's algorithm). Use cork to send a request by parts.
+    bool m_NoDelay = false;
+    // TCP_FASTOPEN_CONNECT: if the server has given a TFO cookie on an earlier connection,
+    // connect completes at once and the first sent data goes with SYN, saving a round
+    // trip. Silently ignored if the kernel does not support it.
+    bool m_FastOpen = false;
+    // TCP_QUICKACK: received data is acknowledged at once, without delayed ACK. The kernel
+    // drops the mode by itself, so PlainSocket sets it again after every recv.
+    bool m_QuickAck = false;
+    // SO_RCVBUF and SO_SNDBUF in bytes (the kernel doubles them), zero for defaults.
+    // Set before connect, so that the TCP window scale matches.
+    int m_RecvBufSize = 0;
+    int m_SendBufSize = 0;
+};
+
 // Client socket for TCP communication.
-// Only blocking mode is available now.
-// Sets socket timeout for send/recv actions.
+// In blocking mode sets socket timeout for connect, send and recv actions.
+// Connection attempts to the resolved addresses are raced (RFC 8305, Happy Eyeballs):
+// the addresses are ordered alternating the address families, and if an attempt has
+// not finished in CONNECT_ATTEMPT_DELAY the next one is started in parallel (or at
+// once if it has failed). The first connected socket wins, the rest are closed.
+// In non-blocking mode connect, send and recv never wait; the socket is to be driven
+// by an event loop (see EventLoop), the connection is established when the socket
+// becomes writable, see connectError.
 struct SocketBase
 {
 public:
+    enum mode_t
+    {
+        BLOCKING,
+        NON_BLOCKING,
+    };
+
+    // Delay (microseconds) before the next connection attempt is started.
+    static constexpr unsigned long CONNECT_ATTEMPT_DELAY = 250000;
+
     // Throws NetException
-    // Sets timeout aUsecTimeout (microseconds) for send/recv unless it's zero.
-    SocketBase(const char* aAddress, const char* aPort, unsigned long aUsecTimeout = 0);
+    // Sets timeout aUsecTimeout (microseconds) for send/recv unless it's zero; in blocking
+    // mode it is also the deadline of connecting to all the addresses altogether.
+    // In non-blocking mode the connection is not raced, only the first address that
+    // accepts connect is used. Addresses are resolved through ResolverCache if it is installed.
+    // Options are applied to every connection attempt.
+    SocketBase(const char* aAddress, const char* aPort, unsigned long aUsecTimeout = 0, mode_t aMode = BLOCKING,
+               const SocketOptions& aOptions = SocketOptions());
+    // The same, but connect to one of the given list (for instance, a cached resolve result).
+    SocketBase(const struct addrinfo* aInfo, unsigned long aUsecTimeout = 0, mode_t aMode = BLOCKING,
+               const SocketOptions& aOptions = SocketOptions());
     ~SocketBase() noexcept;
 
     SocketBase(const SocketBase&) = delete;
     SocketBase& operator=(const SocketBase&) = delete;
+    // The moved-from socket is closed (fd() is -1) and can only be destroyed or assigned.
+    SocketBase(SocketBase&& a) noexcept;
+    SocketBase& operator=(SocketBase&& a) noexcept;
 
     void swap(SocketBase& a) noexcept;
 
+    // File descriptor, for instance for EventLoop.
+    int fd() const { return m_Fd; }
+    // Result of connect in non-blocking mode: errno, zero if the socket is connected.
+    // Valid when the socket becomes writable.
+    int connectError() const;
+
 protected:
     int m_Fd;
+    // TCP_QUICKACK is to be set again after receiving.
+    bool m_QuickAck = false;
 
 };
 
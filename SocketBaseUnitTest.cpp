@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <SocketBase.hpp>
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <NetException.hpp>
+#include <PlainSocket.hpp>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+using Clock = std::chrono::steady_clock;
+const auto DELAY = std::chrono::microseconds(SocketBase::CONNECT_ATTEMPT_DELAY);
+
+// Loopback address of the given family with a port.
+struct Address
+{
+    explicit Address(int aFamily)
+    {
+        m_Len = aFamily == AF_INET ? sizeof(sockaddr_in) : sizeof(sockaddr_in6);
+        if (aFamily == AF_INET)
+        {
+            auto* sAddr = reinterpret_cast<sockaddr_in*>(&m_Storage);
+            sAddr->sin_family = AF_INET;
+            sAddr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        }
+        else
+        {
+            auto* sAddr = reinterpret_cast<sockaddr_in6*>(&m_Storage);
+            sAddr->sin6_family = AF_INET6;
+            sAddr->sin6_addr = in6addr_loopback;
+        }
+    }
+    sockaddr* get() { return reinterpret_cast<sockaddr*>(&m_Storage); }
+    int family() const { return m_Storage.ss_family; }
+
+    sockaddr_storage m_Storage{};
+    socklen_t m_Len;
+};
+
+// Socket bound to a loopback address; it listens unless refusing: connecting
+// to it is refused then. If blackholed, its accept queue is filled, so that
+// connection attempts are never answered.
+struct Server
+{
+    enum kind_t
+    {
+        GOOD,
+        REFUSING,
+        BLACKHOLE,
+    };
+
+    Server(int aFamily, kind_t aKind) : m_Addr(aFamily)
+    {
+        m_Fd = socket(aFamily, SOCK_STREAM, IPPROTO_TCP);
+        check(m_Fd >= 0, "socket");
+        check(bind(m_Fd, m_Addr.get(), m_Addr.m_Len) == 0, "bind");
+        check(getsockname(m_Fd, m_Addr.get(), &m_Addr.m_Len) == 0, "getsockname");
+        if (aKind == REFUSING)
+            return;
+        check(listen(m_Fd, aKind == BLACKHOLE ? 0 : 16) == 0, "listen");
+        if (aKind == GOOD)
+            return;
+        m_Filler = socket(aFamily, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP);
+        check(m_Filler >= 0, "socket");
+        check(connect(m_Filler, m_Addr.get(), m_Addr.m_Len) == 0 || errno == EINPROGRESS, "connect");
+        struct pollfd sPoll{m_Filler, POLLOUT, 0};
+        check(poll(&sPoll, 1, 1000) == 1, "Filler is not connected");
+    }
+    ~Server()
+    {
+        close(m_Fd);
+        if (m_Filler >= 0)
+            close(m_Filler);
+    }
+
+    // Whether there's a connection to accept; it is accepted and checked with a byte.
+    bool accepted(int aClient)
+    {
+        struct pollfd sPoll{m_Fd, POLLIN, 0};
+        if (poll(&sPoll, 1, 0) != 1)
+            return false;
+        int s = accept(m_Fd, nullptr, nullptr);
+        check(s >= 0, "accept");
+        check(send(aClient, "x", 1, MSG_NOSIGNAL) == 1, "send");
+        char c = 0;
+        check(recv(s, &c, 1, 0) == 1 && c == 'x', "recv");
+        close(s);
+        return true;
+    }
+
+    Address m_Addr;
+    int m_Fd;
+    int m_Filler = -1;
+};
+
+// Resolve result that consists of the addresses of the given servers.
+struct AddrList
+{
+    explicit AddrList(const std::vector<Server*>& aServers)
+    {
+        m_Infos.resize(aServers.size());
+        for (size_t i = 0; i < aServers.size(); i++)
+        {
+            addrinfo& sInfo = m_Infos[i];
+            sInfo.ai_family = aServers[i]->m_Addr.family();
+            sInfo.ai_socktype = SOCK_STREAM;
+            sInfo.ai_protocol = IPPROTO_TCP;
+            sInfo.ai_addr = aServers[i]->m_Addr.get();
+            sInfo.ai_addrlen = aServers[i]->m_Addr.m_Len;
+            sInfo.ai_next = i + 1 < aServers.size() ? &m_Infos[i + 1] : nullptr;
+        }
+    }
+    const addrinfo* get() const { return m_Infos.data(); }
+
+    std::vector<addrinfo> m_Infos;
+};
+
+double seconds(Clock::time_point aStart)
+{
+    return std::chrono::duration<double>(Clock::now() - aStart).count();
+}
+
+double delays(Clock::time_point aStart)
+{
+    return seconds(aStart) / std::chrono::duration<double>(DELAY).count();
+}
+
+void test_simple()
+{
+    Server sGood(AF_INET, Server::GOOD);
+    SocketBase s("127.0.0.1", std::to_string(ntohs(reinterpret_cast<sockaddr_in*>(sGood.m_Addr.get())->sin_port)).c_str());
+    check((fcntl(s.fd(), F_GETFL) & O_NONBLOCK) == 0, "The socket is not blocking");
+    check(sGood.accepted(s.fd()), "Not connected");
+}
+
+// The second attempt is started after the delay and wins.
+void test_race()
+{
+    Server sDead(AF_INET, Server::BLACKHOLE);
+    Server sGood(AF_INET, Server::GOOD);
+    AddrList sList({&sDead, &sGood});
+    auto sStart = Clock::now();
+    SocketBase s(sList.get(), 10000000);
+    check(delays(sStart) >= 1, "The second attempt was started too early");
+    check(seconds(sStart) < 5, "The second attempt was started too late");
+    check((fcntl(s.fd(), F_GETFL) & O_NONBLOCK) == 0, "The socket is not blocking");
+    check(sGood.accepted(s.fd()), "Not connected");
+}
+
+// Address families alternate: the IPv4 address is tried second, and the deadline
+// comes before the third attempt.
+void test_families()
+{
+    Server sDead1(AF_INET6, Server::BLACKHOLE);
+    Server sDead2(AF_INET6, Server::BLACKHOLE);
+    Server sGood(AF_INET, Server::GOOD);
+    AddrList sList({&sDead1, &sDead2, &sGood});
+    SocketBase s(sList.get(), SocketBase::CONNECT_ATTEMPT_DELAY * 3 / 2);
+    check(sGood.accepted(s.fd()), "Not connected");
+}
+
+// A refused attempt doesn't delay the next one.
+void test_refused()
+{
+    Server sRefusing(AF_INET, Server::REFUSING);
+    Server sGood(AF_INET6, Server::GOOD);
+    AddrList sList({&sRefusing, &sGood});
+    auto sStart = Clock::now();
+    SocketBase s(sList.get(), 10000000);
+    check(delays(sStart) < 1, "The next attempt was delayed");
+    check(sGood.accepted(s.fd()), "Not connected");
+
+    AddrList sRefused({&sRefusing});
+    try
+    {
+        SocketBase sFail(sRefused.get(), 10000000);
+        check(false, "Connected to nowhere");
+    }
+    catch (const NetException& e)
+    {
+        check(std::strcmp(e.what(), "connect failed") == 0, "Wrong error");
+    }
+}
+
+// All the attempts hang, the whole connect is limited by the timeout.
+void test_timeout()
+{
+    Server sDead1(AF_INET, Server::BLACKHOLE);
+    Server sDead2(AF_INET6, Server::BLACKHOLE);
+    AddrList sList({&sDead1, &sDead2});
+    auto sStart = Clock::now();
+    try
+    {
+        SocketBase s(sList.get(), SocketBase::CONNECT_ATTEMPT_DELAY * 2);
+        check(false, "Connected to nowhere");
+    }
+    catch (const NetException& e)
+    {
+        check(std::strcmp(e.what(), "connect failed") == 0, "Wrong error");
+    }
+    check(delays(sStart) >= 2, "Timed out too early");
+    check(seconds(sStart) < 5, "Timed out too late");
+}
+
+// Non-blocking mode connects to the first address without waiting.
+void test_non_blocking()
+{
+    Server sDead(AF_INET, Server::BLACKHOLE);
+    Server sGood(AF_INET, Server::GOOD);
+    AddrList sList({&sDead, &sGood});
+    SocketBase s(sList.get(), 0, SocketBase::NON_BLOCKING);
+    check((fcntl(s.fd(), F_GETFL) & O_NONBLOCK) != 0, "The socket is blocking");
+    struct pollfd sPoll{s.fd(), POLLOUT, 0};
+    check(poll(&sPoll, 1, 0) == 0, "Connected to a blackhole");
+}
+
+int getOption(int aFd, int aLevel, int aName)
+{
+    int sValue = 0;
+    socklen_t sLen = sizeof(sValue);
+    check(getsockopt(aFd, aLevel, aName, &sValue, &sLen) == 0, "getsockopt");
+    return sValue;
+}
+
+void test_options()
+{
+    Server sGood(AF_INET, Server::GOOD);
+    AddrList sList({&sGood});
+    {
+        SocketBase s(sList.get());
+        check(getOption(s.fd(), IPPROTO_TCP, TCP_NODELAY) == 0, "Unexpected TCP_NODELAY");
+        check(sGood.accepted(s.fd()), "Not connected");
+    }
+
+    SocketOptions sOptions;
+    sOptions.m_NoDelay = true;
+    sOptions.m_FastOpen = true;
+    sOptions.m_QuickAck = true;
+    sOptions.m_RecvBufSize = 256 * 1024;
+    sOptions.m_SendBufSize = 128 * 1024;
+    for (SocketBase::mode_t sMode : {SocketBase::BLOCKING, SocketBase::NON_BLOCKING})
+    {
+        SocketBase s(sList.get(), 0, sMode, sOptions);
+        check(getOption(s.fd(), IPPROTO_TCP, TCP_NODELAY) != 0, "No TCP_NODELAY");
+        check(getOption(s.fd(), SOL_SOCKET, SO_RCVBUF) >= sOptions.m_RecvBufSize, "Wrong SO_RCVBUF");
+        check(getOption(s.fd(), SOL_SOCKET, SO_SNDBUF) >= sOptions.m_SendBufSize, "Wrong SO_SNDBUF");
+        struct pollfd sPoll{s.fd(), POLLOUT, 0};
+        check(poll(&sPoll, 1, 1000) == 1 && s.connectError() == 0, "Not connected");
+        check(sGood.accepted(s.fd()), "Not connected");
+    }
+
+    char sCache[16];
+    PlainSocket s(sCache, "127.0.0.1", std::to_string(ntohs(reinterpret_cast<sockaddr_in*>(sGood.m_Addr.get())->sin_port)).c_str(),
+                  0, PlainSocket::BLOCKING, sOptions);
+    s.cork();
+    check(getOption(s.fd(), IPPROTO_TCP, TCP_CORK) != 0, "Not corked");
+    s.uncork();
+    check(getOption(s.fd(), IPPROTO_TCP, TCP_CORK) == 0, "Not uncorked");
+    check(sGood.accepted(s.fd()), "Not connected");
+}
+
+int main()
+{
+    try
+    {
+        test_simple();
+        test_race();
+        test_families();
+        test_refused();
+        test_timeout();
+        test_non_blocking();
+        test_options();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const NetException& e)
+    {
+        std::cerr << e.what() << ": " << e.how() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Well done!" << std::endl;
+}
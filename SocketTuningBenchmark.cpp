@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <PlainSocket.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <NetException.hpp>
+
+// Benchmark of SocketOptions and cork over loopback, against a tiny HTTP-like server
+// thread that answers "GET /<size>" with a body of that size.
+// Latency: requests on one connection, each sent in two parts (the request line and
+// the headers, as a client that builds a request by parts does), for several profiles.
+// Connect: a new connection for each request, with and without TCP Fast Open
+// (that needs the cookie, i.e. net.ipv4.tcp_fastopen with both client and server bits).
+// Throughput: a large body with different socket buffer sizes.
+// Usage: SocketTuningBenchmark [--requests N] [--connects N] [--megabytes N]
+//  --requests N   number of requests of each latency profile (default 200);
+//  --connects N   number of connections of each connect profile (default 200);
+//  --megabytes N  size of the body of each throughput profile (default 1024).
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t SMALL_BODY = 100;
+const size_t CHUNK_SIZE = 1024 * 1024;
+
+std::string responseHeader(size_t aBodySize)
+{
+    return "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(aBodySize) + "\r\n\r\n";
+}
+
+void serve(int s)
+{
+    std::string sRequest;
+    std::string sChunk(CHUNK_SIZE, 'x');
+    char sBuf[4096];
+    while (true)
+    {
+        size_t sEnd = sRequest.find("\r\n\r\n");
+        if (sEnd == std::string::npos)
+        {
+            ssize_t r = recv(s, sBuf, sizeof(sBuf), 0);
+            if (r <= 0)
+                break;
+            sRequest.append(sBuf, r);
+            continue;
+        }
+        size_t sSize = std::strtoull(sRequest.c_str() + 5, nullptr, 10);
+        sRequest.erase(0, sEnd + 4);
+        std::string sHeader = responseHeader(sSize);
+        // Small responses are sent with one call.
+        if (sSize <= sChunk.size())
+            sHeader.append(sChunk, 0, sSize);
+        bool sOk = send(s, sHeader.data(), sHeader.size(), MSG_NOSIGNAL) == ssize_t(sHeader.size());
+        for (size_t sSent = sHeader.size() > sSize ? sSize : 0; sOk && sSent < sSize; sSent += sChunk.size())
+        {
+            size_t sPart = std::min(sChunk.size(), sSize - sSent);
+            sOk = send(s, sChunk.data(), sPart, MSG_NOSIGNAL) == ssize_t(sPart);
+        }
+        if (!sOk)
+            break;
+    }
+    close(s);
+}
+
+void server(int aListen)
+{
+    while (true)
+    {
+        int s = accept(aListen, nullptr, nullptr);
+        if (s < 0)
+            break;
+        std::thread(serve, s).detach();
+    }
+}
+
+struct Profile
+{
+    const char* m_Name;
+    SocketOptions m_Options;
+    bool m_Cork;
+};
+
+SocketOptions options(bool aNoDelay, bool aQuickAck, bool aFastOpen = false, int aBufSize = 0)
+{
+    SocketOptions sRes;
+    sRes.m_NoDelay = aNoDelay;
+    sRes.m_QuickAck = aQuickAck;
+    sRes.m_FastOpen = aFastOpen;
+    sRes.m_RecvBufSize = aBufSize;
+    sRes.m_SendBufSize = aBufSize;
+    return sRes;
+}
+
+// Send a request in two parts and read the response, return the time in microseconds.
+double request(PlainSocket& aSocket, bool aCork, size_t aBodySize, std::string& aBuf)
+{
+    std::string sPath = std::to_string(aBodySize);
+    auto sStart = Clock::now();
+    if (aCork)
+        aSocket.cork();
+    aSocket.sendOrDie("GET /", sPath, " HTTP/1.1\r\n");
+    aSocket.sendOrDie("Host: localhost\r\nUser-Agent: SocketTuningBenchmark\r\n\r\n");
+    if (aCork)
+        aSocket.uncork();
+    aBuf.resize(responseHeader(aBodySize).size() + aBodySize);
+    aSocket.recvOrDie(aBuf);
+    return std::chrono::duration<double, std::micro>(Clock::now() - sStart).count();
+}
+
+void report(const char* aName, std::vector<double>& aTimes)
+{
+    std::sort(aTimes.begin(), aTimes.end());
+    double sSum = 0;
+    for (double t : aTimes)
+        sSum += t;
+    std::cout << "  " << std::left << std::setw(20) << aName << std::right << std::fixed << std::setprecision(1)
+              << " avg " << std::setw(9) << sSum / aTimes.size() << " us"
+              << "   p50 " << std::setw(9) << aTimes[aTimes.size() / 2] << " us"
+              << "   p99 " << std::setw(9) << aTimes[aTimes.size() * 99 / 100] << " us" << std::endl;
+}
+
+} // namespace {
+
+int main(int argc, char** argv)
+{
+    size_t sRequests = 200;
+    size_t sConnects = 200;
+    size_t sMegabytes = 1024;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view sArg = argv[i];
+        if (sArg == "--requests" && i + 1 < argc)
+            sRequests = std::strtoul(argv[++i], nullptr, 10);
+        else if (sArg == "--connects" && i + 1 < argc)
+            sConnects = std::strtoul(argv[++i], nullptr, 10);
+        else if (sArg == "--megabytes" && i + 1 < argc)
+            sMegabytes = std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--requests N] [--connects N] [--megabytes N]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    sRequests = std::max(sRequests, size_t(1));
+    sConnects = std::max(sConnects, size_t(1));
+
+    try
+    {
+        int sListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        struct sockaddr_in sAddr{};
+        sAddr.sin_family = AF_INET;
+        sAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t sAddrLen = sizeof(sAddr);
+        if (sListen < 0 || bind(sListen, (sockaddr*)&sAddr, sizeof(sAddr)) != 0 ||
+            listen(sListen, SOMAXCONN) != 0 || getsockname(sListen, (sockaddr*)&sAddr, &sAddrLen) != 0)
+            throw std::runtime_error("failed to listen on loopback");
+        // Server side of Fast Open, it may be disabled by sysctl.
+        int sQueue = 16;
+        setsockopt(sListen, IPPROTO_TCP, TCP_FASTOPEN, &sQueue, sizeof(sQueue));
+        std::string sPort = std::to_string(ntohs(sAddr.sin_port));
+        std::thread(server, sListen).detach();
+
+        std::string sBuf;
+        char sCache[4096];
+
+        std::cout << "Latency, " << sRequests << " requests of " << SMALL_BODY << " bytes on one connection:" << std::endl;
+        const Profile LATENCY_PROFILES[] = {
+            {"default", options(false, false), false},
+            {"nodelay", options(true, false), false},
+            {"cork", options(false, false), true},
+            {"nodelay+cork", options(true, false), true},
+            {"quickack", options(false, true), false},
+            {"nodelay+quickack", options(true, true), false},
+        };
+        for (const Profile& sProfile : LATENCY_PROFILES)
+        {
+            PlainSocket s(sCache, "127.0.0.1", sPort.c_str(), 0, PlainSocket::BLOCKING, sProfile.m_Options);
+            std::vector<double> sTimes;
+            for (size_t i = 0; i < sRequests; i++)
+                sTimes.push_back(request(s, sProfile.m_Cork, SMALL_BODY, sBuf));
+            report(sProfile.m_Name, sTimes);
+        }
+
+        std::cout << "Connect and request, " << sConnects << " connections:" << std::endl;
+        const Profile CONNECT_PROFILES[] = {
+            {"nodelay+cork", options(true, false), true},
+            {"nodelay+cork+tfo", options(true, false, true), true},
+        };
+        for (const Profile& sProfile : CONNECT_PROFILES)
+        {
+            std::vector<double> sTimes;
+            for (size_t i = 0; i < sConnects; i++)
+            {
+                auto sStart = Clock::now();
+                PlainSocket s(sCache, "127.0.0.1", sPort.c_str(), 0, PlainSocket::BLOCKING, sProfile.m_Options);
+                request(s, sProfile.m_Cork, SMALL_BODY, sBuf);
+                sTimes.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sStart).count());
+            }
+            report(sProfile.m_Name, sTimes);
+        }
+
+        std::cout << "Throughput, " << sMegabytes << " MB on one connection:" << std::endl;
+        const std::pair<const char*, int> BUFFER_PROFILES[] = {
+            {"default buffers", 0},
+            {"64KB buffers", 64 * 1024},
+            {"4MB buffers", 4 * 1024 * 1024},
+        };
+        for (auto [sName, sBufSize] : BUFFER_PROFILES)
+        {
+            PlainSocket s(sCache, "127.0.0.1", sPort.c_str(), 0, PlainSocket::BLOCKING,
+                          options(true, false, false, sBufSize));
+            size_t sSize = sMegabytes * 1024 * 1024;
+            std::string sPath = std::to_string(sSize);
+            auto sStart = Clock::now();
+            s.sendOrDie("GET /", sPath, " HTTP/1.1\r\n\r\n");
+            sBuf.resize(responseHeader(sSize).size());
+            s.recvOrDie(sBuf);
+            sBuf.resize(CHUNK_SIZE);
+            for (size_t sLeft = sSize; sLeft > 0; )
+            {
+                size_t sPart = std::min(sLeft, sBuf.size());
+                s.recvOrDie(sBuf.data(), sPart);
+                sLeft -= sPart;
+            }
+            double sSeconds = std::chrono::duration<double>(Clock::now() - sStart).count();
+            std::cout << "  " << std::left << std::setw(20) << sName << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(10) << sSize / sSeconds / 1e6 << " MB/s" << std::endl;
+        }
+        shutdown(sListen, SHUT_RDWR);
+        close(sListen);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const NetException& e)
+    {
+        std::cerr << e.what() << ": " << e.how() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <UringSocket.hpp>
+
+#include <limits.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    // Sockets whose partial sends wait for a submission entry. Rings are used by one
+    // thread each, so are their sockets.
+    std::vector<UringSocket*>& pendingSockets()
+    {
+        thread_local std::vector<UringSocket*> sPending;
+        return sPending;
+    }
+} // namespace {
+
+UringSocket::UringSocket(IoUring& aRing, char* aCache, size_t aCacheSize,
+                         const char* aAddress, const char* aPort, unsigned long aUsecTimeout,
+                         mode_t aMode, const SocketOptions& aOptions)
+: PlainSocket(aCache, aCacheSize, aAddress, aPort, aUsecTimeout, aMode, aOptions), m_Ring(aRing)
+{
+}
+
+UringSocket::~UringSocket() noexcept
+{
+    if (m_Pending)
+    {
+        std::vector<UringSocket*>& sPending = pendingSockets();
+        sPending.erase(std::find(sPending.begin(), sPending.end(), this));
+    }
+}
+
+bool UringSocket::queueImpl(op_t aOp, bool aContinue)
+{
+    // Continuations of earlier operations go first.
+    if (!aContinue && !pendingSockets().empty())
+        requeue(m_Ring);
+    io_uring_sqe* sSqe = m_Ring.getSqe();
+    if (sSqe == nullptr)
+        return false;
+    m_Op = aOp;
+    if (!aContinue)
+    {
+        m_CurVec = 0;
+        m_Done = 0;
+        m_Error = 0;
+        m_ShutDown = false;
+    }
+    m_Hdr = msghdr{};
+    m_Hdr.msg_iov = m_Vecs.data() + m_CurVec;
+    m_Hdr.msg_iovlen = std::min(m_Vecs.size() - m_CurVec, size_t(IOV_MAX));
+    sSqe->opcode = aOp == OP_RECV ? IORING_OP_RECVMSG : IORING_OP_SENDMSG;
+    sSqe->fd = fd();
+    sSqe->addr = reinterpret_cast<uintptr_t>(&m_Hdr);
+    sSqe->len = 1;
+    sSqe->msg_flags = aOp == OP_SEND ? MSG_NOSIGNAL : 0;
+    sSqe->user_data = reinterpret_cast<uintptr_t>(this);
+    return true;
+}
+
+void UringSocket::complete(int aResult)
+{
+    op_t sOp = m_Op;
+    m_Op = OP_NONE;
+    if (aResult < 0)
+    {
+        m_Error = -aResult;
+        m_CurVec = 0;
+        return;
+    }
+    if (aResult == 0 && sOp == OP_RECV)
+    {
+        m_ShutDown = true;
+        m_CurVec = 0;
+        return;
+    }
+    if (sOp == OP_RECV)
+        rearmQuickAck();
+
+    // Skip done bytes in vectors, for receive count only bytes in the buffers.
+    size_t sSize = aResult;
+    while (m_CurVec < m_Vecs.size())
+    {
+        size_t sWas = sSize;
+        bool sDepleted = m_Vecs[m_CurVec].skip(sSize);
+        if (sOp == OP_SEND || m_CurVec < m_NumBuffers)
+            m_Done += sWas - sSize;
+        if (!sDepleted)
+            break;
+        ++m_CurVec;
+    }
+    if (sOp == OP_RECV)
+    {
+        // The rest is in the cache.
+        addCachedSize(aResult - m_Done);
+        m_CurVec = 0;
+        return;
+    }
+    if (m_CurVec == m_Vecs.size())
+    {
+        m_CurVec = 0;
+        return;
+    }
+    // Partial send, the rest is queued after the completions are reaped.
+    m_Op = OP_SEND;
+    m_Pending = true;
+    pendingSockets().push_back(this);
+}
+
+void UringSocket::requeue(IoUring& aRing)
+{
+    std::vector<UringSocket*>& sPending = pendingSockets();
+    auto sEnd = std::remove_if(sPending.begin(), sPending.end(), [&aRing](UringSocket* s)
+    {
+        if (&s->m_Ring != &aRing || !s->queueImpl(OP_SEND, true))
+            return false;
+        s->m_Pending = false;
+        return true;
+    });
+    sPending.erase(sEnd, sPending.end());
+}
+
+size_t UringSocket::recvResult(bool& aShutDownError)
+{
+    if (m_Error != 0)
+        throw NetException("recv failed", m_Error);
+    if (m_ShutDown)
+    {
+        if (aShutDownError)
+            throw NetException("recv failed", "peer was closed");
+        aShutDownError = true;
+    }
+    return m_Done;
+}
+
+size_t UringSocket::sendResult()
+{
+    if (m_Error != 0)
+        throw NetException("send failed", m_Error);
+    return m_Done;
+}
+
+size_t UringSocket::completeAll(IoUring& aRing)
+{
+    size_t sCount = aRing.reap([](const io_uring_cqe& aCqe)
+    {
+        reinterpret_cast<UringSocket*>(aCqe.user_data)->complete(aCqe.res);
+    });
+    if (!pendingSockets().empty())
+        requeue(aRing);
+    return sCount;
+}
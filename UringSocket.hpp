@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <IoUring.hpp>
+#include <NetException.hpp>
+#include <PlainSocket.hpp>
+
+// PlainSocket whose receiving and sending are done with io_uring (see IoUring).
+// An operation is queued to the ring as one submission entry with all its vectors:
+// for receiving these are the given buffers followed by the free space of the cache,
+// exactly as PlainSocket passes them to recvmsg. Operations of many sockets are
+// submitted with one system call and their completions are dispatched by completeAll.
+// A partial send is continued with a new entry that is queued after the completions
+// are reaped, by completeAll, or if the submission queue is full then, by the next
+// completeAll or queueRecv/queueSend of the ring (the socket stays busy meanwhile).
+// The blocking methods of PlainSocket can be used while no operation is in progress.
+// Usage:
+//  for (UringSocket& s : sSockets) s.queueRecv(); // To the cache.
+//  sRing.submit(1);
+//  UringSocket::completeAll(sRing);
+//  for (UringSocket& s : sSockets) if (!s.busy()) { s.recvResult(sShutDown); ... s.cachedData() ... }
+
+class UringSocket : public PlainSocket
+{
+public:
+    // The same arguments as of PlainSocket, options (TCP_QUICKACK too) work the same way.
+    template <size_t N>
+    UringSocket(IoUring& aRing, char (&aCache)[N],
+                const char* aAddress, const char* aPort, unsigned long aUsecTimeout = 0,
+                mode_t aMode = BLOCKING, const SocketOptions& aOptions = SocketOptions());
+    UringSocket(IoUring& aRing, char* aCache, size_t aCacheSize,
+                const char* aAddress, const char* aPort, unsigned long aUsecTimeout = 0,
+                mode_t aMode = BLOCKING, const SocketOptions& aOptions = SocketOptions());
+    ~UringSocket() noexcept;
+
+    // Queue receiving of some data (at least one byte, or shutdown) to given buffers and
+    // then to the cache; the arguments are the same as in recvSome. If buffers are given
+    // the cache must be empty (take cached data first). The buffers must stay valid
+    // until the operation is completed.
+    // Return false if the submission queue of the ring is full (submit and try again).
+    // Throws NetException if there's no room to receive to (the cache is full and
+    // there are no buffers), as recvSome does.
+    template <class ...ARGS>
+    bool queueRecv(ARGS&&... aArgs);
+    // Queue sending of all given data, the arguments are the same as in sendOrDie.
+    // Partial sends are continued automatically. The data must stay valid until
+    // the operation is completed. Return false if the submission queue is full.
+    template <class ...ARGS>
+    bool queueSend(ARGS&&... aArgs);
+
+    // Whether an operation was queued and is not completed yet.
+    bool busy() const { return m_Op != OP_NONE; }
+    // Result of the completed receive: the number of bytes received to the buffers
+    // (not to the cache). Peer shutdown is handled as in recvSome.
+    // Throws NetException if the receive failed.
+    size_t recvResult(bool& aShutDownError);
+    // Result of the completed send: the number of sent bytes. Throws NetException.
+    size_t sendResult();
+
+    // Handle the completion of the socket's operation. Doesn't queue anything, see completeAll.
+    void complete(int aResult);
+    // Handle all available completions of the ring, that must belong to UringSockets,
+    // then queue the continuations of partial sends. Return the number of handled completions.
+    static size_t completeAll(IoUring& aRing);
+
+
+    //////////////////////////////////// PRIVATE BELOW ////////////////////////////////////
+//private:
+
+    enum op_t
+    {
+        OP_NONE,
+        OP_RECV,
+        OP_SEND,
+    };
+
+    // Queue the operation with m_Vecs[m_CurVec..), a new one or the continuation
+    // of a partial send.
+    bool queueImpl(op_t aOp, bool aContinue = false);
+    // Queue the continuations of partial sends of the ring's sockets, as many as fit.
+    static void requeue(IoUring& aRing);
+
+    IoUring& m_Ring;
+    op_t m_Op = OP_NONE;
+    // Vectors of the current operation and the first of them that is not done.
+    std::vector<IOVec> m_Vecs;
+    size_t m_CurVec = 0;
+    // Number of vectors of user buffers in m_Vecs (the rest are of the cache).
+    size_t m_NumBuffers = 0;
+    msghdr m_Hdr{};
+    // Result of the operation: done bytes (to buffers for receive), errno, shutdown.
+    size_t m_Done = 0;
+    int m_Error = 0;
+    bool m_ShutDown = false;
+    // The continuation of a partial send is to be queued (the socket is in the pending list).
+    bool m_Pending = false;
+};
+
+//////////////////////////////////// IMPLEMENTATION ////////////////////////////////////
+template <size_t N>
+UringSocket::UringSocket(IoUring& aRing, char (&aCache)[N],
+                         const char* aAddress, const char* aPort, unsigned long aUsecTimeout,
+                         mode_t aMode, const SocketOptions& aOptions)
+: UringSocket(aRing, aCache, N, aAddress, aPort, aUsecTimeout, aMode, aOptions)
+{
+}
+
+template <class ...ARGS>
+bool UringSocket::queueRecv(ARGS&&... aArgs)
+{
+    auto sIVecs = makeIVec(std::forward<ARGS>(aArgs)...);
+    m_NumBuffers = sIVecs.size();
+    // Room for two vectors of the cache.
+    m_Vecs.assign(sIVecs.begin(), sIVecs.end());
+    m_Vecs.resize(m_NumBuffers + 2, IOVec(iovec{}));
+    size_t sCount = addCacheIVecs(m_Vecs.data(), m_NumBuffers);
+    m_Vecs.resize(sCount, IOVec(iovec{}));
+    if (std::all_of(m_Vecs.begin(), m_Vecs.end(), [](const IOVec& v) { return v.iov_len == 0; }))
+        throw NetException("recv failed", "not enough cache for requested operation");
+    return queueImpl(OP_RECV);
+}
+
+template <class ...ARGS>
+bool UringSocket::queueSend(ARGS&&... aArgs)
+{
+    auto sOVecs = makeOVec(std::forward<ARGS>(aArgs)...);
+    m_Vecs.assign(sOVecs.begin(), sOVecs.end());
+    m_NumBuffers = m_Vecs.size();
+    return queueImpl(OP_SEND);
+}
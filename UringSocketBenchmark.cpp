@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <UringSocket.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <NetException.hpp>
+
+// Benchmark of receiving from many connections over loopback: PlainSocket with one
+// recvmsg per read versus UringSocket with reads of all the sockets batched into one
+// io_uring_enter. A server thread floods all the connections with data; the client
+// reads to the socket caches for a given time and reports throughput and the number
+// of system calls.
+// Usage: UringSocketBenchmark [--sockets N] [--seconds S]
+//  --sockets N  number of connections (default 64);
+//  --seconds S  duration of each run (default 2).
+
+namespace {
+
+const size_t CACHE_SIZE = 64 * 1024;
+const size_t CHUNK_SIZE = 16 * 1024;
+
+struct Result
+{
+    size_t m_Bytes = 0;
+    size_t m_Syscalls = 0;
+    double m_Seconds = 0;
+};
+
+// Send chunks to all the accepted connections in turn until stopped. Sends are
+// non-blocking, so that a connection that is not read does not stall the others.
+void flood(int aListen, size_t aCount, const std::atomic<bool>& aStop)
+{
+    std::vector<int> sSockets;
+    for (size_t i = 0; i < aCount; i++)
+    {
+        int s = accept(aListen, nullptr, nullptr);
+        if (s < 0)
+            throw std::runtime_error("accept failed");
+        sSockets.push_back(s);
+    }
+    std::string sChunk(CHUNK_SIZE, 'x');
+    while (!aStop.load(std::memory_order_relaxed))
+        for (int s : sSockets)
+            send(s, sChunk.data(), sChunk.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    for (int s : sSockets)
+        close(s);
+}
+
+struct Client
+{
+    Client(IoUring& aRing, const char* aPort) : m_Socket(aRing, m_Cache, "127.0.0.1", aPort, 1000000) {}
+    char m_Cache[CACHE_SIZE];
+    UringSocket m_Socket;
+};
+
+// Take all cached data of the socket, return its size.
+size_t take(PlainSocket& aSocket)
+{
+    auto [sFirst, sSecond] = aSocket.cachedData();
+    size_t sSize = sFirst.size() + sSecond.size();
+    aSocket.dropCache(sSize);
+    return sSize;
+}
+
+template <class FUNC>
+Result run(IoUring& aRing, int aListen, const char* aPort, size_t aCount, double aSeconds, FUNC aFunc)
+{
+    std::atomic<bool> sStop{false};
+    std::thread sServer(flood, aListen, aCount, std::cref(sStop));
+    std::vector<std::unique_ptr<Client>> sClients;
+    for (size_t i = 0; i < aCount; i++)
+        sClients.emplace_back(new Client(aRing, aPort));
+
+    Result sResult;
+    auto sStart = std::chrono::steady_clock::now();
+    auto sEnd = sStart + std::chrono::duration<double>(aSeconds);
+    aFunc(sClients, sResult, [&]() { return std::chrono::steady_clock::now() >= sEnd; });
+    sResult.m_Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - sStart).count();
+
+    sStop = true;
+    sServer.join();
+    return sResult;
+}
+
+using Clients = std::vector<std::unique_ptr<Client>>;
+
+// One blocking recvmsg per socket in turn.
+template <class DONE>
+void plain(Clients& aClients, Result& aResult, DONE aDone)
+{
+    while (!aDone())
+    {
+        for (auto& c : aClients)
+        {
+            bool sShutDown = false;
+            c->m_Socket.recvSome(1, sShutDown);
+            aResult.m_Bytes += take(c->m_Socket);
+            aResult.m_Syscalls++;
+        }
+    }
+}
+
+// Reads of all the sockets are kept queued in the ring.
+template <class DONE>
+void uring(Clients& aClients, Result& aResult, DONE aDone)
+{
+    IoUring& sRing = aClients.front()->m_Socket.m_Ring;
+    size_t sEnters = sRing.numEnters();
+    bool sStop = false;
+    size_t sBusy = 0;
+    do
+    {
+        sStop = sStop || aDone();
+        for (auto& c : aClients)
+        {
+            UringSocket& s = c->m_Socket;
+            if (s.busy())
+                continue;
+            aResult.m_Bytes += take(s);
+            if (!sStop && !s.queueRecv())
+                break;
+        }
+        sBusy = 0;
+        for (auto& c : aClients)
+            sBusy += c->m_Socket.busy();
+        if (sBusy != 0)
+        {
+            sRing.submit(1);
+            UringSocket::completeAll(sRing);
+        }
+    } while (sBusy != 0);
+    aResult.m_Syscalls = sRing.numEnters() - sEnters;
+}
+
+void report(const char* aName, const Result& aResult)
+{
+    std::cout << std::left << std::setw(8) << aName << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << aResult.m_Bytes / aResult.m_Seconds / 1e6 << " MB/s"
+              << std::setw(12) << aResult.m_Syscalls / aResult.m_Seconds << " syscalls/s"
+              << std::setw(10) << (aResult.m_Syscalls != 0 ? aResult.m_Bytes / aResult.m_Syscalls : 0)
+              << " bytes/syscall" << std::endl;
+}
+
+} // namespace {
+
+int main(int argc, char** argv)
+{
+    size_t sCount = 64;
+    double sSeconds = 2;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view sArg = argv[i];
+        if (sArg == "--sockets" && i + 1 < argc)
+            sCount = std::strtoul(argv[++i], nullptr, 10);
+        else if (sArg == "--seconds" && i + 1 < argc)
+            sSeconds = std::strtod(argv[++i], nullptr);
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--sockets N] [--seconds S]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (sCount == 0)
+        sCount = 1;
+
+    try
+    {
+        int sListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        struct sockaddr_in sAddr{};
+        sAddr.sin_family = AF_INET;
+        sAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t sAddrLen = sizeof(sAddr);
+        if (sListen < 0 || bind(sListen, (sockaddr*)&sAddr, sizeof(sAddr)) != 0 ||
+            listen(sListen, SOMAXCONN) != 0 || getsockname(sListen, (sockaddr*)&sAddr, &sAddrLen) != 0)
+            throw std::runtime_error("failed to listen on loopback");
+        std::string sPort = std::to_string(ntohs(sAddr.sin_port));
+
+        IoUring sRing(sCount);
+        std::cout << sCount << " sockets, " << sSeconds << " seconds" << std::endl;
+        report("plain", run(sRing, sListen, sPort.c_str(), sCount, sSeconds,
+                            [](Clients& c, Result& r, auto d) { plain(c, r, d); }));
+        report("uring", run(sRing, sListen, sPort.c_str(), sCount, sSeconds,
+                            [](Clients& c, Result& r, auto d) { uring(c, r, d); }));
+        close(sListen);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const NetException& e)
+    {
+        std::cerr << e.what() << ": " << e.how() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
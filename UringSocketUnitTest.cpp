@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2020, Aleksandr Lyapunov
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <UringSocket.hpp>
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <NetException.hpp>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+constexpr size_t NUM_SOCKETS = 32;
+// More connections for test_pending and test_options.
+constexpr size_t NUM_CONNECTIONS = NUM_SOCKETS + 2;
+// Size of a line that is much more than socket buffers.
+constexpr size_t BULK_SIZE = 8 * 1024 * 1024;
+
+// Server side of a connection: answers each line with the same line, or with its
+// size for long lines, until the client closes the connection.
+void serve(int s)
+{
+    std::string sLine;
+    char sBuf[64 * 1024];
+    while (true)
+    {
+        ssize_t r = recv(s, sBuf, sizeof(sBuf), 0);
+        if (r <= 0)
+            break;
+        for (ssize_t i = 0; i < r; i++)
+        {
+            sLine += sBuf[i];
+            if (sBuf[i] != '\n')
+                continue;
+            std::string sAnswer = sLine.size() < 1000 ? sLine : std::to_string(sLine.size()) + "\n";
+            check(send(s, sAnswer.data(), sAnswer.size(), MSG_NOSIGNAL) == ssize_t(sAnswer.size()), "send");
+            sLine.clear();
+        }
+    }
+    close(s);
+}
+
+void server(int aListen)
+{
+    std::vector<std::thread> sThreads;
+    for (size_t i = 0; i < NUM_CONNECTIONS; i++)
+    {
+        int s = accept(aListen, nullptr, nullptr);
+        check(s >= 0, "accept");
+        sThreads.emplace_back(serve, s);
+    }
+    for (std::thread& t : sThreads)
+        t.join();
+}
+
+struct Client
+{
+    Client(IoUring& aRing, const char* aPort) : m_Socket(aRing, m_Cache, "127.0.0.1", aPort, 1000000) {}
+    char m_Cache[256];
+    UringSocket m_Socket;
+};
+
+// Wait until all the sockets complete their operations.
+void wait_all(IoUring& aRing, std::vector<std::unique_ptr<Client>>& aClients)
+{
+    auto sBusy = [&]()
+    {
+        return std::any_of(aClients.begin(), aClients.end(), [](const auto& c) { return c->m_Socket.busy(); });
+    };
+    while (sBusy())
+    {
+        aRing.submit(1);
+        UringSocket::completeAll(aRing);
+    }
+}
+
+void test_uring(IoUring& aRing, const char* aPort)
+{
+    std::vector<std::unique_ptr<Client>> sClients;
+    for (size_t i = 0; i < NUM_SOCKETS; i++)
+        sClients.emplace_back(new Client(aRing, aPort));
+
+    // Requests of all the sockets are submitted with one system call.
+    std::vector<std::string> sNumbers;
+    for (size_t i = 0; i < NUM_SOCKETS; i++)
+        sNumbers.push_back(std::to_string(i));
+    for (size_t i = 0; i < NUM_SOCKETS; i++)
+        check(sClients[i]->m_Socket.queueSend("hello ", sNumbers[i], "\n"), "queueSend");
+    size_t sEnters = aRing.numEnters();
+    check(aRing.submit() == NUM_SOCKETS, "Not all were submitted");
+    check(aRing.numEnters() == sEnters + 1, "Wrong number of system calls");
+    wait_all(aRing, sClients);
+    for (size_t i = 0; i < NUM_SOCKETS; i++)
+        check(sClients[i]->m_Socket.sendResult() == 7 + sNumbers[i].size(), "Wrong sent size");
+
+    // Answers are received to the caches.
+    for (size_t i = 0; i < NUM_SOCKETS; i++)
+    {
+        std::string sExpected = "hello " + sNumbers[i] + "\n";
+        PlainSocket& s = sClients[i]->m_Socket;
+        while (s.cachedData().first.size() < sExpected.size())
+        {
+            check(sClients[i]->m_Socket.queueRecv(), "queueRecv");
+            wait_all(aRing, sClients);
+            bool sShutDown = false;
+            check(sClients[i]->m_Socket.recvResult(sShutDown) == 0, "Received not to cache");
+            check(!sShutDown, "Unexpected shutdown");
+        }
+        check(s.cachedData().first == sExpected, "Wrong answer");
+        s.dropCache(sExpected.size());
+    }
+
+    // Receive to a buffer and then to the cache with one operation.
+    UringSocket& s = sClients[0]->m_Socket;
+    s.sendOrDie("0123456789\n");
+    char sBuf[4];
+    size_t sInBuf = 0;
+    bool sShutDown = false;
+    while (sInBuf < sizeof(sBuf))
+    {
+        check(s.queueRecv(sBuf + sInBuf, sizeof(sBuf) - sInBuf), "queueRecv");
+        wait_all(aRing, sClients);
+        sInBuf += s.recvResult(sShutDown);
+        check(sInBuf == sizeof(sBuf) || s.cachedData().first.empty(), "Cache is filled before the buffer");
+    }
+    while (s.cachedData().first.size() < 7)
+        s.recvSome(1, sShutDown);
+    check(std::string_view(sBuf, sizeof(sBuf)) == "0123", "Wrong data in the buffer");
+    check(s.cachedData().first == "456789\n", "Wrong data in the cache");
+    s.dropCache(7);
+
+    // A send that is much more than socket buffers is continued after partial sends.
+    std::string sBulk(BULK_SIZE - 1, 'x');
+    check(s.queueSend(sBulk, "\n"), "queueSend");
+    wait_all(aRing, sClients);
+    check(s.sendResult() == BULK_SIZE, "Wrong bulk sent size");
+    std::string sAnswer = std::to_string(BULK_SIZE) + "\n";
+    while (s.cachedData().first.size() < sAnswer.size())
+        s.recvSome(1, sShutDown);
+    check(s.cachedData().first == sAnswer, "Wrong bulk answer");
+    s.dropCache(sAnswer.size());
+
+    // A receive to the full cache fails as recvSome does, before taking an entry.
+    s.sendOrDie(std::string(300, 'y'), "\n");
+    while (s.cachedData().first.size() < sizeof(Client::m_Cache))
+        s.recvSome(1, sShutDown);
+    size_t sQueued = aRing.queued();
+    auto sThrows = [](auto aQueue)
+    {
+        try
+        {
+            aQueue();
+        }
+        catch (const NetException&)
+        {
+            return true;
+        }
+        return false;
+    };
+    check(sThrows([&s]() { s.queueRecv(); }), "Receive to the full cache was queued");
+    check(sThrows([&s, &sBuf]() { s.queueRecv(sBuf, 0); }), "Receive to nowhere was queued");
+    check(!s.busy() && aRing.queued() == sQueued, "Failed receive took an entry");
+}
+
+// A partial send whose continuation doesn't fit in the submission queue is continued
+// when an entry is free.
+void test_pending(const char* aPort)
+{
+    IoUring sRing(1);
+    Client c(sRing, aPort);
+    UringSocket& s = c.m_Socket;
+
+    // The queue is taken by an entry of another user, when the send of the first
+    // 3 bytes of the data completes.
+    io_uring_sqe* sNop = sRing.getSqe();
+    check(sNop != nullptr && sRing.getSqe() == nullptr, "The queue must be full");
+    sNop->opcode = IORING_OP_NOP;
+    const std::string_view sData = "pending\n";
+    auto sOVecs = makeOVec(sData);
+    s.m_Vecs.assign(sOVecs.begin(), sOVecs.end());
+    s.m_NumBuffers = s.m_Vecs.size();
+    s.m_Op = UringSocket::OP_SEND;
+    s.complete(3);
+    check(s.busy() && s.m_Pending && sRing.queued() == 1, "The continuation must wait");
+    UringSocket::completeAll(sRing);
+    check(s.m_Pending, "The continuation must wait for a free entry");
+
+    // The entry is submitted and completed, nothing else is done.
+    size_t sEnters = sRing.numEnters();
+    check(sRing.submit(1) == 1, "Not submitted");
+    check(sRing.reap([](const io_uring_cqe&) {}) == 1, "Not completed");
+    check(sRing.numEnters() == sEnters + 1, "Wrong number of system calls");
+
+    check(UringSocket::completeAll(sRing) == 0, "Nothing must be completed");
+    check(!s.m_Pending && sRing.queued() == 1, "The continuation was not queued");
+    while (s.busy())
+    {
+        sRing.submit(1);
+        UringSocket::completeAll(sRing);
+    }
+    check(s.sendResult() == sData.size(), "Wrong sent size of the continued send");
+    bool sShutDown = false;
+    while (s.cachedData().first.size() < 5)
+        s.recvSome(1, sShutDown);
+    check(s.cachedData().first == "ding\n", "Wrong answer to the continued send");
+}
+
+int sockOpt(int aFd, int aLevel, int aName)
+{
+    int sValue = 0;
+    socklen_t sLen = sizeof(sValue);
+    check(getsockopt(aFd, aLevel, aName, &sValue, &sLen) == 0, "getsockopt");
+    return sValue;
+}
+
+// Options are applied as by PlainSocket, TCP_QUICKACK is set again after a receive.
+void test_options(IoUring& aRing, const char* aPort)
+{
+    SocketOptions sOptions;
+    sOptions.m_NoDelay = true;
+    sOptions.m_QuickAck = true;
+    char sCache[256];
+    UringSocket s(aRing, sCache, "127.0.0.1", aPort, 1000000, UringSocket::BLOCKING, sOptions);
+    check(sockOpt(s.fd(), IPPROTO_TCP, TCP_NODELAY) != 0, "TCP_NODELAY is not set");
+    check(sockOpt(s.fd(), IPPROTO_TCP, TCP_QUICKACK) != 0, "TCP_QUICKACK is not set");
+
+    // As if the kernel has dropped the mode.
+    int sZero = 0;
+    check(setsockopt(s.fd(), IPPROTO_TCP, TCP_QUICKACK, &sZero, sizeof(sZero)) == 0, "setsockopt");
+    check(sockOpt(s.fd(), IPPROTO_TCP, TCP_QUICKACK) == 0, "TCP_QUICKACK is not dropped");
+    s.sendOrDie("quick\n");
+    while (s.cachedData().first.size() < 6)
+    {
+        check(s.queueRecv(), "queueRecv");
+        while (s.busy())
+        {
+            aRing.submit(1);
+            UringSocket::completeAll(aRing);
+        }
+        bool sShutDown = false;
+        s.recvResult(sShutDown);
+    }
+    check(s.cachedData().first == "quick\n", "Wrong answer with options");
+    check(sockOpt(s.fd(), IPPROTO_TCP, TCP_QUICKACK) != 0, "TCP_QUICKACK is not set again");
+}
+
+int main()
+{
+    try
+    {
+        int sListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        check(sListen >= 0, "socket");
+        struct sockaddr_in sAddr{};
+        sAddr.sin_family = AF_INET;
+        sAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t sAddrLen = sizeof(sAddr);
+        check(bind(sListen, (sockaddr*)&sAddr, sizeof(sAddr)) == 0, "bind");
+        check(listen(sListen, SOMAXCONN) == 0, "listen");
+        check(getsockname(sListen, (sockaddr*)&sAddr, &sAddrLen) == 0, "getsockname");
+        std::string sPort = std::to_string(ntohs(sAddr.sin_port));
+
+        // io_uring may be not available (old kernel, seccomp in a container), that is not an error.
+        std::unique_ptr<IoUring> sRing;
+        try
+        {
+            sRing.reset(new IoUring(64));
+        }
+        catch (const NetException& e)
+        {
+            std::cout << "io_uring is not available (" << e.what() << ": " << e.how() << "), skipped" << std::endl;
+        }
+        if (sRing != nullptr)
+        {
+            std::thread srv(server, sListen);
+            test_uring(*sRing, sPort.c_str());
+            test_pending(sPort.c_str());
+            test_options(*sRing, sPort.c_str());
+            srv.join();
+        }
+        close(sListen);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const NetException& e)
+    {
+        std::cerr << e.what() << ": " << e.how() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Well done!" << std::endl;
+}